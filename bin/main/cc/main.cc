@@ -82,6 +82,30 @@ namespace mdl {
       Matrix m = examples();
     }
   }
+
+  void doConvolutionTest(size_t count) {
+    std::cout << "Convolving..." << std::endl;
+    Conv2DShape shape{16, 32, 32, 3, 3, 1, 1};
+    Matrix images = Matrices::Normal(64, 16 * 32 * 32, 1);
+    Matrix filters = Matrices::Normal(32, 16 * 3 * 3, 2);
+    Pool2DShape pool{32, 32, 32, 2, 2};
+    auto g = profiler::probe("Convolution Loop");
+    for (size_t i = 0; i < count; i++) {
+      Matrix features;
+      {
+        auto g = profiler::probe("Conv2D");
+        features = Conv2D(images, filters, shape);
+      }
+      {
+        auto g = profiler::probe("Conv2DBackward");
+        Conv2DBackward(images, filters, features, shape);
+      }
+      {
+        auto g = profiler::probe("MaxPool2D");
+        MaxPool2D(features, pool);
+      }
+    }
+  }
 }
 
 int main() {
@@ -91,6 +115,7 @@ int main() {
     mdl::doTransposeTest(1000);
     // mdl::doAddittionTest(10000);
     // mdl::doSliceToMatrixTest(1000);
+    // mdl::doConvolutionTest(100);
   }
   std::ofstream out("prof-report.xml");
   mdl::profiler::save(out);
@@ -67,8 +67,7 @@ where:
     if (!fileName) { return std::string(); }
 
     auto tempFile = std::filesystem::path(fileName);
-    return tempFile.parent_path().string() 
-        + "/." + tempFile.filename().c_str() + ".tmp";
+    return (tempFile.parent_path() / ("." + tempFile.filename().string() + ".tmp")).string();
   }
 
   int Main(const char** args, int argc) {
@@ -89,21 +88,24 @@ where:
 
     std::string tempFileName = GetTemporaryFileName(outputFileName);
     auto toAppendStream = FromMtxStream(&std::cin);
-    std::unique_ptr<Matrix> mat;
     std::function<std::unique_ptr<Matrix>()> outStream = []() { return std::unique_ptr<Matrix>(); };
     auto path = std::filesystem::path(outputFileName);
+    MtxCompression compression = MtxCompression::kNone;
     if (std::filesystem::exists(path)) {
       outStream = FromMtxStream(outputFileName);
+      compression = MtxCompressionOf(outputFileName);
     }
 
-    SaveMtx(tempFileName.c_str(), [&toAppendStream, &mat, &outStream]() -> const Matrix* {
-      mat = outStream();
-      if (mat) {
-        return mat.get();
-      }
-      mat = toAppendStream();
-      return mat.get();
-    });    
+    // see push
+    MtxWriter writer(tempFileName.c_str(),
+        {.compression = compression, .background = true, .sync = true});
+    for (auto mat = outStream(); mat; mat = outStream()) {
+      writer.Write(std::move(*mat));
+    }
+    for (auto mat = toAppendStream(); mat; mat = toAppendStream()) {
+      writer.Write(std::move(*mat));
+    }
+    writer.Close();
 
     std::filesystem::rename(tempFileName, outputFileName);
 
@@ -26,6 +26,7 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <fstream>
 #include <iostream>
 #include <memory>
 
@@ -46,6 +47,7 @@ namespace cat {
   bool csv = false;
   bool help = false;
   bool raw = false;
+  bool compress = false;
   bool sizesOnly = false;
   math::size_t fr = 0;
   math::size_t fc = 0;
@@ -66,6 +68,8 @@ where:
   --col      Outputs a specific column. Equivalent to --fc <col> --tc <col + 1>
   --csv      Outputs in csv format
   --raw      Outputs in raw format (e.g. binary MTX representation)
+  --compress Compresses raw output (block shuffle + LZ). Compressed input is always
+             read transparently
   -s,--sizes Prints matrix sizes only 
   --help     Prints this mesage
 )" << std::endl;
@@ -78,6 +82,7 @@ where:
     opts.AddOption("tr", Assign(&tr, ParseInt));
     opts.AddOption("tc", Assign(&tc, ParseInt));
     opts.AddOption("raw", Assign(&raw, true));
+    opts.AddOption("compress", Assign(&compress, true));
     opts.AddOption("csv", Assign(&csv, true));
     opts.AddOption("row", [](const char* val) {
       int row = ParseInt(val);
@@ -94,6 +99,58 @@ where:
     return opts.Parse(args, argc);
   }
 
+  // Regular files are read with MtxReader, which only fetches the cells in range (and, for sizes, no
+  //   cells at all), so peeking at a few rows of a huge matrix is instant.
+  void CatFile(MtxCompression compression) {
+    MtxReader reader(inputFile);
+    size_t numMatrices = reader.NumMatrices();
+    size_t idx = 0;
+
+    if (sizesOnly) {
+      auto sizes = [&reader](size_t index) {
+        return std::make_pair(
+            Range(fr, tr).FitToBounds(reader.NumRows(index)).Length(),
+            Range(fc, tc).FitToBounds(reader.NumCols(index)).Length());
+      };
+
+      if (raw) {
+        Matrix mat(1, 2);
+        SaveMtx(std::cout, [&]() -> const Matrix* {
+          if (idx == numMatrices) { return nullptr; }
+          auto [rows, cols] = sizes(idx++);
+          mat(0, 0) = rows;
+          mat(0, 1) = cols;
+          return &mat;
+        }, compression);
+      } else {
+        for (; idx < numMatrices; idx++) {
+          auto [rows, cols] = sizes(idx);
+          if (csv) {
+            std::cout << rows << "," << cols << std::endl;
+          } else {
+            std::cout << rows << " x " << cols << std::endl;
+          }
+        }
+      }
+    } else if (raw) {
+      Matrix mat;
+      SaveMtx(std::cout, [&]() -> const Matrix* {
+        if (idx == numMatrices) { return nullptr; }
+        mat = reader.Read(idx++, Range(fr, tr), Range(fc, tc));
+        return &mat;
+      }, compression);
+    } else {
+      for (; idx < numMatrices; idx++) {
+        Matrix matrix = reader.Read(idx, Range(fr, tr), Range(fc, tc));
+        if (csv) {
+          SaveCsv(std::cout, matrix);
+        } else {
+          std::cout << matrix << std::endl;
+        }
+      }
+    }
+  }
+
   int Main(const char** args, int argc) {
     if (!ParseArgs(args, argc)) {
       return 1;
@@ -109,11 +166,27 @@ where:
       return 2;
     }
 
+    if (compress && !raw) {
+      std::cerr << "error: 'compress' requires 'raw'" << std::endl;
+      return 2;
+    }
+    MtxCompression compression = compress ? MtxCompression::kShuffleLZ : MtxCompression::kNone;
+
+    if (inputFile && MtxReader::IsSeekable(inputFile)) {
+      CatFile(compression);
+      return 0;
+    }
+
+    // stdin, and pipes, FIFOs or <(...) given as the file, are streamed instead
+    std::ifstream file;
+    if (inputFile) {
+      file.open(inputFile, std::ios_base::binary);
+    }
+    std::istream& in = inputFile ? file : std::cin;
+
     if (sizesOnly) {
       if (raw) {
-        std::function<std::unique_ptr<Matrix> ()> stream = inputFile
-            ? FromMtxStream(inputFile)
-            : FromMtxStream(&std::cin);
+        auto stream = FromMtxStream(&in);
         Matrix mat(1, 2);
         SaveMtx(std::cout, [&stream, &mat]() -> const Matrix* {
           auto pMatrix = stream();
@@ -122,7 +195,7 @@ where:
           mat(0, 0) = slice.NumRows();
           mat(0, 1) = slice.NumCols();
           return &mat;
-        });
+        }, compression);
       } else {
         auto consumer = [](Matrix&& matrix) {
           auto slice = matrix(Range(fr, tr), Range(fc, tc));
@@ -134,24 +207,18 @@ where:
           return true;
         };
 
-        if (inputFile) {
-          FromMtx(inputFile, consumer);
-        } else {
-          FromMtx(std::cin, consumer);
-        }
+        FromMtx(in, consumer);
       }
     } else {    // !sizesOnly
       if (raw) {
-        std::function<std::unique_ptr<Matrix> ()> stream = inputFile
-            ? FromMtxStream(inputFile)
-            : FromMtxStream(&std::cin);
+        auto stream = FromMtxStream(&in);
         Matrix mat;
         SaveMtx(std::cout, [&stream, &mat]() -> const Matrix* {
           auto pMatrix = stream();
           if (!pMatrix) { return nullptr; }
           mat = (*pMatrix)(Range(fr, tr), Range(fc, tc));
           return &mat;
-        });
+        }, compression);
       } else {
         auto consumer = [](Matrix&& matrix) {
           if (csv) {
@@ -162,11 +229,7 @@ where:
           return true;
         };
 
-        if (inputFile) {
-          FromMtx(inputFile, consumer);
-        } else {
-          FromMtx(std::cin, consumer);
-        }
+        FromMtx(in, consumer);
       }
     }
 
@@ -91,11 +91,21 @@ where:
 
     Matrix matrix;
     bool empty = true;
-    FromMtx(intputFileName, [&matrix, &empty](Matrix&& mat) {
-      matrix = std::move(mat);
-      empty = false;
-      return false;
-    });
+    if (MtxReader::IsSeekable(intputFileName)) {
+      // only the head's bytes are read
+      MtxReader reader(intputFileName);
+      empty = !reader.Contains(0);
+      if (!empty) {
+        matrix = reader.Read(0);
+      }
+    } else {
+      // pipes, FIFOs and <(...) can't be seeked, so they're streamed up to the head
+      FromMtx(intputFileName, [&matrix, &empty](Matrix&& mat) {
+        matrix = std::move(mat);
+        empty = false;
+        return false;
+      });
+    }
 
     if (raw) {
       if (empty) {
@@ -67,6 +67,32 @@ where:
     return opts.Parse(args, argc);
   }
 
+  std::string GetTemporaryFileName(const char* fileName) {
+    auto tempFile = std::filesystem::path(fileName);
+    return (tempFile.parent_path() / ("." + tempFile.filename().string() + ".tmp")).string();
+  }
+
+  // Removes the first matrix from the file and returns it (null if the file has none).
+  std::unique_ptr<Matrix> PopFile(const char* fileName) {
+    // The rest is written to a temporary file first: truncating the input while it's still being
+    //   read would lose whatever wasn't buffered yet.
+    std::string tempFileName = GetTemporaryFileName(fileName);
+    auto stream = FromMtxStream(fileName);
+    std::unique_ptr<Matrix> popped = stream();
+    // the file keeps its compression
+    MtxCompression compression = MtxCompressionOf(fileName);
+
+    MtxWriter writer(tempFileName.c_str(),
+        {.compression = compression, .background = true, .sync = true});
+    for (auto mat = stream(); mat; mat = stream()) {
+      writer.Write(std::move(*mat));
+    }
+    writer.Close();
+
+    std::filesystem::rename(tempFileName, fileName);
+    return popped;
+  }
+
   int Main(const char** args, int argc) {
     if (!ParseArgs(args, argc)) {
       PrintUsage();
@@ -88,19 +114,7 @@ where:
       return 3;
     }
 
-    std::unique_ptr<Matrix> popped;
-    std::unique_ptr<Matrix> mat;
-    int idx = 0;
-    auto stream = FromMtxStream(inputFileName);
-
-    SaveMtx(inputFileName, [&popped, &idx, &stream, &mat]() {
-      if (idx == 0) {
-        popped = stream();
-        idx++;
-      }
-      mat = stream();
-      return mat.get();
-    });
+    std::unique_ptr<Matrix> popped = PopFile(inputFileName);
 
     if (raw) {
       if (!popped) {
@@ -67,8 +67,7 @@ where:
     if (!fileName) { return std::string(); }
 
     auto tempFile = std::filesystem::path(fileName);
-    return tempFile.parent_path().string() 
-        + "/." + tempFile.filename().c_str() + ".tmp";
+    return (tempFile.parent_path() / ("." + tempFile.filename().string() + ".tmp")).string();
   }
 
   int Main(const char** args, int argc) {
@@ -89,21 +88,26 @@ where:
 
     std::string tempFileName = GetTemporaryFileName(outputFileName);
     auto toPushStream = FromMtxStream(&std::cin);
-    std::unique_ptr<Matrix> mat;
     std::function<std::unique_ptr<Matrix>()> outputStream = []() { return std::unique_ptr<Matrix>(); };
     auto path = std::filesystem::path(outputFileName);
+    // the file keeps its compression
+    MtxCompression compression = MtxCompression::kNone;
     if (std::filesystem::exists(path)) {
       outputStream = FromMtxStream(outputFileName);
+      compression = MtxCompressionOf(outputFileName);
     }
 
-    SaveMtx(tempFileName.c_str(), [&toPushStream, &mat, &outputStream]() -> const Matrix* {
-      mat = toPushStream();
-      if (mat) {
-        return mat.get();
-      }
-      mat = outputStream();
-      return mat.get();
-    });    
+    // matrices are handed off to the writer's thread, which writes them while the next ones are
+    //   read; synced, so the rename never exposes a partially written file
+    MtxWriter writer(tempFileName.c_str(),
+        {.compression = compression, .background = true, .sync = true});
+    for (auto mat = toPushStream(); mat; mat = toPushStream()) {
+      writer.Write(std::move(*mat));
+    }
+    for (auto mat = outputStream(); mat; mat = outputStream()) {
+      writer.Write(std::move(*mat));
+    }
+    writer.Close();
 
     std::filesystem::rename(tempFileName, outputFileName);
 
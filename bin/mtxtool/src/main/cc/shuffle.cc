@@ -78,8 +78,7 @@ where:
     }
 
     auto tempFile = std::filesystem::path(fileName);
-    return tempFile.parent_path().string() 
-        + "/." + tempFile.filename().c_str() + ".tmp";
+    return (tempFile.parent_path() / ("." + tempFile.filename().string() + ".tmp")).string();
   }
 
   int Main(const char** args, int argc) {
@@ -117,7 +116,13 @@ where:
     };
 
     if (inputFileName) {
-      SaveMtx(outputFileName.c_str(), supplier);
+      // the file keeps its compression
+      MtxWriter writer(outputFileName.c_str(),
+          {.compression = MtxCompressionOf(inputFileName), .background = true, .sync = true});
+      for (Matrix* matrix = supplier(); matrix; matrix = supplier()) {
+        writer.Write(std::move(*matrix));
+      }
+      writer.Close();
       std::filesystem::rename(outputFileName, inputFileName);
     } else {
       SaveMtx(std::cout, supplier);
@@ -91,11 +91,22 @@ where:
 
     Matrix matrix;
     bool empty = true;
-    FromMtx(intputFileName, [&matrix, &empty](Matrix&& mat) {
-      matrix = std::move(mat);
-      empty = false;
-      return true;
-    });
+    if (MtxReader::IsSeekable(intputFileName)) {
+      // skips over every matrix but the last one, without reading them
+      MtxReader reader(intputFileName);
+      size_t numMatrices = reader.NumMatrices();
+      empty = numMatrices == 0;
+      if (!empty) {
+        matrix = reader.Read(numMatrices - 1);
+      }
+    } else {
+      // pipes, FIFOs and <(...) can't be seeked, so every matrix is streamed through
+      FromMtx(intputFileName, [&matrix, &empty](Matrix&& mat) {
+        matrix = std::move(mat);
+        empty = false;
+        return true;
+      });
+    }
 
     if (raw) {
       if (empty) {
@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <memory>
+
+#include <mdl/matrix.h>
+
+namespace mdl {
+namespace math {
+namespace tools {
+  namespace pop {
+    std::unique_ptr<Matrix> PopFile(const char* fileName);
+  }
+
+  TEST(PopTest, TestPopRelativeFileName) {
+    auto dir = std::filesystem::temp_directory_path() / "PopTest.TestPopRelativeFileName";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    auto cwd = std::filesystem::current_path();
+    std::filesystem::current_path(dir);
+
+    Matrix first = Matrices::Sequence(2, 3, Range(1));
+    Matrix second = Matrices::Ones(4, 1);
+    SaveMtx("data.mtx", [&first, &second, idx = 0]() mutable -> const Matrix* {
+      switch (idx++) {
+        case 0: return &first;
+        case 1: return &second;
+        default: return nullptr;
+      }
+    });
+
+    std::unique_ptr<Matrix> popped = pop::PopFile("data.mtx");
+    std::filesystem::current_path(cwd);
+
+    ASSERT_TRUE(popped);
+    ASSERT_TRUE(first.Equals(*popped));
+    // the temporary file sits next to the input, not at the filesystem root, and is renamed over it
+    ASSERT_FALSE(std::filesystem::exists(dir / ".data.mtx.tmp"));
+    auto stream = FromMtxStream((dir / "data.mtx").c_str());
+    std::unique_ptr<Matrix> rest = stream();
+    ASSERT_TRUE(rest);
+    ASSERT_TRUE(second.Equals(*rest));
+    ASSERT_FALSE(stream());
+
+    std::filesystem::remove_all(dir);
+  }
+} // namespace tools
+} // namespace math
+} // namespace mdl
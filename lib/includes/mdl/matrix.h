@@ -33,6 +33,19 @@
 #include "../../src/lib/h/basematrix_operator_overload.h"
 #include "../../src/lib/h/matrix_operator_overload.h"
 #include "../../src/lib/h/functions.h"
+#include "../../src/lib/h/linalg.h"
 #include "../../src/lib/h/metal/engine.h"
+#include "../../src/lib/h/minibatch_loader.h"
+#include "../../src/lib/h/stats.h"
+#include "../../src/lib/h/async.h"
+#include "../../src/lib/h/graph.h"
+#include "../../src/lib/h/convolution.h"
+#include "../../src/lib/h/parameter_arena.h"
+#include "../../src/lib/h/optimizers.h"
+#include "../../src/lib/h/mtx_writer.h"
+#include "../../src/lib/h/mtx_reader.h"
+#include "../../src/lib/h/mask.h"
+#include "../../src/lib/h/distances.h"
+#include "../../src/lib/h/mtx_multiply.h"
 
 #endif // _MDL_MATRIX
\ No newline at end of file
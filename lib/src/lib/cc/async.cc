@@ -0,0 +1,135 @@
+#include "../h/async.h"
+
+#include <atomic>
+
+#include <mdl/concurrent.h>
+
+#include "../h/functions.h"
+#include "../h/matrix_operator_overload.h"
+#include "../h/multithread/helper.h"
+
+namespace mdl {
+namespace math {
+
+  namespace async {
+    namespace {
+      mdl::concurrent::ThreadFactory factory("async");
+      mdl::concurrent::ExecutorService executor(multithread::kNumKernels, factory);
+    }
+
+    void Submit(std::function<void ()> task) {
+      executor.Submit([task]() {
+        task();
+        return 0;
+      });
+    }
+
+    bool StateBase::IsReady() const {
+      std::lock_guard<std::mutex> lock(mutex);
+      return ready;
+    }
+
+    void StateBase::Wait() const {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [this] { return ready; });
+    }
+
+    std::exception_ptr StateBase::GetError() const {
+      std::lock_guard<std::mutex> lock(mutex);
+      return error;
+    }
+
+    bool StateBase::AddContinuation(std::function<void ()> fn) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (ready) {
+        return false;
+      }
+      continuations.push_back(std::move(fn));
+      return true;
+    }
+
+    void StateBase::OnReady(std::function<void ()> fn) {
+      if (!AddContinuation(fn)) {
+        fn();
+      }
+    }
+
+    void StateBase::SetError(std::exception_ptr error) {
+      Complete(error);
+    }
+
+    void StateBase::Complete(std::exception_ptr error) {
+      std::vector<std::function<void ()>> toRun;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready = true;
+        this->error = error;
+        toRun.swap(continuations);
+      }
+      cv.notify_all();
+
+      // outside the lock: continuations may complete (or wait on) other states
+      for (auto& continuation : toRun) {
+        continuation();
+      }
+    }
+
+    void StateBase::WaitAndCheck() const {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [this] { return ready; });
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+
+    void WhenAll(
+        const std::vector<std::shared_ptr<StateBase>>& dependencies,
+        std::function<void (std::exception_ptr)> done) {
+      if (dependencies.empty()) {
+        done(nullptr);
+        return;
+      }
+
+      struct Join {
+        std::atomic<int> pending;
+        std::mutex mutex;
+        std::exception_ptr error;
+      };
+      auto join = std::make_shared<Join>();
+      join->pending = dependencies.size();
+
+      for (const auto& dependency : dependencies) {
+        StateBase* state = dependency.get();
+        dependency->OnReady([join, state, done]() {
+          std::exception_ptr error = state->GetError();
+          if (error) {
+            std::lock_guard<std::mutex> lock(join->mutex);
+            if (!join->error) {
+              join->error = error;
+            }
+          }
+          if (--join->pending == 0) {
+            done(join->error);
+          }
+        });
+      }
+    }
+  }
+
+  AsyncHandle<Matrix> MultiplyAsync(
+      const Matrix& matrix1, const Matrix& matrix2, const std::vector<AsyncDependency>& after) {
+    return RunAsync([&matrix1, &matrix2]() { return matrix1 * matrix2; }, after);
+  }
+
+  AsyncHandle<Matrix> MultiplyAsync(
+      const AsyncHandle<Matrix>& matrix1, const AsyncHandle<Matrix>& matrix2) {
+    return OperateAsync(
+        [](const Matrix& m1, const Matrix& m2) { return m1 * m2; }, matrix1, matrix2);
+  }
+
+  AsyncHandle<std::vector<Matrix>> FromMtxAsync(const std::string& fileName) {
+    return RunAsync([fileName]() { return FromMtx(fileName.c_str()); });
+  }
+
+} // math
+} // mdl
@@ -1,12 +1,107 @@
 #include "../h/basematrix.h"
 
 #include "../h/misc.h"
+#include "../h/multithread/helper.h"
+
+#include <cstdint>
+#include <cstring>
 
 namespace mdl {
 namespace math {
 
+  namespace {
+    const size_t kCopyTileSize = 32;
+
+    // Address interval [first, last] (in units of float_t) covered by a rows x cols region.
+    void GetExtent(
+        const MemoryLayout& layout, 
+        size_t rows, 
+        size_t cols, 
+        std::intptr_t& first, 
+        std::intptr_t& last) {
+      std::intptr_t base = reinterpret_cast<std::intptr_t>(layout.data) / sizeof(float_t);
+      std::intptr_t rowSpan = (rows - 1) * layout.rowStride;
+      std::intptr_t colSpan = (cols - 1) * layout.colStride;
+      first = base + std::min<std::intptr_t>(0, rowSpan) + std::min<std::intptr_t>(0, colSpan);
+      last = base + std::max<std::intptr_t>(0, rowSpan) + std::max<std::intptr_t>(0, colSpan);
+    }
+
+    void CopyBlock(
+        const MemoryLayout& dst, 
+        const MemoryLayout& src, 
+        size_t frow, 
+        size_t trow, 
+        size_t fcol, 
+        size_t tcol) {
+      if (dst.colStride == 1 && src.colStride == 1) {
+        // both row-contiguous
+        for (size_t row = frow; row < trow; row++) {
+          std::memcpy(
+              dst.data + row * dst.rowStride + fcol, 
+              src.data + row * src.rowStride + fcol, 
+              (tcol - fcol) * sizeof(float_t));
+        }
+      } else if (dst.colStride == 1 && src.rowStride == 1) {
+        // transposed source: walk tiles so both reads and writes stay in cache
+        for (size_t row0 = frow; row0 < trow; row0 += kCopyTileSize) {
+          size_t row1 = std::min(trow, row0 + kCopyTileSize);
+          for (size_t col0 = fcol; col0 < tcol; col0 += kCopyTileSize) {
+            size_t col1 = std::min(tcol, col0 + kCopyTileSize);
+            for (size_t row = row0; row < row1; row++) {
+              float_t * dRunner = dst.data + row * dst.rowStride;
+              const float_t * sRunner = src.data + row;
+              for (size_t col = col0; col < col1; col++) {
+                dRunner[col] = sRunner[col * src.colStride];
+              }
+            }
+          }
+        }
+      } else {
+        // general strided gather/scatter
+        std::ptrdiff_t dColStride = dst.colStride;
+        std::ptrdiff_t sColStride = src.colStride;
+        for (size_t row = frow; row < trow; row++) {
+          float_t * dRunner = dst.data + row * dst.rowStride;
+          const float_t * sRunner = src.data + row * src.rowStride;
+          for (size_t col = fcol; col < tcol; col++) {
+            dRunner[col * dColStride] = sRunner[col * sColStride];
+          }
+        }
+      }
+    }
+  }
+
+  bool MemoryLayout::Overlaps(const MemoryLayout& other, size_t rows, size_t cols) const {
+    if (rows <= 0 || cols <= 0) { return false; }
+
+    std::intptr_t first1, last1, first2, last2;
+    GetExtent(*this, rows, cols, first1, last1);
+    GetExtent(other, rows, cols, first2, last2);
+    if (last1 < first2 || last2 < first1) { return false; }
+
+    // Common case: two row-major blocks of the same parent matrix (e.g. different columns of the 
+    //   same rows). These overlap only if both their row and column intervals intersect.
+    if (rowStride == other.rowStride && rowStride > 0 && colStride == 1 && other.colStride == 1) {
+      std::intptr_t base1 = reinterpret_cast<std::intptr_t>(data) / sizeof(float_t);
+      std::intptr_t base2 = reinterpret_cast<std::intptr_t>(other.data) / sizeof(float_t);
+      std::intptr_t origin = std::min(base1, base2);
+      std::intptr_t row1 = (base1 - origin) / rowStride, col1 = (base1 - origin) % rowStride;
+      std::intptr_t row2 = (base2 - origin) / rowStride, col2 = (base2 - origin) % rowStride;
+      if (col1 + cols <= rowStride && col2 + cols <= rowStride) {
+        return row1 < row2 + rows && row2 < row1 + rows
+            && col1 < col2 + cols && col2 < col1 + cols;
+      }
+    }
+
+    return true;
+  }
+
   BaseMatrix::~BaseMatrix() {}
 
+  bool BaseMatrix::GetLayout(MemoryLayout&) const {
+    return false;
+  }
+
 
   bool BaseMatrix::Equals(const BaseMatrix& other) const {
     if (this == &other) { return true; }
@@ -89,6 +184,12 @@ namespace math {
   void BaseMatrix::Copy(const BaseMatrix& other) {
     size_t rows = std::min(NumRows(), other.NumRows());
     size_t cols = std::min(NumCols(), other.NumCols());
+
+    MemoryLayout dst, src;
+    if (GetLayout(dst) && other.GetLayout(src)) {
+      StridedCopy(dst, src, rows, cols);
+      return;
+    }
     
     for (size_t row = 0; row < rows; row++) {
       for (size_t col = 0; col < cols; col++) {
@@ -119,6 +220,42 @@ namespace math {
     delete[] buffer;
   }
 
+  void BaseMatrix::AliasAwareCopy(const BaseMatrix& other) {
+    size_t rows = std::min(NumRows(), other.NumRows());
+    size_t cols = std::min(NumCols(), other.NumCols());
+
+    MemoryLayout dst, src;
+    if (GetLayout(dst) && other.GetLayout(src) && !dst.Overlaps(src, rows, cols)) {
+      StridedCopy(dst, src, rows, cols);
+    } else {
+      BufferedCopy(other);
+    }
+  }
+
+  void BaseMatrix::StridedCopy(
+      const MemoryLayout& dst, const MemoryLayout& src, size_t rows, size_t cols) {
+    if (rows <= 0 || cols <= 0) { return; }
+
+    if (rows * cols < multithread::kMinParallelCells) {
+      CopyBlock(dst, src, 0, rows, 0, cols);
+    } else if (rows >= multithread::kNumKernels) {
+      multithread::Partition(rows, [&dst, &src, cols](size_t from, size_t to) {
+        return [&dst, &src, from, to, cols]() {
+          CopyBlock(dst, src, from, to, 0, cols);
+          return 0;
+        };
+      });
+    } else {
+      // few, very long rows: split columns instead
+      multithread::Partition(cols, [&dst, &src, rows](size_t from, size_t to) {
+        return [&dst, &src, from, to, rows]() {
+          CopyBlock(dst, src, 0, rows, from, to);
+          return 0;
+        };
+      });
+    }
+  }
+
   std::ostream& operator<<(std::ostream& os, const BaseMatrix& matrix) {
     for (size_t row = 0; row < matrix.NumRows(); row++) {
       for (size_t col = 0; col < matrix.NumCols(); col++) {
@@ -0,0 +1,246 @@
+#include "../h/compression.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace mdl {
+namespace math {
+namespace compression {
+  namespace {
+    const int kHashBits = 14;
+    const std::size_t kMinMatch = 4;
+    const std::size_t kMaxOffset = 65535;
+    // The last bytes of a block are always literals, so matches can be extended with unchecked
+    //   4 byte reads.
+    const std::size_t kLastLiterals = 5;
+    const std::size_t kMatchSearchLimit = 12;
+
+    inline std::uint32_t Read32(const char* p) {
+      std::uint32_t value;
+      std::memcpy(&value, p, sizeof(value));
+      return value;
+    }
+
+    inline std::uint32_t Hash(std::uint32_t sequence) {
+      return (sequence * 2654435761u) >> (32 - kHashBits);
+    }
+
+    inline char* WriteLength(char* op, std::size_t length) {
+      for (; length >= 255; length -= 255) {
+        *op++ = static_cast<char>(255);
+      }
+      *op++ = static_cast<char>(length);
+      return op;
+    }
+
+    inline char* WriteSequence(
+        char* op, const char* literals, std::size_t numLiterals, std::size_t offset,
+        std::size_t matchLength) {
+      char* token = op++;
+      std::size_t extra = matchLength - kMinMatch;
+      *token = static_cast<char>(
+          ((numLiterals < 15 ? numLiterals : 15) << 4) | (extra < 15 ? extra : 15));
+      if (numLiterals >= 15) {
+        op = WriteLength(op, numLiterals - 15);
+      }
+      std::memcpy(op, literals, numLiterals);
+      op += numLiterals;
+
+      *op++ = static_cast<char>(offset & 0xff);
+      *op++ = static_cast<char>(offset >> 8);
+      if (extra >= 15) {
+        op = WriteLength(op, extra - 15);
+      }
+      return op;
+    }
+
+    // Reads a length extension. Returns false when running out of input.
+    inline bool ReadLength(
+        const unsigned char*& ip, const unsigned char* end, std::size_t& length) {
+      unsigned char byte;
+      do {
+        if (ip >= end) { return false; }
+        byte = *ip++;
+        length += byte;
+      } while (byte == 255);
+      return true;
+    }
+  }
+
+  namespace {
+    // Element sizes known at compile time let the loop over bytes unroll, so both directions
+    //   walk the interleaved side sequentially.
+    template <std::size_t kSize>
+    void Shuffle(const char* src, char* dst, std::size_t count) {
+      for (std::size_t i = 0; i < count; i++) {
+        for (std::size_t byte = 0; byte < kSize; byte++) {
+          dst[byte * count + i] = src[i * kSize + byte];
+        }
+      }
+    }
+
+    template <std::size_t kSize>
+    void Unshuffle(const char* src, char* dst, std::size_t count) {
+      for (std::size_t i = 0; i < count; i++) {
+        for (std::size_t byte = 0; byte < kSize; byte++) {
+          dst[i * kSize + byte] = src[byte * count + i];
+        }
+      }
+    }
+  }
+
+  void Shuffle(const char* src, char* dst, std::size_t count, std::size_t elementSize) {
+    switch (elementSize) {
+      case 4: Shuffle<4>(src, dst, count); return;
+      case 8: Shuffle<8>(src, dst, count); return;
+    }
+    for (std::size_t byte = 0; byte < elementSize; byte++) {
+      char* out = dst + byte * count;
+      for (std::size_t i = 0; i < count; i++) {
+        out[i] = src[i * elementSize + byte];
+      }
+    }
+  }
+
+  void Unshuffle(const char* src, char* dst, std::size_t count, std::size_t elementSize) {
+    switch (elementSize) {
+      case 4: Unshuffle<4>(src, dst, count); return;
+      case 8: Unshuffle<8>(src, dst, count); return;
+    }
+    for (std::size_t byte = 0; byte < elementSize; byte++) {
+      const char* in = src + byte * count;
+      for (std::size_t i = 0; i < count; i++) {
+        dst[i * elementSize + byte] = in[i];
+      }
+    }
+  }
+
+  std::size_t Compress(const char* src, std::size_t size, char* dst) {
+    const char* ip = src;
+    const char* anchor = src;
+    const char* end = src + size;
+    char* op = dst;
+
+    if (size > kMatchSearchLimit) {
+      // positions are relative to src; 0 (unset) is just a candidate that fails to match
+      std::unique_ptr<std::uint32_t[]> table(new std::uint32_t[1 << kHashBits]());
+      const char* searchLimit = end - kMatchSearchLimit;
+      const char* matchLimit = end - kLastLiterals;
+
+      while (ip < searchLimit) {
+        std::uint32_t sequence = Read32(ip);
+        std::uint32_t hash = Hash(sequence);
+        const char* candidate = src + table[hash];
+        table[hash] = static_cast<std::uint32_t>(ip - src);
+
+        if (candidate >= ip || static_cast<std::size_t>(ip - candidate) > kMaxOffset
+            || Read32(candidate) != sequence) {
+          // skip faster through data that doesn't compress
+          ip += 1 + ((ip - anchor) >> 6);
+          continue;
+        }
+
+        std::size_t length = kMinMatch;
+        while (ip + length < matchLimit && candidate[length] == ip[length]) {
+          length++;
+        }
+        op = WriteSequence(op, anchor, ip - anchor, ip - candidate, length);
+        ip += length;
+        anchor = ip;
+      }
+    }
+
+    // trailing literals, in a sequence without a match
+    std::size_t numLiterals = end - anchor;
+    *op++ = static_cast<char>((numLiterals < 15 ? numLiterals : 15) << 4);
+    if (numLiterals >= 15) {
+      op = WriteLength(op, numLiterals - 15);
+    }
+    // an empty input may come as a null pointer, which memcpy() doesn't take even for 0 bytes
+    if (numLiterals > 0) {
+      std::memcpy(op, anchor, numLiterals);
+      op += numLiterals;
+    }
+
+    return op - dst;
+  }
+
+  bool Decompress(const char* src, std::size_t srcSize, char* dst, std::size_t size) {
+    const unsigned char* ip = reinterpret_cast<const unsigned char*>(src);
+    const unsigned char* end = ip + srcSize;
+    char* op = dst;
+    char* outEnd = dst + size;
+
+    for (;;) {
+      if (ip >= end) { return false; }
+      unsigned char token = *ip++;
+
+      std::size_t numLiterals = token >> 4;
+      if (numLiterals == 15 && !ReadLength(ip, end, numLiterals)) { return false; }
+      if (numLiterals > static_cast<std::size_t>(end - ip)
+          || numLiterals > static_cast<std::size_t>(outEnd - op)) {
+        return false;
+      }
+      if (numLiterals > 0) {
+        std::memcpy(op, ip, numLiterals);
+        ip += numLiterals;
+        op += numLiterals;
+      }
+
+      if (ip == end) {
+        // the last sequence has no match
+        return op == outEnd;
+      }
+
+      if (end - ip < 2) { return false; }
+      std::size_t offset = ip[0] | (static_cast<std::size_t>(ip[1]) << 8);
+      ip += 2;
+      std::size_t length = token & 0x0f;
+      if (length == 15 && !ReadLength(ip, end, length)) { return false; }
+      length += kMinMatch;
+
+      if (offset == 0 || offset > static_cast<std::size_t>(op - dst)
+          || length > static_cast<std::size_t>(outEnd - op)) {
+        return false;
+      }
+      const char* match = op - offset;
+      if (offset >= length) {
+        std::memcpy(op, match, length);
+        op += length;
+      } else if (offset >= 8) {
+        // Overlapping copy, which repeats the last offset bytes. Chunks no longer than offset
+        //   only read bytes that are already written.
+        char* matchEnd = op + length;
+        for (; op + 8 <= matchEnd; op += 8, match += 8) {
+          std::memcpy(op, match, 8);
+        }
+        for (; op < matchEnd; op++, match++) {
+          *op = *match;
+        }
+      } else {
+        for (std::size_t i = 0; i < length; i++) {
+          *op++ = match[i];
+        }
+      }
+    }
+  }
+
+  bool DecodeShuffled(
+      const char* src, std::size_t srcSize, char* dst, std::size_t count, std::size_t elementSize) {
+    std::size_t rawSize = count * elementSize;
+    if (srcSize == rawSize) {
+      std::memcpy(dst, src, rawSize);
+      return true;
+    }
+    std::unique_ptr<char[]> shuffled(new char[rawSize]);
+    if (!Decompress(src, srcSize, shuffled.get(), rawSize)) {
+      return false;
+    }
+    Unshuffle(shuffled.get(), dst, count, elementSize);
+    return true;
+  }
+
+} // compression
+} // math
+} // mdl
@@ -0,0 +1,493 @@
+#include "../h/convolution.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "../h/multithread/helper.h"
+#include "../h/stats.h"
+
+namespace mdl {
+namespace math {
+  using multithread::Dot;
+  using multithread::ParallelFor;
+
+  namespace {
+    inline float_t* DataOf(const Matrix& matrix) {
+      MemoryLayout layout;
+      matrix.GetLayout(layout);
+      return layout.data;
+    }
+
+    void CheckShape(const char* what, const Matrix& matrix, size_t rows, size_t cols) {
+      if (matrix.NumRows() != rows || matrix.NumCols() != cols) {
+        std::ostringstream os;
+        os << what << " should be " << rows << 'x' << cols << ", got "
+            << matrix.NumRows() << 'x' << matrix.NumCols();
+        throw std::invalid_argument(os.str());
+      }
+    }
+
+    size_t OutputSize(size_t size, size_t kernel, size_t stride, size_t padding, size_t dilation) {
+      size_t span = dilation * (kernel - 1) + 1;
+      if (size + 2 * padding < span) {
+        return 0;
+      }
+      return (size + 2 * padding - span) / stride + 1;
+    }
+
+    // Output columns [from, to) for which input column ox * stride + offset lies in [0, width).
+    inline void ValidRange(
+        size_t outputWidth, size_t width, size_t stride, size_t offset,
+        size_t& from, size_t& to) {
+      from = offset < 0 ? (-offset + stride - 1) / stride : 0;
+      to = width - 1 - offset < 0 ? 0 : std::min(outputWidth, (width - 1 - offset) / stride + 1);
+      if (to < from) {
+        to = from;
+      }
+    }
+
+    void CheckConv(const Conv2DShape& shape) {
+      if (shape.channels <= 0 || shape.height <= 0 || shape.width <= 0
+          || shape.kernelHeight <= 0 || shape.kernelWidth <= 0
+          || shape.stride <= 0 || shape.dilation <= 0 || shape.padding < 0) {
+        throw std::invalid_argument("Invalid convolution shape");
+      }
+      if (shape.OutputHeight() <= 0 || shape.OutputWidth() <= 0) {
+        std::ostringstream os;
+        os << "Kernel of " << shape.kernelHeight << 'x' << shape.kernelWidth << " (dilation "
+            << shape.dilation << ") doesn't fit " << shape.height << 'x' << shape.width
+            << " images with padding " << shape.padding;
+        throw std::invalid_argument(os.str());
+      }
+    }
+
+    void CheckPool(const Pool2DShape& shape) {
+      if (shape.channels <= 0 || shape.height <= 0 || shape.width <= 0
+          || shape.window <= 0 || shape.stride <= 0 || shape.padding < 0
+          || shape.padding >= shape.window) {
+        throw std::invalid_argument("Invalid pooling shape");
+      }
+      if (shape.OutputHeight() <= 0 || shape.OutputWidth() <= 0) {
+        std::ostringstream os;
+        os << "Window of " << shape.window << 'x' << shape.window << " doesn't fit "
+            << shape.height << 'x' << shape.width << " images with padding " << shape.padding;
+        throw std::invalid_argument(os.str());
+      }
+    }
+
+    // Calls fn(outputIndex, inputFrom, inputTo) with the clipped input range of every window
+    //   along one dimension.
+    template <typename Fn>
+    inline void ForEachWindow(
+        size_t outputSize, size_t size, size_t window, size_t stride, size_t padding, Fn fn) {
+      for (size_t out = 0; out < outputSize; out++) {
+        size_t first = out * stride - padding;
+        fn(out, std::max<size_t>(first, 0), std::min(first + window, size));
+      }
+    }
+  }
+
+  size_t Conv2DShape::OutputHeight() const {
+    return OutputSize(height, kernelHeight, stride, padding, dilation);
+  }
+
+  size_t Conv2DShape::OutputWidth() const {
+    return OutputSize(width, kernelWidth, stride, padding, dilation);
+  }
+
+  size_t Pool2DShape::OutputHeight() const {
+    return OutputSize(height, window, stride, padding, 1);
+  }
+
+  size_t Pool2DShape::OutputWidth() const {
+    return OutputSize(width, window, stride, padding, 1);
+  }
+
+  Matrix Conv2D(const Matrix& images, const Matrix& filters, const Conv2DShape& shape) {
+    CheckConv(shape);
+    size_t channels = shape.channels;
+    size_t height = shape.height;
+    size_t width = shape.width;
+    size_t kh = shape.kernelHeight;
+    size_t kw = shape.kernelWidth;
+    size_t stride = shape.stride;
+    size_t padding = shape.padding;
+    size_t dilation = shape.dilation;
+    size_t outHeight = shape.OutputHeight();
+    size_t outWidth = shape.OutputWidth();
+    size_t numImages = images.NumRows();
+    size_t numFilters = filters.NumRows();
+    size_t filterSize = channels * kh * kw;
+    CheckShape("Images", images, numImages, channels * height * width);
+    CheckShape("Filters", filters, numFilters, filterSize);
+
+    std::uint64_t outCells = static_cast<std::uint64_t>(numImages) * numFilters
+        * outHeight * outWidth;
+    static stats::Counter counter("Conv2D", stats::Backend::kMultiThread);
+    stats::Probe probe(counter, numImages, numFilters * outHeight * outWidth, outCells,
+        2 * outCells * filterSize,
+        (images.NumCells() + filters.NumCells() + outCells) * sizeof(float_t));
+
+    Matrix result(numImages, numFilters * outHeight * outWidth);
+    const float_t* x = DataOf(images);
+    const float_t* w = DataOf(filters);
+    float_t* y = DataOf(result);
+    size_t outPlane = outHeight * outWidth;
+
+    // one item per (image, output row), computing that row for every filter
+    ParallelFor(numImages * outHeight,
+        static_cast<std::uint64_t>(numFilters) * filterSize * outWidth,
+        [=](size_t from, size_t to) {
+      for (size_t item = from; item < to; item++) {
+        size_t image = item / outHeight;
+        size_t oy = item % outHeight;
+        const float_t* xImage = x + image * channels * height * width;
+        float_t* yRow = y + image * numFilters * outPlane + oy * outWidth;
+
+        for (size_t c = 0; c < channels; c++) {
+          for (size_t r = 0; r < kh; r++) {
+            size_t iy = oy * stride + r * dilation - padding;
+            if (iy < 0 || iy >= height) { continue; }
+            const float_t* xRow = xImage + (c * height + iy) * width;
+
+            for (size_t s = 0; s < kw; s++) {
+              size_t offset = s * dilation - padding;
+              size_t oxFrom, oxTo;
+              ValidRange(outWidth, width, stride, offset, oxFrom, oxTo);
+              const float_t* tap = w + (c * kh + r) * kw + s;
+
+              for (size_t k = 0; k < numFilters; k++) {
+                float_t weight = tap[k * filterSize];
+                float_t* out = yRow + k * outPlane;
+                if (stride == 1) {
+                  for (size_t ox = oxFrom; ox < oxTo; ox++) {
+                    out[ox] += weight * xRow[ox + offset];
+                  }
+                } else {
+                  for (size_t ox = oxFrom; ox < oxTo; ox++) {
+                    out[ox] += weight * xRow[ox * stride + offset];
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+    });
+
+    return result;
+  }
+
+  Conv2DGradients Conv2DBackward(
+      const Matrix& images,
+      const Matrix& filters,
+      const Matrix& outputGradient,
+      const Conv2DShape& shape) {
+    CheckConv(shape);
+    size_t channels = shape.channels;
+    size_t height = shape.height;
+    size_t width = shape.width;
+    size_t kh = shape.kernelHeight;
+    size_t kw = shape.kernelWidth;
+    size_t stride = shape.stride;
+    size_t padding = shape.padding;
+    size_t dilation = shape.dilation;
+    size_t outHeight = shape.OutputHeight();
+    size_t outWidth = shape.OutputWidth();
+    size_t numImages = images.NumRows();
+    size_t numFilters = filters.NumRows();
+    size_t filterSize = channels * kh * kw;
+    size_t imageSize = channels * height * width;
+    size_t outPlane = outHeight * outWidth;
+    CheckShape("Images", images, numImages, imageSize);
+    CheckShape("Filters", filters, numFilters, filterSize);
+    CheckShape("Output gradient", outputGradient, numImages, numFilters * outPlane);
+
+    std::uint64_t outCells = outputGradient.NumCells();
+    static stats::Counter counter("Conv2DBackward", stats::Backend::kMultiThread);
+    stats::Probe probe(counter, numImages, numFilters * outPlane, outCells,
+        4 * outCells * filterSize,
+        2 * (images.NumCells() + filters.NumCells() + outCells) * sizeof(float_t));
+
+    Conv2DGradients gradients{Matrix(numImages, imageSize), Matrix(numFilters, filterSize)};
+    const float_t* x = DataOf(images);
+    const float_t* w = DataOf(filters);
+    const float_t* dy = DataOf(outputGradient);
+    float_t* dx = DataOf(gradients.images);
+    float_t* dw = DataOf(gradients.filters);
+
+    // Input gradient, one item per (image, input row). Each input row gathers from the output
+    //   rows it contributed to, so items never write to the same cells.
+    ParallelFor(numImages * height, static_cast<std::uint64_t>(numFilters) * filterSize * outWidth,
+        [=](size_t from, size_t to) {
+      for (size_t item = from; item < to; item++) {
+        size_t image = item / height;
+        size_t iy = item % height;
+        const float_t* dyImage = dy + image * numFilters * outPlane;
+        float_t* dxImage = dx + image * imageSize;
+
+        for (size_t r = 0; r < kh; r++) {
+          size_t t = iy + padding - r * dilation;
+          if (t < 0 || t % stride != 0 || t / stride >= outHeight) { continue; }
+          size_t oy = t / stride;
+
+          for (size_t c = 0; c < channels; c++) {
+            float_t* dxRow = dxImage + (c * height + iy) * width;
+            for (size_t s = 0; s < kw; s++) {
+              size_t offset = s * dilation - padding;
+              size_t oxFrom, oxTo;
+              ValidRange(outWidth, width, stride, offset, oxFrom, oxTo);
+              const float_t* tap = w + (c * kh + r) * kw + s;
+
+              for (size_t k = 0; k < numFilters; k++) {
+                float_t weight = tap[k * filterSize];
+                const float_t* dyRow = dyImage + k * outPlane + oy * outWidth;
+                if (stride == 1) {
+                  for (size_t ox = oxFrom; ox < oxTo; ox++) {
+                    dxRow[ox + offset] += weight * dyRow[ox];
+                  }
+                } else {
+                  for (size_t ox = oxFrom; ox < oxTo; ox++) {
+                    dxRow[ox * stride + offset] += weight * dyRow[ox];
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+    });
+
+    // Filter gradient, one item per (filter, channel): each owns kh x kw taps.
+    ParallelFor(numFilters * channels, static_cast<std::uint64_t>(numImages) * outPlane * kh * kw,
+        [=](size_t from, size_t to) {
+      for (size_t item = from; item < to; item++) {
+        size_t k = item / channels;
+        size_t c = item % channels;
+        float_t* taps = dw + k * filterSize + c * kh * kw;
+
+        for (size_t image = 0; image < numImages; image++) {
+          const float_t* xPlane = x + image * imageSize + c * height * width;
+          const float_t* dyPlane = dy + (image * numFilters + k) * outPlane;
+
+          for (size_t oy = 0; oy < outHeight; oy++) {
+            const float_t* dyRow = dyPlane + oy * outWidth;
+            for (size_t r = 0; r < kh; r++) {
+              size_t iy = oy * stride + r * dilation - padding;
+              if (iy < 0 || iy >= height) { continue; }
+              const float_t* xRow = xPlane + iy * width;
+
+              for (size_t s = 0; s < kw; s++) {
+                size_t offset = s * dilation - padding;
+                size_t oxFrom, oxTo;
+                ValidRange(outWidth, width, stride, offset, oxFrom, oxTo);
+                if (stride == 1) {
+                  taps[r * kw + s] += Dot(dyRow + oxFrom, xRow + oxFrom + offset, oxTo - oxFrom);
+                } else {
+                  float_t sum = 0.0;
+                  for (size_t ox = oxFrom; ox < oxTo; ox++) {
+                    sum += dyRow[ox] * xRow[ox * stride + offset];
+                  }
+                  taps[r * kw + s] += sum;
+                }
+              }
+            }
+          }
+        }
+      }
+    });
+
+    return gradients;
+  }
+
+  Matrix MaxPool2D(const Matrix& images, const Pool2DShape& shape) {
+    CheckPool(shape);
+    size_t height = shape.height;
+    size_t width = shape.width;
+    size_t outHeight = shape.OutputHeight();
+    size_t outWidth = shape.OutputWidth();
+    size_t numPlanes = images.NumRows() * shape.channels;
+    CheckShape("Images", images, images.NumRows(), shape.channels * height * width);
+
+    std::uint64_t outCells = static_cast<std::uint64_t>(numPlanes) * outHeight * outWidth;
+    static stats::Counter counter("MaxPool2D", stats::Backend::kMultiThread);
+    stats::Probe probe(counter, images.NumRows(), shape.channels * outHeight * outWidth, outCells,
+        outCells * shape.window * shape.window, (images.NumCells() + outCells) * sizeof(float_t));
+
+    Matrix result(images.NumRows(), shape.channels * outHeight * outWidth);
+    const float_t* x = DataOf(images);
+    float_t* y = DataOf(result);
+
+    ParallelFor(numPlanes,
+        static_cast<std::uint64_t>(outHeight) * outWidth * shape.window * shape.window,
+        [=](size_t from, size_t to) {
+      for (size_t plane = from; plane < to; plane++) {
+        const float_t* xPlane = x + plane * height * width;
+        float_t* yPlane = y + plane * outHeight * outWidth;
+
+        ForEachWindow(outHeight, height, shape.window, shape.stride, shape.padding,
+            [&](size_t oy, size_t yFrom, size_t yTo) {
+          ForEachWindow(outWidth, width, shape.window, shape.stride, shape.padding,
+              [&](size_t ox, size_t xFrom, size_t xTo) {
+            float_t max = -std::numeric_limits<float_t>::infinity();
+            for (size_t iy = yFrom; iy < yTo; iy++) {
+              for (size_t ix = xFrom; ix < xTo; ix++) {
+                max = std::max(max, xPlane[iy * width + ix]);
+              }
+            }
+            yPlane[oy * outWidth + ox] = max;
+          });
+        });
+      }
+    });
+
+    return result;
+  }
+
+  Matrix MaxPool2DBackward(
+      const Matrix& images, const Matrix& outputGradient, const Pool2DShape& shape) {
+    CheckPool(shape);
+    size_t height = shape.height;
+    size_t width = shape.width;
+    size_t outHeight = shape.OutputHeight();
+    size_t outWidth = shape.OutputWidth();
+    size_t numPlanes = images.NumRows() * shape.channels;
+    CheckShape("Images", images, images.NumRows(), shape.channels * height * width);
+    CheckShape("Output gradient", outputGradient, images.NumRows(),
+        shape.channels * outHeight * outWidth);
+
+    std::uint64_t outCells = outputGradient.NumCells();
+    static stats::Counter counter("MaxPool2DBackward", stats::Backend::kMultiThread);
+    stats::Probe probe(counter, images.NumRows(), shape.channels * outHeight * outWidth, outCells,
+        outCells * shape.window * shape.window,
+        (2 * images.NumCells() + outCells) * sizeof(float_t));
+
+    Matrix result(images.NumRows(), images.NumCols());
+    const float_t* x = DataOf(images);
+    const float_t* dy = DataOf(outputGradient);
+    float_t* dx = DataOf(result);
+
+    ParallelFor(numPlanes,
+        static_cast<std::uint64_t>(outHeight) * outWidth * shape.window * shape.window,
+        [=](size_t from, size_t to) {
+      for (size_t plane = from; plane < to; plane++) {
+        const float_t* xPlane = x + plane * height * width;
+        const float_t* dyPlane = dy + plane * outHeight * outWidth;
+        float_t* dxPlane = dx + plane * height * width;
+
+        ForEachWindow(outHeight, height, shape.window, shape.stride, shape.padding,
+            [&](size_t oy, size_t yFrom, size_t yTo) {
+          ForEachWindow(outWidth, width, shape.window, shape.stride, shape.padding,
+              [&](size_t ox, size_t xFrom, size_t xTo) {
+            size_t argMax = yFrom * width + xFrom;
+            for (size_t iy = yFrom; iy < yTo; iy++) {
+              for (size_t ix = xFrom; ix < xTo; ix++) {
+                if (xPlane[iy * width + ix] > xPlane[argMax]) {
+                  argMax = iy * width + ix;
+                }
+              }
+            }
+            dxPlane[argMax] += dyPlane[oy * outWidth + ox];
+          });
+        });
+      }
+    });
+
+    return result;
+  }
+
+  Matrix AvgPool2D(const Matrix& images, const Pool2DShape& shape) {
+    CheckPool(shape);
+    size_t height = shape.height;
+    size_t width = shape.width;
+    size_t outHeight = shape.OutputHeight();
+    size_t outWidth = shape.OutputWidth();
+    size_t numPlanes = images.NumRows() * shape.channels;
+    CheckShape("Images", images, images.NumRows(), shape.channels * height * width);
+
+    std::uint64_t outCells = static_cast<std::uint64_t>(numPlanes) * outHeight * outWidth;
+    static stats::Counter counter("AvgPool2D", stats::Backend::kMultiThread);
+    stats::Probe probe(counter, images.NumRows(), shape.channels * outHeight * outWidth, outCells,
+        outCells * shape.window * shape.window, (images.NumCells() + outCells) * sizeof(float_t));
+
+    Matrix result(images.NumRows(), shape.channels * outHeight * outWidth);
+    const float_t* x = DataOf(images);
+    float_t* y = DataOf(result);
+
+    ParallelFor(numPlanes,
+        static_cast<std::uint64_t>(outHeight) * outWidth * shape.window * shape.window,
+        [=](size_t from, size_t to) {
+      for (size_t plane = from; plane < to; plane++) {
+        const float_t* xPlane = x + plane * height * width;
+        float_t* yPlane = y + plane * outHeight * outWidth;
+
+        ForEachWindow(outHeight, height, shape.window, shape.stride, shape.padding,
+            [&](size_t oy, size_t yFrom, size_t yTo) {
+          ForEachWindow(outWidth, width, shape.window, shape.stride, shape.padding,
+              [&](size_t ox, size_t xFrom, size_t xTo) {
+            float_t sum = 0.0;
+            for (size_t iy = yFrom; iy < yTo; iy++) {
+              for (size_t ix = xFrom; ix < xTo; ix++) {
+                sum += xPlane[iy * width + ix];
+              }
+            }
+            yPlane[oy * outWidth + ox] = sum / ((yTo - yFrom) * (xTo - xFrom));
+          });
+        });
+      }
+    });
+
+    return result;
+  }
+
+  Matrix AvgPool2DBackward(const Matrix& outputGradient, const Pool2DShape& shape) {
+    CheckPool(shape);
+    size_t height = shape.height;
+    size_t width = shape.width;
+    size_t outHeight = shape.OutputHeight();
+    size_t outWidth = shape.OutputWidth();
+    size_t numImages = outputGradient.NumRows();
+    size_t numPlanes = numImages * shape.channels;
+    CheckShape("Output gradient", outputGradient, numImages,
+        shape.channels * outHeight * outWidth);
+
+    std::uint64_t outCells = outputGradient.NumCells();
+    static stats::Counter counter("AvgPool2DBackward", stats::Backend::kMultiThread);
+    stats::Probe probe(counter, numImages, shape.channels * outHeight * outWidth, outCells,
+        outCells * shape.window * shape.window,
+        (outCells + static_cast<std::uint64_t>(numPlanes) * height * width) * sizeof(float_t));
+
+    Matrix result(numImages, shape.channels * height * width);
+    const float_t* dy = DataOf(outputGradient);
+    float_t* dx = DataOf(result);
+
+    ParallelFor(numPlanes,
+        static_cast<std::uint64_t>(outHeight) * outWidth * shape.window * shape.window,
+        [=](size_t from, size_t to) {
+      for (size_t plane = from; plane < to; plane++) {
+        const float_t* dyPlane = dy + plane * outHeight * outWidth;
+        float_t* dxPlane = dx + plane * height * width;
+
+        ForEachWindow(outHeight, height, shape.window, shape.stride, shape.padding,
+            [&](size_t oy, size_t yFrom, size_t yTo) {
+          ForEachWindow(outWidth, width, shape.window, shape.stride, shape.padding,
+              [&](size_t ox, size_t xFrom, size_t xTo) {
+            float_t share = dyPlane[oy * outWidth + ox] / ((yTo - yFrom) * (xTo - xFrom));
+            for (size_t iy = yFrom; iy < yTo; iy++) {
+              for (size_t ix = xFrom; ix < xTo; ix++) {
+                dxPlane[iy * width + ix] += share;
+              }
+            }
+          });
+        });
+      }
+    });
+
+    return result;
+  }
+
+} // math
+} // mdl
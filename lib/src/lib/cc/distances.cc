@@ -0,0 +1,185 @@
+#include "../h/distances.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "../h/multithread/helper.h"
+#include "../h/stats.h"
+
+namespace mdl {
+namespace math {
+  using multithread::Dot;
+  using multithread::ParallelFor;
+
+  namespace {
+    // KNearest compares kReferenceTile references against kQueryBlock queries at a time: the
+    //   products of a tile take 16MB, whatever the number of references or queries.
+    const size_t kQueryBlock = 1024;
+    const size_t kReferenceTile = 4096;
+
+    inline float_t* DataOf(const Matrix& matrix) {
+      MemoryLayout layout;
+      matrix.GetLayout(layout);
+      return layout.data;
+    }
+
+    void CheckRowLengths(const Matrix& matrix1, const Matrix& matrix2) {
+      if (matrix1.NumCols() != matrix2.NumCols()) {
+        std::ostringstream os;
+        os << "Cannot compare rows of different lengths: " << matrix1.NumRows() << 'x'
+            << matrix1.NumCols() << " and " << matrix2.NumRows() << 'x' << matrix2.NumCols();
+        throw std::invalid_argument(os.str());
+      }
+    }
+
+    // What the metric needs of every row besides the products: its squared norm, or for cosine
+    //   distances the inverse of its norm (0 for rows of zeros, so their cosine is 0).
+    std::vector<float_t> RowTerms(const Matrix& matrix, bool cosine) {
+      size_t rows = matrix.NumRows();
+      size_t cols = matrix.NumCols();
+      std::vector<float_t> terms(rows);
+      const float_t* data = DataOf(matrix);
+      float_t* out = terms.data();
+      ParallelFor(rows, cols, [data, out, cols, cosine](size_t from, size_t to) {
+        for (size_t row = from; row < to; row++) {
+          float_t norm = Dot(data + row * cols, data + row * cols, cols);
+          out[row] = !cosine ? norm : norm > 0 ? 1 / std::sqrt(norm) : 0;
+        }
+      });
+      return terms;
+    }
+
+    // Distance from the product of two rows and their terms; squared for Euclidean metrics,
+    //   which ranks the same. Clamped, as rounding may leave tiny negative squares.
+    inline float_t FromProduct(bool cosine, float_t product, float_t term1, float_t term2) {
+      return cosine
+          ? 1 - product * term1 * term2
+          : std::max<float_t>(0, term1 + term2 - 2 * product);
+    }
+  }
+
+  Matrix PairwiseDistances(const Matrix& matrix1, const Matrix& matrix2, Distance metric) {
+    CheckRowLengths(matrix1, matrix2);
+
+    size_t rows = matrix1.NumRows();
+    size_t cols = matrix2.NumRows();
+    static stats::Counter counter("PairwiseDistances", stats::Backend::kMultiThread);
+    std::uint64_t outCells = static_cast<std::uint64_t>(rows) * cols;
+    stats::Probe probe(counter, rows, cols, outCells, 2 * outCells * matrix1.NumCols(),
+        (matrix1.NumCells() + matrix2.NumCells() + outCells) * sizeof(float_t));
+
+    bool cosine = metric == Distance::kCosine;
+    bool root = metric == Distance::kEuclidean;
+    std::vector<float_t> terms1 = RowTerms(matrix1, cosine);
+    std::vector<float_t> terms2 = RowTerms(matrix2, cosine);
+
+    Matrix result = matrix1 * matrix2.Transposed();
+    float_t* data = DataOf(result);
+    const float_t* t1 = terms1.data();
+    const float_t* t2 = terms2.data();
+    ParallelFor(rows, cols, [data, t1, t2, cols, cosine, root](size_t from, size_t to) {
+      for (size_t row = from; row < to; row++) {
+        float_t* out = data + row * cols;
+        for (size_t col = 0; col < cols; col++) {
+          float_t distance = FromProduct(cosine, out[col], t1[row], t2[col]);
+          out[col] = root ? std::sqrt(distance) : distance;
+        }
+      }
+    });
+
+    return result;
+  }
+
+  ValuesWithIndices KNearest(
+      const Matrix& queries, const Matrix& references, size_t k, Distance metric) {
+    CheckRowLengths(queries, references);
+    if (k < 0) {
+      std::ostringstream os;
+      os << "Cannot find the " << k << " nearest references";
+      throw std::invalid_argument(os.str());
+    }
+
+    size_t numQueries = queries.NumRows();
+    size_t numReferences = references.NumRows();
+    k = std::min(k, numReferences);
+    static stats::Counter counter("KNearest", stats::Backend::kMultiThread);
+    std::uint64_t numPairs = static_cast<std::uint64_t>(numQueries) * numReferences;
+    stats::Probe probe(counter, numQueries, k, static_cast<std::uint64_t>(numQueries) * k,
+        2 * numPairs * queries.NumCols(),
+        (queries.NumCells() + references.NumCells()) * sizeof(float_t));
+
+    Matrix values(numQueries, k, new float_t[numQueries * k]);
+    std::vector<size_t> indices(numQueries * k);
+    if (k == 0) {
+      return {std::move(values), std::move(indices)};
+    }
+
+    bool cosine = metric == Distance::kCosine;
+    std::vector<float_t> queryTerms = RowTerms(queries, cosine);
+    std::vector<float_t> referenceTerms = RowTerms(references, cosine);
+
+    // Max-heaps of (distance, reference) per query of the block: the worst of the k nearest so
+    //   far is on top, and most references are rejected by comparing against it.
+    typedef std::pair<float_t, size_t> Candidate;
+    std::vector<Candidate> heaps(std::min(numQueries, kQueryBlock) * k);
+    std::vector<size_t> heapSizes(std::min(numQueries, kQueryBlock));
+
+    for (size_t first = 0; first < numQueries; first += kQueryBlock) {
+      size_t count = std::min(kQueryBlock, numQueries - first);
+      std::fill(heapSizes.begin(), heapSizes.end(), 0);
+      auto block = queries(Range(first, first + count), Range());
+
+      for (size_t tile = 0; tile < numReferences; tile += kReferenceTile) {
+        size_t tileSize = std::min(kReferenceTile, numReferences - tile);
+        Matrix products = block * references(Range(tile, tile + tileSize), Range()).Transpose();
+        const float_t* data = DataOf(products);
+
+        ParallelFor(count, tileSize, [&, data, first, tile, tileSize](size_t from, size_t to) {
+          for (size_t i = from; i < to; i++) {
+            Candidate* heap = heaps.data() + i * k;
+            size_t size = heapSizes[i];
+            float_t queryTerm = queryTerms[first + i];
+            const float_t* row = data + i * tileSize;
+            for (size_t j = 0; j < tileSize; j++) {
+              Candidate candidate(
+                  FromProduct(cosine, row[j], queryTerm, referenceTerms[tile + j]), tile + j);
+              if (size < k) {
+                heap[size++] = candidate;
+                std::push_heap(heap, heap + size);
+              } else if (candidate < heap[0]) {
+                std::pop_heap(heap, heap + k);
+                heap[k - 1] = candidate;
+                std::push_heap(heap, heap + k);
+              }
+            }
+            heapSizes[i] = size;
+          }
+        });
+      }
+
+      float_t* valueData = DataOf(values);
+      ParallelFor(count, k, [&, valueData, first](size_t from, size_t to) {
+        for (size_t i = from; i < to; i++) {
+          Candidate* heap = heaps.data() + i * k;
+          std::sort_heap(heap, heap + k);
+          for (size_t j = 0; j < k; j++) {
+            size_t cell = (first + i) * k + j;
+            valueData[cell] = metric == Distance::kEuclidean
+                ? std::sqrt(heap[j].first)
+                : heap[j].first;
+            indices[cell] = heap[j].second;
+          }
+        }
+      });
+    }
+
+    return {std::move(values), std::move(indices)};
+  }
+
+} // math
+} // mdl
@@ -1,6 +1,9 @@
 #include "../h/functions.h"
 
+#include <algorithm>
+#include <atomic>
 #include <climits>
+#include <cstring>
 #include <vector>
 #include <fstream>
 
@@ -9,6 +12,10 @@
 #include "../h/operation.h"
 #include "../h/singlethread/basematrix_impl.h"
 #include "../h/multithread/basematrix_impl.h"
+#include "../h/multithread/matrix_impl.h"
+#include "../h/compression.h"
+#include "../h/mtx_writer.h"
+#include "../h/stats.h"
 #include <mdl/io.h>
 #include <mdl/util.h>
 
@@ -136,21 +143,30 @@ namespace math {
     return result;
   }
 
+  std::vector<Matrix> BatchMultiply(
+      std::span<const Matrix> matrices1, std::span<const Matrix> matrices2) {
+    return multithread::MatrixImpl::BatchMultiply(matrices1, matrices2);
+  }
+
+  Matrix BatchMultiply(const Matrix& stacked1, const Matrix& stacked2, size_t batchSize) {
+    return multithread::MatrixImpl::BatchMultiply(stacked1, stacked2, batchSize);
+  }
+
+
   Matrix Sigmoid(const BaseMatrix& matrix) {
-    return 1.0 / (1 + mdl::math::Exp(-matrix));
+    return BaseMatrixImpl::UnaryOperate<op::Sigmoid>(matrix);
   }
 
   Matrix SigmoidGradient(const Matrix& matrix) {
-    Matrix sigmoid = Sigmoid(matrix);
-    return Prod(sigmoid, 1 - sigmoid);
+    return multithread::MatrixImpl::UnaryOperate<op::SigmoidGradient>(matrix);
   }
 
   Matrix ReLU(const Matrix& matrix) {
-    return Prod(matrix, (matrix > 0));
+    return multithread::MatrixImpl::UnaryOperate<op::ReLU>(matrix);
   }  
 
   Matrix ReLUGradient(const Matrix& matrix) {
-    return matrix > 0;
+    return multithread::MatrixImpl::UnaryOperate<op::ReLUGradient>(matrix);
   }
 
   Matrix Identity(const Matrix& matrix) {
@@ -161,6 +177,177 @@ namespace math {
     return Matrices::Ones(matrix.NumRows(), matrix.NumCols());
   }
 
+  Matrix Tanh(const Matrix& matrix) {
+    return multithread::MatrixImpl::UnaryOperate<op::Tanh>(matrix);
+  }
+
+  Matrix TanhGradient(const Matrix& matrix) {
+    return multithread::MatrixImpl::UnaryOperate<op::TanhGradient>(matrix);
+  }
+
+  Matrix LeakyReLU(const Matrix& matrix, float_t slope) {
+    return multithread::MatrixImpl::UnaryOperate(matrix, op::LeakyReLU(slope));
+  }
+
+  Matrix LeakyReLUGradient(const Matrix& matrix, float_t slope) {
+    return multithread::MatrixImpl::UnaryOperate(matrix, op::LeakyReLUGradient(slope));
+  }
+
+  Matrix GELU(const Matrix& matrix) {
+    return multithread::MatrixImpl::UnaryOperate<op::GELU>(matrix);
+  }
+
+  Matrix GELUGradient(const Matrix& matrix) {
+    return multithread::MatrixImpl::UnaryOperate<op::GELUGradient>(matrix);
+  }
+
+  Matrix Softplus(const Matrix& matrix) {
+    return multithread::MatrixImpl::UnaryOperate<op::Softplus>(matrix);
+  }
+
+  Matrix SoftplusGradient(const Matrix& matrix) {
+    return multithread::MatrixImpl::UnaryOperate<op::SoftplusGradient>(matrix);
+  }
+
+  ActivationWithGradient SigmoidWithGradient(const Matrix& matrix) {
+    auto [value, gradient] = multithread::MatrixImpl::ValueAndGradient<op::Sigmoid>(matrix);
+    return {std::move(value), std::move(gradient)};
+  }
+
+  ActivationWithGradient ReLUWithGradient(const Matrix& matrix) {
+    auto [value, gradient] = multithread::MatrixImpl::ValueAndGradient<op::ReLU>(matrix);
+    return {std::move(value), std::move(gradient)};
+  }
+
+  ActivationWithGradient TanhWithGradient(const Matrix& matrix) {
+    auto [value, gradient] = multithread::MatrixImpl::ValueAndGradient<op::Tanh>(matrix);
+    return {std::move(value), std::move(gradient)};
+  }
+
+  ActivationWithGradient LeakyReLUWithGradient(const Matrix& matrix, float_t slope) {
+    auto [value, gradient] =
+        multithread::MatrixImpl::ValueAndGradient(matrix, op::LeakyReLU(slope));
+    return {std::move(value), std::move(gradient)};
+  }
+
+  ActivationWithGradient GELUWithGradient(const Matrix& matrix) {
+    auto [value, gradient] = multithread::MatrixImpl::ValueAndGradient<op::GELU>(matrix);
+    return {std::move(value), std::move(gradient)};
+  }
+
+  ActivationWithGradient SoftplusWithGradient(const Matrix& matrix) {
+    auto [value, gradient] = multithread::MatrixImpl::ValueAndGradient<op::Softplus>(matrix);
+    return {std::move(value), std::move(gradient)};
+  }
+
+  Matrix SigmoidGradientFromOutput(const Matrix& output) {
+    return multithread::MatrixImpl::UnaryOperate<op::SigmoidOutputGradient>(output);
+  }
+
+  Matrix ReLUGradientFromOutput(const Matrix& output) {
+    return multithread::MatrixImpl::UnaryOperate<op::ReLUGradient>(output);
+  }
+
+  Matrix TanhGradientFromOutput(const Matrix& output) {
+    return multithread::MatrixImpl::UnaryOperate<op::TanhOutputGradient>(output);
+  }
+
+  Matrix LeakyReLUGradientFromOutput(const Matrix& output, float_t slope) {
+    return multithread::MatrixImpl::UnaryOperate(output, op::LeakyReLUGradient(slope));
+  }
+
+  Matrix SoftplusGradientFromOutput(const Matrix& output) {
+    return multithread::MatrixImpl::UnaryOperate<op::SoftplusOutputGradient>(output);
+  }
+
+  Matrix Softmax(const Matrix& matrix) {
+    return multithread::MatrixImpl::RowSoftmax(matrix, false);
+  }
+
+  Matrix LogSoftmax(const Matrix& matrix) {
+    return multithread::MatrixImpl::RowSoftmax(matrix, true);
+  }
+
+  Matrix LogSumExp(const Matrix& matrix) {
+    return multithread::MatrixImpl::RowLogSumExp(matrix);
+  }
+
+  Matrix ColSoftmax(const Matrix& matrix) {
+    return multithread::MatrixImpl::ColSoftmax(matrix, false);
+  }
+
+  Matrix ColLogSoftmax(const Matrix& matrix) {
+    return multithread::MatrixImpl::ColSoftmax(matrix, true);
+  }
+
+  Matrix ColLogSumExp(const Matrix& matrix) {
+    return multithread::MatrixImpl::ColLogSumExp(matrix);
+  }
+
+  std::vector<size_t> ArgMax(const Matrix& matrix) {
+    return multithread::MatrixImpl::RowArgExtreme(matrix, false);
+  }
+
+  std::vector<size_t> ArgMin(const Matrix& matrix) {
+    return multithread::MatrixImpl::RowArgExtreme(matrix, true);
+  }
+
+  std::vector<size_t> ColArgMax(const Matrix& matrix) {
+    return multithread::MatrixImpl::ColArgExtreme(matrix, false);
+  }
+
+  std::vector<size_t> ColArgMin(const Matrix& matrix) {
+    return multithread::MatrixImpl::ColArgExtreme(matrix, true);
+  }
+
+  ValuesWithIndices TopK(const Matrix& matrix, size_t k) {
+    auto [values, indices] = multithread::MatrixImpl::RowTopK(matrix, k);
+    return {std::move(values), std::move(indices)};
+  }
+
+  std::vector<size_t> ArgSort(const Matrix& matrix, bool descending) {
+    return multithread::MatrixImpl::RowArgSort(matrix, descending);
+  }
+
+  Matrix Gather(const Matrix& matrix, std::span<const size_t> rows) {
+    return multithread::MatrixImpl::Gather(matrix, rows);
+  }
+
+  Matrix Permute(const Matrix& matrix, std::span<const size_t> rows) {
+    std::vector<bool> seen(matrix.NumRows());
+    bool valid = static_cast<size_t>(rows.size()) == matrix.NumRows();
+    for (size_t i = 0; valid && i < static_cast<size_t>(rows.size()); i++) {
+      valid = rows[i] >= 0 && rows[i] < matrix.NumRows() && !seen[rows[i]];
+      if (valid) {
+        seen[rows[i]] = true;
+      }
+    }
+    if (!valid) {
+      std::ostringstream os;
+      os << "Not a permutation of " << matrix.NumRows() << " rows";
+      throw std::invalid_argument(os.str());
+    }
+    return multithread::MatrixImpl::Gather(matrix, rows);
+  }
+
+  void Scatter(Matrix& target, std::span<const size_t> rows, const Matrix& source) {
+    multithread::MatrixImpl::Scatter(target, rows, source, false);
+  }
+
+  void ScatterAdd(Matrix& target, std::span<const size_t> rows, const Matrix& source) {
+    multithread::MatrixImpl::Scatter(target, rows, source, true);
+  }
+
+  LossWithGradient SoftmaxCrossEntropy(const Matrix& logits, const Matrix& targets) {
+    auto [loss, gradient] = multithread::MatrixImpl::SoftmaxCrossEntropy(logits, targets);
+    return {std::move(loss), std::move(gradient)};
+  }
+
+  LossWithGradient SoftmaxCrossEntropy(const Matrix& logits, const std::vector<size_t>& labels) {
+    auto [loss, gradient] = multithread::MatrixImpl::SoftmaxCrossEntropy(logits, labels);
+    return {std::move(loss), std::move(gradient)};
+  }
+
   Matrix Pack(const std::vector<Matrix>& matrices) {
     size_t size = 0;
     for (auto it = matrices.begin(); it != matrices.end(); it++) {
@@ -197,6 +384,73 @@ namespace math {
     return matrices;
   }
 
+  namespace {
+    // Blocks decoded per read, enough to keep every worker busy while bounding the memory held in
+    //   compressed form.
+    const size_t kMtxBlocksPerRead = 4 * multithread::kNumKernels;
+
+    // Reads numCells cells of elementSize bytes each into dst, decoding them if the file is
+    //   compressed.
+    void ReadMtxPayload(
+        std::istream& in, int controlReg, char* dst, size_t numCells, size_t elementSize) {
+      if (!(controlReg & kMtxCompressedBit)) {
+        in.read(dst, elementSize * numCells);
+        return;
+      }
+
+      static stats::Counter counter("DecompressMtx", stats::Backend::kMultiThread);
+      stats::Probe probe(counter, 1, numCells, numCells, 0, 2 * numCells * elementSize);
+
+      size_t numBlocks = (numCells + kMtxBlockCells - 1) / kMtxBlockCells;
+      std::vector<int> sizes(numBlocks);
+      in.read(reinterpret_cast<char*>(sizes.data()), sizeof(int) * numBlocks);
+      if (in.gcount() != static_cast<std::streamsize>(sizeof(int) * numBlocks)) {
+        throw mdl::io::io_exception("Unexpected end of compressed matrix");
+      }
+
+      std::vector<size_t> offsets;
+      std::unique_ptr<char[]> buffer;
+      size_t capacity = 0;
+      for (size_t firstBlock = 0; firstBlock < numBlocks; firstBlock += kMtxBlocksPerRead) {
+        size_t lastBlock = std::min(numBlocks, firstBlock + kMtxBlocksPerRead);
+
+        offsets.assign(1, 0);
+        for (size_t block = firstBlock; block < lastBlock; block++) {
+          size_t rawSize = std::min(kMtxBlockCells, numCells - block * kMtxBlockCells)
+              * elementSize;
+          if (sizes[block] <= 0 || static_cast<size_t>(sizes[block]) > rawSize) {
+            throw mdl::io::io_exception("Corrupted compressed matrix");
+          }
+          offsets.push_back(offsets.back() + sizes[block]);
+        }
+        if (offsets.back() > capacity) {
+          capacity = offsets.back();
+          buffer.reset(new char[capacity]);
+        }
+        in.read(buffer.get(), offsets.back());
+        if (static_cast<size_t>(in.gcount()) != offsets.back()) {
+          throw mdl::io::io_exception("Unexpected end of compressed matrix");
+        }
+
+        std::atomic<bool> corrupted(false);
+        multithread::ParallelFor(lastBlock - firstBlock, kMtxBlockCells,
+            [&](size_t from, size_t to) {
+          for (size_t i = from; i < to; i++) {
+            size_t block = firstBlock + i;
+            size_t count = std::min(kMtxBlockCells, numCells - block * kMtxBlockCells);
+            if (!compression::DecodeShuffled(buffer.get() + offsets[i], sizes[block],
+                dst + block * kMtxBlockCells * elementSize, count, elementSize)) {
+              corrupted = true;
+            }
+          }
+        });
+        if (corrupted) {
+          throw mdl::io::io_exception("Corrupted compressed matrix");
+        }
+      }
+    }
+  }
+
   std::vector<Matrix> FromMtx(std::istream& in) {
     std::vector<Matrix> vec;
     FromMtx(in, [&vec](Matrix&& mat) {
@@ -245,7 +499,8 @@ namespace math {
         if (rows * cols > 0) {
           if (controlReg & kDoublePrecisionBit) {
             std::unique_ptr<double_t> buffer(new double_t[((size_t) rows) * cols]);
-            in->read(reinterpret_cast<char *>(buffer.get()), sizeof(double_t) * rows * cols);
+            ReadMtxPayload(*in, controlReg, reinterpret_cast<char *>(buffer.get()),
+                ((size_t) rows) * cols, sizeof(double_t));
 
             if (kDoublePrecision) {
               matrix = Matrix(rows, cols, reinterpret_cast<float_t *>(buffer.release()));
@@ -256,7 +511,8 @@ namespace math {
             }
           } else {
             std::unique_ptr<single_t> buffer(new single_t[((size_t) rows) * cols]);
-            in->read(reinterpret_cast<char *>(buffer.get()), sizeof(single_t) * rows * cols);
+            ReadMtxPayload(*in, controlReg, reinterpret_cast<char *>(buffer.get()),
+                ((size_t) rows) * cols, sizeof(single_t));
 
             if (kDoublePrecision) {
               matrix = Matrix(rows, cols, 
@@ -330,22 +586,88 @@ namespace math {
     };
   }
 
-  void SaveMtx(std::ostream& out, std::function<const Matrix* ()> supplier) {
+  void SaveMtx(
+      std::ostream& out, std::function<const Matrix* ()> supplier, MtxCompression compression) {
     mdl::util::functional::SupplierIterable<const Matrix> iterable(supplier);
-    SaveMtx(out, iterable.begin(), iterable.end());
+    SaveMtx(out, iterable.begin(), iterable.end(), compression);
+  }
+
+  MtxCompression MtxCompressionOf(const char* fileName) {
+    std::ifstream in(fileName, std::ios_base::binary);
+    if (!in.is_open()) {
+      throw mdl::util::exceptionstream()
+        .Append("Could not open file: ").Append(fileName)
+        .Build<mdl::io::file_not_found_exception>();
+    }
+
+    int header[2] = {0, 0};
+    in.read(reinterpret_cast<char *>(header), sizeof(header));
+    if (in.gcount() != sizeof(header) || header[0] != kMtxFileMark) {
+      throw mdl::util::exceptionstream()
+          .Append("Input does not appear to contain matrices")
+          .Build();
+    }
+    return header[1] & kMtxCompressedBit ? MtxCompression::kShuffleLZ : MtxCompression::kNone;
   }
 
-  void SaveMtx(std::ostream& out, const Matrix& matrix) {
-    SaveMtx(out, mdl::util::functional::AsSupplier(&matrix));
+  void SaveMtx(std::ostream& out, const Matrix& matrix, MtxCompression compression) {
+    SaveMtx(out, mdl::util::functional::AsSupplier(&matrix), compression);
   }
 
-  void SaveMtx(const char* fileName, std::function<const Matrix* ()> supplier) {
-    mdl::util::functional::SupplierIterable<const Matrix> iterable(supplier);
-    SaveMtx(fileName, iterable.begin(), iterable.end());
+  void SaveMtx(
+      const char* fileName, std::function<const Matrix* ()> supplier,
+      MtxCompression compression) {
+    // in the background, so the supplier computes the next matrix while this one is written
+    MtxWriter writer(fileName, MtxWriterOptions{compression, true});
+    for (const Matrix* matrix = supplier(); matrix; matrix = supplier()) {
+      writer.Write(*matrix);
+    }
+    writer.Close();
   }
 
-  void SaveMtx(const char* fileName, const Matrix& matrix) {
-    SaveMtx(fileName, mdl::util::functional::AsSupplier(&matrix));
+  void SaveMtx(const char* fileName, const Matrix& matrix, MtxCompression compression) {
+    SaveMtx(fileName, mdl::util::functional::AsSupplier(&matrix), compression);
+  }
+
+  void WriteMtxPayload(
+      const float_t* data, size_t numCells, MtxCompression compression,
+      const std::function<void (const char*, std::size_t)>& write) {
+    const char* bytes = reinterpret_cast<const char*>(data);
+    if (compression == MtxCompression::kNone) {
+      write(bytes, sizeof(float_t) * numCells);
+      return;
+    }
+
+    size_t numBlocks = (numCells + kMtxBlockCells - 1) / kMtxBlockCells;
+    std::vector<int> sizes(numBlocks);
+    std::vector<std::unique_ptr<char[]>> blocks(numBlocks);
+
+    static stats::Counter counter("CompressMtx", stats::Backend::kMultiThread);
+    stats::Probe probe(counter, 1, numCells, numCells, 0, 2 * numCells * sizeof(float_t));
+
+    multithread::ParallelFor(numBlocks, kMtxBlockCells, [&](size_t from, size_t to) {
+      for (size_t block = from; block < to; block++) {
+        size_t first = block * kMtxBlockCells;
+        size_t count = std::min(kMtxBlockCells, numCells - first);
+        size_t rawSize = count * sizeof(float_t);
+
+        std::unique_ptr<char[]> shuffled(new char[rawSize]);
+        compression::Shuffle(bytes + first * sizeof(float_t), shuffled.get(), count,
+            sizeof(float_t));
+        blocks[block].reset(new char[compression::CompressBound(rawSize)]);
+        size_t size = compression::Compress(shuffled.get(), rawSize, blocks[block].get());
+        // incompressible blocks are stored as is, which readers tell by their size
+        sizes[block] = size < rawSize ? size : rawSize;
+      }
+    });
+
+    write(reinterpret_cast<const char*>(sizes.data()), sizeof(int) * numBlocks);
+    for (size_t block = 0; block < numBlocks; block++) {
+      size_t first = block * kMtxBlockCells;
+      size_t rawSize = std::min(kMtxBlockCells, numCells - first) * sizeof(float_t);
+      write(sizes[block] < rawSize ? blocks[block].get() : bytes + first * sizeof(float_t),
+          sizes[block]);
+    }
   }
 
   void SaveCsv(const char* fileName, const Matrix& matrix) {
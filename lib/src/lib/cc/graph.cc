@@ -0,0 +1,496 @@
+#include "../h/graph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+#include "../h/multithread/helper.h"
+#include "../h/stats.h"
+
+namespace mdl {
+namespace math {
+  using multithread::Dot;
+  using multithread::ParallelFor;
+
+  namespace {
+    // Cells a fused element-wise step runs all of its operations on before moving on, so the
+    //   running values stay in L1.
+    const size_t kFusedBlockSize = 1024;
+    // Arena offsets are multiples of this many cells (a cache line), so buffers don't share lines.
+    const size_t kArenaAlignment = 16;
+
+    struct Lifetime {
+      int buffer;
+      size_t size;
+      int first;
+      int last;
+      size_t offset = 0;
+    };
+
+    // Greedy by size: largest buffers first, each at the lowest offset that doesn't overlap any
+    //   buffer placed before it and live during some of the same steps. Returns the arena size.
+    size_t PlaceBuffers(std::vector<Lifetime>& lifetimes) {
+      std::vector<Lifetime*> order;
+      for (Lifetime& lifetime : lifetimes) {
+        order.push_back(&lifetime);
+      }
+      std::stable_sort(order.begin(), order.end(), [](const Lifetime* l1, const Lifetime* l2) {
+        return l1->size > l2->size;
+      });
+
+      size_t arenaSize = 0;
+      std::vector<const Lifetime*> placed;
+      for (Lifetime* lifetime : order) {
+        std::vector<std::pair<size_t, size_t>> taken;
+        for (const Lifetime* other : placed) {
+          if (other->first <= lifetime->last && lifetime->first <= other->last) {
+            taken.push_back({other->offset, other->offset + other->size});
+          }
+        }
+        std::sort(taken.begin(), taken.end());
+
+        size_t offset = 0;
+        for (const auto& [begin, end] : taken) {
+          if (offset + lifetime->size <= begin) {
+            break;
+          }
+          offset = std::max(offset, end);
+        }
+
+        lifetime->offset = offset;
+        arenaSize = std::max(arenaSize, offset + lifetime->size);
+        placed.push_back(lifetime);
+      }
+      return arenaSize;
+    }
+
+    inline size_t Align(size_t cells) {
+      return (cells + kArenaAlignment - 1) / kArenaAlignment * kArenaAlignment;
+    }
+  }
+
+  bool Graph::IsElementwise(Kind kind) {
+    return kind != Kind::kInput && kind != Kind::kConstant && kind != Kind::kMultiply;
+  }
+
+  const Graph::Node& Graph::NodeOf(Value value) const {
+    if (value.id < 0 || value.id >= static_cast<int>(nodes.size())) {
+      throw std::invalid_argument("Value was not recorded by this graph");
+    }
+    return nodes[value.id];
+  }
+
+  Graph::Value Graph::Record(const Node& node) {
+    nodes.push_back(node);
+    return Value(nodes.size() - 1, node.rows, node.cols);
+  }
+
+  Graph::Value Graph::Input(size_t rows, size_t cols) {
+    Node node{Kind::kInput, rows, cols};
+    node.index = numInputs++;
+    return Record(node);
+  }
+
+  Graph::Value Graph::Constant(const Matrix& matrix) {
+    Node node{Kind::kConstant, matrix.NumRows(), matrix.NumCols()};
+    node.index = constants.size();
+    constants.push_back(matrix);
+    return Record(node);
+  }
+
+  Graph::Value Graph::Multiply(Value matrix1, Value matrix2) {
+    const Node& node1 = NodeOf(matrix1);
+    const Node& node2 = NodeOf(matrix2);
+    if (node1.cols != node2.rows) {
+      std::ostringstream os;
+      os << "Cannot multiply matrices of incompatible dimensions: "
+          << node1.rows << 'x' << node1.cols << " and " << node2.rows << 'x' << node2.cols;
+      throw std::invalid_argument(os.str());
+    }
+    return Record(Node{Kind::kMultiply, node1.rows, node2.cols, matrix1.id, matrix2.id});
+  }
+
+  Graph::Value Graph::Binary(Kind kind, Value matrix1, Value matrix2) {
+    const Node& node1 = NodeOf(matrix1);
+    const Node& node2 = NodeOf(matrix2);
+    if ((node2.rows != node1.rows && node2.rows != 1)
+        || (node2.cols != node1.cols && node2.cols != 1)) {
+      std::ostringstream os;
+      os << "Cannot operate on matrices of incompatible dimensions: "
+          << node1.rows << 'x' << node1.cols << " and " << node2.rows << 'x' << node2.cols;
+      throw std::invalid_argument(os.str());
+    }
+    return Record(Node{kind, node1.rows, node1.cols, matrix1.id, matrix2.id});
+  }
+
+  Graph::Value Graph::Unary(Kind kind, Value matrix, float_t scalar) {
+    const Node& node = NodeOf(matrix);
+    return Record(Node{kind, node.rows, node.cols, matrix.id, -1, scalar});
+  }
+
+  Graph::Value Graph::Add(Value matrix1, Value matrix2) {
+    return Binary(Kind::kAdd, matrix1, matrix2);
+  }
+
+  Graph::Value Graph::Subtract(Value matrix1, Value matrix2) {
+    return Binary(Kind::kSubtract, matrix1, matrix2);
+  }
+
+  Graph::Value Graph::Prod(Value matrix1, Value matrix2) {
+    return Binary(Kind::kProd, matrix1, matrix2);
+  }
+
+  Graph::Value Graph::Scale(Value matrix, float_t scalar) {
+    return Unary(Kind::kScale, matrix, scalar);
+  }
+
+  Graph::Value Graph::Exp(Value matrix) {
+    return Unary(Kind::kExp, matrix);
+  }
+
+  Graph::Value Graph::Sigmoid(Value matrix) {
+    return Unary(Kind::kSigmoid, matrix);
+  }
+
+  Graph::Value Graph::ReLU(Value matrix) {
+    return Unary(Kind::kReLU, matrix);
+  }
+
+  CompiledGraph Graph::Compile(const std::vector<Value>& outputs) const {
+    int numNodes = nodes.size();
+
+    // only what the outputs depend on is run; count the uses of each node among those
+    std::vector<bool> needed(numNodes, false);
+    std::vector<int> uses(numNodes, 0);
+    std::vector<int> outputOf(numNodes, -1);
+    for (std::size_t i = 0; i < outputs.size(); i++) {
+      NodeOf(outputs[i]);
+      needed[outputs[i].id] = true;
+      if (outputOf[outputs[i].id] < 0) {
+        outputOf[outputs[i].id] = i;
+      }
+    }
+    for (int id = numNodes - 1; id >= 0; id--) {
+      if (!needed[id]) { continue; }
+      for (int operand : {nodes[id].operand1, nodes[id].operand2}) {
+        if (operand >= 0) {
+          needed[operand] = true;
+          uses[operand]++;
+        }
+      }
+    }
+
+    // An element-wise node used only by another element-wise node (of the same shape) is fused
+    //   into it: both run in the same pass and the intermediate is never stored.
+    std::vector<int> fusedFrom(numNodes, -1);
+    std::vector<bool> fused(numNodes, false);
+    for (int id = 0; id < numNodes; id++) {
+      const Node& node = nodes[id];
+      if (!needed[id] || !IsElementwise(node.kind)) { continue; }
+      for (int operand : {node.operand1, node.operand2}) {
+        if (operand < 0) { continue; }
+        const Node& producer = nodes[operand];
+        if (IsElementwise(producer.kind) && uses[operand] == 1 && outputOf[operand] < 0
+            && producer.rows == node.rows && producer.cols == node.cols) {
+          fusedFrom[id] = operand;
+          fused[operand] = true;
+          break;
+        }
+      }
+    }
+
+    CompiledGraph compiled;
+    for (const Node& node : nodes) {
+      if (node.kind == Kind::kInput) {
+        compiled.inputShapes.resize(std::max<size_t>(compiled.inputShapes.size(), node.index + 1));
+        compiled.inputShapes[node.index] = {node.rows, node.cols};
+      }
+    }
+    for (const Value& output : outputs) {
+      compiled.outputs.push_back(Matrix(output.rows, output.cols));
+    }
+
+    std::vector<Lifetime> lifetimes;
+    auto newBuffer = [&compiled](CompiledGraph::Storage storage, size_t index) {
+      compiled.buffers.push_back(CompiledGraph::Buffer{storage, index});
+      return static_cast<int>(compiled.buffers.size() - 1);
+    };
+    auto newArenaBuffer = [&compiled, &lifetimes, &newBuffer](size_t cells) {
+      int buffer = newBuffer(CompiledGraph::Storage::kArena, 0);
+      int step = compiled.steps.size();
+      lifetimes.push_back(Lifetime{buffer, Align(cells), step, step});
+      return buffer;
+    };
+    auto read = [&compiled, &lifetimes](int buffer) {
+      for (Lifetime& lifetime : lifetimes) {
+        if (lifetime.buffer == buffer) {
+          lifetime.last = compiled.steps.size();
+        }
+      }
+      return buffer;
+    };
+
+    std::vector<int> bufferOf(numNodes, -1);
+    std::vector<int> transposedConstant(numNodes, -1);
+    for (int id = 0; id < numNodes; id++) {
+      const Node& node = nodes[id];
+      if (!needed[id]) { continue; }
+
+      if (node.kind == Kind::kInput) {
+        bufferOf[id] = newBuffer(CompiledGraph::Storage::kInput, node.index);
+        continue;
+      }
+      if (node.kind == Kind::kConstant) {
+        compiled.constants.push_back(constants[node.index]);
+        bufferOf[id] = newBuffer(CompiledGraph::Storage::kConstant, compiled.constants.size() - 1);
+        continue;
+      }
+      if (fused[id]) { continue; }
+
+      CompiledGraph::Step step{node.kind == Kind::kMultiply, node.rows, node.cols};
+      if (node.kind == Kind::kMultiply) {
+        const Node& right = nodes[node.operand2];
+        step.inner = right.rows;
+        step.operand1 = read(bufferOf[node.operand1]);
+        if (right.cols == 1) {
+          // a column vector is its own transpose
+          step.operand2 = read(bufferOf[node.operand2]);
+        } else if (right.kind == Kind::kConstant) {
+          if (transposedConstant[node.operand2] < 0) {
+            compiled.constants.push_back(constants[right.index].Transpose());
+            transposedConstant[node.operand2] = newBuffer(
+                CompiledGraph::Storage::kConstant, compiled.constants.size() - 1);
+          }
+          step.operand2 = transposedConstant[node.operand2];
+        } else {
+          step.operand2 = read(bufferOf[node.operand2]);
+          step.scratch = newArenaBuffer(right.rows * right.cols);
+        }
+      } else {
+        // walk the fused chain back to its first operation
+        std::vector<int> chain({id});
+        while (fusedFrom[chain.back()] >= 0) {
+          chain.push_back(fusedFrom[chain.back()]);
+        }
+        std::reverse(chain.begin(), chain.end());
+
+        step.source = read(bufferOf[nodes[chain[0]].operand1]);
+        for (std::size_t i = 0; i < chain.size(); i++) {
+          const Node& link = nodes[chain[i]];
+          CompiledGraph::Apply apply{link.kind};
+          apply.scalar = link.scalar;
+
+          int operand = link.operand2;
+          if (i > 0 && link.operand2 == chain[i - 1]) {
+            operand = link.operand1;
+            apply.reversed = true;
+          }
+          if (operand >= 0) {
+            const Node& other = nodes[operand];
+            apply.operand = read(bufferOf[operand]);
+            if (other.rows == 1 && other.cols == 1) {
+              apply.broadcast = CompiledGraph::Broadcast::kScalar;
+            } else if (other.rows == 1 && node.rows > 1) {
+              apply.broadcast = CompiledGraph::Broadcast::kRow;
+            } else if (other.cols == 1 && node.cols > 1) {
+              apply.broadcast = CompiledGraph::Broadcast::kCol;
+            }
+          }
+          step.applies.push_back(apply);
+        }
+      }
+
+      if (outputOf[id] >= 0) {
+        step.out = newBuffer(CompiledGraph::Storage::kOutput, outputOf[id]);
+      } else {
+        step.out = newArenaBuffer(node.rows * node.cols);
+      }
+      bufferOf[id] = step.out;
+      compiled.steps.push_back(step);
+    }
+
+    // outputs not written in place (inputs, constants, repeated outputs) are copied
+    for (std::size_t i = 0; i < outputs.size(); i++) {
+      int id = outputs[i].id;
+      if (outputOf[id] == static_cast<int>(i) && nodes[id].kind != Kind::kInput
+          && nodes[id].kind != Kind::kConstant) {
+        continue;
+      }
+      CompiledGraph::Step step{false, nodes[id].rows, nodes[id].cols};
+      step.source = read(bufferOf[id]);
+      step.out = newBuffer(CompiledGraph::Storage::kOutput, i);
+      compiled.steps.push_back(step);
+    }
+
+    compiled.arenaSize = PlaceBuffers(lifetimes);
+    for (const Lifetime& lifetime : lifetimes) {
+      compiled.buffers[lifetime.buffer].index = lifetime.offset;
+    }
+    compiled.arena.reset(new float_t[compiled.arenaSize]);
+    compiled.addresses.resize(compiled.buffers.size());
+    return compiled;
+  }
+
+  const std::vector<Matrix>& CompiledGraph::Run(
+      std::initializer_list<std::reference_wrapper<const Matrix>> inputs) {
+    if (inputs.size() != inputShapes.size()) {
+      std::ostringstream os;
+      os << "Expected " << inputShapes.size() << " inputs, got " << inputs.size();
+      throw std::invalid_argument(os.str());
+    }
+    const std::reference_wrapper<const Matrix>* input = inputs.begin();
+    for (std::size_t i = 0; i < inputShapes.size(); i++) {
+      const Matrix& matrix = input[i];
+      if (matrix.rows != inputShapes[i].first || matrix.cols != inputShapes[i].second) {
+        std::ostringstream os;
+        os << "Input " << i << " should be " << inputShapes[i].first << 'x'
+            << inputShapes[i].second << ", got " << matrix.rows << 'x' << matrix.cols;
+        throw std::invalid_argument(os.str());
+      }
+    }
+
+    for (std::size_t b = 0; b < buffers.size(); b++) {
+      const Buffer& buffer = buffers[b];
+      switch (buffer.storage) {
+        case Storage::kInput: addresses[b] = input[buffer.index].get().data.get(); break;
+        case Storage::kConstant: addresses[b] = constants[buffer.index].data.get(); break;
+        case Storage::kArena: addresses[b] = arena.get() + buffer.index; break;
+        case Storage::kOutput: addresses[b] = outputs[buffer.index].data.get(); break;
+      }
+    }
+
+    for (const Step& step : steps) {
+      if (step.multiply) {
+        RunMultiply(step);
+      } else {
+        RunElementwise(step);
+      }
+    }
+    return outputs;
+  }
+
+  void CompiledGraph::RunMultiply(const Step& step) {
+    size_t rows = step.rows;
+    size_t cols = step.cols;
+    size_t inner = step.inner;
+    static stats::Counter counter("GraphMultiply", stats::Backend::kMultiThread);
+    std::uint64_t outCells = static_cast<std::uint64_t>(rows) * cols;
+    stats::Probe probe(counter, rows, cols, outCells, 2 * outCells * inner,
+        (static_cast<std::uint64_t>(rows) * inner + inner * cols + outCells) * sizeof(float_t));
+
+    const float_t* m1Data = addresses[step.operand1];
+    const float_t* m2Data = addresses[step.operand2];
+    float_t* out = addresses[step.out];
+
+    if (step.scratch >= 0) {
+      float_t* transposed = addresses[step.scratch];
+      ParallelFor(cols, inner, [m2Data, transposed, inner, cols](size_t from, size_t to) {
+        for (size_t col = from; col < to; col++) {
+          for (size_t i = 0; i < inner; i++) {
+            transposed[col * inner + i] = m2Data[i * cols + col];
+          }
+        }
+      });
+      m2Data = transposed;
+    }
+
+    ParallelFor(rows * cols, inner, [m1Data, m2Data, out, cols, inner](size_t from, size_t to) {
+      size_t row = from / cols;
+      size_t col = from % cols;
+      for (size_t cell = from; cell < to; cell++) {
+        out[cell] = Dot(m1Data + row * inner, m2Data + col * inner, inner);
+        if (++col == cols) {
+          col = 0;
+          row++;
+        }
+      }
+    });
+  }
+
+  void CompiledGraph::RunElementwise(const Step& step) {
+    size_t cols = step.cols;
+    std::uint64_t numCells = static_cast<std::uint64_t>(step.rows) * cols;
+    static stats::Counter counter("GraphElementwise", stats::Backend::kMultiThread);
+    stats::Probe probe(counter, step.rows, cols, numCells, numCells * step.applies.size(),
+        (step.applies.size() + 2) * numCells * sizeof(float_t));
+
+    const float_t* source = addresses[step.source];
+    float_t* out = addresses[step.out];
+
+    ParallelFor(numCells, [this, &step, source, out, cols](size_t from, size_t to) {
+      for (size_t block = from; block < to; block += kFusedBlockSize) {
+        size_t end = std::min(to, block + kFusedBlockSize);
+        std::copy(source + block, source + end, out + block);
+        for (const Apply& apply : step.applies) {
+          const float_t* operand = apply.operand >= 0 ? addresses[apply.operand] : nullptr;
+          ApplyBlock(apply, operand, out, block, end, cols);
+        }
+      }
+    });
+  }
+
+  void CompiledGraph::ApplyBlock(
+      const Apply& apply, const float_t* operand, float_t* out, size_t from, size_t to,
+      size_t cols) {
+    // calls fn(value, operand) for every cell, with the operand broadcast as needed
+    auto binary = [&apply, operand, out, from, to, cols](auto fn) {
+      switch (apply.broadcast) {
+        case Broadcast::kNone:
+          for (size_t i = from; i < to; i++) { fn(out[i], operand[i]); }
+          break;
+        case Broadcast::kScalar:
+          for (size_t i = from; i < to; i++) { fn(out[i], operand[0]); }
+          break;
+        case Broadcast::kRow:
+          for (size_t i = from, col = from % cols; i < to; i++) {
+            fn(out[i], operand[col]);
+            if (++col == cols) { col = 0; }
+          }
+          break;
+        case Broadcast::kCol:
+          for (size_t i = from, row = from / cols, col = from % cols; i < to; i++) {
+            fn(out[i], operand[row]);
+            if (++col == cols) {
+              col = 0;
+              row++;
+            }
+          }
+          break;
+      }
+    };
+
+    float_t scalar = apply.scalar;
+    switch (apply.kind) {
+      case Graph::Kind::kAdd:
+        binary([](float_t& value, float_t other) { value += other; });
+        break;
+      case Graph::Kind::kSubtract:
+        if (apply.reversed) {
+          binary([](float_t& value, float_t other) { value = other - value; });
+        } else {
+          binary([](float_t& value, float_t other) { value -= other; });
+        }
+        break;
+      case Graph::Kind::kProd:
+        binary([](float_t& value, float_t other) { value *= other; });
+        break;
+      case Graph::Kind::kScale:
+        for (size_t i = from; i < to; i++) { out[i] *= scalar; }
+        break;
+      case Graph::Kind::kExp:
+        for (size_t i = from; i < to; i++) { out[i] = std::exp(out[i]); }
+        break;
+      case Graph::Kind::kSigmoid:
+        for (size_t i = from; i < to; i++) { out[i] = 1.0 / (1.0 + std::exp(-out[i])); }
+        break;
+      case Graph::Kind::kReLU:
+        for (size_t i = from; i < to; i++) { out[i] = out[i] > 0 ? out[i] : 0.0; }
+        break;
+      default:
+        break;
+    }
+  }
+
+} // math
+} // mdl
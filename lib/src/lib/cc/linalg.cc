@@ -0,0 +1,494 @@
+#include "../h/linalg.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+#include "../h/matrices.h"
+#include "../h/matrix_operator_overload.h"
+#include "../h/range.h"
+#include "../h/multithread/helper.h"
+#include <mdl/profiler.h>
+
+namespace mdl {
+namespace math {
+  using multithread::ParallelFor;
+
+  namespace {
+    void CheckSquare(const Matrix& matrix, const char* what) {
+      if (matrix.NumRows() != matrix.NumCols()) {
+        std::ostringstream os;
+        os << what << " requires a square matrix, got "
+            << matrix.NumRows() << 'x' << matrix.NumCols();
+        throw std::invalid_argument(os.str());
+      }
+    }
+
+    void CheckRhs(const Matrix& matrix, const Matrix& b) {
+      if (matrix.NumRows() != b.NumRows()) {
+        std::ostringstream os;
+        os << "Cannot solve system of incompatible dimensions: "
+            << matrix.NumRows() << 'x' << matrix.NumCols()
+            << " and " << b.NumRows() << 'x' << b.NumCols();
+        throw std::invalid_argument(os.str());
+      }
+    }
+
+    // data[row, col] -= update[row - fromRow, col - fromCol] over update's shape. When
+    //   "lowerOnly", only cells on or below the diagonal of data are touched.
+    void SubtractBlock(
+        float_t* data,
+        size_t cols,
+        size_t fromRow,
+        size_t fromCol,
+        Matrix update,
+        bool lowerOnly = false) {
+      const float_t* src = &update(0, 0);
+      size_t rows = update.NumRows();
+      size_t ucols = update.NumCols();
+
+      ParallelFor(rows, ucols, [=](size_t from, size_t to) {
+        for (size_t row = from; row < to; row++) {
+          float_t* dest = data + (fromRow + row) * cols + fromCol;
+          const float_t* runner = src + row * ucols;
+          size_t end = lowerOnly ? std::min(ucols, fromRow + row - fromCol + 1) : ucols;
+          for (size_t col = 0; col < end; col++) {
+            dest[col] -= runner[col];
+          }
+        }
+      });
+    }
+
+    // Solves L * X = B in place (B is n x k, row major), for a lower triangular n x n L.
+    void ForwardSubstitute(const float_t* l, size_t n, bool unitDiagonal, float_t* x, size_t k) {
+      ParallelFor(k, static_cast<std::uint64_t>(n) * n / 2, [=](size_t from, size_t to) {
+        for (size_t i = 0; i < n; i++) {
+          float_t* xi = x + i * k;
+          for (size_t j = 0; j < i; j++) {
+            float_t lij = l[i * n + j];
+            if (lij == 0.0) { continue; }
+            const float_t* xj = x + j * k;
+            for (size_t c = from; c < to; c++) {
+              xi[c] -= lij * xj[c];
+            }
+          }
+          if (!unitDiagonal) {
+            float_t diagonal = l[i * n + i];
+            for (size_t c = from; c < to; c++) {
+              xi[c] /= diagonal;
+            }
+          }
+        }
+      });
+    }
+
+    // Solves U * X = B in place, for an upper triangular n x n U stored with "ldu" columns. When
+    //   "transposed", U is read as the transpose of the lower triangle instead.
+    void BackSubstitute(
+        const float_t* u, size_t ldu, size_t n, bool transposed, float_t* x, size_t k) {
+      ParallelFor(k, static_cast<std::uint64_t>(n) * n / 2, [=](size_t from, size_t to) {
+        for (size_t i = n - 1; i >= 0; i--) {
+          float_t* xi = x + i * k;
+          for (size_t j = i + 1; j < n; j++) {
+            float_t uij = transposed ? u[j * ldu + i] : u[i * ldu + j];
+            if (uij == 0.0) { continue; }
+            const float_t* xj = x + j * k;
+            for (size_t c = from; c < to; c++) {
+              xi[c] -= uij * xj[c];
+            }
+          }
+          float_t diagonal = u[i * ldu + i];
+          for (size_t c = from; c < to; c++) {
+            xi[c] /= diagonal;
+          }
+        }
+      });
+    }
+  }
+
+  LU::LU(const Matrix& matrix)
+      : factors(matrix), permutation(matrix.NumRows()), sign(1), singular(false) {
+    auto g = profiler::probe("LU");
+    CheckSquare(matrix, "LU factorization");
+
+    size_t n = factors.NumRows();
+    float_t* a = factors.data.get();
+    std::iota(permutation.begin(), permutation.end(), 0);
+
+    for (size_t k = 0; k < n; k += kFactorizationBlockSize) {
+      size_t kb = std::min(k + kFactorizationBlockSize, n);
+
+      // Panel: unblocked elimination of columns [k, kb), all rows below the diagonal.
+      for (size_t j = k; j < kb; j++) {
+        size_t pivotRow = j;
+        for (size_t i = j + 1; i < n; i++) {
+          if (std::abs(a[i * n + j]) > std::abs(a[pivotRow * n + j])) {
+            pivotRow = i;
+          }
+        }
+        if (pivotRow != j) {
+          // Swapping full rows also applies the interchange to the finished L columns on the
+          //   left and to the not yet updated columns on the right.
+          std::swap_ranges(a + j * n, a + (j + 1) * n, a + pivotRow * n);
+          std::swap(permutation[j], permutation[pivotRow]);
+          sign = -sign;
+        }
+
+        float_t pivot = a[j * n + j];
+        if (pivot == 0.0) {
+          // nothing left to eliminate in this column
+          singular = true;
+          continue;
+        }
+
+        ParallelFor(n - j - 1, kb - j, [a, n, j, kb, pivot](size_t from, size_t to) {
+          const float_t* pivotData = a + j * n;
+          for (size_t i = j + 1 + from; i < j + 1 + to; i++) {
+            float_t* row = a + i * n;
+            float_t l = row[j] /= pivot;
+            for (size_t c = j + 1; c < kb; c++) {
+              row[c] -= l * pivotData[c];
+            }
+          }
+        });
+      }
+
+      if (kb == n) {
+        break;
+      }
+
+      // U12 = L11^-1 * A12, split by columns.
+      ParallelFor(n - kb, static_cast<std::uint64_t>(kb - k) * (kb - k),
+          [a, n, k, kb](size_t from, size_t to) {
+        for (size_t i = k + 1; i < kb; i++) {
+          float_t* row = a + i * n + kb;
+          for (size_t j = k; j < i; j++) {
+            float_t l = a[i * n + j];
+            const float_t* pivotData = a + j * n + kb;
+            for (size_t c = from; c < to; c++) {
+              row[c] -= l * pivotData[c];
+            }
+          }
+        }
+      });
+
+      // A22 -= L21 * U12
+      Matrix l21 = factors(Range(kb, n), Range(k, kb));
+      Matrix u12 = factors(Range(k, kb), Range(kb, n));
+      SubtractBlock(a, n, kb, kb, l21 * u12);
+    }
+  }
+
+  Matrix LU::L() const {
+    size_t n = factors.NumRows();
+    return Matrix(n, n, [this](size_t row, size_t col) {
+      return row > col ? factors(row, col) : (row == col ? 1.0f : 0.0f);
+    });
+  }
+
+  Matrix LU::U() const {
+    size_t n = factors.NumRows();
+    return Matrix(n, n, [this](size_t row, size_t col) {
+      return row <= col ? factors(row, col) : 0.0f;
+    });
+  }
+
+  float_t LU::Determinant() const {
+    float_t det = sign;
+    for (size_t i = 0; i < factors.NumRows(); i++) {
+      det *= factors(i, i);
+    }
+    return det;
+  }
+
+  Matrix LU::Solve(const Matrix& b) const {
+    CheckRhs(factors, b);
+    if (singular) {
+      throw std::invalid_argument("Cannot solve system: matrix is singular");
+    }
+
+    size_t n = factors.NumRows();
+    size_t k = b.NumCols();
+    float_t* bData = b.data.get();
+    Matrix x(n, k, new float_t[n * k]);
+    float_t* xData = x.data.get();
+    for (size_t i = 0; i < n; i++) {
+      std::memcpy(xData + i * k, bData + permutation[i] * k, k * sizeof(float_t));
+    }
+
+    ForwardSubstitute(factors.data.get(), n, true, xData, k);
+    BackSubstitute(factors.data.get(), n, n, false, xData, k);
+    return x;
+  }
+
+  Matrix LU::Inverse() const {
+    return Solve(Matrices::Identity(factors.NumRows()));
+  }
+
+  Cholesky::Cholesky(const Matrix& matrix) : factors(matrix) {
+    auto g = profiler::probe("Cholesky");
+    CheckSquare(matrix, "Cholesky factorization");
+
+    size_t n = factors.NumRows();
+    float_t* a = factors.data.get();
+
+    for (size_t k = 0; k < n; k += kFactorizationBlockSize) {
+      size_t kb = std::min(k + kFactorizationBlockSize, n);
+
+      // Diagonal block. Contributions from columns before k were already subtracted by the
+      //   trailing updates of previous steps.
+      for (size_t j = k; j < kb; j++) {
+        float_t* rowJ = a + j * n;
+        float_t diagonal = rowJ[j];
+        for (size_t l = k; l < j; l++) {
+          diagonal -= rowJ[l] * rowJ[l];
+        }
+        if (!(diagonal > 0.0)) {
+          throw std::invalid_argument(
+              "Cholesky factorization requires a positive definite matrix");
+        }
+        rowJ[j] = std::sqrt(diagonal);
+
+        for (size_t i = j + 1; i < kb; i++) {
+          float_t* rowI = a + i * n;
+          float_t sum = rowI[j];
+          for (size_t l = k; l < j; l++) {
+            sum -= rowI[l] * rowJ[l];
+          }
+          rowI[j] = sum / rowJ[j];
+        }
+      }
+
+      if (kb == n) {
+        break;
+      }
+
+      // L21 = A21 * L11^-T, split by rows.
+      ParallelFor(n - kb, static_cast<std::uint64_t>(kb - k) * (kb - k),
+          [a, n, k, kb](size_t from, size_t to) {
+        for (size_t i = kb + from; i < kb + to; i++) {
+          float_t* rowI = a + i * n;
+          for (size_t j = k; j < kb; j++) {
+            const float_t* rowJ = a + j * n;
+            float_t sum = rowI[j];
+            for (size_t l = k; l < j; l++) {
+              sum -= rowI[l] * rowJ[l];
+            }
+            rowI[j] = sum / rowJ[j];
+          }
+        }
+      });
+
+      // A22 -= L21 * L21', lower triangle only.
+      Matrix l21 = factors(Range(kb, n), Range(k, kb));
+      SubtractBlock(a, n, kb, kb, l21 * l21.Transposed(), true);
+    }
+  }
+
+  Matrix Cholesky::L() const {
+    size_t n = factors.NumRows();
+    return Matrix(n, n, [this](size_t row, size_t col) {
+      return row >= col ? factors(row, col) : 0.0f;
+    });
+  }
+
+  float_t Cholesky::Determinant() const {
+    float_t det = 1.0;
+    for (size_t i = 0; i < factors.NumRows(); i++) {
+      det *= factors(i, i) * factors(i, i);
+    }
+    return det;
+  }
+
+  Matrix Cholesky::Solve(const Matrix& b) const {
+    CheckRhs(factors, b);
+
+    size_t n = factors.NumRows();
+    Matrix x = b;
+    ForwardSubstitute(factors.data.get(), n, false, x.data.get(), x.NumCols());
+    BackSubstitute(factors.data.get(), n, n, true, x.data.get(), x.NumCols());
+    return x;
+  }
+
+  QR::QR(const Matrix& matrix) : factors(matrix), tau(matrix.NumCols()) {
+    auto g = profiler::probe("QR");
+    size_t m = factors.NumRows();
+    size_t n = factors.NumCols();
+    if (m < n) {
+      std::ostringstream os;
+      os << "QR factorization requires at least as many rows as columns, got "
+          << m << 'x' << n;
+      throw std::invalid_argument(os.str());
+    }
+
+    float_t* a = factors.data.get();
+
+    for (size_t k = 0; k < n; k += kFactorizationBlockSize) {
+      size_t kb = std::min(k + kFactorizationBlockSize, n);
+      size_t b = kb - k;
+
+      // Panel: Householder reflections for columns [k, kb), applied within the panel only.
+      for (size_t j = k; j < kb; j++) {
+        double sigma = 0.0;
+        for (size_t i = j + 1; i < m; i++) {
+          sigma += static_cast<double>(a[i * n + j]) * a[i * n + j];
+        }
+        if (sigma == 0.0) {
+          tau[j] = 0.0;
+          continue;
+        }
+
+        double alpha = a[j * n + j];
+        double norm = std::sqrt(alpha * alpha + sigma);
+        double beta = alpha >= 0.0 ? -norm : norm;
+        tau[j] = (beta - alpha) / beta;
+        float_t scale = 1.0 / (alpha - beta);
+        for (size_t i = j + 1; i < m; i++) {
+          a[i * n + j] *= scale;
+        }
+        a[j * n + j] = beta;
+
+        for (size_t c = j + 1; c < kb; c++) {
+          float_t w = a[j * n + c];
+          for (size_t i = j + 1; i < m; i++) {
+            w += a[i * n + j] * a[i * n + c];
+          }
+          w *= tau[j];
+          a[j * n + c] -= w;
+          for (size_t i = j + 1; i < m; i++) {
+            a[i * n + c] -= a[i * n + j] * w;
+          }
+        }
+      }
+
+      if (kb == n) {
+        break;
+      }
+
+      // The panel's reflections H(k) ... H(kb - 1) = I - V * T * V', with V the unit lower
+      //   trapezoidal (m - k) x b matrix of Householder vectors and T upper triangular.
+      Matrix v(m - k, b, [a, n, k](size_t row, size_t col) {
+        return row > col ? a[(k + row) * n + k + col] : (row == col ? 1.0f : 0.0f);
+      });
+      Matrix t(b, b);
+      for (size_t j = 0; j < b; j++) {
+        t(j, j) = tau[k + j];
+        for (size_t i = 0; i < j; i++) {
+          // z = V(:, i)' * V(:, j)
+          float_t z = 0.0;
+          for (size_t row = j; row < m - k; row++) {
+            z += v(row, i) * v(row, j);
+          }
+          for (size_t l = 0; l <= i; l++) {
+            t(l, j) -= tau[k + j] * t(l, i) * z;
+          }
+        }
+      }
+
+      // A2 = H' * A2 = A2 - V * (T' * (V' * A2))
+      Matrix a2 = factors(Range(k, m), Range(kb, n));
+      Matrix w = t.Transposed() * (v.Transposed() * a2);
+      SubtractBlock(a, n, k, kb, v * w);
+    }
+  }
+
+  Matrix QR::Q() const {
+    size_t m = factors.NumRows();
+    size_t n = factors.NumCols();
+    Matrix q(m, n);
+    float_t* qData = q.data.get();
+    const float_t* a = factors.data.get();
+    for (size_t i = 0; i < n; i++) {
+      qData[i * n + i] = 1.0;
+    }
+
+    // Q = H(0) * ... * H(n - 1) * I, applied right to left. H(j) only touches rows and columns
+    //   from j onwards at that point.
+    for (size_t j = n - 1; j >= 0; j--) {
+      float_t tj = tau[j];
+      if (tj == 0.0) { continue; }
+      ParallelFor(n - j, m - j, [=](size_t from, size_t to) {
+        for (size_t c = j + from; c < j + to; c++) {
+          float_t w = qData[j * n + c];
+          for (size_t i = j + 1; i < m; i++) {
+            w += a[i * n + j] * qData[i * n + c];
+          }
+          w *= tj;
+          qData[j * n + c] -= w;
+          for (size_t i = j + 1; i < m; i++) {
+            qData[i * n + c] -= a[i * n + j] * w;
+          }
+        }
+      });
+    }
+    return q;
+  }
+
+  Matrix QR::R() const {
+    size_t n = factors.NumCols();
+    return Matrix(n, n, [this](size_t row, size_t col) {
+      return row <= col ? factors(row, col) : 0.0f;
+    });
+  }
+
+  Matrix QR::Solve(const Matrix& b) const {
+    CheckRhs(factors, b);
+
+    size_t m = factors.NumRows();
+    size_t n = factors.NumCols();
+    size_t k = b.NumCols();
+    const float_t* a = factors.data.get();
+    for (size_t i = 0; i < n; i++) {
+      if (factors(i, i) == 0.0) {
+        throw std::invalid_argument("Cannot solve least squares: matrix is rank deficient");
+      }
+    }
+
+    // Y = Q' * B
+    Matrix y = b;
+    float_t* yData = y.data.get();
+    for (size_t j = 0; j < n; j++) {
+      float_t tj = tau[j];
+      if (tj == 0.0) { continue; }
+      ParallelFor(k, m - j, [=](size_t from, size_t to) {
+        for (size_t c = from; c < to; c++) {
+          float_t w = yData[j * k + c];
+          for (size_t i = j + 1; i < m; i++) {
+            w += a[i * n + j] * yData[i * k + c];
+          }
+          w *= tj;
+          yData[j * k + c] -= w;
+          for (size_t i = j + 1; i < m; i++) {
+            yData[i * k + c] -= a[i * n + j] * w;
+          }
+        }
+      });
+    }
+
+    // R * X = Y(0:n, :)
+    Matrix x = y(Range(0, n), Range(0, k));
+    BackSubstitute(a, n, n, false, x.data.get(), k);
+    return x;
+  }
+
+  Matrix Solve(const Matrix& a, const Matrix& b) {
+    return LU(a).Solve(b);
+  }
+
+  Matrix LeastSquares(const Matrix& a, const Matrix& b) {
+    return QR(a).Solve(b);
+  }
+
+  Matrix Inverse(const Matrix& matrix) {
+    return LU(matrix).Inverse();
+  }
+
+  float_t Determinant(const Matrix& matrix) {
+    return LU(matrix).Determinant();
+  }
+
+} // math
+} // mdl
@@ -0,0 +1,251 @@
+#include "../h/mask.h"
+#include "../h/matrices.h"
+
+#include <bit>
+#include <memory>
+#include <optional>
+
+namespace mdl {
+namespace math {
+
+  using multithread::ParallelFor;
+
+  namespace {
+    void CheckDimensions(const char* what, const Mask& mask, size_t rows, size_t cols) {
+      if (mask.NumRows() != rows || mask.NumCols() != cols) {
+        std::ostringstream os;
+        os << "Cannot apply a " << mask.NumRows() << 'x' << mask.NumCols() << " mask to "
+            << what << " of " << rows << 'x' << cols;
+        throw std::invalid_argument(os.str());
+      }
+    }
+
+    // out[j] = bit j of bits ? a[j] : b(j), for j in [0, n). N is n when fixed, to unroll full
+    //   words into a loop the compiler vectorizes.
+    template <int N, typename Other>
+    inline void Select(
+        std::uint64_t bits, const float_t* a, Other& b, float_t* out, std::uint64_t n) {
+      if (N != 0) {
+        n = N;
+      }
+      for (std::uint64_t j = 0; j < n; j++) {
+        out[j] = (bits >> j) & 1 ? a[j] : b(j);
+      }
+    }
+
+    // Where, with b(i) the value of cell i where mask is unset.
+    template <typename Other>
+    void SelectAll(const std::uint64_t* words, std::size_t numWords, const float_t* a, Other b,
+        float_t* out, std::uint64_t numCells) {
+      ParallelFor(numWords, 64, [words, a, &b, out, numCells](size_t from, size_t to) {
+        for (size_t word = from; word < to; word++) {
+          std::uint64_t first = static_cast<std::uint64_t>(word) * 64;
+          auto other = [&b, first](std::uint64_t j) { return b(first + j); };
+          if (numCells - first >= 64) {
+            Select<64>(words[word], a + first, other, out + first, 64);
+          } else {
+            Select<0>(words[word], a + first, other, out + first, numCells - first);
+          }
+        }
+      });
+    }
+
+    struct AndWords {
+      static std::uint64_t operate(std::uint64_t a, std::uint64_t b) { return a & b; }
+    };
+
+    struct OrWords {
+      static std::uint64_t operate(std::uint64_t a, std::uint64_t b) { return a | b; }
+    };
+  }
+
+  Mask::Mask() : Mask(0, 0) {}
+
+  Mask::Mask(size_t rows, size_t cols)
+      : rows(rows), cols(cols),
+        words((static_cast<std::uint64_t>(rows) * cols + 63) / 64) {}
+
+  Mask Mask::NonZero(const Matrix& matrix) {
+    return Compare<op::NotEquals>(matrix, 0.0);
+  }
+
+  void Mask::Set(size_t row, size_t col, bool value) {
+    std::uint64_t cell = static_cast<std::uint64_t>(row) * cols + col;
+    std::uint64_t bit = std::uint64_t(1) << (cell % 64);
+    if (value) {
+      words[cell / 64] |= bit;
+    } else {
+      words[cell / 64] &= ~bit;
+    }
+  }
+
+  std::uint64_t Mask::Count() const {
+    std::uint64_t count = 0;
+    for (std::uint64_t word : words) {
+      count += std::popcount(word);
+    }
+    return count;
+  }
+
+  Matrix Mask::ToMatrix() const {
+    return Where(*this, Matrices::Ones(rows, cols), 0.0);
+  }
+
+  bool Mask::Equals(const Mask& other) const {
+    return rows == other.rows && cols == other.cols && words == other.words;
+  }
+
+  template <typename Operation>
+  Mask Mask::Combine(const Mask& other) const {
+    CheckDimensions("a mask", other, rows, cols);
+    Mask result(rows, cols);
+    for (std::size_t i = 0; i < words.size(); i++) {
+      result.words[i] = Operation::operate(words[i], other.words[i]);
+    }
+    return result;
+  }
+
+  Mask Mask::operator&&(const Mask& other) const {
+    return Combine<AndWords>(other);
+  }
+
+  Mask Mask::operator||(const Mask& other) const {
+    return Combine<OrWords>(other);
+  }
+
+  Mask Mask::operator!() const {
+    Mask result(rows, cols);
+    for (std::size_t i = 0; i < words.size(); i++) {
+      result.words[i] = ~words[i];
+    }
+    std::uint64_t tail = NumCells() % 64;
+    if (tail != 0) {
+      result.words.back() &= (std::uint64_t(1) << tail) - 1;
+    }
+    return result;
+  }
+
+  Matrix Where(const Mask& mask, const Matrix& matrix1, const Matrix& matrix2) {
+    size_t rows = matrix1.NumRows();
+    size_t cols = matrix1.NumCols();
+    if (rows != matrix2.NumRows() || cols != matrix2.NumCols()) {
+      std::ostringstream os;
+      os << "Cannot operate on matrices of different dimensions: " << rows << 'x' << cols
+          << " and " << matrix2.NumRows() << 'x' << matrix2.NumCols();
+      throw std::invalid_argument(os.str());
+    }
+    CheckDimensions("matrices", mask, rows, cols);
+
+    std::uint64_t numCells = mask.NumCells();
+    static stats::Counter counter("Where", stats::Backend::kMultiThread);
+    stats::Probe probe(counter, rows, cols, numCells, numCells, 3 * numCells * sizeof(float_t));
+
+    MemoryLayout layout1, layout2;
+    matrix1.GetLayout(layout1);
+    matrix2.GetLayout(layout2);
+    const float_t* a = layout1.data;
+    const float_t* b = layout2.data;
+    float_t* out = new float_t[numCells];
+    Matrix result(rows, cols, out);
+
+    SelectAll(mask.words.data(), mask.words.size(), a,
+        [b](std::uint64_t i) { return b[i]; }, out, numCells);
+
+    return result;
+  }
+
+  Matrix Where(const Mask& mask, const Matrix& matrix, float_t scalar) {
+    size_t rows = matrix.NumRows();
+    size_t cols = matrix.NumCols();
+    CheckDimensions("a matrix", mask, rows, cols);
+
+    std::uint64_t numCells = mask.NumCells();
+    static stats::Counter counter("Where", stats::Backend::kMultiThread);
+    stats::Probe probe(counter, rows, cols, numCells, numCells, 2 * numCells * sizeof(float_t));
+
+    MemoryLayout layout;
+    matrix.GetLayout(layout);
+    const float_t* a = layout.data;
+    float_t* out = new float_t[numCells];
+    Matrix result(rows, cols, out);
+
+    SelectAll(mask.words.data(), mask.words.size(), a,
+        [scalar](std::uint64_t) { return scalar; }, out, numCells);
+
+    return result;
+  }
+
+  void MaskedAssign(BaseMatrix& target, const Mask& mask, float_t value) {
+    size_t rows = target.NumRows();
+    size_t cols = target.NumCols();
+    CheckDimensions("a matrix", mask, rows, cols);
+
+    MemoryLayout layout;
+    if (!target.GetLayout(layout)) {
+      for (size_t row = 0; row < rows; row++) {
+        for (size_t col = 0; col < cols; col++) {
+          if (mask(row, col)) {
+            target(row, col) = value;
+          }
+        }
+      }
+      return;
+    }
+
+    ParallelFor(rows, cols, [&layout, &mask, value, cols](size_t from, size_t to) {
+      for (size_t row = from; row < to; row++) {
+        float_t* y = layout.data + row * layout.rowStride;
+        for (size_t col = 0; col < cols; col++) {
+          if (mask(row, col)) {
+            y[col * layout.colStride] = value;
+          }
+        }
+      }
+    });
+  }
+
+  void MaskedAssign(BaseMatrix& target, const Mask& mask, const BaseMatrix& source) {
+    size_t rows = target.NumRows();
+    size_t cols = target.NumCols();
+    if (rows != source.NumRows() || cols != source.NumCols()) {
+      std::ostringstream os;
+      os << "Cannot operate on matrices of different dimensions: " << rows << 'x' << cols
+          << " and " << source.NumRows() << 'x' << source.NumCols();
+      throw std::invalid_argument(os.str());
+    }
+    CheckDimensions("a matrix", mask, rows, cols);
+
+    MemoryLayout dst, src;
+    if (!target.GetLayout(dst) || !source.GetLayout(src)) {
+      Matrix copy = source;
+      for (size_t row = 0; row < rows; row++) {
+        for (size_t col = 0; col < cols; col++) {
+          if (mask(row, col)) {
+            target(row, col) = copy(row, col);
+          }
+        }
+      }
+      return;
+    }
+
+    // a source sharing cells with target (e.g. its transpose) is read before anything is written
+    std::optional<Matrix> copy;
+    if (dst.Overlaps(src, rows, cols)) {
+      copy.emplace(source);
+      copy->GetLayout(src);
+    }
+    ParallelFor(rows, cols, [&dst, &src, &mask, cols](size_t from, size_t to) {
+      for (size_t row = from; row < to; row++) {
+        float_t* y = dst.data + row * dst.rowStride;
+        const float_t* x = src.data + row * src.rowStride;
+        for (size_t col = 0; col < cols; col++) {
+          if (mask(row, col)) {
+            y[col * dst.colStride] = x[col * src.colStride];
+          }
+        }
+      }
+    });
+  }
+
+} // math
+} // mdl
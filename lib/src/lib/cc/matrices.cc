@@ -2,10 +2,14 @@
 
 #include "../h/basematrix_operator_overload.h"
 #include "../h/misc.h"
+#include "../h/multithread/helper.h"
 
 #include <mdl/text.h>
 #include <mdl/util.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <random>
 #include <vector>
 
@@ -13,14 +17,16 @@ namespace mdl {
 namespace math {
 
   Matrix Matrices::Identity(size_t length) {
-    return Matrix(
-      length, length, 
-      [](size_t row, size_t col) { return static_cast<float_t>(row == col); });
+    float_t * data = new float_t[length * length];
+    multithread::Fill(data, length * length, 0.0);
+    for (size_t i = 0; i < length; i++) {
+      data[i * length + i] = 1.0;
+    }
+    return Matrix(length, length, data);
   }
 
   Matrix Matrices::Ones(size_t rows, size_t cols) {
-    return Matrix(rows, cols,
-        [](size_t row, size_t col) { return 1.0; });
+    return Default(rows, cols, 1.0);
   }
 
   Matrix Matrices::Zeros(size_t rows, size_t cols) {
@@ -28,36 +34,150 @@ namespace math {
   }
 
   Matrix Matrices::Random(size_t rows, size_t cols) {
-    return Matrix(rows, cols,
-        [](size_t row, size_t col) { 
-          return NextRand(); 
+    return Uniform(rows, cols, NextSeed());
+  }
+
+  Matrix Matrices::Random(size_t rows, size_t cols, std::uint64_t seed) {
+    return Uniform(rows, cols, seed);
+  }
+
+  Matrix Matrices::Uniform(
+      size_t rows, size_t cols, std::uint64_t seed, float_t min, float_t max) {
+    float_t scale = max - min;
+    return FillRandom(rows, cols, Philox(seed), Philox::kUniformStream, 4,
+        [min, scale](const Philox::block_t& bits, int cell, std::uint64_t) {
+          return min + scale * Philox::ToUniform(bits[cell]);
+        });
+  }
+
+  Matrix Matrices::Normal(
+      size_t rows, size_t cols, std::uint64_t seed, float_t mean, float_t stdDev) {
+    return FillRandom(rows, cols, Philox(seed), Philox::kNormalStream, 4,
+        [mean, stdDev](const Philox::block_t& bits, int cell, std::uint64_t) {
+          return mean + stdDev * Philox::NormalFromBlock(bits, cell);
+        });
+  }
+
+  Matrix Matrices::TruncatedNormal(
+      size_t rows, size_t cols, std::uint64_t seed, float_t mean, float_t stdDev) {
+    Philox philox(seed);
+    return FillRandom(rows, cols, philox, Philox::kTruncatedNormalStream, 1,
+        [&philox, mean, stdDev](const Philox::block_t& bits, int, std::uint64_t index) {
+          float_t value;
+          // All four candidates of a block fall out of bounds rarely (~5% each); the seekable path
+          //   then redraws the element from its first attempt (this same block) until one is in
+          //   bounds.
+          if (!Philox::TruncatedNormalFromBlock(bits, value)) {
+            value = philox.TruncatedNormal(index);
+          }
+          return mean + stdDev * value;
+        });
+  }
+
+  Matrix Matrices::Bernoulli(size_t rows, size_t cols, std::uint64_t seed, float_t p) {
+    return FillRandom(rows, cols, Philox(seed), Philox::kUniformStream, 4,
+        [p](const Philox::block_t& bits, int cell, std::uint64_t) {
+          return static_cast<float_t>(Philox::ToUniform(bits[cell]) < p);
         });
   }
 
+  Matrix Matrices::XavierUniform(size_t rows, size_t cols, std::uint64_t seed) {
+    float_t limit = std::sqrt(6.0 / (rows + cols));
+    return Uniform(rows, cols, seed, -limit, limit);
+  }
+
+  Matrix Matrices::XavierNormal(size_t rows, size_t cols, std::uint64_t seed) {
+    return Normal(rows, cols, seed, 0.0, std::sqrt(2.0 / (rows + cols)));
+  }
+
+  Matrix Matrices::HeUniform(size_t rows, size_t cols, std::uint64_t seed) {
+    float_t limit = std::sqrt(6.0 / rows);
+    return Uniform(rows, cols, seed, -limit, limit);
+  }
+
+  Matrix Matrices::HeNormal(size_t rows, size_t cols, std::uint64_t seed) {
+    return Normal(rows, cols, seed, 0.0, std::sqrt(2.0 / rows));
+  }
+
+  template <typename Transform>
+  Matrix Matrices::FillRandom(
+      size_t rows, 
+      size_t cols, 
+      const Philox& philox, 
+      std::uint32_t stream, 
+      int cellsPerBlock, 
+      Transform transform) {
+    const int kBlocksPerChunk = 64;
+    float_t * data = new float_t[rows * cols];
+
+    multithread::Partition(rows * cols, 
+        [&philox, data, stream, cellsPerBlock, &transform](size_t from, size_t to) {
+      return [&philox, data, from, to, stream, cellsPerBlock, &transform]() {
+        std::uint32_t bits[4 * kBlocksPerChunk];
+        std::uint64_t index = from;
+
+        while (index < (std::uint64_t) to) {
+          std::uint64_t firstBlock = index / cellsPerBlock;
+          std::uint64_t lastBlock = (to - 1) / cellsPerBlock;
+          int count = (int) std::min<std::uint64_t>(kBlocksPerChunk, lastBlock - firstBlock + 1);
+          philox.Fill(firstBlock, count, stream, bits);
+
+          for (int block = 0; block < count; block++) {
+            Philox::block_t lanes{
+                bits[block], 
+                bits[count + block], 
+                bits[2 * count + block], 
+                bits[3 * count + block]};
+            for (int cell = index % cellsPerBlock; 
+                cell < cellsPerBlock && index < (std::uint64_t) to; 
+                cell++, index++) {
+              data[index] = transform(lanes, cell, index);
+            }
+          }
+        }
+        return 0;
+      };
+    });
+
+    return Matrix(rows, cols, data);
+  }
+
   Matrix Matrices::Sequence(size_t rows, size_t cols, size_t length) {
     return Sequence(rows, cols, Range(0, length));
   }
 
   Matrix Matrices::Sequence(size_t rows, size_t cols, Range range) {
-    return Matrix(rows, cols,
-        [cols, range](size_t row, size_t col) {
-          size_t index = row * cols + col;
-          return index < range.Length() ? range.Get(index) : 0; 
-        });
+    size_t numCells = rows * cols;
+    size_t length = std::min(numCells, range.Length());
+    size_t start = range.GetStart();
+    size_t increment = range.GetIncrement();
+    float_t * data = new float_t[numCells];
+
+    multithread::ParallelFor(length, [data, start, increment](size_t from, size_t to) {
+      for (size_t i = from; i < to; i++) {
+        data[i] = start + i * increment;
+      }
+    });
+    multithread::Fill(data + length, numCells - length, 0.0);
+
+    return Matrix(rows, cols, data);
   }  
 
   Matrix Matrices::Default(size_t rows, size_t cols, float_t def) {
-    return Matrix(rows, cols, [def](size_t row, size_t col) { return def; });
+    float_t * data = new float_t[rows * cols];
+    multithread::Fill(data, rows * cols, def);
+    return Matrix(rows, cols, data);
   }
 
   Matrix Matrices::WithValues(size_t cols, const std::vector<float_t>& values) {
     size_t rows = (cols + values.size() - 1) / cols;
- 
-    return Matrix(rows, cols,
-        [cols, &values](size_t row, size_t col) {
-          size_t index = row * cols + col;
-          return index < values.size() ? values[index] : 0; 
-        });
+    size_t numCells = rows * cols;
+    float_t * data = new float_t[numCells];
+
+    std::memcpy(data, values.data(), values.size() * sizeof(float_t));
+    multithread::Fill(data + values.size(), numCells - values.size(), 0.0);
+
+    return Matrix(rows, cols, data);
   }
 
   class MatrixCsvParseListener : public mdl::text::ICsvParseListener {
@@ -22,11 +22,7 @@ namespace math {
   Matrix::Matrix(size_t rows, size_t cols) 
       : rows(rows), cols(cols), 
         data(std::shared_ptr<float_t[]>(new float_t[rows * cols])) {
-    float_t * ptr = data.get();
-
-    for (size_t i = 0; i < rows * cols; i++) {
-        ptr[i] = 0.0;
-    }
+    multithread::Fill(data.get(), rows * cols, 0.0);
   }
 
   Matrix::Matrix(size_t rows, size_t cols, float_t data[]) 
@@ -34,19 +30,6 @@ namespace math {
         data(std::shared_ptr<float_t[]>(data)) {
   }
 
-  Matrix::Matrix(size_t rows, size_t cols, std::function<float_t (size_t, size_t)> initFn)
-      : rows(rows), cols(cols), 
-        data(std::shared_ptr<float_t[]>(new float_t[rows * cols])) {
-    float_t * ptr = data.get();
-
-    for (size_t row = 0; row < rows; row++) {
-      for (size_t col = 0; col < cols; col++) {
-        *ptr = initFn(row, col);
-        ptr++;
-      }
-    }
-  }
-
   Matrix::Matrix(const Matrix& other)
       : rows(other.rows), cols(other.cols), 
         data(std::shared_ptr<float_t[]>(new float_t[rows * cols])) {
@@ -61,13 +44,8 @@ namespace math {
   Matrix::Matrix(const BaseMatrix& other) 
       : rows(other.NumRows()), cols(other.NumCols()),
         data(new float_t[rows * cols]) {
-    float_t * buffer = data.get();
-
-    for (size_t row = 0; row < rows; row++) {
-      for (size_t col = 0; col < cols; col++) {
-        buffer[row * cols + col] = other(row, col);
-      }
-    }
+    // freshly allocated, so it can't alias other
+    Copy(other);
   }
 
   Matrix& Matrix::operator=(const Matrix& other) {
@@ -91,14 +69,9 @@ namespace math {
     rows = other.NumRows();
     cols = other.NumCols();
 
+    // other may be a slice of this matrix; it keeps the old buffer alive while we copy from it.
     data.reset(new float_t[rows * cols]);
-    float_t * buffer = data.get();
-
-    for (size_t row = 0; row < rows; row++) {
-      for (size_t col = 0; col < cols; col++) {
-        buffer[row * cols + col] = other(row, col);
-      }
-    }
+    Copy(other);
 
     return *this;
   }
@@ -160,6 +133,11 @@ namespace math {
     return (*this)(LeftRange(rows), LeftRange(cols));
   }
 
+  const Slice<LeftRange, LeftRange, TransposedAccessor> Matrix::Transposed() const {
+    return Slice<LeftRange, LeftRange, TransposedAccessor>(
+        data, cols, LeftRange(rows), LeftRange(cols));
+  }
+
   Matrix Matrix::Transpose() const {
     auto g = profiler::probe("Transpose");
     return multithread::MatrixImpl::Transpose(*this);
@@ -10,8 +10,29 @@ namespace math {
 
   Matrix operator*(const Matrix& matrix1, const Matrix& matrix2) {
     auto g = profiler::probe("MatrixMultiply");
+    if (matrix1.NumCols() == matrix2.NumRows()) {
+      // The GEMV kernels beat the general loop when either operand is a vector.
+      if (matrix2.NumCols() == 1) {
+        return multithread::MatrixImpl::MatrixVectorMultiply(matrix1, matrix2);
+      } else if (matrix1.NumRows() == 1) {
+        return multithread::MatrixImpl::VectorMatrixMultiply(matrix1, matrix2);
+      }
+    }
     return multithread::MatrixImpl::Multiply(matrix1, matrix2);
   }
 
+  Matrix operator*(const BaseMatrix& matrix1, const BaseMatrix& matrix2) {
+    auto g = profiler::probe("MatrixMultiply");
+    return multithread::MatrixImpl::Multiply(matrix1, matrix2);
+  }
+
+  Matrix operator*(const Matrix& matrix1, const BaseMatrix& matrix2) {
+    return static_cast<const BaseMatrix&>(matrix1) * matrix2;
+  }
+
+  Matrix operator*(const BaseMatrix& matrix1, const Matrix& matrix2) {
+    return matrix1 * static_cast<const BaseMatrix&>(matrix2);
+  }
+
 } // math
 } // mdl
\ No newline at end of file
@@ -0,0 +1,248 @@
+#include "../h/minibatch_loader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+#include "../h/functions.h"
+
+namespace mdl {
+namespace math {
+
+  namespace {
+    void CheckCols(const std::string& fileName, size_t expected, size_t actual) {
+      if (expected != actual) {
+        std::ostringstream os;
+        os << "All matrices must have the same number of columns. Expected " << expected
+            << ", found " << actual << " in " << fileName;
+        throw std::invalid_argument(os.str());
+      }
+    }
+  }
+
+  MinibatchLoader::MinibatchLoader(
+      const std::vector<std::string>& fileNames,
+      size_t batchSize,
+      bool shuffle,
+      std::uint64_t seed,
+      int prefetch)
+      : fileNames(fileNames),
+        batchSize(batchSize),
+        shuffle(shuffle),
+        philox(seed),
+        prefetch(std::max(prefetch, 1)),
+        closing(false) {
+    if (batchSize <= 0) {
+      std::ostringstream os;
+      os << "Invalid batch size: " << batchSize;
+      throw std::invalid_argument(os.str());
+    }
+    // Growing the vector would copy its matrices (Matrix's move constructor isn't noexcept), and
+    //   copies are deep.
+    freeBatches.reserve(this->prefetch + 1);
+    worker = std::thread(&MinibatchLoader::Run, this);
+  }
+
+  MinibatchLoader::~MinibatchLoader() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      closing = true;
+    }
+    notFull.notify_all();
+    worker.join();
+  }
+
+  bool MinibatchLoader::Next(Matrix& batch) {
+    std::unique_lock<std::mutex> lock(mutex);
+    notEmpty.wait(lock, [this] { return !queue.empty() || error; });
+
+    if (queue.empty()) {
+      std::rethrow_exception(error);
+    }
+
+    std::optional<Matrix> next = std::move(queue.front());
+    queue.pop_front();
+    notFull.notify_one();
+
+    if (!next) {
+      return false;
+    }
+
+    if (batch.rows == batchSize && batch.data.use_count() == 1
+        && freeBatches.size() <= prefetch) {
+      freeBatches.push_back(std::move(batch));
+    }
+    batch = std::move(*next);
+    return true;
+  }
+
+  void MinibatchLoader::Run() {
+    try {
+      if (shuffle) {
+        RunShuffledEpochs();
+      } else {
+        RunStreamingEpochs();
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      error = std::current_exception();
+      notEmpty.notify_all();
+    }
+  }
+
+  void MinibatchLoader::RunShuffledEpochs() {
+    std::vector<Matrix> chunks;
+    std::vector<const float_t*> rowPtrs;
+    size_t cols = -1;
+
+    for (const std::string& fileName : fileNames) {
+      FromMtx(fileName.c_str(), [&](Matrix&& matrix) {
+        if (matrix.NumCells() == 0) {
+          return !closing;
+        }
+        if (cols == -1) {
+          cols = matrix.cols;
+        }
+        CheckCols(fileName, cols, matrix.cols);
+        chunks.push_back(std::move(matrix));
+        return !closing;
+      });
+      if (closing) {
+        return;
+      }
+    }
+
+    // Matrix copies are deep, so row addresses are only stable once "chunks" stops growing.
+    for (const Matrix& chunk : chunks) {
+      for (size_t row = 0; row < chunk.rows; row++) {
+        rowPtrs.push_back(chunk.data.get() + row * cols);
+      }
+    }
+
+    size_t numRows = rowPtrs.size();
+    std::vector<size_t> order(numRows);
+    for (std::uint32_t epoch = 0; ; epoch++) {
+      // Fisher-Yates, drawing from a counter keyed on (position, epoch), so every epoch's order is
+      //   reproducible from the seed alone.
+      std::iota(order.begin(), order.end(), 0);
+      for (size_t i = numRows - 1; i > 0; i--) {
+        std::uint32_t bits = philox(Philox::block_t{
+            static_cast<std::uint32_t>(i), epoch, 0, Philox::kShuffleStream})[0];
+        size_t j = static_cast<size_t>((static_cast<std::uint64_t>(bits) * (i + 1)) >> 32);
+        std::swap(order[i], order[j]);
+      }
+
+      for (size_t start = 0; start < numRows; start += batchSize) {
+        size_t n = std::min(batchSize, numRows - start);
+        Matrix batch = Allocate(n, cols);
+        float_t* dest = batch.data.get();
+        for (size_t row = 0; row < n; row++) {
+          std::memcpy(dest + row * cols, rowPtrs[order[start + row]], cols * sizeof(float_t));
+        }
+        if (!Push(&batch)) {
+          return;
+        }
+      }
+
+      if (!Push(nullptr)) {
+        return;
+      }
+    }
+  }
+
+  void MinibatchLoader::RunStreamingEpochs() {
+    for (;;) {
+      size_t cols = -1;
+      size_t filled = 0;
+      Matrix batch;
+
+      for (const std::string& fileName : fileNames) {
+        auto stream = FromMtxStream(fileName.c_str());
+        for (auto matrix = stream(); matrix; matrix = stream()) {
+          if (matrix->NumCells() == 0) {
+            continue;
+          }
+          if (cols == -1) {
+            cols = matrix->cols;
+          }
+          CheckCols(fileName, cols, matrix->cols);
+
+          const float_t* src = matrix->data.get();
+          for (size_t row = 0; row < matrix->rows; ) {
+            if (filled == 0) {
+              batch = Allocate(batchSize, cols);
+            }
+            size_t n = std::min(batchSize - filled, matrix->rows - row);
+            std::memcpy(
+                batch.data.get() + filled * cols, src + row * cols, n * cols * sizeof(float_t));
+            filled += n;
+            row += n;
+
+            if (filled == batchSize) {
+              if (!Push(&batch)) {
+                return;
+              }
+              filled = 0;
+            }
+          }
+          if (closing) {
+            return;
+          }
+        }
+      }
+
+      if (filled > 0) {
+        Matrix last(filled, cols, new float_t[filled * cols]);
+        std::memcpy(last.data.get(), batch.data.get(), filled * cols * sizeof(float_t));
+        if (!Push(&last)) {
+          return;
+        }
+      }
+
+      if (!Push(nullptr)) {
+        return;
+      }
+    }
+  }
+
+  bool MinibatchLoader::Push(Matrix* batch) {
+    std::unique_lock<std::mutex> lock(mutex);
+    notFull.wait(lock, [this] { return queue.size() < prefetch || closing; });
+    if (closing) {
+      return false;
+    }
+
+    if (!batch) {
+      queue.push_back(std::nullopt);
+    } else {
+      // Moving a Matrix shares its buffer, so drop this side's reference before the consumer can
+      //   see the batch: Next() only recycles buffers it holds the only reference to.
+      queue.push_back(std::move(*batch));
+      batch->data.reset();
+    }
+    notEmpty.notify_one();
+    return true;
+  }
+
+  Matrix MinibatchLoader::Allocate(size_t rows, size_t cols) {
+    {
+      // Next() only hands back full batches, which all have the same shape. Anything else is the
+      //   short last batch of an epoch: it gets its own buffer, and the free ones are kept for the
+      //   full batches that follow.
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!freeBatches.empty()
+          && freeBatches.back().rows == rows && freeBatches.back().cols == cols) {
+        Matrix matrix = std::move(freeBatches.back());
+        freeBatches.pop_back();
+        return matrix;
+      }
+    }
+
+    // Every cell is about to be overwritten, so skip the zero fill.
+    return Matrix(rows, cols, new float_t[rows * cols]);
+  }
+
+} // math
+} // mdl
@@ -1,13 +1,15 @@
 #include "../h/misc.h"
+#include "../h/random.h"
 
 #include <random>
 
 namespace mdl {
 namespace math {
 
-  std::random_device rd;
-  std::mt19937 gen(rd());
-  std::uniform_real_distribution<float_t> distribution;
+  // Per thread, so concurrent callers (e.g. shuffling in different threads) don't race on the
+  //   generator's state. Matrix fills use the counter-based generator in random.h instead.
+  thread_local std::mt19937 gen(NextSeed());
+  thread_local std::uniform_real_distribution<float_t> distribution;
 
   float_t NextRand() {
     return distribution(gen);
@@ -0,0 +1,167 @@
+#include "../h/mtx_multiply.h"
+
+#include <algorithm>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "../h/async.h"
+#include "../h/stats.h"
+
+namespace mdl {
+namespace math {
+
+  namespace {
+    struct TileRead {
+      const MtxReader* reader;
+      size_t index;
+      Range rows;
+      Range cols;
+    };
+
+    // Reads tiles in the given order, each one while the caller multiplies the previous ones.
+    class TileStream {
+      public:
+        explicit TileStream(std::vector<TileRead> reads) : reads(std::move(reads)), next(0) {
+          Start();
+        }
+
+        // The read in flight uses the readers, which may not outlive the caller.
+        ~TileStream() {
+          if (pending) {
+            pending->Wait();
+          }
+        }
+
+        AsyncHandle<Matrix> Next() {
+          AsyncHandle<Matrix> tile = *pending;
+          pending.reset();
+          Start();
+          return tile;
+        }
+
+      private:
+        std::vector<TileRead> reads;
+        std::size_t next;
+        std::optional<AsyncHandle<Matrix>> pending;
+
+        void Start() {
+          if (next < reads.size()) {
+            TileRead read = reads[next++];
+            pending.emplace(RunAsync([read]() {
+              return read.reader->Read(read.index, read.rows, read.cols);
+            }));
+          }
+        }
+    };
+
+    // Cells held at once with tiles of up to side x side: two bands of the product, two tiles of
+    //   each operand (the ones multiplied, and the next ones read) and their product.
+    std::uint64_t NumCellsHeld(size_t rows, size_t inner, size_t cols, size_t side) {
+      std::uint64_t bandRows = std::min(side, rows);
+      std::uint64_t tileInner = std::min(side, inner);
+      std::uint64_t tileCols = std::min(side, cols);
+      return 2 * bandRows * cols + 2 * (bandRows * tileInner + tileInner * tileCols)
+          + bandRows * tileCols;
+    }
+  }
+
+  void MultiplyMtx(
+      const MtxReader& reader1, size_t index1, const MtxReader& reader2, size_t index2,
+      MtxWriter& writer, const MtxMultiplyOptions& options) {
+    bool transposed = options.transposeSecond;
+    size_t rows = reader1.NumRows(index1);
+    size_t inner = reader1.NumCols(index1);
+    size_t inner2 = transposed ? reader2.NumCols(index2) : reader2.NumRows(index2);
+    size_t cols = transposed ? reader2.NumRows(index2) : reader2.NumCols(index2);
+    if (inner != inner2) {
+      std::ostringstream os;
+      os << "Cannot multiply matrices of incompatible dimensions: "
+          << rows << 'x' << inner << " and " << inner2 << 'x' << cols;
+      throw std::invalid_argument(os.str());
+    }
+    if (rows == 0 || cols == 0) {
+      // no cells, whatever the inner dimension
+      writer.Write(Matrix(rows, cols));
+      return;
+    }
+
+    // the largest tiles within budget
+    std::uint64_t budget = options.memoryBudget / sizeof(float_t);
+    if (NumCellsHeld(rows, inner, cols, 1) > budget) {
+      std::ostringstream os;
+      os << "Cannot multiply " << rows << 'x' << inner << " and " << inner2 << 'x' << cols
+          << " matrices within " << options.memoryBudget << " bytes";
+      throw std::invalid_argument(os.str());
+    }
+    size_t side = 1;
+    for (size_t high = std::max({rows, inner, cols}); side < high; ) {
+      size_t middle = side + (high - side + 1) / 2;
+      if (NumCellsHeld(rows, inner, cols, middle) <= budget) {
+        side = middle;
+      } else {
+        high = middle - 1;
+      }
+    }
+    size_t bandRows = std::min(side, rows);
+    size_t tileInner = std::min(side, inner);
+    size_t tileCols = std::min(side, cols);
+
+    // before reading anything, as it throws for compressed writers
+    writer.BeginRows(rows, cols);
+
+    // the first operand is read once, and the second once per band
+    std::uint64_t numBands = (rows + bandRows - 1) / bandRows;
+    std::uint64_t outCells = static_cast<std::uint64_t>(rows) * cols;
+    static stats::Counter counter("MultiplyMtx", stats::Backend::kMultiThread);
+    stats::Probe probe(counter, rows, cols, outCells, 2 * outCells * inner,
+        (static_cast<std::uint64_t>(rows) * inner + numBands * inner * cols + outCells)
+            * sizeof(float_t));
+
+    // in the order they're multiplied below
+    std::vector<TileRead> reads;
+    for (size_t first = 0; first < rows; first += bandRows) {
+      Range band(first, std::min(rows, first + bandRows));
+      for (size_t k = 0; k < inner; k += tileInner) {
+        Range innerTile(k, std::min(inner, k + tileInner));
+        reads.push_back({&reader1, index1, band, innerTile});
+        for (size_t col = 0; col < cols; col += tileCols) {
+          Range colTile(col, std::min(cols, col + tileCols));
+          reads.push_back(transposed
+              ? TileRead{&reader2, index2, colTile, innerTile}
+              : TileRead{&reader2, index2, innerTile, colTile});
+        }
+      }
+    }
+    TileStream tiles(std::move(reads));
+
+    for (size_t first = 0; first < rows; first += bandRows) {
+      size_t numRows = std::min(bandRows, rows - first);
+      // a single tile of columns is the first product, moved in (none, with no inner dimension)
+      Matrix band = tileCols == cols && inner > 0 ? Matrix() : Matrix(numRows, cols);
+
+      for (size_t k = 0; k < inner; k += tileInner) {
+        AsyncHandle<Matrix> tile1 = tiles.Next();
+        for (size_t col = 0; col < cols; col += tileCols) {
+          AsyncHandle<Matrix> tile2 = tiles.Next();
+          Matrix product = transposed
+              ? tile1.Get() * tile2.Get().Transposed()
+              : tile1.Get() * tile2.Get();
+          if (tileCols != cols) {
+            band(Range(), Range(col, col + product.NumCols())) += product;
+          } else if (k == 0) {
+            band = std::move(product);
+          } else {
+            band += product;
+          }
+        }
+      }
+
+      writer.WriteRows(std::move(band));
+    }
+  }
+
+} // math
+} // mdl
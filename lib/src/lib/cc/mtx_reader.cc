@@ -0,0 +1,334 @@
+#include "../h/mtx_reader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <mdl/io.h>
+#include <mdl/util.h>
+
+#include "../h/functions.h"
+#include "../h/compression.h"
+#include "../h/multithread/helper.h"
+
+namespace mdl {
+namespace math {
+
+  namespace {
+    // Rows are read in chunks of about this many bytes...
+    const std::size_t kReadChunkBytes = 1 << 22;
+    // ...gaps between their columns included, unless gaps are larger than this, in which case every
+    //   row gets its own pread().
+    const std::size_t kMaxSkippedBytes = 1 << 16;
+    // Compressed blocks fetched per pread(), and then decoded in parallel.
+    const std::size_t kBlocksPerRead = 4 * multithread::kNumKernels;
+
+    inline float_t Cell(const char* src, std::size_t elementSize) {
+      if (elementSize == sizeof(single_t)) {
+        single_t value;
+        std::memcpy(&value, src, sizeof(value));
+        return value;
+      }
+      double_t value;
+      std::memcpy(&value, src, sizeof(value));
+      return value;
+    }
+
+    // Copies the selected columns of one row, given src points at column first.
+    void CopyCols(
+        const char* src, std::size_t elementSize, const Range& cols, std::int64_t first,
+        float_t* dst) {
+      std::int64_t numCols = cols.Length();
+      if (cols.GetIncrement() == 1 && elementSize == sizeof(float_t)) {
+        std::memcpy(dst, src + (cols.GetStart() - first) * elementSize, numCols * elementSize);
+        return;
+      }
+      for (std::int64_t j = 0; j < numCols; j++) {
+        dst[j] = Cell(src + (cols.Get(j) - first) * elementSize, elementSize);
+      }
+    }
+  }
+
+  MtxReader::MtxReader(const char* fileName)
+      : fileName(fileName), complete(false) {
+    fd = ::open(fileName, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      throw mdl::util::exceptionstream()
+        .Append("Could not open file: ").Append(fileName)
+        .Build<mdl::io::file_not_found_exception>();
+    }
+
+    try {
+      struct stat st;
+      if (::fstat(fd, &st) != 0) {
+        throw mdl::util::exceptionstream()
+            .Append("Cannot read file: ").Append(fileName)
+            .Append(": ").Append(std::strerror(errno))
+            .Build<mdl::io::io_exception>();
+      }
+      fileSize = st.st_size;
+
+      int header[2] = {0, 0};
+      if (fileSize >= sizeof(header)) {
+        ReadBytes(reinterpret_cast<char*>(header), sizeof(header), 0);
+      }
+      if (header[0] != kMtxFileMark) {
+        throw mdl::util::exceptionstream()
+            .Append("Input does not appear to contain matrices")
+            .Build();
+      }
+      elementSize = header[1] & kDoublePrecisionBit ? sizeof(double_t) : sizeof(single_t);
+      compressed = header[1] & kMtxCompressedBit;
+    } catch (...) {
+      ::close(fd);
+      throw;
+    }
+  }
+
+  MtxReader::~MtxReader() {
+    ::close(fd);
+  }
+
+  bool MtxReader::IsSeekable(const char* fileName) {
+    struct stat st;
+    return ::stat(fileName, &st) != 0 || S_ISREG(st.st_mode);
+  }
+
+  size_t MtxReader::NumMatrices() const {
+    Locate(kMaxSizeT - 1);
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+  }
+
+  bool MtxReader::Contains(size_t index) const {
+    return index >= 0 && Locate(index);
+  }
+
+  size_t MtxReader::NumRows(size_t index) const {
+    return Get(index).rows;
+  }
+
+  size_t MtxReader::NumCols(size_t index) const {
+    return Get(index).cols;
+  }
+
+  MtxCompression MtxReader::GetCompression() const {
+    return compressed ? MtxCompression::kShuffleLZ : MtxCompression::kNone;
+  }
+
+  Matrix MtxReader::Read(size_t index) const {
+    return Read(index, Range(), Range());
+  }
+
+  Matrix MtxReader::Read(size_t index, const Range& rows, const Range& cols) const {
+    const Entry& entry = Get(index);
+    Range fitRows = rows.FitToBounds(entry.rows);
+    Range fitCols = cols.FitToBounds(entry.cols);
+    size_t numRows = fitRows.Length();
+    size_t numCols = fitCols.Length();
+    if (numRows == 0 || numCols == 0) {
+      return Matrix(numRows, numCols);
+    }
+
+    float_t* cells = new float_t[static_cast<std::size_t>(numRows) * numCols];
+    Matrix result(numRows, numCols, cells);
+    if (compressed) {
+      ReadCompressed(entry, fitRows, fitCols, cells);
+    } else {
+      ReadPlain(entry, fitRows, fitCols, cells);
+    }
+    return result;
+  }
+
+  const MtxReader::Entry* MtxReader::Locate(size_t index) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    while (entries.size() <= static_cast<std::size_t>(index) && !complete) {
+      std::uint64_t offset = entries.empty() ? 2 * sizeof(int) : entries.back().end;
+      if (offset >= fileSize) {
+        complete = true;
+        break;
+      }
+
+      int dims[2];
+      if (offset + sizeof(dims) > fileSize) {
+        throw mdl::io::io_exception("Unexpected end of file: " + fileName);
+      }
+      ReadBytes(reinterpret_cast<char*>(dims), sizeof(dims), offset);
+
+      Entry entry{0, 0, offset + sizeof(dims), {}, offset + sizeof(dims)};
+      // like FromMtxStream, anything without cells reads as 0x0
+      if (dims[0] > 0 && dims[1] > 0) {
+        entry.rows = dims[0];
+        entry.cols = dims[1];
+        std::uint64_t numCells = static_cast<std::uint64_t>(dims[0]) * dims[1];
+
+        if (!compressed) {
+          entry.end = entry.payload + numCells * elementSize;
+        } else {
+          std::uint64_t numBlocks = (numCells + kMtxBlockCells - 1) / kMtxBlockCells;
+          if (entry.payload + numBlocks * sizeof(int) > fileSize) {
+            throw mdl::io::io_exception("Unexpected end of compressed matrix");
+          }
+          std::vector<int> sizes(numBlocks);
+          ReadBytes(reinterpret_cast<char*>(sizes.data()), numBlocks * sizeof(int),
+              entry.payload);
+
+          entry.blocks.push_back(entry.payload + numBlocks * sizeof(int));
+          for (std::uint64_t block = 0; block < numBlocks; block++) {
+            std::uint64_t rawSize = std::min<std::uint64_t>(
+                kMtxBlockCells, numCells - block * kMtxBlockCells) * elementSize;
+            if (sizes[block] <= 0 || static_cast<std::uint64_t>(sizes[block]) > rawSize) {
+              throw mdl::io::io_exception("Corrupted compressed matrix");
+            }
+            entry.blocks.push_back(entry.blocks.back() + sizes[block]);
+          }
+          entry.end = entry.blocks.back();
+        }
+      }
+
+      if (entry.end > fileSize) {
+        throw mdl::io::io_exception("Unexpected end of file: " + fileName);
+      }
+      entries.push_back(std::move(entry));
+    }
+
+    return static_cast<std::size_t>(index) < entries.size() ? &entries[index] : nullptr;
+  }
+
+  const MtxReader::Entry& MtxReader::Get(size_t index) const {
+    if (!Contains(index)) {
+      std::ostringstream os;
+      os << "Invalid matrix index: " << index << ". " << fileName << " has " << NumMatrices()
+          << " matrices";
+      throw std::invalid_argument(os.str());
+    }
+    return *Locate(index);
+  }
+
+  void MtxReader::ReadBytes(char* dst, std::size_t size, std::uint64_t offset) const {
+    while (size > 0) {
+      ssize_t count = ::pread(fd, dst, size, offset);
+      if (count < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw mdl::util::exceptionstream()
+            .Append("Cannot read file: ").Append(fileName)
+            .Append(": ").Append(std::strerror(errno))
+            .Build<mdl::io::io_exception>();
+      }
+      if (count == 0) {
+        throw mdl::io::io_exception("Unexpected end of file: " + fileName);
+      }
+      dst += count;
+      size -= count;
+      offset += count;
+    }
+  }
+
+  void MtxReader::ReadPlain(
+      const Entry& entry, const Range& rows, const Range& cols, float_t* out) const {
+    std::int64_t numRows = rows.Length();
+    std::int64_t numCols = cols.Length();
+    std::int64_t rowCells = entry.cols;
+    std::size_t rowBytes = rowCells * elementSize;
+    // the columns touched, whichever way the range runs
+    std::int64_t first = std::min(cols.Get(0), cols.Get(numCols - 1));
+    std::int64_t span = std::max(cols.Get(0), cols.Get(numCols - 1)) + 1 - first;
+
+    if (rows.GetIncrement() == 1 && cols.GetIncrement() == 1 && span == rowCells
+        && elementSize == sizeof(float_t)) {
+      // whole rows, straight into the result
+      ReadBytes(reinterpret_cast<char*>(out), numRows * rowBytes,
+          entry.payload + rows.GetStart() * rowBytes);
+      return;
+    }
+
+    std::int64_t rowsPerRead = 1;
+    if (rows.GetIncrement() == 1 && (rowCells - span) * elementSize <= kMaxSkippedBytes) {
+      rowsPerRead = std::max<std::int64_t>(1, kReadChunkBytes / rowBytes);
+    }
+    rowsPerRead = std::min(rowsPerRead, numRows);
+    std::vector<char> buffer(((rowsPerRead - 1) * rowCells + span) * elementSize);
+
+    for (std::int64_t i = 0; i < numRows; i += rowsPerRead) {
+      std::int64_t n = std::min(rowsPerRead, numRows - i);
+      std::int64_t row = rows.Get(i);
+      ReadBytes(buffer.data(), ((n - 1) * rowCells + span) * elementSize,
+          entry.payload + (row * rowCells + first) * elementSize);
+      for (std::int64_t k = 0; k < n; k++) {
+        CopyCols(buffer.data() + k * rowBytes, elementSize, cols, first,
+            out + (i + k) * numCols);
+      }
+    }
+  }
+
+  void MtxReader::ReadCompressed(
+      const Entry& entry, const Range& rows, const Range& cols, float_t* out) const {
+    std::int64_t numRows = rows.Length();
+    std::int64_t numCols = cols.Length();
+    std::int64_t rowCells = entry.cols;
+    std::int64_t numCells = static_cast<std::int64_t>(entry.rows) * rowCells;
+    std::int64_t firstRow = std::min(rows.Get(0), rows.Get(numRows - 1));
+    std::int64_t lastRow = std::max(rows.Get(0), rows.Get(numRows - 1));
+    std::int64_t firstCol = std::min(cols.Get(0), cols.Get(numCols - 1));
+    std::int64_t lastCol = std::max(cols.Get(0), cols.Get(numCols - 1));
+
+    // only the blocks between the first and the last cell needed
+    std::size_t firstBlock = (firstRow * rowCells + firstCol) / kMtxBlockCells;
+    std::size_t endBlock = (lastRow * rowCells + lastCol) / kMtxBlockCells + 1;
+
+    std::vector<char> buffer;
+    for (std::size_t group = firstBlock; group < endBlock; group += kBlocksPerRead) {
+      std::size_t groupEnd = std::min(endBlock, group + kBlocksPerRead);
+      buffer.resize(entry.blocks[groupEnd] - entry.blocks[group]);
+      ReadBytes(buffer.data(), buffer.size(), entry.blocks[group]);
+
+      std::atomic<bool> corrupted(false);
+      multithread::ParallelFor(groupEnd - group, kMtxBlockCells, [&](size_t from, size_t to) {
+        std::unique_ptr<char[]> decoded(new char[kMtxBlockCells * elementSize]);
+        for (std::size_t block = group + from; block < group + to; block++) {
+          std::int64_t blockStart = block * kMtxBlockCells;
+          std::int64_t count = std::min<std::int64_t>(kMtxBlockCells, numCells - blockStart);
+          if (!compression::DecodeShuffled(
+              buffer.data() + (entry.blocks[block] - entry.blocks[group]),
+              entry.blocks[block + 1] - entry.blocks[block],
+              decoded.get(), count, elementSize)) {
+            corrupted = true;
+            continue;
+          }
+
+          // blocks don't share cells, so neither do the cells of out they fill
+          std::int64_t blockEnd = blockStart + count;
+          std::int64_t fromRow = std::max(firstRow, blockStart / rowCells);
+          std::int64_t toRow = std::min(lastRow, (blockEnd - 1) / rowCells);
+          for (std::int64_t row = fromRow; row <= toRow; row++) {
+            std::int64_t offset = row - rows.GetStart();
+            if (offset % rows.GetIncrement() != 0) {
+              continue;
+            }
+            float_t* dst = out + offset / rows.GetIncrement() * numCols;
+            for (std::int64_t j = 0; j < numCols; j++) {
+              std::int64_t cell = row * rowCells + cols.Get(j);
+              if (cell >= blockStart && cell < blockEnd) {
+                dst[j] = Cell(decoded.get() + (cell - blockStart) * elementSize, elementSize);
+              }
+            }
+          }
+        }
+      });
+      if (corrupted) {
+        throw mdl::io::io_exception("Corrupted compressed matrix");
+      }
+    }
+  }
+
+} // math
+} // mdl
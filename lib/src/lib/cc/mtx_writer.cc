@@ -0,0 +1,385 @@
+#include "../h/mtx_writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <mdl/io.h>
+#include <mdl/util.h>
+
+namespace mdl {
+namespace math {
+
+  namespace {
+    const std::size_t kPageSize = 4096;
+
+    mdl::io::io_exception WriteError(const std::string& fileName, int errorNumber) {
+      return mdl::util::exceptionstream()
+          .Append("Cannot write to file: ")
+          .Append(fileName)
+          .Append(": ")
+          .Append(std::strerror(errorNumber))
+          .Build<mdl::io::io_exception>();
+    }
+  }
+
+  MtxWriter::MtxWriter(const char* fileName, const MtxWriterOptions& options)
+      : MtxWriter(Open(fileName), true, fileName, options) {}
+
+  MtxWriter::MtxWriter(int fd, const MtxWriterOptions& options)
+      : MtxWriter(fd, false, nullptr, options) {}
+
+  MtxWriter::MtxWriter(
+      int fd, bool ownsFd, const char* fileName, const MtxWriterOptions& options)
+  try
+      : fileName(fileName ? std::string(fileName) : "descriptor " + std::to_string(fd)),
+        fd(fd),
+        ownsFd(ownsFd),
+        options(options),
+        closed(false),
+        pendingRows(0),
+        pendingCols(0),
+        used(0),
+        closing(false) {
+    // whole pages, and never empty
+    this->options.bufferSize = (std::max<std::size_t>(options.bufferSize, 1) + kPageSize - 1)
+        / kPageSize * kPageSize;
+    current = Allocate();
+
+    int controlReg = 0;
+    if (kDoublePrecision) {
+      controlReg |= kDoublePrecisionBit;
+    }
+    if (options.compression != MtxCompression::kNone) {
+      controlReg |= kMtxCompressedBit;
+    }
+    Append(reinterpret_cast<const char*>(&kMtxFileMark), sizeof(int));
+    Append(reinterpret_cast<const char*>(&controlReg), sizeof(int));
+
+    if (options.background) {
+      freeBuffers.push_back(Allocate());
+      worker = std::thread(&MtxWriter::Run, this);
+    }
+  } catch (...) {
+    // the destructor won't run, so nothing else closes it
+    if (ownsFd) {
+      ::close(fd);
+    }
+  }
+
+  MtxWriter::~MtxWriter() {
+    try {
+      Close();
+    } catch (...) {
+      // nowhere to report it
+    }
+  }
+
+  void MtxWriter::Write(const Matrix& matrix) {
+    CheckError();
+    CheckNotPending();
+    WriteHeader(matrix.NumRows(), matrix.NumCols());
+    WriteCells(matrix);
+  }
+
+  void MtxWriter::Write(Matrix&& matrix) {
+    CheckError();
+    CheckNotPending();
+    WriteHeader(matrix.NumRows(), matrix.NumCols());
+    WriteCells(std::move(matrix));
+  }
+
+  void MtxWriter::BeginRows(size_t rows, size_t cols) {
+    CheckError();
+    CheckNotPending();
+    if (options.compression != MtxCompression::kNone) {
+      throw std::invalid_argument("Cannot write compressed matrices a band of rows at a time");
+    }
+    if (rows < 0 || cols < 0) {
+      std::ostringstream os;
+      os << "Cannot write a " << rows << 'x' << cols << " matrix";
+      throw std::invalid_argument(os.str());
+    }
+    WriteHeader(rows, cols);
+    // rows of no columns have no cells left to write
+    pendingRows = cols > 0 ? rows : 0;
+    pendingCols = cols;
+  }
+
+  void MtxWriter::WriteRows(const Matrix& rows) {
+    CheckError();
+    CheckRows(rows);
+    pendingRows -= rows.NumRows();
+    WriteCells(rows);
+  }
+
+  void MtxWriter::WriteRows(Matrix&& rows) {
+    CheckError();
+    CheckRows(rows);
+    pendingRows -= rows.NumRows();
+    WriteCells(std::move(rows));
+  }
+
+  void MtxWriter::Close() {
+    if (closed) {
+      return;
+    }
+    closed = true;
+
+    std::exception_ptr failure;
+    try {
+      if (used > 0) {
+        Submit(nullptr, 0, Matrix());
+      }
+    } catch (...) {
+      failure = std::current_exception();
+    }
+
+    if (options.background) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+      }
+      notEmpty.notify_all();
+      worker.join();
+      if (!failure) {
+        failure = error;
+      }
+    }
+
+    if (!failure && options.sync && ::fsync(fd) != 0) {
+      failure = std::make_exception_ptr(WriteError(fileName, errno));
+    }
+    if (ownsFd && ::close(fd) != 0 && !failure) {
+      failure = std::make_exception_ptr(WriteError(fileName, errno));
+    }
+    if (!failure && pendingRows > 0) {
+      std::ostringstream os;
+      os << "Closed " << fileName << " before the last " << pendingRows << " rows were written";
+      failure = std::make_exception_ptr(mdl::io::io_exception(os.str()));
+    }
+    if (failure) {
+      std::rethrow_exception(failure);
+    }
+  }
+
+  MtxWriter::Buffer MtxWriter::Allocate() const {
+    Buffer buffer(static_cast<char*>(std::aligned_alloc(kPageSize, options.bufferSize)));
+    if (!buffer) {
+      throw std::bad_alloc();
+    }
+    return buffer;
+  }
+
+  void MtxWriter::WriteHeader(size_t rows, size_t cols) {
+    // stored as 32 bits, whatever size_t is
+    if (rows > std::numeric_limits<int>::max() || cols > std::numeric_limits<int>::max()) {
+      std::ostringstream os;
+      os << "Cannot write a " << rows << 'x' << cols << " matrix: dimensions are limited to "
+          << std::numeric_limits<int>::max();
+      throw std::invalid_argument(os.str());
+    }
+    int dims[2] = {static_cast<int>(rows), static_cast<int>(cols)};
+    Append(reinterpret_cast<const char*>(dims), sizeof(dims));
+  }
+
+  void MtxWriter::WriteCells(const Matrix& matrix) {
+    size_t numCells = matrix.NumCells();
+    if (numCells == 0) {
+      return;
+    }
+    MemoryLayout layout;
+    matrix.GetLayout(layout);
+
+    if (options.compression != MtxCompression::kNone) {
+      WriteMtxPayload(layout.data, numCells, options.compression,
+          [this](const char* bytes, std::size_t size) { Append(bytes, size); });
+    } else if (!options.background && numCells * sizeof(float_t) >= options.bufferSize / 2) {
+      // written right away, so there's no need to copy it
+      Submit(layout.data, numCells, Matrix());
+    } else {
+      Append(reinterpret_cast<const char*>(layout.data), numCells * sizeof(float_t));
+    }
+  }
+
+  void MtxWriter::WriteCells(Matrix&& matrix) {
+    Matrix owner(std::move(matrix));
+    // the move shares the buffer, so the caller must let go of it explicitly
+    matrix = Matrix();
+
+    if (!options.background || owner.NumCells() * sizeof(float_t) < options.bufferSize / 2) {
+      WriteCells(static_cast<const Matrix&>(owner));
+      return;
+    }
+
+    MemoryLayout layout;
+    owner.GetLayout(layout);
+    Submit(layout.data, owner.NumCells(), std::move(owner));
+  }
+
+  void MtxWriter::CheckNotPending() const {
+    if (pendingRows > 0) {
+      std::ostringstream os;
+      os << "Cannot write anything else before the last " << pendingRows
+          << " rows of the matrix BeginRows() started";
+      throw std::invalid_argument(os.str());
+    }
+  }
+
+  void MtxWriter::CheckRows(const Matrix& rows) const {
+    if (rows.NumRows() > pendingRows || (rows.NumRows() > 0 && rows.NumCols() != pendingCols)) {
+      std::ostringstream os;
+      os << "Cannot write " << rows.NumRows() << 'x' << rows.NumCols() << " rows when "
+          << pendingRows << " rows of " << pendingCols << " columns are left";
+      throw std::invalid_argument(os.str());
+    }
+  }
+
+  void MtxWriter::Append(const char* bytes, std::size_t size) {
+    while (size > 0) {
+      std::size_t n = std::min(size, options.bufferSize - used);
+      std::memcpy(current.get() + used, bytes, n);
+      used += n;
+      bytes += n;
+      size -= n;
+      if (used == options.bufferSize) {
+        Submit(nullptr, 0, Matrix());
+      }
+    }
+  }
+
+  void MtxWriter::Submit(const float_t* cells, size_t numCells, Matrix&& owner) {
+    std::size_t size = used;
+    used = 0;
+    if (!options.background) {
+      WriteJob(current.get(), size, cells, numCells);
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    queue.push_back(Job{std::move(current), size, cells, numCells, std::move(owner)});
+    notEmpty.notify_one();
+    bufferFree.wait(lock, [this] { return !freeBuffers.empty() || error; });
+    if (freeBuffers.empty()) {
+      std::rethrow_exception(error);
+    }
+    current = std::move(freeBuffers.back());
+    freeBuffers.pop_back();
+  }
+
+  int MtxWriter::Open(const char* fileName) {
+    int fd = ::open(fileName, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+      throw WriteError(fileName, errno);
+    }
+    return fd;
+  }
+
+  void MtxWriter::WriteJob(
+      const char* bytes, std::size_t size, const float_t* cells, size_t numCells) {
+    if (numCells > 0 && options.compression != MtxCompression::kNone) {
+      WriteAll(bytes, size);
+      WriteMtxPayload(cells, numCells, options.compression,
+          [this](const char* bytes, std::size_t size) { WriteAll(bytes, size); });
+    } else {
+      WriteAll(bytes, size, reinterpret_cast<const char*>(cells), numCells * sizeof(float_t));
+    }
+  }
+
+  void MtxWriter::WriteAll(const char* bytes, std::size_t size) {
+    WriteAll(bytes, size, nullptr, 0);
+  }
+
+  void MtxWriter::WriteAll(
+      const char* bytes1, std::size_t size1, const char* bytes2, std::size_t size2) {
+    iovec iov[2] = {
+        {const_cast<char*>(bytes1), size1},
+        {const_cast<char*>(bytes2), size2}};
+    iovec* next = iov;
+    int count = 2;
+
+    for (;;) {
+      while (count > 0 && next->iov_len == 0) {
+        next++;
+        count--;
+      }
+      if (count == 0) {
+        return;
+      }
+
+      ssize_t written = ::writev(fd, next, count);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw WriteError(fileName, errno);
+      }
+      // partial writes leave the rest for the next round
+      for (std::size_t left = written; left > 0; ) {
+        std::size_t n = std::min(left, next->iov_len);
+        next->iov_base = static_cast<char*>(next->iov_base) + n;
+        next->iov_len -= n;
+        left -= n;
+        if (next->iov_len == 0) {
+          next++;
+          count--;
+        }
+      }
+    }
+  }
+
+  void MtxWriter::CheckError() {
+    if (closed) {
+      throw mdl::io::io_exception("Cannot write to a closed MtxWriter");
+    }
+    if (options.background) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+  }
+
+  void MtxWriter::Run() {
+    bool failed = false;
+    for (;;) {
+      Job job;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return !queue.empty() || closing; });
+        if (queue.empty()) {
+          return;
+        }
+        job = std::move(queue.front());
+        queue.pop_front();
+      }
+
+      // after a failure, jobs are only drained, so their buffers keep flowing back
+      if (!failed) {
+        try {
+          WriteJob(job.buffer.get(), job.size, job.cells, job.numCells);
+        } catch (...) {
+          failed = true;
+          std::lock_guard<std::mutex> lock(mutex);
+          error = std::current_exception();
+        }
+      }
+      job.owner = Matrix();
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeBuffers.push_back(std::move(job.buffer));
+      }
+      bufferFree.notify_one();
+    }
+  }
+
+} // math
+} // mdl
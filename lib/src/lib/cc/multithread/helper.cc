@@ -1,7 +1,9 @@
 #include "../../h/multithread/helper.h"
+#include "../../h/multithread/numa.h"
 
 #include <mdl/concurrent.h>
 #include <mdl/matrix.h>
+#include <algorithm>
 #include <vector>
 
 
@@ -19,21 +21,36 @@ namespace multithread {
     size_t partitionSize = numCells / numKernels;
     size_t mod = numCells % numKernels;
 
-    std::vector<mdl::concurrent::Future<int>> futures;
+    std::vector<std::function<int ()>> tasks;
     size_t left = 0;
     while (left < numCells) {
       size_t right = left + partitionSize + (mod > 0);
-      futures.push_back(executor.Submit(dispatch(left, right)));
+      tasks.push_back(dispatch(left, right));
       mod--;
       left = right;
     }
 
+    if (RunOnNumaWorkers(tasks)) {
+      return;
+    }
+
+    std::vector<mdl::concurrent::Future<int>> futures;
+    for (auto& task : tasks) {
+      futures.push_back(executor.Submit(task));
+    }
+
     // wait for all computations to finish.
     for (auto it = futures.begin(); it != futures.end(); it++) {
       it->Get();
     }
   }
 
+  void Fill(float_t * data, size_t numCells, float_t value) {
+    ParallelFor(numCells, [data, value](size_t from, size_t to) {
+      std::fill_n(data + from, to - from, value);
+    });
+  }
+
 } // namespace multithread
 } // namespace math
 } // namespace mdl
\ No newline at end of file
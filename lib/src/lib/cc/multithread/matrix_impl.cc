@@ -1,64 +1,928 @@
 #include "../../h/multithread/matrix_impl.h"
 #include "../../h/multithread/helper.h"
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <optional>
+
 namespace mdl {
 namespace math {
 namespace multithread {
+  namespace {
+    typedef void (*SmallKernel)(
+        const float_t* a, const float_t* b, float_t* c, size_t m, size_t k, size_t n);
+
+    // c = a * b for an m x k a and a k x N b. Each output row is accumulated in a fixed size
+    //   array, so the compiler fully unrolls and vectorizes the inner loop and keeps the row in
+    //   registers. No transposed copy of b is needed as b is streamed row by row.
+    template <int N>
+    void FixedWidthMultiply(
+        const float_t* a, const float_t* b, float_t* c, size_t m, size_t k, size_t) {
+      for (size_t i = 0; i < m; i++) {
+        float_t acc[N] = {};
+        const float_t* aRow = a + i * k;
+        for (size_t p = 0; p < k; p++) {
+          float_t aip = aRow[p];
+          const float_t* bRow = b + p * N;
+          for (int j = 0; j < N; j++) {
+            acc[j] += aip * bRow[j];
+          }
+        }
+        std::copy(acc, acc + N, c + i * N);
+      }
+    }
+
+    void AnyWidthMultiply(
+        const float_t* a, const float_t* b, float_t* c, size_t m, size_t k, size_t n) {
+      for (size_t i = 0; i < m; i++) {
+        float_t* cRow = c + i * n;
+        std::fill_n(cRow, n, 0.0);
+        const float_t* aRow = a + i * k;
+        for (size_t p = 0; p < k; p++) {
+          float_t aip = aRow[p];
+          const float_t* bRow = b + p * n;
+          for (size_t j = 0; j < n; j++) {
+            cRow[j] += aip * bRow[j];
+          }
+        }
+      }
+    }
+
+    SmallKernel SelectKernel(size_t n) {
+      switch (n) {
+        case 2: return FixedWidthMultiply<2>;
+        case 4: return FixedWidthMultiply<4>;
+        case 8: return FixedWidthMultiply<8>;
+        case 16: return FixedWidthMultiply<16>;
+        case 32: return FixedWidthMultiply<32>;
+        case 64: return FixedWidthMultiply<64>;
+        default: return AnyWidthMultiply;
+      }
+    }
+
+    // Values a softmax row is processed in at a time: the max of a block is found first, so the
+    //   running sum is rescaled once per block rather than once per value, and the block is still
+    //   in L1 when its exponentials are summed.
+    const size_t kSoftmaxBlockSize = 256;
+
+    // Max of x[0, n) and sum of exp(x[i] - max), in a single pass over x.
+    void MaxAndSumExp(const float_t* x, size_t n, float_t& max, float_t& sum) {
+      max = -std::numeric_limits<float_t>::infinity();
+      sum = 0.0;
+      for (size_t block = 0; block < n; block += kSoftmaxBlockSize) {
+        size_t end = std::min(n, block + kSoftmaxBlockSize);
+        float_t blockMax = max;
+        for (size_t i = block; i < end; i++) {
+          blockMax = std::max(blockMax, x[i]);
+        }
+        if (blockMax > max) {
+          sum *= FastExp(max - blockMax);
+          max = blockMax;
+        }
+
+        float_t sums[kAccumulators] = {};
+        size_t i = block;
+        for (; i + kAccumulators <= end; i += kAccumulators) {
+          for (int j = 0; j < kAccumulators; j++) {
+            sums[j] += FastExp(x[i + j] - max);
+          }
+        }
+        for (; i < end; i++) {
+          sums[0] += FastExp(x[i] - max);
+        }
+        for (int j = 0; j < kAccumulators; j++) {
+          sum += sums[j];
+        }
+      }
+    }
+
+    inline float_t LogSumExp(const float_t* x, size_t n) {
+      float_t max, sum;
+      MaxAndSumExp(x, n, max, sum);
+      return max + std::log(sum);
+    }
+
+    // Column-wise counterpart of MaxAndSumExp over columns [from, to) of a rows x cols matrix.
+    //   Goes over the matrix twice (max, then sum), row by row, so accesses stay sequential.
+    void ColMaxAndSumExp(
+        const float_t* data, size_t rows, size_t cols, size_t from, size_t to,
+        float_t* max, float_t* sum) {
+      std::fill(max + from, max + to, -std::numeric_limits<float_t>::infinity());
+      std::fill(sum + from, sum + to, 0.0);
+      for (size_t row = 0; row < rows; row++) {
+        const float_t* x = data + row * cols;
+        for (size_t col = from; col < to; col++) {
+          max[col] = std::max(max[col], x[col]);
+        }
+      }
+      for (size_t row = 0; row < rows; row++) {
+        const float_t* x = data + row * cols;
+        for (size_t col = from; col < to; col++) {
+          sum[col] += FastExp(x[col] - max[col]);
+        }
+      }
+    }
+
+    // Whether a ranks before b in ascending (descending) order, where i and j are their indices:
+    //   NaNs go last either way, and ties by index, so every order is total and deterministic.
+    template <bool Descending>
+    inline bool RanksBefore(float_t a, size_t i, float_t b, size_t j) {
+      if (std::isnan(a) || std::isnan(b)) {
+        return std::isnan(a) == std::isnan(b) ? i < j : std::isnan(b);
+      }
+      if (a != b) {
+        return Descending ? a > b : a < b;
+      }
+      return i < j;
+    }
+
+    // Index of the first min (max) of x[0, n), skipping NaNs; 0 if there are only NaNs. The
+    //   extreme value is found first, in independent lanes the compiler vectorizes, then searched
+    //   for, which is far cheaper than tracking indices along the way.
+    template <bool Min>
+    size_t ArgExtreme(const float_t* x, size_t n) {
+      const float_t worst = Min
+          ? std::numeric_limits<float_t>::infinity()
+          : -std::numeric_limits<float_t>::infinity();
+      float_t lanes[kAccumulators];
+      std::fill_n(lanes, kAccumulators, worst);
+      size_t i = 0;
+      for (; i + kAccumulators <= n; i += kAccumulators) {
+        for (int j = 0; j < kAccumulators; j++) {
+          lanes[j] = (Min ? x[i + j] < lanes[j] : x[i + j] > lanes[j]) ? x[i + j] : lanes[j];
+        }
+      }
+
+      float_t best = worst;
+      for (int j = 0; j < kAccumulators; j++) {
+        best = (Min ? lanes[j] < best : lanes[j] > best) ? lanes[j] : best;
+      }
+      for (; i < n; i++) {
+        best = (Min ? x[i] < best : x[i] > best) ? x[i] : best;
+      }
+      for (i = 0; i < n; i++) {
+        if (x[i] == best) {
+          return i;
+        }
+      }
+      return 0;
+    }
+
+    // Column-wise counterpart of ArgExtreme over columns [from, to) of a rows x cols matrix, row
+    //   by row so accesses stay sequential. best holds the extremes found so far; columns that
+    //   hold only NaNs, or only the worst infinity, keep row 0, same as ArgExtreme.
+    template <bool Min>
+    void ColsArgExtreme(
+        const float_t* data, size_t rows, size_t cols, size_t from, size_t to,
+        float_t* best, size_t* index) {
+      std::fill(best + from, best + to, Min
+          ? std::numeric_limits<float_t>::infinity()
+          : -std::numeric_limits<float_t>::infinity());
+      std::fill(index + from, index + to, 0);
+      for (size_t row = 0; row < rows; row++) {
+        const float_t* x = data + row * cols;
+        for (size_t col = from; col < to; col++) {
+          if (Min ? x[col] < best[col] : x[col] > best[col]) {
+            best[col] = x[col];
+            index[col] = row;
+          }
+        }
+      }
+    }
+
+    // Rows a gather prefetches ahead of the one it copies. Rows are at random addresses the
+    //   hardware can't predict, and only the first lines of each need a head start.
+    const size_t kGatherPrefetchDistance = 4;
+
+    void CheckRowIndices(std::span<const size_t> rows, size_t numRows) {
+      for (size_t row : rows) {
+        if (row < 0 || row >= numRows) {
+          std::ostringstream os;
+          os << "Row " << row << " out of range for " << numRows << " rows";
+          throw std::invalid_argument(os.str());
+        }
+      }
+    }
+
+    // Output columns the NN/TN kernel computes at a time: a slice of an output row that stays in L1
+    //   while all of matrix2's rows are added to it.
+    constexpr size_t kGemmColBlock = 256;
+
+    // acc += a * b for a row a of length inner, and the first width columns of b, a block of
+    //   matrix2. Four rows of b per pass over acc, which lives on the stack where it can't alias
+    //   them. Blocks of a fixed Width have a constant trip count, which the compiler vectorizes
+    //   fully; Width 0 takes the given width.
+    template <int Width>
+    inline void AccumulateRows(const float_t* a, const float_t* b, size_t rowStride, size_t inner,
+        size_t width, float_t* acc) {
+      if (Width != 0) {
+        width = Width;
+      }
+      size_t k = 0;
+      for (; k + 4 <= inner; k += 4) {
+        float_t a0 = a[k], a1 = a[k + 1], a2 = a[k + 2], a3 = a[k + 3];
+        const float_t* b0 = b + k * rowStride;
+        const float_t* b1 = b0 + rowStride;
+        const float_t* b2 = b1 + rowStride;
+        const float_t* b3 = b2 + rowStride;
+        for (size_t col = 0; col < width; col++) {
+          acc[col] += a0 * b0[col] + a1 * b1[col] + a2 * b2[col] + a3 * b3[col];
+        }
+      }
+      for (; k < inner; k++) {
+        const float_t* bk = b + k * rowStride;
+        for (size_t col = 0; col < width; col++) {
+          acc[col] += a[k] * bk[col];
+        }
+      }
+    }
+
+    // Layout of a product operand, which the kernels need with contiguous rows or columns. Copies
+    //   operands that have neither into copy.
+    MemoryLayout GemmLayout(const BaseMatrix& matrix, std::optional<Matrix>& copy) {
+      MemoryLayout layout;
+      if (!matrix.GetLayout(layout) || (layout.colStride != 1 && layout.rowStride != 1)) {
+        copy.emplace(matrix);
+        copy->GetLayout(layout);
+      }
+      return layout;
+    }
+
+    // Row row of a product operand, in place if its cells are adjacent, or gathered into buffer.
+    inline const float_t* GemmRow(
+        const MemoryLayout& layout, size_t row, size_t length, float_t* buffer) {
+      const float_t* src = layout.data + row * layout.rowStride;
+      if (layout.colStride == 1) {
+        return src;
+      }
+      for (size_t i = 0; i < length; i++) {
+        buffer[i] = src[i * layout.colStride];
+      }
+      return buffer;
+    }
+
+    void CheckMultiply(size_t rows1, size_t cols1, size_t rows2, size_t cols2) {
+      if (cols1 != rows2) {
+        std::ostringstream os;
+        os << "Cannot multiply matrices of incompatible dimensions: " 
+            << rows1 << 'x' << cols1 << " and " << rows2 << 'x' << cols2;
+        throw std::invalid_argument(os.str());
+      }
+    }
+  }
+
   Matrix MatrixImpl::Multiply(const Matrix& matrix1, const Matrix& matrix2) {
-    if (matrix1.cols != matrix2.rows) {
+    return Multiply(
+        static_cast<const BaseMatrix&>(matrix1), static_cast<const BaseMatrix&>(matrix2));
+  }
+
+  Matrix MatrixImpl::Multiply(const BaseMatrix& matrix1, const BaseMatrix& matrix2) {
+    CheckMultiply(matrix1.NumRows(), matrix1.NumCols(), matrix2.NumRows(), matrix2.NumCols());
+
+    size_t rows = matrix1.NumRows();
+    size_t cols = matrix2.NumCols();
+    size_t inner = matrix1.NumCols();
+    static stats::Counter counter("Multiply", stats::Backend::kMultiThread);
+    std::uint64_t outCells = static_cast<std::uint64_t>(rows) * cols;
+    stats::Probe probe(counter, rows, cols, outCells, 2 * outCells * inner,
+        (matrix1.NumCells() + matrix2.NumCells() + outCells) * sizeof(float_t));
+
+    std::optional<Matrix> copy1;
+    std::optional<Matrix> copy2;
+    MemoryLayout layout1 = GemmLayout(matrix1, copy1);
+    MemoryLayout layout2 = GemmLayout(matrix2, copy2);
+    float_t * rData = new float_t[outCells];
+    Matrix result(rows, cols, rData);
+    if (outCells == 0) {
+      return result;
+    }
+
+    if (layout2.rowStride == 1) {
+      // NT and TT: columns of matrix2 are contiguous, so every cell is one dot product.
+      ParallelFor(outCells, 2ull * inner, [&](size_t from, size_t to) {
+        std::vector<float_t> buffer(layout1.colStride == 1 ? 0 : inner);
+        size_t row = from / cols;
+        const float_t* a = GemmRow(layout1, row, inner, buffer.data());
+        for (size_t cell = from; cell < to; cell++) {
+          if (cell / cols != row) {
+            row = cell / cols;
+            a = GemmRow(layout1, row, inner, buffer.data());
+          }
+          rData[cell] = Dot(a, layout2.data + (cell % cols) * layout2.colStride, inner);
+        }
+      });
+    } else {
+      // NN and TN: rows of matrix2 are contiguous, so each output row accumulates rows of matrix2
+      //   scaled by a row of matrix1, a block of columns at a time. Consecutive items share
+      //   the same block, whose slice of matrix2 then stays in cache.
+      size_t numBlocks = (cols + kGemmColBlock - 1) / kGemmColBlock;
+      ParallelFor(numBlocks * rows, 2ull * inner * std::min(cols, kGemmColBlock),
+          [&](size_t from, size_t to) {
+        std::vector<float_t> buffer(layout1.colStride == 1 ? 0 : inner);
+        for (size_t item = from; item < to; item++) {
+          size_t row = item % rows;
+          size_t first = item / rows * kGemmColBlock;
+          size_t width = std::min(kGemmColBlock, cols - first);
+          const float_t* a = GemmRow(layout1, row, inner, buffer.data());
+          float_t acc[kGemmColBlock] = {};
+          if (width == kGemmColBlock) {
+            AccumulateRows<kGemmColBlock>(
+                a, layout2.data + first, layout2.rowStride, inner, width, acc);
+          } else {
+            // the last, narrower block: as much as possible in fixed width pieces
+            size_t col = 0;
+            for (; col + 32 <= width; col += 32) {
+              AccumulateRows<32>(
+                  a, layout2.data + first + col, layout2.rowStride, inner, 32, acc + col);
+            }
+            AccumulateRows<0>(
+                a, layout2.data + first + col, layout2.rowStride, inner, width - col, acc + col);
+          }
+          std::copy_n(acc, width, rData + row * cols + first);
+        }
+      });
+    }
+
+    return result;
+  }
+
+  Matrix MatrixImpl::MatrixVectorMultiply(const Matrix& matrix, const Matrix& vector) {
+    CheckMultiply(matrix.rows, matrix.cols, vector.rows, vector.cols);
+
+    size_t rows = matrix.rows;
+    size_t cols = matrix.cols;
+    static stats::Counter counter("MatrixVectorMultiply", stats::Backend::kMultiThread);
+    stats::Probe probe(counter, rows, 1, rows, 2ull * rows * cols,
+        (static_cast<std::uint64_t>(rows) * cols + cols + rows) * sizeof(float_t));
+
+    Matrix result(rows, 1, new float_t[rows]);
+    const float_t* mData = matrix.data.get();
+    const float_t* vData = vector.data.get();
+    float_t* out = result.data.get();
+
+    ParallelFor(rows, cols, [mData, vData, out, cols](size_t from, size_t to) {
+      for (size_t row = from; row < to; row++) {
+        out[row] = Dot(mData + row * cols, vData, cols);
+      }
+    });
+
+    return result;
+  }
+
+  Matrix MatrixImpl::VectorMatrixMultiply(const Matrix& vector, const Matrix& matrix) {
+    CheckMultiply(vector.rows, vector.cols, matrix.rows, matrix.cols);
+
+    size_t rows = matrix.rows;
+    size_t cols = matrix.cols;
+    static stats::Counter counter("VectorMatrixMultiply", stats::Backend::kMultiThread);
+    stats::Probe probe(counter, 1, cols, cols, 2ull * rows * cols,
+        (static_cast<std::uint64_t>(rows) * cols + rows + cols) * sizeof(float_t));
+
+    Matrix result(1, cols);
+    const float_t* mData = matrix.data.get();
+    const float_t* vData = vector.data.get();
+    float_t* out = result.data.get();
+
+    // Each task owns a range of output columns and walks all of matrix's rows over that range,
+    //   so every row segment is read exactly once and the inner loop is a contiguous axpy.
+    ParallelFor(cols, rows, [mData, vData, out, rows, cols](size_t from, size_t to) {
+      float_t* outRunner = out + from;
+      size_t length = to - from;
+      for (size_t row = 0; row < rows; row++) {
+        float_t scale = vData[row];
+        const float_t* mRunner = mData + row * cols + from;
+        for (size_t col = 0; col < length; col++) {
+          outRunner[col] += scale * mRunner[col];
+        }
+      }
+    });
+
+    return result;
+  }
+
+  std::vector<Matrix> MatrixImpl::BatchMultiply(
+      std::span<const Matrix> matrices1, std::span<const Matrix> matrices2) {
+    if (matrices1.size() != matrices2.size()) {
+      std::ostringstream os;
+      os << "Cannot multiply batches of different sizes: " 
+          << matrices1.size() << " and " << matrices2.size();
+      throw std::invalid_argument(os.str());
+    }
+
+    size_t batchSize = matrices1.size();
+    std::uint64_t flops = 0;
+    std::uint64_t bytes = 0;
+    std::vector<float_t*> outputs(batchSize);
+    for (size_t i = 0; i < batchSize; i++) {
+      const Matrix& matrix1 = matrices1[i];
+      const Matrix& matrix2 = matrices2[i];
+      CheckMultiply(matrix1.rows, matrix1.cols, matrix2.rows, matrix2.cols);
+      flops += 2ull * matrix1.rows * matrix1.cols * matrix2.cols;
+      bytes += (matrix1.NumCells() + matrix2.NumCells() + matrix1.rows * matrix2.cols) 
+          * sizeof(float_t);
+    }
+
+    static stats::Counter counter("BatchMultiply", stats::Backend::kMultiThread);
+    stats::Probe probe(counter, batchSize, 1, batchSize, flops, bytes);
+
+    std::vector<Matrix> results;
+    results.reserve(batchSize);
+    for (size_t i = 0; i < batchSize; i++) {
+      float_t* data = new float_t[matrices1[i].rows * matrices2[i].cols];
+      results.push_back(Matrix(matrices1[i].rows, matrices2[i].cols, data));
+      outputs[i] = data;
+    }
+
+    ParallelFor(batchSize, batchSize > 0 ? flops / batchSize : 0,
+        [matrices1, matrices2, &outputs](size_t from, size_t to) {
+      for (size_t i = from; i < to; i++) {
+        const Matrix& matrix1 = matrices1[i];
+        const Matrix& matrix2 = matrices2[i];
+        SelectKernel(matrix2.cols)(
+            matrix1.data.get(), 
+            matrix2.data.get(), 
+            outputs[i], 
+            matrix1.rows, 
+            matrix1.cols, 
+            matrix2.cols);
+      }
+    });
+
+    return results;
+  }
+
+  Matrix MatrixImpl::BatchMultiply(
+      const Matrix& stacked1, const Matrix& stacked2, size_t batchSize) {
+    if (batchSize <= 0 || stacked1.rows % batchSize != 0 || stacked2.rows % batchSize != 0) {
       std::ostringstream os;
-      os << "Cannot multiply matrices of incompatible dimensions: " 
-          << matrix1.rows << 'x' << matrix1.cols
-          << " and " << matrix2.rows << 'x' << matrix2.cols;
+      os << "Cannot split matrices of dimensions " 
+          << stacked1.rows << 'x' << stacked1.cols << " and " 
+          << stacked2.rows << 'x' << stacked2.cols << " into " << batchSize << " products";
       throw std::invalid_argument(os.str());
     }
-    
-    Matrix m2Transp = matrix2.Transpose();
-
-    size_t rows = matrix1.rows;
-    size_t cols = matrix2.cols;
-    size_t cols1 = matrix1.cols;
-    size_t numCells = rows * cols;
-    float_t * m1Data = matrix1.data.get();
-    float_t * m2Data = m2Transp.data.get();
-    float_t * rData = new float_t[numCells];
-
-
-    Partition(numCells, [m1Data, m2Data, rData, cols, cols1](size_t from, size_t to) {
-      return [m1Data, m2Data, rData, from, to, cols, cols1]() { 
-        size_t frow = from / cols;
-        size_t fcol = from % cols;
-        size_t trow = to / cols;
-        size_t tcol = to % cols;
-
-        float_t * runner1 = m1Data + frow * cols1;
-        float_t * rRunner = rData + frow * cols + fcol;
-        float_t * runner2 = m2Data + fcol * cols1;
-        for (size_t row = frow, col = fcol; 
-            row != trow || col != tcol;) {
-          float_t sum = 0.0;
-          
-          #pragma clang loop vectorize(enable)
-          for (int i = 0; i < cols1; i++) {
-            sum += runner1[i] * runner2[i];
+
+    size_t m = stacked1.rows / batchSize;
+    size_t k = stacked2.rows / batchSize;
+    size_t n = stacked2.cols;
+    CheckMultiply(m, stacked1.cols, k, n);
+
+    std::uint64_t flopsPerProduct = 2ull * m * k * n;
+    static stats::Counter counter("BatchMultiply", stats::Backend::kMultiThread);
+    stats::Probe probe(counter, batchSize, 1, batchSize, flopsPerProduct * batchSize,
+        (stacked1.NumCells() + stacked2.NumCells() + static_cast<std::uint64_t>(m) * n * batchSize) 
+            * sizeof(float_t));
+
+    Matrix result(stacked1.rows, n, new float_t[stacked1.rows * n]);
+    const float_t* data1 = stacked1.data.get();
+    const float_t* data2 = stacked2.data.get();
+    float_t* out = result.data.get();
+    SmallKernel kernel = SelectKernel(n);
+
+    ParallelFor(batchSize, flopsPerProduct, 
+        [data1, data2, out, m, k, n, kernel](size_t from, size_t to) {
+      for (size_t i = from; i < to; i++) {
+        kernel(data1 + i * m * k, data2 + i * k * n, out + i * m * n, m, k, n);
+      }
+    });
+
+    return result;
+  }
+
+  Matrix MatrixImpl::RowSoftmax(const Matrix& matrix, bool log) {
+    size_t rows = matrix.rows;
+    size_t cols = matrix.cols;
+    static stats::Counter counter("Softmax", stats::Backend::kMultiThread);
+    std::uint64_t numCells = matrix.NumCells();
+    stats::Probe probe(counter, rows, cols, numCells, 4 * numCells,
+        2 * numCells * sizeof(float_t));
+
+    Matrix result(rows, cols, new float_t[numCells]);
+    const float_t* data = matrix.data.get();
+    float_t* out = result.data.get();
+
+    ParallelFor(rows, 2 * cols, [data, out, cols, log](size_t from, size_t to) {
+      for (size_t row = from; row < to; row++) {
+        const float_t* x = data + row * cols;
+        float_t* y = out + row * cols;
+        float_t max, sum;
+        MaxAndSumExp(x, cols, max, sum);
+
+        if (log) {
+          float_t shift = max + std::log(sum);
+          for (size_t col = 0; col < cols; col++) {
+            y[col] = x[col] - shift;
           }
-         
-          *(rRunner++) = sum;
-          col++;
-          runner2 += cols1;
-
-          if (col >= cols) { 
-            col = 0; 
-            row++;
-            runner1 += cols1;
-            runner2 = m2Data;
+        } else {
+          float_t scale = 1.0 / sum;
+          for (size_t col = 0; col < cols; col++) {
+            y[col] = FastExp(x[col] - max) * scale;
           }
         }
-        return 0; 
-      };
+      }
+    });
+
+    return result;
+  }
+
+  Matrix MatrixImpl::ColSoftmax(const Matrix& matrix, bool log) {
+    size_t rows = matrix.rows;
+    size_t cols = matrix.cols;
+    static stats::Counter counter("ColSoftmax", stats::Backend::kMultiThread);
+    std::uint64_t numCells = matrix.NumCells();
+    stats::Probe probe(counter, rows, cols, numCells, 4 * numCells,
+        3 * numCells * sizeof(float_t));
+
+    Matrix result(rows, cols, new float_t[numCells]);
+    std::unique_ptr<float_t[]> max(new float_t[cols]);
+    std::unique_ptr<float_t[]> sum(new float_t[cols]);
+    const float_t* data = matrix.data.get();
+    float_t* out = result.data.get();
+    float_t* maxData = max.get();
+    float_t* sumData = sum.get();
+
+    ParallelFor(cols, 3 * rows, [data, out, rows, cols, log, maxData, sumData](
+        size_t from, size_t to) {
+      ColMaxAndSumExp(data, rows, cols, from, to, maxData, sumData);
+      for (size_t col = from; col < to; col++) {
+        if (log) {
+          maxData[col] += std::log(sumData[col]);
+        } else {
+          sumData[col] = 1.0 / sumData[col];
+        }
+      }
+
+      for (size_t row = 0; row < rows; row++) {
+        const float_t* x = data + row * cols;
+        float_t* y = out + row * cols;
+        for (size_t col = from; col < to; col++) {
+          y[col] = log
+              ? x[col] - maxData[col]
+              : FastExp(x[col] - maxData[col]) * sumData[col];
+        }
+      }
     });
 
-    return Matrix(rows, cols, rData);
+    return result;
+  }
+
+  Matrix MatrixImpl::RowLogSumExp(const Matrix& matrix) {
+    size_t rows = matrix.rows;
+    size_t cols = matrix.cols;
+    static stats::Counter counter("LogSumExp", stats::Backend::kMultiThread);
+    std::uint64_t numCells = matrix.NumCells();
+    stats::Probe probe(counter, rows, cols, numCells, 2 * numCells,
+        (numCells + rows) * sizeof(float_t));
+
+    Matrix result(rows, 1, new float_t[rows]);
+    const float_t* data = matrix.data.get();
+    float_t* out = result.data.get();
+
+    ParallelFor(rows, cols, [data, out, cols](size_t from, size_t to) {
+      for (size_t row = from; row < to; row++) {
+        out[row] = LogSumExp(data + row * cols, cols);
+      }
+    });
+
+    return result;
+  }
+
+  Matrix MatrixImpl::ColLogSumExp(const Matrix& matrix) {
+    size_t rows = matrix.rows;
+    size_t cols = matrix.cols;
+    static stats::Counter counter("ColLogSumExp", stats::Backend::kMultiThread);
+    std::uint64_t numCells = matrix.NumCells();
+    stats::Probe probe(counter, rows, cols, numCells, 2 * numCells,
+        (2 * numCells + cols) * sizeof(float_t));
+
+    Matrix result(1, cols, new float_t[cols]);
+    std::unique_ptr<float_t[]> sum(new float_t[cols]);
+    const float_t* data = matrix.data.get();
+    float_t* out = result.data.get();
+    float_t* sumData = sum.get();
+
+    ParallelFor(cols, 2 * rows, [data, out, rows, cols, sumData](size_t from, size_t to) {
+      ColMaxAndSumExp(data, rows, cols, from, to, out, sumData);
+      for (size_t col = from; col < to; col++) {
+        out[col] += std::log(sumData[col]);
+      }
+    });
+
+    return result;
+  }
+
+  std::pair<Matrix, Matrix> MatrixImpl::SoftmaxCrossEntropy(
+      const Matrix& logits, const Matrix& targets) {
+    if (logits.rows != targets.rows || logits.cols != targets.cols) {
+      std::ostringstream os;
+      os << "Cannot operate on matrices of different dimensions: " 
+          << logits.rows << 'x' << logits.cols << " and " << targets.rows << 'x' << targets.cols;
+      throw std::invalid_argument(os.str());
+    }
+
+    size_t rows = logits.rows;
+    size_t cols = logits.cols;
+    static stats::Counter counter("SoftmaxCrossEntropy", stats::Backend::kMultiThread);
+    std::uint64_t numCells = logits.NumCells();
+    stats::Probe probe(counter, rows, cols, numCells, 6 * numCells,
+        3 * numCells * sizeof(float_t));
+
+    Matrix loss(rows, 1, new float_t[rows]);
+    Matrix gradient(rows, cols, new float_t[numCells]);
+    const float_t* data = logits.data.get();
+    const float_t* targetData = targets.data.get();
+    float_t* lossData = loss.data.get();
+    float_t* gradientData = gradient.data.get();
+
+    ParallelFor(rows, 2 * cols,
+        [data, targetData, lossData, gradientData, cols](size_t from, size_t to) {
+      for (size_t row = from; row < to; row++) {
+        const float_t* x = data + row * cols;
+        const float_t* t = targetData + row * cols;
+        float_t* g = gradientData + row * cols;
+        float_t shift = LogSumExp(x, cols);
+
+        // loss = sum(t * (shift - x)), gradient = softmax(x) - t
+        float_t targetSum = 0.0;
+        float_t dot = 0.0;
+        for (size_t col = 0; col < cols; col++) {
+          targetSum += t[col];
+          dot += t[col] * x[col];
+          g[col] = FastExp(x[col] - shift) - t[col];
+        }
+        lossData[row] = targetSum * shift - dot;
+      }
+    });
+
+    return {std::move(loss), std::move(gradient)};
+  }
+
+  std::pair<Matrix, Matrix> MatrixImpl::SoftmaxCrossEntropy(
+      const Matrix& logits, const std::vector<size_t>& labels) {
+    size_t rows = logits.rows;
+    size_t cols = logits.cols;
+    if (static_cast<size_t>(labels.size()) != rows) {
+      std::ostringstream os;
+      os << "Expected one label per row: " << rows << " rows and " << labels.size() << " labels";
+      throw std::invalid_argument(os.str());
+    }
+    for (size_t label : labels) {
+      if (label < 0 || label >= cols) {
+        std::ostringstream os;
+        os << "Label " << label << " out of range for " << cols << " classes";
+        throw std::invalid_argument(os.str());
+      }
+    }
+
+    static stats::Counter counter("SoftmaxCrossEntropy", stats::Backend::kMultiThread);
+    std::uint64_t numCells = logits.NumCells();
+    stats::Probe probe(counter, rows, cols, numCells, 4 * numCells,
+        2 * numCells * sizeof(float_t));
+
+    Matrix loss(rows, 1, new float_t[rows]);
+    Matrix gradient(rows, cols, new float_t[numCells]);
+    const float_t* data = logits.data.get();
+    const size_t* labelData = labels.data();
+    float_t* lossData = loss.data.get();
+    float_t* gradientData = gradient.data.get();
+
+    ParallelFor(rows, 2 * cols,
+        [data, labelData, lossData, gradientData, cols](size_t from, size_t to) {
+      for (size_t row = from; row < to; row++) {
+        const float_t* x = data + row * cols;
+        float_t* g = gradientData + row * cols;
+        float_t shift = LogSumExp(x, cols);
+
+        for (size_t col = 0; col < cols; col++) {
+          g[col] = FastExp(x[col] - shift);
+        }
+        g[labelData[row]] -= 1.0;
+        lossData[row] = shift - x[labelData[row]];
+      }
+    });
+
+    return {std::move(loss), std::move(gradient)};
+  }
+
+  std::vector<size_t> MatrixImpl::RowArgExtreme(const Matrix& matrix, bool min) {
+    size_t rows = matrix.rows;
+    size_t cols = matrix.cols;
+    static stats::Counter maxCounter("ArgMax", stats::Backend::kMultiThread);
+    static stats::Counter minCounter("ArgMin", stats::Backend::kMultiThread);
+    std::uint64_t numCells = matrix.NumCells();
+    stats::Probe probe(min ? minCounter : maxCounter, rows, cols, numCells, numCells,
+        numCells * sizeof(float_t) + rows * sizeof(size_t));
+
+    std::vector<size_t> result(rows);
+    const float_t* data = matrix.data.get();
+    size_t* out = result.data();
+
+    ParallelFor(rows, cols, [data, out, cols, min](size_t from, size_t to) {
+      for (size_t row = from; row < to; row++) {
+        const float_t* x = data + row * cols;
+        out[row] = min ? ArgExtreme<true>(x, cols) : ArgExtreme<false>(x, cols);
+      }
+    });
+
+    return result;
+  }
+
+  std::vector<size_t> MatrixImpl::ColArgExtreme(const Matrix& matrix, bool min) {
+    size_t rows = matrix.rows;
+    size_t cols = matrix.cols;
+    static stats::Counter maxCounter("ColArgMax", stats::Backend::kMultiThread);
+    static stats::Counter minCounter("ColArgMin", stats::Backend::kMultiThread);
+    std::uint64_t numCells = matrix.NumCells();
+    stats::Probe probe(min ? minCounter : maxCounter, rows, cols, numCells, numCells,
+        numCells * sizeof(float_t) + cols * sizeof(size_t));
+
+    std::vector<size_t> result(cols);
+    std::unique_ptr<float_t[]> best(new float_t[cols]);
+    const float_t* data = matrix.data.get();
+    size_t* out = result.data();
+    float_t* bestData = best.get();
+
+    ParallelFor(cols, rows, [data, out, rows, cols, bestData, min](size_t from, size_t to) {
+      if (min) {
+        ColsArgExtreme<true>(data, rows, cols, from, to, bestData, out);
+      } else {
+        ColsArgExtreme<false>(data, rows, cols, from, to, bestData, out);
+      }
+    });
+
+    return result;
+  }
+
+  std::pair<Matrix, std::vector<size_t>> MatrixImpl::RowTopK(const Matrix& matrix, size_t k) {
+    if (k < 0) {
+      std::ostringstream os;
+      os << "Cannot take the top " << k << " cells of a row";
+      throw std::invalid_argument(os.str());
+    }
+
+    size_t rows = matrix.rows;
+    size_t cols = matrix.cols;
+    k = std::min(k, cols);
+    static stats::Counter counter("TopK", stats::Backend::kMultiThread);
+    std::uint64_t numCells = matrix.NumCells();
+    stats::Probe probe(counter, rows, k, static_cast<std::uint64_t>(rows) * k, numCells,
+        numCells * sizeof(float_t) + static_cast<std::uint64_t>(rows) * k
+            * (sizeof(float_t) + sizeof(size_t)));
+
+    Matrix values(rows, k, new float_t[rows * k]);
+    std::vector<size_t> indices(rows * k);
+    if (k == 0) {
+      return {std::move(values), std::move(indices)};
+    }
+    const float_t* data = matrix.data.get();
+    float_t* valueData = values.data.get();
+    size_t* indexData = indices.data();
+
+    ParallelFor(rows, cols, [data, valueData, indexData, cols, k](size_t from, size_t to) {
+      // A heap of the k best cells so far, with the worst of them on top: most cells are
+      //   rejected by a single comparison against it.
+      std::vector<size_t> heap;
+      heap.reserve(k);
+      for (size_t row = from; row < to; row++) {
+        const float_t* x = data + row * cols;
+        auto before = [x](size_t i, size_t j) { return RanksBefore<true>(x[i], i, x[j], j); };
+
+        heap.clear();
+        for (size_t col = 0; col < k; col++) {
+          heap.push_back(col);
+        }
+        std::make_heap(heap.begin(), heap.end(), before);
+        for (size_t col = k; col < cols; col++) {
+          if (before(col, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), before);
+            heap.back() = col;
+            std::push_heap(heap.begin(), heap.end(), before);
+          }
+        }
+        std::sort_heap(heap.begin(), heap.end(), before);
+
+        for (size_t i = 0; i < k; i++) {
+          valueData[row * k + i] = x[heap[i]];
+          indexData[row * k + i] = heap[i];
+        }
+      }
+    });
+
+    return {std::move(values), std::move(indices)};
+  }
+
+  std::vector<size_t> MatrixImpl::RowArgSort(const Matrix& matrix, bool descending) {
+    size_t rows = matrix.rows;
+    size_t cols = matrix.cols;
+    static stats::Counter counter("ArgSort", stats::Backend::kMultiThread);
+    std::uint64_t numCells = matrix.NumCells();
+    stats::Probe probe(counter, rows, cols, numCells,
+        numCells * static_cast<std::uint64_t>(std::bit_width(static_cast<std::uint64_t>(cols))),
+        numCells * (sizeof(float_t) + sizeof(size_t)));
+
+    std::vector<size_t> result(numCells);
+    const float_t* data = matrix.data.get();
+    size_t* out = result.data();
+
+    ParallelFor(rows, 16 * cols, [data, out, cols, descending](size_t from, size_t to) {
+      for (size_t row = from; row < to; row++) {
+        const float_t* x = data + row * cols;
+        size_t* order = out + row * cols;
+        std::iota(order, order + cols, 0);
+        // ties are broken by index, so an unstable sort gives the stable order
+        if (descending) {
+          std::sort(order, order + cols, [x](size_t i, size_t j) {
+            return RanksBefore<true>(x[i], i, x[j], j);
+          });
+        } else {
+          std::sort(order, order + cols, [x](size_t i, size_t j) {
+            return RanksBefore<false>(x[i], i, x[j], j);
+          });
+        }
+      }
+    });
+
+    return result;
+  }
+
+  Matrix MatrixImpl::Gather(const Matrix& matrix, std::span<const size_t> rows) {
+    CheckRowIndices(rows, matrix.rows);
+
+    size_t count = rows.size();
+    size_t cols = matrix.cols;
+    static stats::Counter counter("Gather", stats::Backend::kMultiThread);
+    std::uint64_t numCells = static_cast<std::uint64_t>(count) * cols;
+    stats::Probe probe(counter, count, cols, numCells, 0, 2 * numCells * sizeof(float_t));
+
+    Matrix result(count, cols, new float_t[numCells]);
+    const float_t* src = matrix.data.get();
+    const size_t* index = rows.data();
+    float_t* dst = result.data.get();
+
+    ParallelFor(count, cols, [src, index, dst, cols](size_t from, size_t to) {
+      for (size_t i = from; i < to; i++) {
+        if (i + kGatherPrefetchDistance < to) {
+          __builtin_prefetch(src + index[i + kGatherPrefetchDistance] * cols);
+        }
+        std::copy_n(src + index[i] * cols, cols, dst + i * cols);
+      }
+    });
+
+    return result;
+  }
+
+  void MatrixImpl::Scatter(
+      Matrix& target, std::span<const size_t> rows, const Matrix& source, bool add) {
+    if (static_cast<size_t>(rows.size()) != source.rows || source.cols != target.cols) {
+      std::ostringstream os;
+      os << "Cannot scatter " << source.rows << 'x' << source.cols << " rows at " << rows.size()
+          << " indices into a " << target.rows << 'x' << target.cols << " matrix";
+      throw std::invalid_argument(os.str());
+    }
+    CheckRowIndices(rows, target.rows);
+    // Rows written may be read later on if source shares cells with target: the same matrix, or
+    //   views of one buffer at different offsets (e.g. of a ParameterArena).
+    const float_t* targetCells = target.data.get();
+    const float_t* sourceCells = source.data.get();
+    if (std::less<const float_t*>()(sourceCells, targetCells + target.NumCells())
+        && std::less<const float_t*>()(targetCells, sourceCells + source.NumCells())) {
+      Scatter(target, rows, Matrix(source), add);
+      return;
+    }
+
+    size_t count = rows.size();
+    size_t cols = target.cols;
+    static stats::Counter counter("Scatter", stats::Backend::kMultiThread);
+    std::uint64_t numCells = static_cast<std::uint64_t>(count) * cols;
+    stats::Probe probe(counter, count, cols, numCells, add ? numCells : 0,
+        (add ? 3 : 2) * numCells * sizeof(float_t));
+
+    const float_t* src = source.data.get();
+    const size_t* index = rows.data();
+    float_t* dst = target.data.get();
+
+    // Every thread owns a range of target's rows and goes over all of the indices, skipping the
+    //   others' rows: repeated indices need no locking, and are applied in order.
+    std::uint64_t cellsPerRow = target.rows > 0 ? numCells / target.rows + 1 : 0;
+    ParallelFor(target.rows, cellsPerRow, [src, index, dst, count, cols, add](
+        size_t from, size_t to) {
+      for (size_t i = 0; i < count; i++) {
+        if (index[i] < from || index[i] >= to) {
+          continue;
+        }
+        const float_t* x = src + i * cols;
+        float_t* y = dst + index[i] * cols;
+        if (add) {
+          for (size_t col = 0; col < cols; col++) {
+            y[col] += x[col];
+          }
+        } else {
+          std::copy_n(x, cols, y);
+        }
+      }
+    });
   }
 
 } // namepsace multithread
@@ -0,0 +1,293 @@
+#include "../../h/multithread/numa.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+  #include <pthread.h>
+  #include <sched.h>
+#endif
+
+#include "../../h/multithread/helper.h"
+
+namespace mdl {
+namespace math {
+namespace multithread {
+
+  namespace {
+    thread_local int currentNode = -1;
+
+    int NumCpus() {
+      int cpus = std::thread::hardware_concurrency();
+      return cpus > 0 ? cpus : 1;
+    }
+
+    // Parses cpulist files, e.g. "0-3,8-11".
+    std::vector<int> ParseCpuList(const std::string& list) {
+      std::vector<int> cpus;
+      std::istringstream in(list);
+      std::string range;
+      while (std::getline(in, range, ',')) {
+        std::size_t dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; cpu++) {
+          cpus.push_back(cpu);
+        }
+      }
+      return cpus;
+    }
+
+    bool PinCurrentThread(const std::vector<int>& cpus) {
+#ifdef __linux__
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      for (int cpu : cpus) {
+        CPU_SET(cpu, &set);
+      }
+      return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+      return false;
+#endif
+    }
+
+    class NumaPool {
+      public:
+        NumaPool(const Topology& topology, Pinning pinning) : pinned(true) {
+          int numNodes = topology.NumNodes();
+          for (int w = 0; w < kNumKernels; w++) {
+            int node = w * numNodes / kNumKernels;
+            // index of this worker among the ones on the same node
+            int first = (node * kNumKernels + numNodes - 1) / numNodes;
+            const std::vector<int>& nodeCpus = topology.CpusOf(node);
+
+            std::vector<int> cpus;
+            if (pinning == Pinning::kCore) {
+              cpus.push_back(nodeCpus[(w - first) % nodeCpus.size()]);
+            } else if (pinning == Pinning::kNode) {
+              cpus = nodeCpus;
+            }
+
+            workers.push_back(std::make_unique<Worker>());
+            workers.back()->node = node;
+            workers.back()->thread = std::thread(&NumaPool::Loop, this, workers.back().get(), cpus);
+          }
+
+          // wait until every worker tried pinning itself, so IsPinned() is accurate
+          std::unique_lock<std::mutex> lock(startMutex);
+          started.wait(lock, [this] { return numStarted == kNumKernels; });
+        }
+
+        ~NumaPool() {
+          for (auto& worker : workers) {
+            {
+              std::lock_guard<std::mutex> lock(worker->mutex);
+              worker->stopping = true;
+            }
+            worker->ready.notify_one();
+            worker->thread.join();
+          }
+        }
+
+        void Run(std::vector<std::function<int ()>>& tasks) {
+          if (currentNode >= 0) {
+            // Nested partition from inside a task; waiting on our own queue would deadlock.
+            for (auto& task : tasks) {
+              task();
+            }
+            return;
+          }
+
+          std::mutex doneMutex;
+          std::condition_variable done;
+          std::size_t pending = tasks.size();
+          std::exception_ptr error;
+
+          for (std::size_t i = 0; i < tasks.size(); i++) {
+            Worker& worker = *workers[i % workers.size()];
+            std::function<int ()>& task = tasks[i];
+            {
+              std::lock_guard<std::mutex> lock(worker.mutex);
+              worker.queue.push_back([&task, &doneMutex, &done, &pending, &error]() {
+                std::exception_ptr taskError;
+                try {
+                  task();
+                } catch (...) {
+                  taskError = std::current_exception();
+                }
+
+                std::lock_guard<std::mutex> lock(doneMutex);
+                if (taskError && !error) {
+                  error = taskError;
+                }
+                if (--pending == 0) {
+                  done.notify_one();
+                }
+              });
+            }
+            worker.ready.notify_one();
+          }
+
+          std::unique_lock<std::mutex> lock(doneMutex);
+          done.wait(lock, [&pending] { return pending == 0; });
+          if (error) {
+            std::rethrow_exception(error);
+          }
+        }
+
+        inline int NodeOfWorker(int worker) const { return workers[worker]->node; }
+        inline bool IsPinned() const { return pinned; }
+
+      private:
+        struct Worker {
+          std::thread thread;
+          std::mutex mutex;
+          std::condition_variable ready;
+          std::deque<std::function<void ()>> queue;
+          bool stopping = false;
+          int node = 0;
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::mutex startMutex;
+        std::condition_variable started;
+        int numStarted = 0;
+        bool pinned;
+
+        void Loop(Worker* worker, std::vector<int> cpus) {
+          currentNode = worker->node;
+          bool success = cpus.empty() || PinCurrentThread(cpus);
+          {
+            std::lock_guard<std::mutex> lock(startMutex);
+            pinned = pinned && success;
+            numStarted++;
+          }
+          started.notify_one();
+
+          for (;;) {
+            std::function<void ()> task;
+            {
+              std::unique_lock<std::mutex> lock(worker->mutex);
+              worker->ready.wait(lock, [worker] {
+                return worker->stopping || !worker->queue.empty();
+              });
+              if (worker->queue.empty()) {
+                return;
+              }
+              task = std::move(worker->queue.front());
+              worker->queue.pop_front();
+            }
+            task();
+          }
+        }
+    };
+
+    std::mutex poolMutex;
+    std::shared_ptr<NumaPool> pool;
+
+    std::shared_ptr<NumaPool> GetPool() {
+      std::lock_guard<std::mutex> lock(poolMutex);
+      return pool;
+    }
+  }
+
+  Topology::Topology(const std::vector<std::vector<int>>& nodes) : nodes(nodes) {}
+
+  Topology Topology::Detect() {
+    std::vector<std::vector<int>> nodes;
+    for (int node = 0; ; node++) {
+      std::ifstream in(
+          "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+      std::string list;
+      if (!in || !std::getline(in, list)) {
+        break;
+      }
+      std::vector<int> cpus = ParseCpuList(list);
+      // memory only nodes have no CPUs to run workers on
+      if (!cpus.empty()) {
+        nodes.push_back(cpus);
+      }
+    }
+
+    if (nodes.empty()) {
+      nodes.push_back(std::vector<int>());
+      for (int cpu = 0; cpu < NumCpus(); cpu++) {
+        nodes[0].push_back(cpu);
+      }
+    }
+    return Topology(nodes);
+  }
+
+  Topology Topology::Fake(int numNodes, int cpusPerNode) {
+    std::vector<std::vector<int>> nodes(numNodes);
+    for (int node = 0; node < numNodes; node++) {
+      for (int i = 0; i < cpusPerNode; i++) {
+        nodes[node].push_back((node * cpusPerNode + i) % NumCpus());
+      }
+    }
+    return Topology(nodes);
+  }
+
+  void EnableNuma(const Topology& topology, Pinning pinning) {
+    if (topology.NumNodes() == 0) {
+      throw std::invalid_argument("Topology must have at least one node");
+    }
+    for (int node = 0; node < topology.NumNodes(); node++) {
+      if (topology.CpusOf(node).empty()) {
+        std::ostringstream os;
+        os << "Node " << node << " has no CPUs";
+        throw std::invalid_argument(os.str());
+      }
+    }
+
+    auto replacement = std::make_shared<NumaPool>(topology, pinning);
+    std::lock_guard<std::mutex> lock(poolMutex);
+    pool = replacement;
+  }
+
+  void DisableNuma() {
+    std::shared_ptr<NumaPool> old;
+    {
+      std::lock_guard<std::mutex> lock(poolMutex);
+      old.swap(pool);
+    }
+    // old pool (and its threads) go away here, outside the lock
+  }
+
+  bool IsNumaEnabled() {
+    return GetPool() != nullptr;
+  }
+
+  bool IsNumaPinned() {
+    std::shared_ptr<NumaPool> current = GetPool();
+    return current && current->IsPinned();
+  }
+
+  int NodeOfChunk(int chunk) {
+    std::shared_ptr<NumaPool> current = GetPool();
+    return current ? current->NodeOfWorker(chunk % kNumKernels) : -1;
+  }
+
+  int CurrentNode() {
+    return currentNode;
+  }
+
+  bool RunOnNumaWorkers(std::vector<std::function<int ()>>& tasks) {
+    std::shared_ptr<NumaPool> current = GetPool();
+    if (!current) {
+      return false;
+    }
+    current->Run(tasks);
+    return true;
+  }
+
+} // namespace multithread
+} // namespace math
+} // namespace mdl
@@ -0,0 +1,122 @@
+#include "../h/optimizers.h"
+
+#include <initializer_list>
+#include <sstream>
+#include <stdexcept>
+
+#include "../h/operation.h"
+#include "../h/stats.h"
+#include "../h/multithread/matrix_reflexive_impl.h"
+
+namespace mdl {
+namespace math {
+  using multithread::MatrixReflexiveImpl;
+
+  namespace {
+    // Cells of every buffer, after checking they all match weights' dimensions, are contiguous
+    //   and don't overlap one another.
+    size_t CheckBuffers(
+        const char* optimizer,
+        std::initializer_list<const BaseMatrix*> matrices,
+        std::initializer_list<float_t**> data) {
+      const BaseMatrix& weights = **matrices.begin();
+      size_t rows = weights.NumRows();
+      size_t cols = weights.NumCols();
+      size_t n = rows * cols;
+
+      auto out = data.begin();
+      for (const BaseMatrix* matrix : matrices) {
+        if (matrix->NumRows() != rows || matrix->NumCols() != cols) {
+          std::ostringstream os;
+          os << "Cannot operate on matrices of different dimensions: " << rows << 'x' << cols
+              << " and " << matrix->NumRows() << 'x' << matrix->NumCols();
+          throw std::invalid_argument(os.str());
+        }
+
+        MemoryLayout layout;
+        if (!matrix->GetLayout(layout)
+            || (cols > 1 && layout.colStride != 1)
+            || (rows > 1 && layout.rowStride != cols)) {
+          std::ostringstream os;
+          os << optimizer << " updates need contiguous matrices";
+          throw std::invalid_argument(os.str());
+        }
+        **out++ = layout.data;
+      }
+
+      for (auto i = data.begin(); i != data.end(); i++) {
+        for (auto j = i + 1; j != data.end(); j++) {
+          if (n > 0 && **i < **j + n && **j < **i + n) {
+            std::ostringstream os;
+            os << optimizer << " weights, gradient and state must not overlap";
+            throw std::invalid_argument(os.str());
+          }
+        }
+      }
+      return n;
+    }
+  }
+
+  void Update(
+      const SGDMomentum& optimizer,
+      BaseMatrix& weights,
+      const BaseMatrix& gradient,
+      BaseMatrix& velocity) {
+    float_t *w, *g, *v;
+    size_t n = CheckBuffers("SGD", {&weights, &gradient, &velocity}, {&w, &g, &v});
+
+    static stats::Counter counter("SGDMomentum", stats::Backend::kMultiThread);
+    stats::Probe probe(counter, weights.NumRows(), weights.NumCols(), n, 6 * n,
+        5 * n * sizeof(float_t));
+
+    MatrixReflexiveImpl::ReflexiveUpdate(
+        op::SGDMomentumUpdate(
+            optimizer.learningRate, optimizer.momentum, optimizer.weightDecay,
+            optimizer.nesterov),
+        w, g, n, v);
+  }
+
+  void Update(
+      const Adam& optimizer,
+      BaseMatrix& weights,
+      const BaseMatrix& gradient,
+      BaseMatrix& moment1,
+      BaseMatrix& moment2,
+      std::uint64_t step) {
+    if (step < 1) {
+      throw std::invalid_argument("Adam steps count from 1");
+    }
+    float_t *w, *g, *m, *v;
+    size_t n = CheckBuffers(
+        "Adam", {&weights, &gradient, &moment1, &moment2}, {&w, &g, &m, &v});
+
+    static stats::Counter counter("Adam", stats::Backend::kMultiThread);
+    stats::Probe probe(counter, weights.NumRows(), weights.NumCols(), n, 13 * n,
+        7 * n * sizeof(float_t));
+
+    MatrixReflexiveImpl::ReflexiveUpdate(
+        op::AdamUpdate(
+            optimizer.learningRate, optimizer.beta1, optimizer.beta2, optimizer.epsilon,
+            optimizer.weightDecay, step),
+        w, g, n, m, v);
+  }
+
+  void Update(
+      const RMSProp& optimizer,
+      BaseMatrix& weights,
+      const BaseMatrix& gradient,
+      BaseMatrix& meanSquare) {
+    float_t *w, *g, *s;
+    size_t n = CheckBuffers("RMSProp", {&weights, &gradient, &meanSquare}, {&w, &g, &s});
+
+    static stats::Counter counter("RMSProp", stats::Backend::kMultiThread);
+    stats::Probe probe(counter, weights.NumRows(), weights.NumCols(), n, 8 * n,
+        5 * n * sizeof(float_t));
+
+    MatrixReflexiveImpl::ReflexiveUpdate(
+        op::RMSPropUpdate(optimizer.learningRate, optimizer.decay, optimizer.epsilon),
+        w, g, n, s);
+  }
+
+} // math
+} // mdl
@@ -0,0 +1,84 @@
+#include "../h/parameter_arena.h"
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace mdl {
+namespace math {
+
+  ParameterArena::ParameterArena(const std::vector<std::pair<size_t, size_t>>& shapes)
+      : shapes(shapes), packed(1, TotalCells(shapes)) {
+    CarveViews();
+  }
+
+  ParameterArena::ParameterArena(const std::vector<Matrix>& matrices) {
+    for (const Matrix& matrix : matrices) {
+      shapes.emplace_back(matrix.rows, matrix.cols);
+    }
+    size_t size = TotalCells(shapes);
+    packed = Matrix(1, size, new float_t[size]);
+
+    float_t* runner = packed.data.get();
+    for (const Matrix& matrix : matrices) {
+      std::memcpy(runner, matrix.data.get(), matrix.NumCells() * sizeof(float_t));
+      runner += matrix.NumCells();
+    }
+    CarveViews();
+  }
+
+  ParameterArena::ParameterArena(
+      Matrix&& packed, const std::vector<std::pair<size_t, size_t>>& shapes)
+      : shapes(shapes), packed(std::move(packed)) {
+    size_t size = TotalCells(shapes);
+    if (this->packed.rows != 1 || this->packed.cols != size) {
+      std::ostringstream os;
+      os << "Cannot unpack a " << this->packed.rows << 'x' << this->packed.cols
+          << " matrix into " << shapes.size() << " matrices of " << size << " cells";
+      throw std::invalid_argument(os.str());
+    }
+    CarveViews();
+  }
+
+  void ParameterArena::Load(const Matrix& values) {
+    if (values.rows != 1 || values.cols != packed.cols) {
+      std::ostringstream os;
+      os << "Cannot operate on matrices of different dimensions: "
+          << packed.rows << 'x' << packed.cols << " and " << values.rows << 'x' << values.cols;
+      throw std::invalid_argument(os.str());
+    }
+    if (values.data.get() != packed.data.get()) {
+      std::memcpy(packed.data.get(), values.data.get(), packed.cols * sizeof(float_t));
+    }
+  }
+
+  size_t ParameterArena::TotalCells(const std::vector<std::pair<size_t, size_t>>& shapes) {
+    size_t size = 0;
+    for (const auto& shape : shapes) {
+      if (shape.first < 0 || shape.second < 0) {
+        std::ostringstream os;
+        os << "Invalid matrix shape: " << shape.first << 'x' << shape.second;
+        throw std::invalid_argument(os.str());
+      }
+      size += shape.first * shape.second;
+    }
+    return size;
+  }
+
+  void ParameterArena::CarveViews() {
+    views.clear();
+    views.reserve(shapes.size());
+    size_t offset = 0;
+    for (const auto& shape : shapes) {
+      Matrix view;
+      view.rows = shape.first;
+      view.cols = shape.second;
+      // aliasing constructor: shares ownership of the arena, points into it
+      view.data = std::shared_ptr<float_t[]>(packed.data, packed.data.get() + offset);
+      views.push_back(std::move(view));
+      offset += shape.first * shape.second;
+    }
+  }
+
+} // math
+} // mdl
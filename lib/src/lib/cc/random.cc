@@ -0,0 +1,152 @@
+#include "../h/random.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace mdl {
+namespace math {
+
+  namespace {
+    const std::uint32_t kPhiloxM0 = 0xD2511F53;
+    const std::uint32_t kPhiloxM1 = 0xCD9E8D57;
+    const std::uint32_t kPhiloxW0 = 0x9E3779B9;
+    const std::uint32_t kPhiloxW1 = 0xBB67AE85;
+    const int kPhiloxRounds = 10;
+    const double kTwoPi = 6.283185307179586476925286766559;
+
+    // Box-Muller transform over two lanes. Returns the cosine branch when "sine" is false.
+    inline float_t BoxMuller(std::uint32_t bits1, std::uint32_t bits2, bool sine) {
+      double radius = std::sqrt(-2.0 * std::log(Philox::ToOpenUniform(bits1)));
+      double theta = kTwoPi * Philox::ToUniform(bits2);
+      return static_cast<float_t>(radius * (sine ? std::sin(theta) : std::cos(theta)));
+    }
+  }
+
+  Philox::Philox(std::uint64_t seed)
+      : key0(static_cast<std::uint32_t>(seed)),
+        key1(static_cast<std::uint32_t>(seed >> 32)),
+        seed(seed) {}
+
+  Philox::block_t Philox::operator()(const block_t& counter) const {
+    std::uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    std::uint32_t k0 = key0, k1 = key1;
+
+    for (int round = 0; round < kPhiloxRounds; round++) {
+      std::uint64_t p0 = static_cast<std::uint64_t>(kPhiloxM0) * c0;
+      std::uint64_t p1 = static_cast<std::uint64_t>(kPhiloxM1) * c2;
+      std::uint32_t n0 = static_cast<std::uint32_t>(p1 >> 32) ^ c1 ^ k0;
+      std::uint32_t n1 = static_cast<std::uint32_t>(p1);
+      std::uint32_t n2 = static_cast<std::uint32_t>(p0 >> 32) ^ c3 ^ k1;
+      std::uint32_t n3 = static_cast<std::uint32_t>(p0);
+      c0 = n0; c1 = n1; c2 = n2; c3 = n3;
+      k0 += kPhiloxW0;
+      k1 += kPhiloxW1;
+    }
+
+    return block_t{c0, c1, c2, c3};
+  }
+
+  void Philox::Fill(
+      std::uint64_t first, int count, std::uint32_t stream, std::uint32_t* out) const {
+    // Structure-of-arrays layout: each round below is a straight loop over kBatchSize independent
+    // blocks, which the compiler turns into SIMD multiplies.
+    std::uint32_t c0[kBatchSize], c1[kBatchSize], c2[kBatchSize], c3[kBatchSize];
+
+    for (int base = 0; base < count; base += kBatchSize) {
+      int batch = std::min(kBatchSize, count - base);
+      std::uint32_t k0 = key0, k1 = key1;
+
+      for (int i = 0; i < kBatchSize; i++) {
+        std::uint64_t counter = first + base + i;
+        c0[i] = static_cast<std::uint32_t>(counter);
+        c1[i] = static_cast<std::uint32_t>(counter >> 32);
+        c2[i] = 0;
+        c3[i] = stream;
+      }
+
+      for (int round = 0; round < kPhiloxRounds; round++) {
+        for (int i = 0; i < kBatchSize; i++) {
+          std::uint64_t p0 = static_cast<std::uint64_t>(kPhiloxM0) * c0[i];
+          std::uint64_t p1 = static_cast<std::uint64_t>(kPhiloxM1) * c2[i];
+          std::uint32_t n0 = static_cast<std::uint32_t>(p1 >> 32) ^ c1[i] ^ k0;
+          std::uint32_t n2 = static_cast<std::uint32_t>(p0 >> 32) ^ c3[i] ^ k1;
+          c1[i] = static_cast<std::uint32_t>(p1);
+          c3[i] = static_cast<std::uint32_t>(p0);
+          c0[i] = n0;
+          c2[i] = n2;
+        }
+        k0 += kPhiloxW0;
+        k1 += kPhiloxW1;
+      }
+
+      for (int i = 0; i < batch; i++) {
+        out[base + i] = c0[i];
+        out[count + base + i] = c1[i];
+        out[2 * count + base + i] = c2[i];
+        out[3 * count + base + i] = c3[i];
+      }
+    }
+  }
+
+  float_t Philox::Uniform(std::uint64_t index) const {
+    std::uint64_t block = index >> 2;
+    block_t bits = (*this)(block_t{
+        static_cast<std::uint32_t>(block),
+        static_cast<std::uint32_t>(block >> 32),
+        0,
+        kUniformStream});
+    return ToUniform(bits[index & 3]);
+  }
+
+  float_t Philox::Normal(std::uint64_t index) const {
+    // Each block yields two Box-Muller pairs, i.e. four normals.
+    std::uint64_t block = index >> 2;
+    block_t bits = (*this)(block_t{
+        static_cast<std::uint32_t>(block),
+        static_cast<std::uint32_t>(block >> 32),
+        0,
+        kNormalStream});
+    return NormalFromBlock(bits, index & 3);
+  }
+
+  float_t Philox::TruncatedNormal(std::uint64_t index) const {
+    // Rejection sampling, with as many attempts as it takes: values out of bounds are redrawn,
+    // never clamped. Every element owns its own counter sequence (the attempt number goes in the
+    // third word), so the number of rejections of one element never shifts another's values.
+    for (std::uint32_t attempt = 0; ; attempt++) {
+      block_t bits = (*this)(block_t{
+          static_cast<std::uint32_t>(index),
+          static_cast<std::uint32_t>(index >> 32),
+          attempt,
+          kTruncatedNormalStream});
+
+      float_t value;
+      if (TruncatedNormalFromBlock(bits, value)) {
+        return value;
+      }
+    }
+  }
+
+  float_t Philox::NormalFromBlock(const block_t& bits, int cell) {
+    int lane = cell & 2;
+    return BoxMuller(bits[lane], bits[lane + 1], cell & 1);
+  }
+
+  bool Philox::TruncatedNormalFromBlock(const block_t& bits, float_t& value) {
+    for (int candidate = 0; candidate < 4; candidate++) {
+      value = NormalFromBlock(bits, candidate);
+      if (std::abs(value) <= kTruncationBound) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::uint64_t NextSeed() {
+    static thread_local std::random_device rd;
+    return (static_cast<std::uint64_t>(rd()) << 32) | rd();
+  }
+
+} // math
+} // mdl
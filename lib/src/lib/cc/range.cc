@@ -2,6 +2,8 @@
 
 #include <cmath>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
 
 namespace mdl {
 namespace math {
@@ -9,6 +11,18 @@ namespace math {
   using std::cout;
   using std::endl;
 
+  namespace {
+    // current.Get(next.Get(i)) for every index of next.
+    template <typename CUR, typename NXT>
+    IndexRange Map(const CUR& current, const NXT& next) {
+      std::vector<size_t> indices(next.Length());
+      for (size_t i = 0; i < next.Length(); i++) {
+        indices[i] = current.Get(next.Get(i));
+      }
+      return IndexRange(std::move(indices));
+    }
+  }
+
   const RightRange Ranges::ALL = RightRange(0);
   const UnitRange Ranges::FIRST = UnitRange(0);
   const RightRange Ranges::SKIP_FIRST = RightRange(1);
@@ -40,6 +54,21 @@ namespace math {
   }
 
 
+  IndexRange::IndexRange(std::vector<size_t> indices)
+      : indices(std::make_shared<const std::vector<size_t>>(std::move(indices))) {}
+
+  IndexRange IndexRange::FitToBounds(size_t max) const {
+    for (size_t index : *indices) {
+      if (index < 0 || index >= max) {
+        std::ostringstream os;
+        os << "Index " << index << " out of range for " << max << " rows or columns";
+        throw std::invalid_argument(os.str());
+      }
+    }
+    return *this;
+  }
+
+
   Range::Range(size_t start, size_t end, size_t increment) : 
       start(start), end(end), increment(increment) {
     if ((increment > 0 && start > end)
@@ -132,5 +161,36 @@ namespace math {
         current.GetIncrement() * next.GetIncrement());
   }
 
+  IndexRange Ranges::Compose(const LeftRange& current, const IndexRange& next) {
+    return next;
+  }
+  IndexRange Ranges::Compose(const RightRange& current, const IndexRange& next) {
+    return Map(current, next);
+  }
+  IndexRange Ranges::Compose(const UnitRange& current, const IndexRange& next) {
+    return Map(current, next);
+  }
+  IndexRange Ranges::Compose(const Range& current, const IndexRange& next) {
+    return Map(current, next);
+  }
+
+  IndexRange Ranges::Compose(const IndexRange& current, const LeftRange& next) {
+    return Map(current, next);
+  }
+  IndexRange Ranges::Compose(const IndexRange& current, const RightRange& next) {
+    return Map(current, next);
+  }
+  UnitRange Ranges::Compose(const IndexRange& current, const UnitRange& next) {
+    return next.Length() == 0 
+        ? next
+        : UnitRange(current.Get(next.GetIndex()));
+  }
+  IndexRange Ranges::Compose(const IndexRange& current, const Range& next) {
+    return Map(current, next);
+  }
+  IndexRange Ranges::Compose(const IndexRange& current, const IndexRange& next) {
+    return Map(current, next);
+  }
+
 } // math
 } // mdl
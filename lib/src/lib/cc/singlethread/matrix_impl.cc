@@ -12,7 +12,13 @@ namespace singlethread {
           << " and " << matrix2.rows << 'x' << matrix2.cols;
       throw std::invalid_argument(os.str());
     }
-    
+
+    static stats::Counter counter("Multiply", stats::Backend::kSingleThread);
+    std::uint64_t numCells = static_cast<std::uint64_t>(matrix1.rows) * matrix2.cols;
+    stats::Probe probe(counter, matrix1.rows, matrix2.cols, numCells,
+        2 * numCells * matrix1.cols,
+        (matrix1.NumCells() + matrix2.NumCells() + numCells) * sizeof(float_t));
+
     size_t rows = matrix1.rows;
     size_t cols = matrix2.cols;
     float_t * data = new float_t[rows * cols];
@@ -0,0 +1,247 @@
+#include "../h/stats.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <tuple>
+#include <utility>
+
+namespace mdl {
+namespace math {
+namespace stats {
+
+  namespace {
+    std::atomic<bool> enabled(true);
+
+    struct Registry {
+      std::mutex mutex;
+      std::vector<Counter*> counters;
+    };
+
+    // Never destroyed, so counters in other translation units can still unregister during exit.
+    Registry& GetRegistry() {
+      static Registry* registry = new Registry();
+      return *registry;
+    }
+
+    bool KeyLess(const OpStats& a, const OpStats& b) {
+      return std::tie(a.op, a.backend, a.rows, a.cols) < std::tie(b.op, b.backend, b.rows, b.cols);
+    }
+
+    bool SameKey(const OpStats& a, const OpStats& b) {
+      return a.op == b.op && a.backend == b.backend && a.rows == b.rows && a.cols == b.cols;
+    }
+
+    void WriteJsonString(std::ostream& out, const std::string& str) {
+      out << '"';
+      for (char c : str) {
+        if (c == '"' || c == '\\') {
+          out << '\\';
+        }
+        out << c;
+      }
+      out << '"';
+    }
+  }
+
+  const char* ToString(Backend backend) {
+    switch (backend) {
+      case Backend::kSingleThread: return "singlethread";
+      case Backend::kMultiThread: return "multithread";
+      case Backend::kMetal: return "metal";
+    }
+    return "unknown";
+  }
+
+  Counter::Counter(std::string op, Backend backend) : op(std::move(op)), backend(backend) {
+    for (auto& bucket : buckets) {
+      bucket.store(nullptr, std::memory_order_relaxed);
+    }
+
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.counters.push_back(this);
+  }
+
+  Counter::~Counter() {
+    {
+      Registry& registry = GetRegistry();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      registry.counters.erase(
+          std::remove(registry.counters.begin(), registry.counters.end(), this),
+          registry.counters.end());
+    }
+
+    for (auto& bucket : buckets) {
+      delete bucket.load(std::memory_order_relaxed);
+    }
+  }
+
+  void Counter::Record(
+      size_t rows,
+      size_t cols,
+      std::uint64_t elements,
+      std::uint64_t flops,
+      std::uint64_t bytes,
+      std::uint64_t nanos) {
+    std::atomic<Bucket*>& slot = buckets[ShapeClass(rows) * kShapeClasses + ShapeClass(cols)];
+    Bucket* bucket = slot.load(std::memory_order_acquire);
+    if (!bucket) {
+      Bucket* fresh = new Bucket();
+      if (slot.compare_exchange_strong(bucket, fresh, std::memory_order_acq_rel)) {
+        bucket = fresh;
+      } else {
+        // another thread got there first; "bucket" now holds its value
+        delete fresh;
+      }
+    }
+
+    bucket->calls.fetch_add(1, std::memory_order_relaxed);
+    bucket->elements.fetch_add(elements, std::memory_order_relaxed);
+    bucket->flops.fetch_add(flops, std::memory_order_relaxed);
+    bucket->bytes.fetch_add(bytes, std::memory_order_relaxed);
+    bucket->nanos.fetch_add(nanos, std::memory_order_relaxed);
+  }
+
+  void Counter::Collect(std::vector<OpStats>& out) const {
+    for (int i = 0; i < kShapeClasses * kShapeClasses; i++) {
+      Bucket* bucket = buckets[i].load(std::memory_order_acquire);
+      if (!bucket || bucket->calls.load(std::memory_order_relaxed) == 0) {
+        continue;
+      }
+
+      out.push_back(OpStats{
+          op,
+          backend,
+          static_cast<std::uint64_t>(1) << (i / kShapeClasses),
+          static_cast<std::uint64_t>(1) << (i % kShapeClasses),
+          bucket->calls.load(std::memory_order_relaxed),
+          bucket->elements.load(std::memory_order_relaxed),
+          bucket->flops.load(std::memory_order_relaxed),
+          bucket->bytes.load(std::memory_order_relaxed),
+          bucket->nanos.load(std::memory_order_relaxed)});
+    }
+  }
+
+  void Counter::Reset() {
+    for (auto& slot : buckets) {
+      Bucket* bucket = slot.load(std::memory_order_acquire);
+      if (bucket) {
+        bucket->calls.store(0, std::memory_order_relaxed);
+        bucket->elements.store(0, std::memory_order_relaxed);
+        bucket->flops.store(0, std::memory_order_relaxed);
+        bucket->bytes.store(0, std::memory_order_relaxed);
+        bucket->nanos.store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool IsEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+  }
+
+  void SetEnabled(bool value) {
+    enabled.store(value, std::memory_order_relaxed);
+  }
+
+  std::vector<OpStats> Snapshot() {
+    std::vector<OpStats> all;
+    {
+      Registry& registry = GetRegistry();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      for (const Counter* counter : registry.counters) {
+        counter->Collect(all);
+      }
+    }
+
+    // Template entry points have one counter per instantiation (e.g. per slice type); fold those
+    //   of the same op together.
+    std::sort(all.begin(), all.end(), KeyLess);
+    std::vector<OpStats> merged;
+    for (const OpStats& stats : all) {
+      if (!merged.empty() && SameKey(merged.back(), stats)) {
+        OpStats& last = merged.back();
+        last.calls += stats.calls;
+        last.elements += stats.elements;
+        last.flops += stats.flops;
+        last.bytes += stats.bytes;
+        last.nanos += stats.nanos;
+      } else {
+        merged.push_back(stats);
+      }
+    }
+    return merged;
+  }
+
+  void Reset() {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (Counter* counter : registry.counters) {
+      counter->Reset();
+    }
+  }
+
+  void Dump(std::ostream& out) {
+    Dump(out, Snapshot());
+  }
+
+  void Dump(std::ostream& out, const std::vector<OpStats>& snapshot) {
+    std::ios_base::fmtflags flags = out.flags();
+    out << std::left
+        << std::setw(20) << "op"
+        << std::setw(14) << "backend"
+        << std::setw(14) << "shape"
+        << std::right
+        << std::setw(10) << "calls"
+        << std::setw(14) << "elements"
+        << std::setw(14) << "ms"
+        << std::setw(12) << "GFLOP/s"
+        << std::setw(12) << "GB/s" << std::endl;
+
+    out << std::fixed << std::setprecision(3);
+    for (const OpStats& stats : snapshot) {
+      std::string shape = "<=" + std::to_string(stats.rows) + "x" + std::to_string(stats.cols);
+      // flops / nanos == GFLOP/s, bytes / nanos == GB/s
+      double nanos = stats.nanos > 0 ? static_cast<double>(stats.nanos) : 1.0;
+      out << std::left
+          << std::setw(20) << stats.op
+          << std::setw(14) << ToString(stats.backend)
+          << std::setw(14) << shape
+          << std::right
+          << std::setw(10) << stats.calls
+          << std::setw(14) << stats.elements
+          << std::setw(14) << stats.nanos / 1e6
+          << std::setw(12) << stats.flops / nanos
+          << std::setw(12) << stats.bytes / nanos << std::endl;
+    }
+    out.flags(flags);
+  }
+
+  void DumpJson(std::ostream& out) {
+    DumpJson(out, Snapshot());
+  }
+
+  void DumpJson(std::ostream& out, const std::vector<OpStats>& snapshot) {
+    out << '[';
+    for (std::size_t i = 0; i < snapshot.size(); i++) {
+      const OpStats& stats = snapshot[i];
+      if (i > 0) {
+        out << ',';
+      }
+      out << "{\"op\":";
+      WriteJsonString(out, stats.op);
+      out << ",\"backend\":\"" << ToString(stats.backend) << '"'
+          << ",\"rows\":" << stats.rows
+          << ",\"cols\":" << stats.cols
+          << ",\"calls\":" << stats.calls
+          << ",\"elements\":" << stats.elements
+          << ",\"flops\":" << stats.flops
+          << ",\"bytes\":" << stats.bytes
+          << ",\"nanos\":" << stats.nanos << '}';
+    }
+    out << ']';
+  }
+
+} // stats
+} // math
+} // mdl
@@ -1,6 +1,8 @@
 #ifndef _MDL_MATH_ACCESSOR
 #define _MDL_MATH_ACCESSOR
 
+#include <cstddef>
+
 #include "typedefs.h"
 
 namespace mdl {
@@ -15,6 +17,9 @@ namespace math {
       inline static float_t& GetLRef(float_t * data, size_t rowLength, size_t row, size_t col) {
         return *(data + rowLength * row + col);
       }
+      inline static std::ptrdiff_t Offset(size_t rowLength, size_t row, size_t col) {
+        return static_cast<std::ptrdiff_t>(rowLength) * row + col;
+      }
       inline static size_t NumRows(size_t rows, size_t cols)  { return rows; }
       inline static size_t NumCols(size_t rows, size_t cols)  { return cols; }
 
@@ -40,6 +45,9 @@ namespace math {
       inline static float_t& GetLRef(float_t * data, size_t rowLength, size_t row, size_t col) {
         return *(data + rowLength * col + row);
       }
+      inline static std::ptrdiff_t Offset(size_t rowLength, size_t row, size_t col) {
+        return static_cast<std::ptrdiff_t>(rowLength) * col + row;
+      }
       inline static size_t NumRows(size_t rows, size_t cols) { return cols; }
       inline static size_t NumCols(size_t rows, size_t cols) { return rows; }
 
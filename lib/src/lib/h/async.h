@@ -0,0 +1,219 @@
+#ifndef _MDL_MATH_ASYNC
+#define _MDL_MATH_ASYNC
+
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "typedefs.h"
+#include "matrix.h"
+
+namespace mdl {
+namespace math {
+
+  namespace async {
+    // Runs task on the async pool. This is a different pool from the one Partition() uses, so
+    //   async tasks can run (blocking) matrix operations without starving them.
+    void Submit(std::function<void ()> task);
+
+    class StateBase {
+      public:
+        bool IsReady() const;
+        void Wait() const;
+        std::exception_ptr GetError() const;
+
+        // Registers fn to run once this state completes, on the thread that completes it. Returns
+        //   false, without registering, if it already completed.
+        bool AddContinuation(std::function<void ()> fn);
+        // Like AddContinuation(), but runs fn right away if already completed.
+        void OnReady(std::function<void ()> fn);
+
+        void SetError(std::exception_ptr error);
+
+      protected:
+        void Complete(std::exception_ptr error);
+        // Waits until ready, then rethrows the error if the operation failed.
+        void WaitAndCheck() const;
+
+      private:
+        mutable std::mutex mutex;
+        mutable std::condition_variable cv;
+        bool ready = false;
+        std::exception_ptr error;
+        std::vector<std::function<void ()>> continuations;
+    };
+
+    template <typename T>
+    class State : public StateBase {
+      public:
+        void SetValue(T&& result) {
+          value.emplace(std::move(result));
+          Complete(nullptr);
+        }
+
+        const T& Get() const {
+          WaitAndCheck();
+          return *value;
+        }
+
+      private:
+        std::optional<T> value;
+    };
+
+    // Of operations run for their side effects alone.
+    template <>
+    class State<void> : public StateBase {
+      public:
+        void SetValue() {
+          Complete(nullptr);
+        }
+
+        void Get() const {
+          WaitAndCheck();
+        }
+    };
+
+    // How a coroutine returning AsyncHandle<T> completes its state: co_return value, or a plain
+    //   co_return for AsyncHandle<void>.
+    template <typename T>
+    struct Promise {
+      std::shared_ptr<State<T>> state = std::make_shared<State<T>>();
+
+      void return_value(T value) { state->SetValue(std::move(value)); }
+    };
+
+    template <>
+    struct Promise<void> {
+      std::shared_ptr<State<void>> state = std::make_shared<State<void>>();
+
+      void return_void() { state->SetValue(); }
+    };
+
+    // Calls done(error) once all dependencies completed; error is the first failure, if any.
+    void WhenAll(
+        const std::vector<std::shared_ptr<StateBase>>& dependencies,
+        std::function<void (std::exception_ptr)> done);
+  }
+
+  // Anything that can be waited on: a prerequisite for an async operation.
+  class AsyncDependency {
+    public:
+      template <typename Handle>
+      AsyncDependency(const Handle& handle) : state(handle.state) {}
+
+      inline const std::shared_ptr<async::StateBase>& GetState() const { return state; }
+
+    private:
+      std::shared_ptr<async::StateBase> state;
+  };
+
+  // Result of an operation running in the background. Copies share the same result.
+  //
+  // Also usable from C++20 coroutines: a coroutine returning AsyncHandle<T> can co_await other
+  //   handles (resuming on whichever thread completes them) and co_return its result.
+  //
+  // AsyncHandle<void> is the handle of work run for its side effects: Get() only waits, and
+  //   rethrows the exception if the work failed.
+  template <typename T>
+  class AsyncHandle {
+    public:
+      explicit AsyncHandle(std::shared_ptr<async::State<T>> state) : state(std::move(state)) {}
+
+      inline bool IsReady() const { return state->IsReady(); }
+      inline void Wait() const { state->Wait(); }
+
+      // Blocks until ready and returns the result (a const T&), or rethrows the operation's
+      //   exception. The reference stays valid for as long as any copy of this handle exists.
+      inline decltype(auto) Get() const { return state->Get(); }
+
+      inline bool await_ready() const { return state->IsReady(); }
+      inline bool await_suspend(std::coroutine_handle<> coroutine) {
+        return state->AddContinuation([coroutine]() { coroutine.resume(); });
+      }
+      inline decltype(auto) await_resume() const { return state->Get(); }
+
+      struct promise_type : async::Promise<T> {
+        AsyncHandle get_return_object() { return AsyncHandle(this->state); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void unhandled_exception() { this->state->SetError(std::current_exception()); }
+      };
+
+    private:
+      std::shared_ptr<async::State<T>> state;
+
+      friend class AsyncDependency;
+  };
+
+  // co_await ResumeInBackground() moves the rest of a coroutine onto the async pool, e.g. so that
+  //   a pipeline started from the main thread doesn't run its first steps there.
+  struct ResumeInBackground {
+    inline bool await_ready() const noexcept { return false; }
+    inline void await_suspend(std::coroutine_handle<> coroutine) const {
+      async::Submit([coroutine]() { coroutine.resume(); });
+    }
+    inline void await_resume() const noexcept {}
+  };
+
+  // Runs fn() on the async pool once every handle in "after" is ready. If any of them failed, fn
+  //   doesn't run and the returned handle fails with the same exception. A fn returning nothing
+  //   gets an AsyncHandle<void>, e.g. to fire and forget, or as a prerequisite.
+  template <typename Fn>
+  auto RunAsync(Fn fn, const std::vector<AsyncDependency>& after = {}) {
+    typedef std::invoke_result_t<Fn> T;
+    auto state = std::make_shared<async::State<T>>();
+
+    std::vector<std::shared_ptr<async::StateBase>> dependencies;
+    for (const AsyncDependency& dependency : after) {
+      dependencies.push_back(dependency.GetState());
+    }
+
+    async::WhenAll(dependencies, [state, fn](std::exception_ptr error) {
+      if (error) {
+        state->SetError(error);
+        return;
+      }
+      async::Submit([state, fn]() {
+        try {
+          if constexpr (std::is_void_v<T>) {
+            fn();
+            state->SetValue();
+          } else {
+            state->SetValue(fn());
+          }
+        } catch (...) {
+          state->SetError(std::current_exception());
+        }
+      });
+    });
+
+    return AsyncHandle<T>(state);
+  }
+
+  // fn(inputs.Get()...) on the async pool, as soon as all inputs are ready.
+  template <typename Fn, typename... Ts>
+  auto OperateAsync(Fn fn, const AsyncHandle<Ts>&... inputs) {
+    return RunAsync(
+        [fn, inputs...]() { return fn(inputs.Get()...); },
+        std::vector<AsyncDependency>({AsyncDependency(inputs)...}));
+  }
+
+  // Matrix arguments are used in place, not copied: they must stay alive, and unmodified, until
+  //   the returned handle is ready.
+  AsyncHandle<Matrix> MultiplyAsync(
+      const Matrix& matrix1, const Matrix& matrix2, const std::vector<AsyncDependency>& after = {});
+  AsyncHandle<Matrix> MultiplyAsync(
+      const AsyncHandle<Matrix>& matrix1, const AsyncHandle<Matrix>& matrix2);
+  AsyncHandle<std::vector<Matrix>> FromMtxAsync(const std::string& fileName);
+
+} // math
+} // mdl
+
+#endif // _MDL_MATH_ASYNC
@@ -2,6 +2,7 @@
 #define _MDL_MATH_BASEMATRIX
 
 #include <algorithm>
+#include <cstddef>
 #include <iostream>
 #include <sstream>
 
@@ -11,6 +12,19 @@
 namespace mdl {
 namespace math {
 
+// Affine description of where a matrix's cells live in memory: cell (row, col) is at
+//   data + row * rowStride + col * colStride. Strides may be zero (UnitRange) or negative 
+//   (decrementing Range).
+struct MemoryLayout {
+  float_t * data;
+  std::ptrdiff_t rowStride;
+  std::ptrdiff_t colStride;
+
+  // Whether a rows x cols region of this layout shares any cell with the same region of other.
+  //   Conservative: may report overlap for interleaved (but disjoint) strided regions.
+  bool Overlaps(const MemoryLayout& other, size_t rows, size_t cols) const;
+};
+
 class BaseMatrix {
   public:
     virtual ~BaseMatrix();
@@ -36,12 +50,23 @@ class BaseMatrix {
     virtual BaseMatrix& RowSwap(size_t row1, size_t row2);
     virtual BaseMatrix& Shuffle();
 
+    // Fills layout and returns true if this matrix can be addressed directly in memory. Matrices
+    //   that return false are only accessed through operator().
+    virtual bool GetLayout(MemoryLayout& layout) const;
+
     static bool Equals(const BaseMatrix& matrix1, const BaseMatrix& matrix2);
   protected:
     friend std::ostream& operator<<(std::ostream&, const BaseMatrix&);
 
+    // Copies assuming this and other do not share memory.
     void Copy(const BaseMatrix& other);
+    // Copies through a temporary buffer, correct even if this and other alias.
     void BufferedCopy(const BaseMatrix& other);
+    // Copies directly when this and other do not overlap; falls back to BufferedCopy otherwise.
+    void AliasAwareCopy(const BaseMatrix& other);
+
+    static void StridedCopy(
+        const MemoryLayout& dst, const MemoryLayout& src, size_t rows, size_t cols);
 };
 
 std::ostream& operator<<(std::ostream& os, const BaseMatrix& matrix);
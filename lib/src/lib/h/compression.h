@@ -0,0 +1,37 @@
+#ifndef _MDL_MATH_COMPRESSION
+#define _MDL_MATH_COMPRESSION
+
+#include <cstddef>
+
+namespace mdl {
+namespace math {
+namespace compression {
+
+  // Byte shuffle: groups the i-th byte of every element together (all first bytes, then all
+  //   second bytes...). For floating point data this puts the sign/exponent bytes, which vary
+  //   little between neighbours, next to each other, so LZ finds far more matches.
+  void Shuffle(const char* src, char* dst, std::size_t count, std::size_t elementSize);
+  void Unshuffle(const char* src, char* dst, std::size_t count, std::size_t elementSize);
+
+  // Largest output Compress() can produce for size bytes of input.
+  inline std::size_t CompressBound(std::size_t size) { return size + size / 255 + 16; }
+
+  // LZ77 with a single-probe hash table and byte-aligned tokens (the LZ4 block layout): fast to
+  //   decode, a few hundred MB/s per thread to encode. Returns the number of bytes written to dst,
+  //   which must hold CompressBound(size) bytes.
+  std::size_t Compress(const char* src, std::size_t size, char* dst);
+  // Decodes exactly size bytes into dst. Returns false if src is not a valid encoding of that many
+  //   bytes; never reads or writes out of bounds either way.
+  bool Decompress(const char* src, std::size_t srcSize, char* dst, std::size_t size);
+
+  // Decodes count elements that were shuffled, then compressed; srcSize == count * elementSize
+  //   means they were stored as is, because compressing didn't help. Returns false if src is
+  //   not a valid encoding.
+  bool DecodeShuffled(
+      const char* src, std::size_t srcSize, char* dst, std::size_t count, std::size_t elementSize);
+
+} // compression
+} // math
+} // mdl
+
+#endif // _MDL_MATH_COMPRESSION
@@ -0,0 +1,79 @@
+#ifndef _MDL_MATH_CONVOLUTION
+#define _MDL_MATH_CONVOLUTION
+
+#include "typedefs.h"
+#include "matrix.h"
+
+namespace mdl {
+namespace math {
+
+  // Image batches are matrices with one image per row, each flattened as channels x height x
+  //   width (row-major within a channel). Outputs use the same layout.
+  //
+  // Convolutions run directly on that layout, with the loops of a matrix multiply (filters x
+  //   patches) but reading each patch in place: no im2col buffer is ever built. The innermost
+  //   loops run along output rows, contiguous in memory, so they vectorize. Work is split across
+  //   images and output rows.
+
+  struct Conv2DShape {
+    size_t channels;
+    size_t height;
+    size_t width;
+    size_t kernelHeight;
+    size_t kernelWidth;
+    size_t stride = 1;
+    // zeros added on every side
+    size_t padding = 0;
+    // spacing between kernel taps; 1 for a regular convolution
+    size_t dilation = 1;
+
+    size_t OutputHeight() const;
+    size_t OutputWidth() const;
+  };
+
+  // Cross-correlation (as in most neural network libraries) of every image with every filter.
+  //   filters has one filter per row, flattened as channels x kernelHeight x kernelWidth. The
+  //   result has filters.NumRows() channels of OutputHeight() x OutputWidth() per image.
+  Matrix Conv2D(const Matrix& images, const Matrix& filters, const Conv2DShape& shape);
+
+  struct Conv2DGradients {
+    Matrix images;
+    Matrix filters;
+  };
+
+  // Gradients of a loss with respect to Conv2D's inputs, given its gradient with respect to the
+  //   output.
+  Conv2DGradients Conv2DBackward(
+      const Matrix& images,
+      const Matrix& filters,
+      const Matrix& outputGradient,
+      const Conv2DShape& shape);
+
+  struct Pool2DShape {
+    size_t channels;
+    size_t height;
+    size_t width;
+    size_t window;
+    size_t stride;
+    // must be smaller than window, so that every window overlaps the image
+    size_t padding = 0;
+
+    size_t OutputHeight() const;
+    size_t OutputWidth() const;
+  };
+
+  // Max of every window, per channel. Padding never wins.
+  Matrix MaxPool2D(const Matrix& images, const Pool2DShape& shape);
+  // Routes each output's gradient to the input that was the max of its window (the first one, on
+  //   ties), which is found again from images.
+  Matrix MaxPool2DBackward(
+      const Matrix& images, const Matrix& outputGradient, const Pool2DShape& shape);
+
+  // Mean of every window, per channel, over the cells inside the image (padding isn't counted).
+  Matrix AvgPool2D(const Matrix& images, const Pool2DShape& shape);
+  Matrix AvgPool2DBackward(const Matrix& outputGradient, const Pool2DShape& shape);
+
+} // math
+} // mdl
+
+#endif // _MDL_MATH_CONVOLUTION
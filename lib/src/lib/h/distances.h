@@ -0,0 +1,35 @@
+#ifndef _MDL_MATH_DISTANCES
+#define _MDL_MATH_DISTANCES
+
+#include "typedefs.h"
+#include "matrix.h"
+#include "functions.h"
+
+namespace mdl {
+namespace math {
+
+  // Distances between the rows of two matrices, e.g. queries and the points they're searched
+  //   among. Euclidean distances come from ||a||^2 + ||b||^2 - 2 a.b, and cosine distances (1 -
+  //   the cosine similarity) from a.b / (||a|| ||b||), so the bulk of the work is a single
+  //   multiply that reads both matrices in place. Distances are then computed from the products
+  //   in a separate pass over the result, in place and in parallel, which reads and writes every
+  //   cell once more.
+  enum class Distance { kEuclidean, kSquaredEuclidean, kCosine };
+
+  // Distance from every row of matrix1 to every row of matrix2: matrix1.NumRows() x
+  //   matrix2.NumRows(). Cosine distances to rows of zeros are 1.
+  Matrix PairwiseDistances(
+      const Matrix& matrix1, const Matrix& matrix2, Distance metric = Distance::kEuclidean);
+
+  // The k references nearest to every query (all of them, if k is larger), nearest first, ties to
+  //   the lower index: values is queries x k, and indices the row of references each came from.
+  //   References are compared a tile at a time against a block of queries, keeping a heap of the
+  //   k best per query, so memory stays bounded however many references there are.
+  ValuesWithIndices KNearest(
+      const Matrix& queries, const Matrix& references, size_t k,
+      Distance metric = Distance::kEuclidean);
+
+} // math
+} // mdl
+
+#endif // _MDL_MATH_DISTANCES
@@ -8,6 +8,7 @@
 #include "matrix_operator_overload.h"
 
 #include <memory>
+#include <span>
 #include <vector>
 #include <fstream>
 #include <mdl/io.h>
@@ -16,6 +17,13 @@ namespace mdl {
 namespace math {
   const int kMtxFileMark = 0x11080101;
   const int kDoublePrecisionBit = 0x01;
+  // Matrix payloads are split in blocks of kMtxBlockCells cells, each byte shuffled and LZ
+  //   compressed (or stored as is when that doesn't help). Each payload starts with the stored size
+  //   of every block, so blocks can be decoded in parallel.
+  const int kMtxCompressedBit = 0x02;
+  const size_t kMtxBlockCells = 1 << 16;
+
+  enum class MtxCompression { kNone, kShuffleLZ };
 
   Matrix Abs(const BaseMatrix& matrix);
   Matrix Ceil(const BaseMatrix& matrix);
@@ -47,13 +55,108 @@ namespace math {
   Matrix Prod(const BaseMatrix& matrix1, const BaseMatrix& matrix2);
   float_t DotProd(const BaseMatrix& matrix1, const BaseMatrix& matrix2);
 
+  // Many independent small products at once: matrices1[i] * matrices2[i]. Parallelizes across the
+  //   batch instead of within each product, which is what dominates for small matrices.
+  std::vector<Matrix> BatchMultiply(
+      std::span<const Matrix> matrices1, std::span<const Matrix> matrices2);
+  // Packed variant: batchSize equally shaped products stacked vertically in stacked1 and stacked2.
+  //   The result stacks the batchSize products the same way.
+  Matrix BatchMultiply(const Matrix& stacked1, const Matrix& stacked2, size_t batchSize);
+
   Matrix Sigmoid(const BaseMatrix& matrix);
   Matrix SigmoidGradient(const Matrix& matrix);
   Matrix ReLU(const Matrix& matrix);
   Matrix ReLUGradient(const Matrix& matrix);
   Matrix Identity(const Matrix& matrix);
   Matrix IdentityGradient(const Matrix& matrix);
-
+  Matrix Tanh(const Matrix& matrix);
+  Matrix TanhGradient(const Matrix& matrix);
+  Matrix LeakyReLU(const Matrix& matrix, float_t slope = 0.01);
+  Matrix LeakyReLUGradient(const Matrix& matrix, float_t slope = 0.01);
+  // Exact (erf based) GELU.
+  Matrix GELU(const Matrix& matrix);
+  Matrix GELUGradient(const Matrix& matrix);
+  Matrix Softplus(const Matrix& matrix);
+  Matrix SoftplusGradient(const Matrix& matrix);
+
+  // Activation and derivative at the same input, computed in a single pass that writes both.
+  //   Cheaper than calling the two functions above when backpropagating.
+  struct ActivationWithGradient {
+    Matrix value;
+    Matrix gradient;
+  };
+
+  ActivationWithGradient SigmoidWithGradient(const Matrix& matrix);
+  ActivationWithGradient ReLUWithGradient(const Matrix& matrix);
+  ActivationWithGradient TanhWithGradient(const Matrix& matrix);
+  ActivationWithGradient LeakyReLUWithGradient(const Matrix& matrix, float_t slope = 0.01);
+  ActivationWithGradient GELUWithGradient(const Matrix& matrix);
+  ActivationWithGradient SoftplusWithGradient(const Matrix& matrix);
+
+  // Derivatives from the activation's output (what a forward pass usually keeps) instead of its
+  //   input, with no exp or tanh to recompute. LeakyReLU's assumes a positive slope.
+  Matrix SigmoidGradientFromOutput(const Matrix& output);
+  Matrix ReLUGradientFromOutput(const Matrix& output);
+  Matrix TanhGradientFromOutput(const Matrix& output);
+  Matrix LeakyReLUGradientFromOutput(const Matrix& output, float_t slope = 0.01);
+  Matrix SoftplusGradientFromOutput(const Matrix& output);
+
+  // Along each row, e.g. over the classes of each sample in a batch. Every row is shifted by its
+  //   max first, so large inputs don't overflow.
+  Matrix Softmax(const Matrix& matrix);
+  Matrix LogSoftmax(const Matrix& matrix);
+  // log(sum(exp(x))) of every row, as a column vector.
+  Matrix LogSumExp(const Matrix& matrix);
+  // Same as above, along each column. ColLogSumExp returns a row vector.
+  Matrix ColSoftmax(const Matrix& matrix);
+  Matrix ColLogSoftmax(const Matrix& matrix);
+  Matrix ColLogSumExp(const Matrix& matrix);
+
+  // Column index of the largest (smallest) cell of every row, the first one on ties. Unlike Max,
+  //   always along rows. NaNs are skipped: a row of only NaNs gives 0.
+  std::vector<size_t> ArgMax(const Matrix& matrix);
+  std::vector<size_t> ArgMin(const Matrix& matrix);
+  // Same as above, along each column: the row index of every column's.
+  std::vector<size_t> ColArgMax(const Matrix& matrix);
+  std::vector<size_t> ColArgMin(const Matrix& matrix);
+
+  struct ValuesWithIndices {
+    Matrix values;
+    // the column every value came from, row-major like values
+    std::vector<size_t> indices;
+  };
+
+  // The k largest cells of every row (all of them, if k is larger), largest first: values is
+  //   rows x k. Selected in a single pass over each row, which is never sorted.
+  ValuesWithIndices TopK(const Matrix& matrix, size_t k);
+  // Column indices that sort every row, rows x cols in row-major order. Equal cells keep their
+  //   order, and NaNs go last in either direction.
+  std::vector<size_t> ArgSort(const Matrix& matrix, bool descending = false);
+
+  // Rows of matrix at the given indices, in order; indices may repeat (e.g. an embedding lookup).
+  //   Same as matrix(IndexRange(rows), Range()), copying whole rows at once.
+  Matrix Gather(const Matrix& matrix, std::span<const size_t> rows);
+  // Gather that checks rows holds every row of matrix exactly once.
+  Matrix Permute(const Matrix& matrix, std::span<const size_t> rows);
+  // Row rows[i] of target = (+=) row i of source. For repeated indices Scatter keeps the last row,
+  //   and ScatterAdd sums them all (e.g. the gradient of an embedding lookup).
+  void Scatter(Matrix& target, std::span<const size_t> rows, const Matrix& source);
+  void ScatterAdd(Matrix& target, std::span<const size_t> rows, const Matrix& source);
+
+  struct LossWithGradient {
+    Matrix loss;
+    Matrix gradient;
+  };
+
+  // Cross entropy between Softmax(logits) and targets, one distribution per row: loss holds the
+  //   loss of every row (rows x 1) and gradient its derivative with respect to logits,
+  //   Softmax(logits) - targets. Computed together, without materializing the softmax.
+  LossWithGradient SoftmaxCrossEntropy(const Matrix& logits, const Matrix& targets);
+  // Same, for one-hot targets given as the class index of every row.
+  LossWithGradient SoftmaxCrossEntropy(const Matrix& logits, const std::vector<size_t>& labels);
+
+  // Both copy every cell. ParameterArena keeps the matrices and their packed form in one buffer
+  //   instead, for code that switches between the two on every step.
   Matrix Pack(const std::vector<Matrix>& matrices);
   std::vector<Matrix> Unpack(
       const Matrix& matrix, 
@@ -65,15 +168,36 @@ namespace math {
   std::vector<Matrix> FromMtx(const char* fileName);
   void FromMtx(const char* fileName, std::function<bool (Matrix&&)> consumer);
   std::function<std::unique_ptr<Matrix> ()> FromMtxStream(const char* fileName);
+  // The compression a file was saved with, read from its header, e.g. to rewrite it the same way.
+  MtxCompression MtxCompressionOf(const char* fileName);
 
+  // Readers handle compressed files transparently, whatever compression they were saved with.
   template <class It>
-  void SaveMtx(std::ostream& out, It begin, It end);  
-  void SaveMtx(std::ostream& out, std::function<const Matrix* ()> supplier);
-  void SaveMtx(std::ostream& out, const Matrix& matrix);
+  void SaveMtx(
+      std::ostream& out, It begin, It end,
+      MtxCompression compression = MtxCompression::kNone);
+  void SaveMtx(
+      std::ostream& out, std::function<const Matrix* ()> supplier,
+      MtxCompression compression = MtxCompression::kNone);
+  void SaveMtx(
+      std::ostream& out, const Matrix& matrix,
+      MtxCompression compression = MtxCompression::kNone);
   template <class It>
-  void SaveMtx(const char* fileName, It begin, It end);
-  void SaveMtx(const char* fileName, std::function<const Matrix* ()> supplier);
-  void SaveMtx(const char* fileName, const Matrix& matrix);
+  void SaveMtx(
+      const char* fileName, It begin, It end,
+      MtxCompression compression = MtxCompression::kNone);
+  void SaveMtx(
+      const char* fileName, std::function<const Matrix* ()> supplier,
+      MtxCompression compression = MtxCompression::kNone);
+  void SaveMtx(
+      const char* fileName, const Matrix& matrix,
+      MtxCompression compression = MtxCompression::kNone);
+
+  // Encodes the cells of one matrix, as laid out by SaveMtx for the given compression, passing the
+  //   bytes to write in order. Uncompressed cells go out in a single call, straight from data.
+  void WriteMtxPayload(
+      const float_t* data, size_t numCells, MtxCompression compression,
+      const std::function<void (const char*, std::size_t)>& write);
 
   void SaveCsv(const char* fileName, const Matrix& matrix);
   void SaveCsv(std::ostream& out, const Matrix& matrix);
@@ -82,39 +206,41 @@ namespace math {
   // IMPLEMENTATIONS
 
   template <class It>
-  void SaveMtx(const char* fileName, It begin, It end) {
-    try {
-      std::ofstream out(fileName, std::ios_base::binary | std::ios_base::out);
-      out.exceptions(std::ios::badbit | std::ios::failbit);
-
-      SaveMtx(out, begin, end);
-    } catch (std::ios_base::failure& ex) {
-      throw mdl::util::exceptionstream()
-        .Append("Cannot write to file: ")
-        .Append(fileName)
-        .Build<mdl::io::io_exception>();
-    }
+  void SaveMtx(const char* fileName, It begin, It end, MtxCompression compression) {
+    It mat = begin;
+    SaveMtx(fileName, [&mat, &end]() -> const Matrix* {
+      return mat == end ? nullptr : &*mat++;
+    }, compression);
   }
 
   template <class It>
-  void SaveMtx(std::ostream& out, It begin, It end) {
+  void SaveMtx(std::ostream& out, It begin, It end, MtxCompression compression) {
     out.write(reinterpret_cast<const char *>(&kMtxFileMark), sizeof(int));
 
     int controlReg = 0;
     if (kDoublePrecision) {
       controlReg |= kDoublePrecisionBit;
     }
+    if (compression != MtxCompression::kNone) {
+      controlReg |= kMtxCompressedBit;
+    }
 
     out.write(reinterpret_cast<const char *>(&controlReg), sizeof(controlReg));
 
     for (It mat = begin; mat != end; ++mat) {
-      int rows = mat->rows;
-      int cols = mat->cols;
+      int rows = mat->NumRows();
+      int cols = mat->NumCols();
       out.write(reinterpret_cast<const char *>(&rows), sizeof(int));
       out.write(reinterpret_cast<const char *>(&cols), sizeof(int));
-      if (mat->rows * mat->cols > 0) {
-        out.write(reinterpret_cast<const char *>(mat->data.get()), 
-            sizeof(float_t) * mat->rows * mat->cols);
+      if (mat->NumCells() > 0) {
+        // the payload is written straight from memory, so the cells have to be contiguous
+        MemoryLayout layout;
+        if (!mat->GetLayout(layout) || layout.colStride != 1
+            || (rows > 1 && layout.rowStride != cols)) {
+          throw mdl::io::io_exception("Only matrices with contiguous cells can be saved");
+        }
+        WriteMtxPayload(layout.data, mat->NumCells(), compression,
+            [&out](const char* bytes, std::size_t size) { out.write(bytes, size); });
       }
     }
   }
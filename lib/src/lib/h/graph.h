@@ -0,0 +1,192 @@
+#ifndef _MDL_MATH_GRAPH
+#define _MDL_MATH_GRAPH
+
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+#include "typedefs.h"
+#include "matrix.h"
+
+namespace mdl {
+namespace math {
+
+  class CompiledGraph;
+
+  // Records a fixed sequence of operations on fixed shapes once, so that it can be compiled and
+  //   replayed many times (e.g. inference on equally sized batches):
+  //
+  //     Graph graph;
+  //     Graph::Value x = graph.Input(batchSize, 784);
+  //     Graph::Value hidden = graph.Sigmoid(
+  //         graph.Add(graph.Multiply(x, graph.Constant(w1)), graph.Constant(b1)));
+  //     ...
+  //     CompiledGraph compiled = graph.Compile({output});
+  //     const Matrix& y = compiled.Run({batch})[0];
+  //
+  // Recording checks dimensions and throws std::invalid_argument right away, so compiled graphs
+  //   never fail on shapes other than the inputs'.
+  class Graph {
+    public:
+      // Result of a recorded operation. Only meaningful for the graph that returned it.
+      class Value {
+        public:
+          Value() : id(-1), rows(0), cols(0) {}
+
+          inline size_t NumRows() const { return rows; }
+          inline size_t NumCols() const { return cols; }
+
+        private:
+          Value(int id, size_t rows, size_t cols) : id(id), rows(rows), cols(cols) {}
+
+          int id;
+          size_t rows;
+          size_t cols;
+
+          friend class Graph;
+      };
+
+      // Inputs are bound, in the order they were declared, on every CompiledGraph::Run().
+      Value Input(size_t rows, size_t cols);
+      // Copied into the graph. Constants multiplied from the right are stored transposed, so the
+      //   compiled graph doesn't transpose them on every run.
+      Value Constant(const Matrix& matrix);
+
+      Value Multiply(Value matrix1, Value matrix2);
+
+      // Element-wise. matrix2 may also be a row vector (1 x cols), a column vector (rows x 1) or a
+      //   1x1 matrix, broadcast over matrix1. The result has the shape of matrix1.
+      Value Add(Value matrix1, Value matrix2);
+      Value Subtract(Value matrix1, Value matrix2);
+      Value Prod(Value matrix1, Value matrix2);
+      Value Scale(Value matrix, float_t scalar);
+
+      Value Exp(Value matrix);
+      Value Sigmoid(Value matrix);
+      Value ReLU(Value matrix);
+
+      // Plans execution of everything "outputs" depend on: chains of element-wise operations are
+      //   fused into single passes, kernels are chosen from the (known) shapes and intermediates
+      //   are assigned to offsets of one arena, reusing space whose contents are no longer needed.
+      CompiledGraph Compile(const std::vector<Value>& outputs) const;
+
+    private:
+      enum class Kind {
+        kInput,
+        kConstant,
+        kMultiply,
+        kAdd,
+        kSubtract,
+        kProd,
+        kScale,
+        kExp,
+        kSigmoid,
+        kReLU
+      };
+
+      struct Node {
+        Kind kind;
+        size_t rows;
+        size_t cols;
+        int operand1 = -1;
+        int operand2 = -1;
+        float_t scalar = 0.0;
+        // index into inputs or constants
+        int index = -1;
+      };
+
+      std::vector<Node> nodes;
+      std::vector<Matrix> constants;
+      int numInputs = 0;
+
+      static bool IsElementwise(Kind kind);
+
+      const Node& NodeOf(Value value) const;
+      Value Record(const Node& node);
+      Value Binary(Kind kind, Value matrix1, Value matrix2);
+      Value Unary(Kind kind, Value matrix, float_t scalar = 0.0);
+
+      friend class CompiledGraph;
+  };
+
+  // Execution plan produced by Graph::Compile(). Not copyable, and not safe to run concurrently
+  //   (use one per thread).
+  class CompiledGraph {
+    public:
+      CompiledGraph(CompiledGraph&& other) = default;
+      CompiledGraph& operator=(CompiledGraph&& other) = default;
+
+      // Runs the plan on inputs shaped as declared. Allocates no matrices: intermediates live in
+      //   the arena and the results are written to matrices owned by this object, which are
+      //   overwritten by the next run (copy them to keep them).
+      const std::vector<Matrix>& Run(
+          std::initializer_list<std::reference_wrapper<const Matrix>> inputs);
+
+      // Number of kernels launched per run, after fusion.
+      inline size_t NumSteps() const { return steps.size(); }
+      // Cells of intermediate storage; compare to the sum of all intermediate sizes.
+      inline size_t ArenaSize() const { return arenaSize; }
+
+    private:
+      enum class Storage { kInput, kConstant, kArena, kOutput };
+      enum class Broadcast { kNone, kRow, kCol, kScalar };
+
+      struct Buffer {
+        Storage storage;
+        size_t index;
+      };
+
+      // One element-wise operation applied to the running value of a fused step.
+      struct Apply {
+        Graph::Kind kind;
+        int operand = -1;
+        Broadcast broadcast = Broadcast::kNone;
+        // operand op value rather than value op operand
+        bool reversed = false;
+        float_t scalar = 0.0;
+      };
+
+      struct Step {
+        bool multiply;
+        size_t rows;
+        size_t cols;
+        int out = -1;
+
+        // multiply: out = operand1 * operand2, reading operand2 transposed. When operand2 isn't
+        //   stored transposed already, it is first transposed into scratch.
+        size_t inner = 0;
+        int operand1 = -1;
+        int operand2 = -1;
+        int scratch = -1;
+
+        // element-wise: out = source, followed by every apply in order
+        int source = -1;
+        std::vector<Apply> applies = {};
+      };
+
+      CompiledGraph() = default;
+
+      std::vector<std::pair<size_t, size_t>> inputShapes;
+      std::vector<Matrix> constants;
+      std::vector<Matrix> outputs;
+      std::unique_ptr<float_t[]> arena;
+      size_t arenaSize = 0;
+      std::vector<Buffer> buffers;
+      std::vector<Step> steps;
+      // resolved addresses of buffers, refreshed on every run
+      std::vector<float_t*> addresses;
+
+      void RunMultiply(const Step& step);
+      void RunElementwise(const Step& step);
+      static void ApplyBlock(
+          const Apply& apply, const float_t* operand, float_t* out, size_t from, size_t to,
+          size_t cols);
+
+      friend class Graph;
+  };
+
+} // math
+} // mdl
+
+#endif // _MDL_MATH_GRAPH
@@ -0,0 +1,85 @@
+#ifndef _MDL_MATH_LINALG
+#define _MDL_MATH_LINALG
+
+#include <vector>
+
+#include "typedefs.h"
+#include "matrix.h"
+
+namespace mdl {
+namespace math {
+
+  // All factorizations below are blocked and right-looking: each step factors a narrow panel of
+  //   kFactorizationBlockSize columns with a simple loop and then updates the trailing matrix with
+  //   one large matrix multiplication, which is where almost all of the work (and all of the
+  //   parallelism) is.
+  const size_t kFactorizationBlockSize = 64;
+
+  // LU factorization with partial pivoting: P * A = L * U, where L is unit lower triangular and U
+  //   is upper triangular. A must be square. Singular matrices can still be factored (and have a
+  //   zero determinant), but cannot be solved or inverted.
+  class LU {
+    public:
+      explicit LU(const Matrix& matrix);
+
+      Matrix L() const;
+      Matrix U() const;
+      // Row i of P * A is row GetPermutation()[i] of A.
+      inline const std::vector<size_t>& GetPermutation() const { return permutation; }
+      inline bool IsSingular() const { return singular; }
+
+      float_t Determinant() const;
+      // Returns X such that A * X = B. B may have any number of columns.
+      Matrix Solve(const Matrix& b) const;
+      Matrix Inverse() const;
+
+    private:
+      // L (below the diagonal) and U (on and above it) packed in the same matrix.
+      Matrix factors;
+      std::vector<size_t> permutation;
+      int sign;
+      bool singular;
+  };
+
+  // Cholesky factorization A = L * L' of a symmetric positive definite matrix. Only the lower
+  //   triangle of A is read.
+  class Cholesky {
+    public:
+      explicit Cholesky(const Matrix& matrix);
+
+      Matrix L() const;
+
+      float_t Determinant() const;
+      Matrix Solve(const Matrix& b) const;
+
+    private:
+      Matrix factors;
+  };
+
+  // Householder QR factorization A = Q * R of a matrix with at least as many rows as columns.
+  //   Q is returned in its thin (rows x cols) form and R is cols x cols.
+  class QR {
+    public:
+      explicit QR(const Matrix& matrix);
+
+      Matrix Q() const;
+      Matrix R() const;
+
+      // Returns X minimizing |A * X - B| (column wise). A must have full column rank.
+      Matrix Solve(const Matrix& b) const;
+
+    private:
+      // R on and above the diagonal, Householder vectors (with an implicit leading 1) below it.
+      Matrix factors;
+      std::vector<float_t> tau;
+  };
+
+  Matrix Solve(const Matrix& a, const Matrix& b);
+  Matrix LeastSquares(const Matrix& a, const Matrix& b);
+  Matrix Inverse(const Matrix& matrix);
+  float_t Determinant(const Matrix& matrix);
+
+} // math
+} // mdl
+
+#endif // _MDL_MATH_LINALG
@@ -0,0 +1,184 @@
+#ifndef _MDL_MATH_MASK
+#define _MDL_MATH_MASK
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "typedefs.h"
+#include "matrix.h"
+#include "operation.h"
+#include "stats.h"
+#include "multithread/helper.h"
+
+namespace mdl {
+namespace math {
+
+  // A boolean per cell of a rows x cols matrix, packed 64 to a word in row-major order. The
+  //   comparison operators return 0/1 matrices of floats; a Mask of the same comparison takes 32
+  //   times less memory, and Where() and MaskedAssign() below apply it in a single pass instead of
+  //   multiplying by it:
+  //
+  //     Mask positive = Mask::Compare<op::GreaterThan>(x, 0.0);
+  //     Matrix clipped = Where(positive, x, 0.0);
+  //     MaskedAssign(y(Range(0, 10), Range()), positive, 1.0);
+  class Mask {
+    public:
+      Mask();
+      // All cells unset.
+      Mask(size_t rows, size_t cols);
+
+      // Cells where the comparison (any of GreaterThan, LessThanEquals, Equals, ... in
+      //   operation.h) holds between the matrix and scalar, or the matching cell of matrix2.
+      template <typename Comparison>
+      static Mask Compare(const Matrix& matrix, float_t scalar);
+      template <typename Comparison>
+      static Mask Compare(const Matrix& matrix1, const Matrix& matrix2);
+      // Cells that aren't zero, e.g. of the 0/1 matrix a comparison operator returned.
+      static Mask NonZero(const Matrix& matrix);
+
+      inline size_t NumRows() const { return rows; }
+      inline size_t NumCols() const { return cols; }
+      inline size_t NumCells() const { return rows * cols; }
+
+      inline bool operator()(size_t row, size_t col) const {
+        std::uint64_t cell = static_cast<std::uint64_t>(row) * cols + col;
+        return (words[cell / 64] >> (cell % 64)) & 1;
+      }
+      void Set(size_t row, size_t col, bool value);
+
+      // Number of cells set, with a popcount per word.
+      std::uint64_t Count() const;
+      // 1.0 where set and 0.0 elsewhere, as the comparison operators return.
+      Matrix ToMatrix() const;
+      bool Equals(const Mask& other) const;
+
+      Mask operator&&(const Mask& other) const;
+      Mask operator||(const Mask& other) const;
+      Mask operator!() const;
+
+    private:
+      size_t rows;
+      size_t cols;
+      // bits past the last cell are always unset
+      std::vector<std::uint64_t> words;
+
+      // Compare against other(i), the value matched with cell i.
+      template <typename Comparison, typename Other>
+      static Mask Compare(size_t rows, size_t cols, const float_t* data, Other other);
+      template <typename Operation>
+      Mask Combine(const Mask& other) const;
+
+      friend Matrix Where(const Mask& mask, const Matrix& matrix1, const Matrix& matrix2);
+      friend Matrix Where(const Mask& mask, const Matrix& matrix, float_t scalar);
+  };
+
+  // mask ? matrix1 : matrix2 (or scalar), cell by cell.
+  Matrix Where(const Mask& mask, const Matrix& matrix1, const Matrix& matrix2);
+  Matrix Where(const Mask& mask, const Matrix& matrix, float_t scalar);
+
+  // Sets the cells of target (a matrix or any slice) where mask is set, to value or to the matching
+  //   cell of source, leaving the others as they are.
+  void MaskedAssign(BaseMatrix& target, const Mask& mask, float_t value);
+  void MaskedAssign(BaseMatrix& target, const Mask& mask, const BaseMatrix& source);
+  // Slices are usually temporaries, e.g. MaskedAssign(m(Range(0, 10), Range()), mask, 0.0).
+  inline void MaskedAssign(BaseMatrix&& target, const Mask& mask, float_t value) {
+    MaskedAssign(target, mask, value);
+  }
+  inline void MaskedAssign(BaseMatrix&& target, const Mask& mask, const BaseMatrix& source) {
+    MaskedAssign(target, mask, source);
+  }
+
+
+  // IMPLEMENTATIONS
+
+  namespace masks {
+    // Packs 64 flags, each 0 or 1, into a word: bit j from flags[j]. Multiplying 8 flags read as
+    //   one word by the constant moves flag k to bit 56 + k, with no carries in between.
+    inline std::uint64_t Pack(const std::uint8_t* flags) {
+      std::uint64_t word = 0;
+      for (int byte = 0; byte < 8; byte++) {
+        std::uint64_t eight;
+        std::memcpy(&eight, flags + 8 * byte, sizeof(eight));
+        word |= ((eight * 0x0102040810204080ull) >> 56) << (8 * byte);
+      }
+      return word;
+    }
+
+    // Flags of cells [first, first + n) as bytes, which the compiler vectorizes, unlike
+    //   setting bits one at a time. N is n when fixed, to unroll full words.
+    template <typename Comparison, int N, typename Other>
+    inline void Flags(
+        const float_t* data, Other& other, std::uint64_t first, size_t n, std::uint8_t* flags) {
+      if (N != 0) {
+        n = N;
+      }
+      for (size_t j = 0; j < n; j++) {
+        float_t out;
+        Comparison::operate(data[first + j], other(first + j), out);
+        flags[j] = out != 0;
+      }
+    }
+  }
+
+  template <typename Comparison>
+  Mask Mask::Compare(const Matrix& matrix, float_t scalar) {
+    MemoryLayout layout;
+    matrix.GetLayout(layout);
+    return Compare<Comparison>(matrix.NumRows(), matrix.NumCols(), layout.data,
+        [scalar](std::uint64_t) { return scalar; });
+  }
+
+  template <typename Comparison>
+  Mask Mask::Compare(const Matrix& matrix1, const Matrix& matrix2) {
+    if (matrix1.NumRows() != matrix2.NumRows() || matrix1.NumCols() != matrix2.NumCols()) {
+      std::ostringstream os;
+      os << "Cannot compare matrices of different dimensions: "
+          << matrix1.NumRows() << 'x' << matrix1.NumCols()
+          << " and " << matrix2.NumRows() << 'x' << matrix2.NumCols();
+      throw std::invalid_argument(os.str());
+    }
+
+    MemoryLayout layout1, layout2;
+    matrix1.GetLayout(layout1);
+    matrix2.GetLayout(layout2);
+    const float_t* data2 = layout2.data;
+    return Compare<Comparison>(matrix1.NumRows(), matrix1.NumCols(), layout1.data,
+        [data2](std::uint64_t i) { return data2[i]; });
+  }
+
+  template <typename Comparison, typename Other>
+  Mask Mask::Compare(size_t rows, size_t cols, const float_t* data, Other other) {
+    Mask mask(rows, cols);
+    std::uint64_t numCells = mask.NumCells();
+    static stats::Counter counter("Compare", stats::Backend::kMultiThread);
+    stats::Probe probe(counter, rows, cols, numCells, numCells,
+        numCells * sizeof(float_t) + mask.words.size() * sizeof(std::uint64_t));
+
+    std::uint64_t* words = mask.words.data();
+    multithread::ParallelFor(mask.words.size(), 64,
+        [data, &other, words, numCells](size_t from, size_t to) {
+      alignas(8) std::uint8_t flags[64];
+      for (size_t word = from; word < to; word++) {
+        std::uint64_t first = static_cast<std::uint64_t>(word) * 64;
+        if (numCells - first >= 64) {
+          masks::Flags<Comparison, 64>(data, other, first, 64, flags);
+        } else {
+          size_t n = numCells - first;
+          masks::Flags<Comparison, 0>(data, other, first, n, flags);
+          std::fill(flags + n, flags + 64, 0);
+        }
+        words[word] = masks::Pack(flags);
+      }
+    });
+
+    return mask;
+  }
+
+} // math
+} // mdl
+
+#endif // _MDL_MATH_MASK
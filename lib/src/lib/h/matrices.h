@@ -1,11 +1,13 @@
 #ifndef _MDL_MATH_MATRICES
 #define _MDL_MATH_MATRICES
 
+#include <cstdint>
 #include <random>
 #include <vector>
 
 #include "typedefs.h"
 #include "matrix.h"
+#include "random.h"
 
 namespace mdl {
 namespace math {
@@ -16,14 +18,42 @@ namespace math {
       static Matrix Ones(size_t rows, size_t cols);
       static Matrix Zeros(size_t rows, size_t cols);
       static Matrix Random(size_t rows, size_t cols);
+      static Matrix Random(size_t rows, size_t cols, std::uint64_t seed);
       static Matrix Sequence(size_t rows, size_t cols, size_t length);
       static Matrix Sequence(size_t rows, size_t cols, Range range);
       static Matrix Default(size_t rows, size_t cols, float_t def);
       static Matrix WithValues(size_t cols, const std::vector<float_t>& values);
 
+      // Seeded random matrices. Cell (row, col) is always the (row * cols + col)-th draw for the
+      //   given seed, no matter how many threads fill the matrix.
+      static Matrix Uniform(
+          size_t rows, size_t cols, std::uint64_t seed, float_t min = 0.0, float_t max = 1.0);
+      static Matrix Normal(
+          size_t rows, size_t cols, std::uint64_t seed, float_t mean = 0.0, float_t stdDev = 1.0);
+      static Matrix TruncatedNormal(
+          size_t rows, size_t cols, std::uint64_t seed, float_t mean = 0.0, float_t stdDev = 1.0);
+      static Matrix Bernoulli(size_t rows, size_t cols, std::uint64_t seed, float_t p);
+
+      // Weight initializers. Matrices are assumed to be laid out as fanIn x fanOut (i.e. rows are
+      //   inputs, columns are outputs, as used in "X * W").
+      static Matrix XavierUniform(size_t rows, size_t cols, std::uint64_t seed);
+      static Matrix XavierNormal(size_t rows, size_t cols, std::uint64_t seed);
+      static Matrix HeUniform(size_t rows, size_t cols, std::uint64_t seed);
+      static Matrix HeNormal(size_t rows, size_t cols, std::uint64_t seed);
+
       static Matrix FromCsv(const char* fileName, bool ignoreFirstLine = false);
       
       static Matrix Biased(const BaseMatrix& matrix);
+
+    private:
+      template <typename Transform>
+      static Matrix FillRandom(
+          size_t rows, 
+          size_t cols, 
+          const Philox& philox, 
+          std::uint32_t stream, 
+          int cellsPerBlock, 
+          Transform transform);
   };
 
 } // math
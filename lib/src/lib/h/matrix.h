@@ -3,6 +3,7 @@
 
 #include <ostream>
 #include <sstream>
+#include <type_traits>
 
 #include "typedefs.h"
 #include "basematrix.h"
@@ -10,6 +11,7 @@
 #include "range.h"
 #include "accessor.h"
 #include "operation.h"
+#include "multithread/helper.h"
 
 namespace mdl {
 namespace math {
@@ -33,7 +35,11 @@ class Matrix : public BaseMatrix {
     explicit Matrix(float_t value);
     Matrix(size_t rows, size_t cols);
     Matrix(size_t rows, size_t cols, float_t data[]);
-    Matrix(size_t rows, size_t cols, std::function<float_t (size_t, size_t)> initFn);
+    // Cell (row, col) is set to initFn(row, col). initFn is inlined and, for large matrices, called
+    //   concurrently from the worker pool, so it must be a pure function of its arguments.
+    template <typename InitFn>
+      requires std::is_invocable_r_v<float_t, InitFn, size_t, size_t>
+    Matrix(size_t rows, size_t cols, InitFn initFn);
     Matrix(const Matrix& other);
     Matrix(Matrix&& other);
     Matrix(const BaseMatrix& other);
@@ -110,11 +116,19 @@ class Matrix : public BaseMatrix {
     const Slice<LeftRange, LeftRange, DirectAccessor> operator()() const;
 
     Matrix Transpose() const;
+    // A view of the transpose, sharing the cells: products such as a.Transposed() * b read it in
+    //   place, where Transpose() would copy the matrix first.
+    const Slice<LeftRange, LeftRange, TransposedAccessor> Transposed() const;
 
     inline size_t NumRows() const override { return rows; }
     inline size_t NumCols() const override { return cols; }
     inline size_t NumCells() const override { return rows * cols; }
 
+    inline bool GetLayout(MemoryLayout& layout) const override {
+      layout = MemoryLayout{data.get(), cols, 1};
+      return true;
+    }
+
     
     std::ostream& operator<<(std::ostream& os);
 
@@ -129,21 +143,45 @@ class Matrix : public BaseMatrix {
     friend class metal::MatrixReflexiveImpl;
     friend class multithread::MatrixReflexiveImpl;
     friend class singlethread::MatrixReflexiveImpl;
+    friend class Matrices;
+    friend class MinibatchLoader;
+    friend class LU;
+    friend class Cholesky;
+    friend class QR;
+    friend class CompiledGraph;
+    friend class ParameterArena;
     friend Matrix operator*(const Matrix& matrix1, const Matrix& matrix2);
 
     friend Matrix Pack(const std::vector<Matrix>& matrices);
     friend std::vector<Matrix> Unpack(
         const Matrix& matrix, 
         const std::vector<std::pair<size_t, size_t>>& sizes);
-    
-    template <class It>
-    friend void SaveMtx(std::ostream& out, It begin, It end);
-    template <class It>
-    friend void SaveMtx(const char* fileName, It begin, It end);
 };
 
 typedef std::function<Matrix (const Matrix&)> mtxtransf;
 
+
+template <typename InitFn>
+  requires std::is_invocable_r_v<float_t, InitFn, size_t, size_t>
+Matrix::Matrix(size_t rows, size_t cols, InitFn initFn)
+    : rows(rows), cols(cols), 
+      data(std::shared_ptr<float_t[]>(new float_t[rows * cols])) {
+  float_t * ptr = data.get();
+  multithread::ParallelFor(rows * cols, [ptr, cols, &initFn](size_t from, size_t to) {
+    size_t frow = from / cols;
+    size_t trow = (to + cols - 1) / cols;
+
+    for (size_t row = frow; row < trow; row++) {
+      size_t fcol = row == frow ? from % cols : 0;
+      size_t tcol = row * cols + cols > to ? to - row * cols : cols;
+      float_t * runner = ptr + row * cols;
+      for (size_t col = fcol; col < tcol; col++) {
+        runner[col] = initFn(row, col);
+      }
+    }
+  });
+}
+
 } // math
 } // mdl
 
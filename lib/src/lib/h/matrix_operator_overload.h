@@ -8,6 +8,11 @@ namespace mdl {
 namespace math {
 
   Matrix operator*(const Matrix& matrix1, const Matrix& matrix2);
+  // Products with slices, e.g. transposed views, which are read in place when their rows or
+  //   columns are contiguous.
+  Matrix operator*(const BaseMatrix& matrix1, const BaseMatrix& matrix2);
+  Matrix operator*(const Matrix& matrix1, const BaseMatrix& matrix2);
+  Matrix operator*(const BaseMatrix& matrix1, const Matrix& matrix2);
 
 } // math
 } // mdl
@@ -6,6 +6,7 @@
 #include <mdl/profiler.h>
 
 #include "../matrix.h"
+#include "../stats.h"
 #include "engine.h"
 
 namespace mdl {
@@ -29,6 +30,8 @@ namespace metal {
     size_t rows = matrix.NumRows();
     size_t cols = matrix.NumCols();
     size_t buffSize = rows * cols * sizeof(float_t);
+    static stats::Counter counter("Transpose", stats::Backend::kMetal);
+    stats::Probe probe(counter, rows, cols, matrix.NumCells(), 0, 2ull * buffSize);
 
     float_t * sdata = matrix.data.get();
     float_t * data = new float_t[rows * cols];
@@ -45,6 +48,11 @@ namespace metal {
   inline Matrix MatrixImpl::Multiply(const Matrix& matrix1, const Matrix& matrix2) {
     size_t rows1 = matrix1.NumRows();
     size_t cols2 = matrix2.NumCols();
+    static stats::Counter counter("Multiply", stats::Backend::kMetal);
+    std::uint64_t numCells = static_cast<std::uint64_t>(rows1) * cols2;
+    stats::Probe probe(counter, rows1, cols2, numCells,
+        2 * numCells * matrix1.NumCols(),
+        (matrix1.NumCells() + matrix2.NumCells() + numCells) * sizeof(float_t));
 
     float_t * m1Data = matrix1.data.get();
     float_t * m2Data = matrix2.data.get();
@@ -0,0 +1,84 @@
+#ifndef _MDL_MATH_MINIBATCH_LOADER
+#define _MDL_MATH_MINIBATCH_LOADER
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "typedefs.h"
+#include "matrix.h"
+#include "random.h"
+
+namespace mdl {
+namespace math {
+
+  // Produces minibatches of rows (examples) read from one or more MTX files. All matrices in all
+  //   files are treated as one dataset, so they must have the same number of columns.
+  //
+  // Reading and batch assembly happen on a background thread that stays up to "prefetch" batches
+  //   ahead of the consumer (2 = double buffering), so they overlap with whatever the caller does
+  //   between calls to Next(). When shuffling, the whole dataset is loaded once and every epoch
+  //   visits it in a new order that only depends on the seed and the epoch number. Without
+  //   shuffling, files are streamed from disk on every epoch and memory stays bounded.
+  class MinibatchLoader {
+    public:
+      MinibatchLoader(
+          const std::vector<std::string>& fileNames,
+          size_t batchSize,
+          bool shuffle = true,
+          std::uint64_t seed = NextSeed(),
+          int prefetch = 2);
+      ~MinibatchLoader();
+
+      MinibatchLoader(const MinibatchLoader&) = delete;
+      MinibatchLoader& operator=(const MinibatchLoader&) = delete;
+
+      // Moves the next minibatch into batch. Returns false at the end of each epoch, in which case
+      //   batch is left untouched; the following call starts the next epoch. The last batch of an
+      //   epoch may have fewer than batchSize rows.
+      //
+      // If batch holds a full-size batch previously returned by this loader, and its buffer is not
+      //   shared with any other matrix, the buffer is handed back to the background thread for
+      //   reuse. Calling Next() in a loop with the same Matrix therefore doesn't allocate.
+      bool Next(Matrix& batch);
+
+      inline size_t GetBatchSize() const { return batchSize; }
+
+    private:
+      std::vector<std::string> fileNames;
+      size_t batchSize;
+      bool shuffle;
+      Philox philox;
+      // compared with the sizes of the queue and free list
+      std::size_t prefetch;
+
+      std::mutex mutex;
+      std::condition_variable notFull;
+      std::condition_variable notEmpty;
+      // An empty optional marks the end of an epoch.
+      std::deque<std::optional<Matrix>> queue;
+      std::vector<Matrix> freeBatches;
+      std::exception_ptr error;
+      std::atomic<bool> closing;
+      std::thread worker;
+
+      void Run();
+      void RunShuffledEpochs();
+      void RunStreamingEpochs();
+      // Queues batch (leaving it empty), or the end of an epoch when batch is null.
+      bool Push(Matrix* batch);
+      Matrix Allocate(size_t rows, size_t cols);
+  };
+
+} // math
+} // mdl
+
+#endif // _MDL_MATH_MINIBATCH_LOADER
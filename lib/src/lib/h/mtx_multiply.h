@@ -0,0 +1,44 @@
+#ifndef _MDL_MATH_MTX_MULTIPLY
+#define _MDL_MATH_MTX_MULTIPLY
+
+#include <cstdint>
+
+#include "typedefs.h"
+#include "matrix.h"
+#include "mtx_reader.h"
+#include "mtx_writer.h"
+
+namespace mdl {
+namespace math {
+
+  struct MtxMultiplyOptions {
+    // Bytes of tiles held at once: of both operands, including the one read ahead, and of two
+    //   bands of result rows, the one being computed and the one being written.
+    std::uint64_t memoryBudget = std::uint64_t(1) << 30;
+    // Multiplies by the transpose of the second matrix, read as it's stored (e.g. A * A^T, for a
+    //   Gram matrix, from a single file).
+    bool transposeSecond = false;
+  };
+
+  // Multiplies matrices too large for memory, straight from their MTX files: matrix index1 of
+  //   reader1 times matrix index2 of reader2 (the same reader, possibly) is written to writer, as
+  //   a single matrix.
+  //
+  // The product is computed a band of rows at a time. Every band adds up the products of tiles of
+  //   the operands, multiplied in memory as usual, and the tiles are as large as the memory budget
+  //   allows, to read the operands as few times as possible. Every tile is read while the previous
+  //   one is multiplied, and with a writer in the background, every band is written while the
+  //   next is computed. Throws std::invalid_argument if the dimensions don't match, or the budget
+  //   can't fit a single row of the product.
+  //
+  // Bands are written with MtxWriter::BeginRows(), so the writer can't compress: it throws
+  //   std::invalid_argument before anything is read, unless the product is empty. Compress the
+  //   file afterwards instead (e.g. with mtxtool cat --compress).
+  void MultiplyMtx(
+      const MtxReader& reader1, size_t index1, const MtxReader& reader2, size_t index2,
+      MtxWriter& writer, const MtxMultiplyOptions& options = MtxMultiplyOptions());
+
+} // math
+} // mdl
+
+#endif // _MDL_MATH_MTX_MULTIPLY
@@ -0,0 +1,88 @@
+#ifndef _MDL_MATH_MTX_READER
+#define _MDL_MATH_MTX_READER
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "typedefs.h"
+#include "matrix.h"
+#include "range.h"
+#include "functions.h"
+
+namespace mdl {
+namespace math {
+
+  // Random access to the matrices of an MTX file, compressed or not. Reads fetch only the bytes
+  //   they need with pread(), so the first rows of a huge matrix, or one shard of its rows, come
+  //   back without loading the rest. Of compressed matrices, only the blocks that hold requested
+  //   cells are read and decoded.
+  //
+  // Matrices are located on demand, by walking the headers (and the block tables of compressed
+  //   matrices) up to the one asked for; payloads are skipped, never read. All methods are safe to
+  //   call from several threads at once.
+  class MtxReader {
+    public:
+      explicit MtxReader(const char* fileName);
+      ~MtxReader();
+
+      MtxReader(const MtxReader&) = delete;
+      MtxReader& operator=(const MtxReader&) = delete;
+
+      // Whether fileName can be read this way. Pipes, FIFOs and process substitutions (<(...))
+      //   can't be seeked, so they have to be streamed with FromMtxStream. Missing files count as
+      //   seekable, leaving the constructor to report them.
+      static bool IsSeekable(const char* fileName);
+
+      // Locates every matrix in the file.
+      size_t NumMatrices() const;
+      // Whether there's an index-th matrix, locating only the ones up to it.
+      bool Contains(size_t index) const;
+      // Dimensions of the index-th matrix. Throw std::invalid_argument past the last matrix, like
+      //   the reads below.
+      size_t NumRows(size_t index) const;
+      size_t NumCols(size_t index) const;
+      // From the file's header, e.g. to rewrite it the way it was written.
+      MtxCompression GetCompression() const;
+
+      Matrix Read(size_t index) const;
+      // Same as Read(index)(rows, cols), ranges clipped to the matrix the same way.
+      Matrix Read(size_t index, const Range& rows, const Range& cols) const;
+
+    private:
+      struct Entry {
+        size_t rows;
+        size_t cols;
+        // first byte of the cells, or of the block table if compressed
+        std::uint64_t payload;
+        // where every block starts, followed by where the last one ends; empty if not compressed
+        std::vector<std::uint64_t> blocks;
+        std::uint64_t end;
+      };
+
+      std::string fileName;
+      int fd;
+      std::uint64_t fileSize;
+      std::size_t elementSize;
+      bool compressed;
+
+      mutable std::mutex mutex;
+      // a deque, so entries stay put while others are appended
+      mutable std::deque<Entry> entries;
+      mutable bool complete;
+
+      // Locates matrices up to index. Returns null if the file has fewer.
+      const Entry* Locate(size_t index) const;
+      const Entry& Get(size_t index) const;
+      void ReadBytes(char* dst, std::size_t size, std::uint64_t offset) const;
+      void ReadPlain(const Entry& entry, const Range& rows, const Range& cols, float_t* out) const;
+      void ReadCompressed(
+          const Entry& entry, const Range& rows, const Range& cols, float_t* out) const;
+  };
+
+} // math
+} // mdl
+
+#endif // _MDL_MATH_MTX_READER
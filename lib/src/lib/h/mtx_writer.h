@@ -0,0 +1,130 @@
+#ifndef _MDL_MATH_MTX_WRITER
+#define _MDL_MATH_MTX_WRITER
+
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "typedefs.h"
+#include "matrix.h"
+#include "functions.h"
+
+namespace mdl {
+namespace math {
+
+  struct MtxWriterOptions {
+    MtxCompression compression = MtxCompression::kNone;
+    // Writes on a background thread, while the caller fills the other of two buffers.
+    bool background = false;
+    // fsync()s the file on Close(), so it's on disk once that returns (e.g. before a rename).
+    bool sync = false;
+    // Size of each buffer. Matrices larger than half of it bypass the buffers when possible.
+    std::size_t bufferSize = 1 << 22;
+  };
+
+  // Writes matrices in the MTX format, the same bytes as SaveMtx, straight to a file descriptor:
+  //   small writes are gathered in page aligned buffers, and large payloads go out together with
+  //   whatever is buffered in a single writev(), with no copy. Writes are sequential, so this also
+  //   works on pipes (e.g. STDOUT_FILENO, as long as nothing else writes to it meanwhile).
+  //
+  // In the background, Write() returns as soon as the matrix is buffered, or handed off when moved
+  //   in, and only blocks while both buffers are in flight. Errors there surface on the next
+  //   Write() or Close(), as io_exception.
+  class MtxWriter {
+    public:
+      // Creates (or truncates) fileName.
+      MtxWriter(const char* fileName, const MtxWriterOptions& options = MtxWriterOptions());
+      // Writes to an open descriptor, which is left open.
+      MtxWriter(int fd, const MtxWriterOptions& options = MtxWriterOptions());
+      // Closes the writer if Close() wasn't called, ignoring errors.
+      ~MtxWriter();
+
+      MtxWriter(const MtxWriter&) = delete;
+      MtxWriter& operator=(const MtxWriter&) = delete;
+
+      // Copies the matrix, unless it's written before returning; either way the caller is free to
+      //   change it afterwards. Throws std::invalid_argument if a dimension doesn't fit the 32 bits
+      //   the format stores.
+      void Write(const Matrix& matrix);
+      // Takes the matrix, leaving it empty. In the background this writes (and compresses) large
+      //   matrices without copying them, so the buffer must not be changed through other matrices
+      //   that share it until Close().
+      void Write(Matrix&& matrix);
+      // Writes a matrix too large to hold in memory a band of rows at a time: BeginRows() writes
+      //   the dimensions, and WriteRows() the next rows, as Write() would their cells, until all
+      //   are written. Nothing else can be written in between. Only without compression, whose
+      //   block table precedes the cells. Throw std::invalid_argument on misuse.
+      void BeginRows(size_t rows, size_t cols);
+      void WriteRows(const Matrix& rows);
+      void WriteRows(Matrix&& rows);
+      // Writes whatever is buffered and waits for the background thread.
+      void Close();
+
+    private:
+      struct Free {
+        void operator()(char* buffer) const { std::free(buffer); }
+      };
+      typedef std::unique_ptr<char[], Free> Buffer;
+
+      // Buffered bytes, followed by the payload of a matrix, if any.
+      struct Job {
+        Buffer buffer;
+        std::size_t size = 0;
+        const float_t* cells = nullptr;
+        size_t numCells = 0;
+        // keeps the cells alive, when handed off
+        Matrix owner;
+      };
+
+      std::string fileName;
+      int fd;
+      bool ownsFd;
+      MtxWriterOptions options;
+      bool closed;
+      // of the matrix BeginRows() started
+      size_t pendingRows;
+      size_t pendingCols;
+
+      Buffer current;
+      std::size_t used;
+
+      std::mutex mutex;
+      std::condition_variable notEmpty;
+      std::condition_variable bufferFree;
+      std::deque<Job> queue;
+      std::vector<Buffer> freeBuffers;
+      std::exception_ptr error;
+      bool closing;
+      std::thread worker;
+
+      // Closes fd if it owns it and construction fails; fileName is null for a bare descriptor.
+      MtxWriter(int fd, bool ownsFd, const char* fileName, const MtxWriterOptions& options);
+
+      static int Open(const char* fileName);
+      Buffer Allocate() const;
+      void WriteHeader(size_t rows, size_t cols);
+      void WriteCells(const Matrix& matrix);
+      void WriteCells(Matrix&& matrix);
+      void CheckNotPending() const;
+      void CheckRows(const Matrix& rows) const;
+      void Append(const char* bytes, std::size_t size);
+      // Writes the current buffer, followed by the given cells, and starts a new buffer.
+      void Submit(const float_t* cells, size_t numCells, Matrix&& owner);
+      void WriteJob(const char* bytes, std::size_t size, const float_t* cells, size_t numCells);
+      void WriteAll(const char* bytes, std::size_t size);
+      void WriteAll(
+          const char* bytes1, std::size_t size1, const char* bytes2, std::size_t size2);
+      void CheckError();
+      void Run();
+  };
+
+} // math
+} // mdl
+
+#endif // _MDL_MATH_MTX_WRITER
@@ -3,6 +3,7 @@
 
 #include "../matrix.h"
 #include "helper.h"
+#include "../stats.h"
 
 namespace mdl {
 namespace math {
@@ -13,6 +14,11 @@ namespace multithread {
 
       template <typename Operation>
       static Matrix Operate(float_t scalar, const BaseMatrix& matrix) {
+        static stats::Counter counter(
+            stats::OpKey<Operation>("BaseScalarOperate"), stats::Backend::kMultiThread);
+        std::uint64_t numCells = static_cast<std::uint64_t>(matrix.NumRows()) * matrix.NumCols();
+        stats::Probe probe(counter, matrix.NumRows(), matrix.NumCols(), numCells, numCells,
+            2 * numCells * sizeof(float_t));
         Matrix result(matrix.NumRows(), matrix.NumCols());
 
         Partition(matrix.NumRows() * matrix.NumCols(), [&matrix, &result, scalar](size_t from, size_t to) {
@@ -38,6 +44,11 @@ namespace multithread {
 
       template <typename Operation>
       static Matrix Operate(const BaseMatrix& matrix, float_t scalar) {
+        static stats::Counter counter(
+            stats::OpKey<Operation>("BaseScalarOperate"), stats::Backend::kMultiThread);
+        std::uint64_t numCells = static_cast<std::uint64_t>(matrix.NumRows()) * matrix.NumCols();
+        stats::Probe probe(counter, matrix.NumRows(), matrix.NumCols(), numCells, numCells,
+            2 * numCells * sizeof(float_t));
         Matrix result(matrix.NumRows(), matrix.NumCols());
 
         Partition(matrix.NumRows() * matrix.NumCols(), [&matrix, &result, scalar](size_t from, size_t to) {
@@ -79,6 +90,12 @@ namespace multithread {
 
           size_t rows = std::max(rows1, rows2);
           size_t cols = std::max(cols1, cols2);
+          static stats::Counter counter(
+              stats::OpKey<Operation>("BaseOperate"), stats::Backend::kMultiThread);
+          std::uint64_t numCells = static_cast<std::uint64_t>(rows) * cols;
+          stats::Probe probe(counter, rows, cols, numCells, numCells,
+              (static_cast<std::uint64_t>(rows1) * cols1 + static_cast<std::uint64_t>(rows2) * cols2
+                  + numCells) * sizeof(float_t));
           Matrix result(rows, cols);
 
           Partition(rows * cols, [&matrix1, &matrix2, &result, cols](size_t from, size_t to) {
@@ -116,6 +133,11 @@ namespace multithread {
 
       template <typename Operation>
       static Matrix UnaryOperate(const BaseMatrix& matrix) {
+        static stats::Counter counter(
+            stats::OpKey<Operation>("BaseUnaryOperate"), stats::Backend::kMultiThread);
+        std::uint64_t numCells = static_cast<std::uint64_t>(matrix.NumRows()) * matrix.NumCols();
+        stats::Probe probe(counter, matrix.NumRows(), matrix.NumCols(), numCells, numCells,
+            2 * numCells * sizeof(float_t));
         Matrix result(matrix.NumRows(), matrix.NumCols());
 
         Partition(matrix.NumRows() * matrix.NumCols(), [&matrix, &result](size_t from, size_t to) {
@@ -141,6 +163,11 @@ namespace multithread {
 
       template <typename Operation>
       static Matrix RowReduce(const BaseMatrix& matrix, float_t initialValue = 0.0) {
+        static stats::Counter counter(
+            stats::OpKey<Operation>("BaseRowReduce"), stats::Backend::kMultiThread);
+        std::uint64_t numCells = static_cast<std::uint64_t>(matrix.NumRows()) * matrix.NumCols();
+        stats::Probe probe(counter, matrix.NumRows(), matrix.NumCols(), numCells, numCells,
+            (numCells + matrix.NumRows()) * sizeof(float_t));
         Matrix result(
             matrix.NumRows(), 
             1, 
@@ -162,6 +189,11 @@ namespace multithread {
 
       template <typename Operation>
       static Matrix ColReduce(const BaseMatrix& matrix, float_t initialValue = 0.0) {
+        static stats::Counter counter(
+            stats::OpKey<Operation>("BaseColReduce"), stats::Backend::kMultiThread);
+        std::uint64_t numCells = static_cast<std::uint64_t>(matrix.NumRows()) * matrix.NumCols();
+        stats::Probe probe(counter, matrix.NumRows(), matrix.NumCols(), numCells, numCells,
+            (numCells + matrix.NumCols()) * sizeof(float_t));
         Matrix result(1, 
             matrix.NumCols(), 
             [initialValue] (size_t row, size_t col) { return initialValue; });
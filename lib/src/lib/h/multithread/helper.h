@@ -3,15 +3,21 @@
 
 #include <mdl/concurrent.h>
 #include <mdl/profiler.h>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
 #include <functional>
 #include <vector>
 
-#include "../matrix.h"
+#include "../typedefs.h"
 
 namespace mdl {
 namespace math {
 namespace multithread {
   const int kNumKernels = 8;
+  // Below this many cells, dispatching to the worker pool costs more than the work itself.
+  const size_t kMinParallelCells = 1 << 14;
 
   // Lamba takes Matrix, start index and final index
   void Partition(
@@ -19,6 +25,92 @@ namespace multithread {
       std::function<std::function<int ()> (size_t, size_t)> dispatch, 
       int numKernels = kNumKernels);
 
+  // Calls fn(from, to) over sub-ranges of [0, numCells). Small ranges run inline on the calling
+  //   thread; larger ones are split across the worker pool.
+  template <typename Fn>
+  void ParallelFor(size_t numCells, Fn fn) {
+    if (numCells < kMinParallelCells) {
+      if (numCells > 0) { fn(0, numCells); }
+      return;
+    }
+
+    Partition(numCells, [&fn](size_t from, size_t to) {
+      return [&fn, from, to]() {
+        fn(from, to);
+        return 0;
+      };
+    });
+  }
+
+  // Calls fn(from, to) over sub-ranges of [0, count), for items (rows, columns, matrices) that
+  //   cost about cellsPerItem cells of work each. Runs inline when the total is small.
+  template <typename Fn>
+  void ParallelFor(size_t count, std::uint64_t cellsPerItem, Fn fn) {
+    if (count < 2 || count * cellsPerItem < kMinParallelCells) {
+      if (count > 0) { fn(0, count); }
+      return;
+    }
+
+    Partition(count, [&fn](size_t from, size_t to) {
+      return [&fn, from, to]() {
+        fn(from, to);
+        return 0;
+      };
+    });
+  }
+
+  // Enough independent accumulators to hide the latency of the vector adds.
+  const int kAccumulators = 8;
+
+  inline float_t Dot(const float_t* a, const float_t* b, size_t n) {
+    float_t acc[kAccumulators] = {};
+    size_t i = 0;
+    for (; i + kAccumulators <= n; i += kAccumulators) {
+      for (int j = 0; j < kAccumulators; j++) {
+        acc[j] += a[i + j] * b[i + j];
+      }
+    }
+    for (; i < n; i++) {
+      acc[0] += a[i] * b[i];
+    }
+
+    float_t sum = 0.0;
+    for (int j = 0; j < kAccumulators; j++) {
+      sum += acc[j];
+    }
+    return sum;
+  }
+
+  // e^x without calls or branches, so loops over it vectorize. Within a couple of ulps of std::exp
+  //   in single precision; double precision builds just use std::exp. Inputs beyond
+  //   about +-88 are clamped (e^x overflows or underflows there), so very negative ones give a
+  //   tiny positive value rather than 0. NaN comes back as NaN.
+  inline float_t FastExp(float_t x) {
+    if constexpr (kDoublePrecision) {
+      return std::exp(x);
+    } else {
+      // NaN would survive the clamp below and make the cast to int undefined
+      if (x != x) { return x; }
+      x = std::min<float_t>(std::max<float_t>(x, -87.3365f), 88.0f);
+      float_t n = std::floor(x * 1.44269504088896341f + 0.5f);
+      float_t r = x - n * 0.693359375f + n * 2.12194440e-4f;
+
+      float_t p = 1.9875691500e-4f;
+      p = p * r + 1.3981999507e-3f;
+      p = p * r + 8.3334519073e-3f;
+      p = p * r + 4.1665795894e-2f;
+      p = p * r + 1.6666665459e-1f;
+      p = p * r + 5.0000001201e-1f;
+      p = p * r * r + r + 1.0f;
+
+      // scale by 2^n by adding n to the exponent bits
+      return p * std::bit_cast<float>((static_cast<std::int32_t>(n) + 127) << 23);
+    }
+  }
+
+  // Sets data[0, numCells) to value. Large buffers are split across the worker pool.
+  void Fill(float_t * data, size_t numCells, float_t value);
+
 } // namespace multithread
 } // namespace math
 } // namespace mdl
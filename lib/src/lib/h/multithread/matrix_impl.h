@@ -3,10 +3,13 @@
 
 #include <mdl/concurrent.h>
 #include <functional>
+#include <span>
+#include <utility>
 #include <vector>
 
 #include "../matrix.h"
 #include "../../h/multithread/helper.h"
+#include "../../h/stats.h"
 
 namespace mdl {
 namespace math {
@@ -16,6 +19,27 @@ namespace multithread {
     public:
       static Matrix Multiply(const Matrix& matrix1, const Matrix& matrix2);
 
+      // Either operand may be transposed (e.g. Matrix::Transposed()), or any slice whose rows or
+      //   columns are contiguous in memory: every combination (NN, NT, TN, TT) is read in place,
+      //   with the loop order that suits it. Operands laid out any other way are copied first.
+      static Matrix Multiply(const BaseMatrix& matrix1, const BaseMatrix& matrix2);
+
+      // matrix (m x k) times a k x 1 column vector. Streams matrix once, in row order.
+      static Matrix MatrixVectorMultiply(const Matrix& matrix, const Matrix& vector);
+
+      // A 1 x k row vector times matrix (k x n). Streams matrix once, in row order.
+      static Matrix VectorMatrixMultiply(const Matrix& vector, const Matrix& matrix);
+
+      // Independent products matrices1[i] * matrices2[i]. Work is split across the batch, not
+      //   within each product.
+      static std::vector<Matrix> BatchMultiply(
+          std::span<const Matrix> matrices1, std::span<const Matrix> matrices2);
+
+      // Same as above for batchSize equally shaped products stacked vertically, i.e. rows
+      //   [i * m, (i + 1) * m) of stacked1 times rows [i * k, (i + 1) * k) of stacked2.
+      static Matrix BatchMultiply(
+          const Matrix& stacked1, const Matrix& stacked2, size_t batchSize);
+
       inline static Matrix Transpose(const Matrix& matrix);
 
       template <typename Operation>
@@ -30,6 +54,45 @@ namespace multithread {
       template <typename Operation>
       static Matrix UnaryOperate(const Matrix& matrix);
 
+      // For operations with parameters: calls operate() on the given instance.
+      template <typename Operation>
+      static Matrix UnaryOperate(const Matrix& matrix, const Operation& operation);
+
+      // One pass writing both operation.operate(x, value, gradient) outputs for every cell x: an
+      //   activation and its derivative, as {value, gradient}.
+      template <typename Operation>
+      static std::pair<Matrix, Matrix> ValueAndGradient(
+          const Matrix& matrix, const Operation& operation = Operation());
+
+      // Softmax, or log-softmax, of every row (column), shifted by its max to avoid overflow.
+      static Matrix RowSoftmax(const Matrix& matrix, bool log);
+      static Matrix ColSoftmax(const Matrix& matrix, bool log);
+      // log(sum(exp(x))) of every row (column), as a column (row) vector.
+      static Matrix RowLogSumExp(const Matrix& matrix);
+      static Matrix ColLogSumExp(const Matrix& matrix);
+
+      // Cross entropy of each row's softmax against a row of target probabilities, or against a
+      //   class index per row, as {loss (rows x 1), gradient with respect to logits}.
+      static std::pair<Matrix, Matrix> SoftmaxCrossEntropy(
+          const Matrix& logits, const Matrix& targets);
+      static std::pair<Matrix, Matrix> SoftmaxCrossEntropy(
+          const Matrix& logits, const std::vector<size_t>& labels);
+
+      // Index of the max (min) of every row, or of every column, the first one on ties. NaNs rank
+      //   last.
+      static std::vector<size_t> RowArgExtreme(const Matrix& matrix, bool min);
+      static std::vector<size_t> ColArgExtreme(const Matrix& matrix, bool min);
+      // The k largest cells of every row, largest first, as {values (rows x k), column indices}.
+      static std::pair<Matrix, std::vector<size_t>> RowTopK(const Matrix& matrix, size_t k);
+      // Column indices that sort every row, rows x cols.
+      static std::vector<size_t> RowArgSort(const Matrix& matrix, bool descending);
+
+      // Rows of matrix at the given indices, which may repeat.
+      static Matrix Gather(const Matrix& matrix, std::span<const size_t> rows);
+      // Row rows[i] of target = (or +=, if add) row i of source, in order for repeated indices.
+      static void Scatter(
+          Matrix& target, std::span<const size_t> rows, const Matrix& source, bool add);
+
       template <typename Operation>
       static Matrix RowReduce(const Matrix& matrix, float_t initialValue = 0.0);
 
@@ -61,6 +124,8 @@ namespace multithread {
     size_t rows = matrix.rows;
     size_t cols = matrix.cols;
     size_t numCells = rows * cols;
+    static stats::Counter counter("Transpose", stats::Backend::kMultiThread);
+    stats::Probe probe(counter, rows, cols, numCells, 0, 2ull * numCells * sizeof(float_t));
     float_t * ddata = new float_t[numCells];
     float_t * sdata = matrix.data.get();
 
@@ -90,6 +155,11 @@ namespace multithread {
 
   template <typename Operation>
   Matrix MatrixImpl::Operate(float_t scalar, const Matrix& matrix) {
+    static stats::Counter counter(
+        stats::OpKey<Operation>("ScalarOperate"), stats::Backend::kMultiThread);
+    std::uint64_t numCells = matrix.NumCells();
+    stats::Probe probe(counter, matrix.NumRows(), matrix.NumCols(), numCells, numCells,
+        2 * numCells * sizeof(float_t));
     Matrix result(matrix.NumRows(), matrix.NumCols());
 
     Partition(matrix.NumCells(), 
@@ -111,6 +181,11 @@ namespace multithread {
 
   template <typename Operation>
   Matrix MatrixImpl::Operate(const Matrix& matrix, float_t scalar) {
+    static stats::Counter counter(
+        stats::OpKey<Operation>("ScalarOperate"), stats::Backend::kMultiThread);
+    std::uint64_t numCells = matrix.NumCells();
+    stats::Probe probe(counter, matrix.NumRows(), matrix.NumCols(), numCells, numCells,
+        2 * numCells * sizeof(float_t));
     Matrix result(matrix.NumRows(), matrix.NumCols());
 
     Partition(matrix.NumCells(), 
@@ -138,6 +213,12 @@ namespace multithread {
     size_t cols1 = matrix1.NumCols();
     size_t rows2 = matrix2.NumRows();
     size_t cols2 = matrix2.NumCols();
+    size_t rows = std::max(rows1, rows2);
+    size_t cols = std::max(cols1, cols2);
+    std::uint64_t numCells = static_cast<std::uint64_t>(rows) * cols;
+    static stats::Counter counter(stats::OpKey<Operation>("Operate"), stats::Backend::kMultiThread);
+    stats::Probe probe(counter, rows, cols, numCells, numCells,
+        (matrix1.NumCells() + matrix2.NumCells() + numCells) * sizeof(float_t));
 
     if (rows1 == rows2) {
       if (cols1 == cols2) {
@@ -159,12 +240,15 @@ namespace multithread {
       }
     } else if (rows1 == 1 && cols1 == 1) {
       // m1 is scalar
+      probe.Dismiss();
       return Operate<Operation>(matrix1(0, 0), matrix2);
     } else if (rows2 == 1 && cols2 == 1) {
       // m2 is scalar
+      probe.Dismiss();
       return Operate<Operation>(matrix1, matrix2(0, 0));
     }
-    
+
+    probe.Dismiss();
     std::ostringstream os;
     os << "Cannot operate on matrices of different dimensions: " << rows1 << 'x' << cols1
         << " and " << rows2 << 'x' << cols2;
@@ -174,6 +258,11 @@ namespace multithread {
 
   template <typename Operation>
   Matrix MatrixImpl::UnaryOperate(const Matrix& matrix) {
+    static stats::Counter counter(
+        stats::OpKey<Operation>("UnaryOperate"), stats::Backend::kMultiThread);
+    std::uint64_t numCells = matrix.NumCells();
+    stats::Probe probe(counter, matrix.NumRows(), matrix.NumCols(), numCells, numCells,
+        2 * numCells * sizeof(float_t));
     Matrix result(matrix.NumRows(), matrix.NumCols());
 
     Partition(matrix.NumCells(), 
@@ -193,8 +282,58 @@ namespace multithread {
   }
 
 
+  template <typename Operation>
+  Matrix MatrixImpl::UnaryOperate(const Matrix& matrix, const Operation& operation) {
+    static stats::Counter counter(
+        stats::OpKey<Operation>("UnaryOperate"), stats::Backend::kMultiThread);
+    std::uint64_t numCells = matrix.NumCells();
+    stats::Probe probe(counter, matrix.NumRows(), matrix.NumCols(), numCells, numCells,
+        2 * numCells * sizeof(float_t));
+    Matrix result(matrix.NumRows(), matrix.NumCols(), new float_t[numCells]);
+
+    const float_t * mData = matrix.data.get();
+    float_t * outData = result.data.get();
+    ParallelFor(numCells, [&operation, mData, outData](size_t from, size_t to) {
+      for (size_t i = from; i < to; i++) {
+        operation.operate(mData[i], outData[i]);
+      }
+    });
+
+    return result;
+  }
+
+
+  template <typename Operation>
+  std::pair<Matrix, Matrix> MatrixImpl::ValueAndGradient(
+      const Matrix& matrix, const Operation& operation) {
+    static stats::Counter counter(
+        stats::OpKey<Operation>("ValueAndGradient"), stats::Backend::kMultiThread);
+    std::uint64_t numCells = matrix.NumCells();
+    stats::Probe probe(counter, matrix.NumRows(), matrix.NumCols(), numCells, 2 * numCells,
+        3 * numCells * sizeof(float_t));
+    Matrix value(matrix.NumRows(), matrix.NumCols(), new float_t[numCells]);
+    Matrix gradient(matrix.NumRows(), matrix.NumCols(), new float_t[numCells]);
+
+    const float_t * mData = matrix.data.get();
+    float_t * valueData = value.data.get();
+    float_t * gradientData = gradient.data.get();
+    ParallelFor(numCells, [&operation, mData, valueData, gradientData](size_t from, size_t to) {
+      for (size_t i = from; i < to; i++) {
+        operation.operate(mData[i], valueData[i], gradientData[i]);
+      }
+    });
+
+    return {std::move(value), std::move(gradient)};
+  }
+
+
   template <typename Operation>
   Matrix MatrixImpl::RowReduce(const Matrix& matrix, float_t initialValue) {
+    static stats::Counter counter(
+        stats::OpKey<Operation>("RowReduce"), stats::Backend::kMultiThread);
+    std::uint64_t numCells = matrix.NumCells();
+    stats::Probe probe(counter, matrix.NumRows(), matrix.NumCols(), numCells, numCells,
+        (numCells + matrix.NumRows()) * sizeof(float_t));
     Matrix result(
         matrix.NumRows(), 
         1, 
@@ -219,6 +358,11 @@ namespace multithread {
 
   template <typename Operation>
   Matrix MatrixImpl::ColReduce(const Matrix& matrix, float_t initialValue) {
+    static stats::Counter counter(
+        stats::OpKey<Operation>("ColReduce"), stats::Backend::kMultiThread);
+    std::uint64_t numCells = matrix.NumCells();
+    stats::Probe probe(counter, matrix.NumRows(), matrix.NumCols(), numCells, numCells,
+        (numCells + matrix.NumCols()) * sizeof(float_t));
     Matrix result(1, 
         matrix.NumCols(), 
         [initialValue] (size_t row, size_t col) { return initialValue; });
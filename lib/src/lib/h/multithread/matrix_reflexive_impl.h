@@ -77,6 +77,19 @@ namespace multithread {
         });
       }
 
+      // Updates self and every state buffer in place from gradient, in a single pass over n
+      //   contiguous cells: op.operate(self[i], gradient[i], state[i]...). Taking raw buffers lets
+      //   callers pass contiguous slices as well as matrices.
+      template <typename Operation, typename... State>
+      static void ReflexiveUpdate(
+          const Operation& op, float_t* self, const float_t* gradient, size_t n, State*... state) {
+        ParallelFor(n, [&op, self, gradient, state...](size_t from, size_t to) {
+          for (size_t i = from; i < to; i++) {
+            op.operate(self[i], gradient[i], state[i]...);
+          }
+        });
+      }
+
     private:
       template <typename Operation>
       static void MatrixReflexiveOperate(
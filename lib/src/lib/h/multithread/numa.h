@@ -0,0 +1,62 @@
+#ifndef _MDL_MATH_MULTI_THREAD_NUMA
+#define _MDL_MATH_MULTI_THREAD_NUMA
+
+#include <functional>
+#include <vector>
+
+#include "../typedefs.h"
+
+namespace mdl {
+namespace math {
+namespace multithread {
+
+  // CPU ids grouped by NUMA node.
+  class Topology {
+    public:
+      explicit Topology(const std::vector<std::vector<int>>& nodes);
+
+      // Reads /sys/devices/system/node on Linux. Elsewhere, or if that fails, all CPUs reported by
+      //   the standard library make up a single node.
+      static Topology Detect();
+      // numNodes nodes of cpusPerNode CPUs each. CPU ids wrap around the CPUs actually present, so
+      //   a multi-node layout can be exercised (and pinned) on a single node machine.
+      static Topology Fake(int numNodes, int cpusPerNode);
+
+      inline int NumNodes() const { return nodes.size(); }
+      inline const std::vector<int>& CpusOf(int node) const { return nodes[node]; }
+
+    private:
+      std::vector<std::vector<int>> nodes;
+  };
+
+  enum class Pinning { kNone, kCore, kNode };
+
+  // Moves Partition() off the shared executor onto kNumKernels workers with a fixed placement.
+  //   Chunk i of every partition always runs on worker i, and workers are spread over nodes in
+  //   contiguous groups (the first chunks on node 0, the next ones on node 1 and so on). Ops over
+  //   equally sized buffers split them identically, so the pages a worker first touches when a
+  //   new matrix is filled are the ones it reads and writes in the ops that follow, and they stay
+  //   on its node.
+  //
+  // kCore pins each worker to one CPU of its node, kNode lets it float within the node. Not meant
+  //   to be toggled while operations are running.
+  void EnableNuma(const Topology& topology, Pinning pinning = Pinning::kCore);
+  void DisableNuma();
+  bool IsNumaEnabled();
+
+  // Whether every worker could be pinned as requested (pinning is only supported on Linux).
+  bool IsNumaPinned();
+  // Node that runs chunk "chunk" of a partition, or -1 when NUMA mode is off.
+  int NodeOfChunk(int chunk);
+  // Node of the calling thread, or -1 when not called from a NUMA worker.
+  int CurrentNode();
+
+  // Runs tasks[i] on the worker for chunk i and waits for all of them, rethrowing the first
+  //   exception. Returns false, without running anything, when NUMA mode is off.
+  bool RunOnNumaWorkers(std::vector<std::function<int ()>>& tasks);
+
+} // namespace multithread
+} // namespace math
+} // namespace mdl
+
+#endif // _MDL_MATH_MULTI_THREAD_NUMA
@@ -1,7 +1,9 @@
 #ifndef _MDL_MATH_MATRIX_OPERATION
 #define _MDL_MATH_MATRIX_OPERATION
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 
 #include "typedefs.h"
 
@@ -11,6 +13,8 @@ namespace op {
 
 class Abs {
   public:
+    constexpr static const char* kName = "Abs";
+
     inline static void operate(float_t op1, float_t& out) {
       out = std::abs(op1);
     }
@@ -22,6 +26,8 @@ class Abs {
 
 class Acos {
   public:
+    constexpr static const char* kName = "Acos";
+
     inline static void operate(float_t op1, float_t& out) {
       out = std::acos(op1);
     }
@@ -33,6 +39,8 @@ class Acos {
 
 class Addition {
   public:
+    constexpr static const char* kName = "Addition";
+
     inline static void operate(float_t op1, float_t op2, float_t& out) {
       out = op1 + op2;
     }
@@ -44,6 +52,8 @@ class Addition {
 
 class And {
   public:
+    constexpr static const char* kName = "And";
+
     inline static void operate(float_t op1, float_t op2, float_t& out) {
       out = op1 && op2;
     }
@@ -55,6 +65,8 @@ class And {
 
 class Asin {
   public:
+    constexpr static const char* kName = "Asin";
+
     inline static void operate(float_t op1, float_t& out) {
       out = std::asin(op1);
     }
@@ -66,6 +78,8 @@ class Asin {
 
 class Atan {
   public:
+    constexpr static const char* kName = "Atan";
+
     inline static void operate(float_t op1, float_t& out) {
       out = std::atan(op1);
     }
@@ -77,6 +91,8 @@ class Atan {
 
 class Ceil {
   public:
+    constexpr static const char* kName = "Ceil";
+
     inline static void operate(float_t op1, float_t& out) {
       out = std::ceil(op1);
     }
@@ -88,6 +104,8 @@ class Ceil {
 
 class Cos {
   public:
+    constexpr static const char* kName = "Cos";
+
     inline static void operate(float_t op1, float_t& out) {
       out = std::cos(op1);
     }
@@ -99,6 +117,8 @@ class Cos {
 
 class Division {
   public:
+    constexpr static const char* kName = "Division";
+
     inline static void operate(float_t op1, float_t op2, float_t& out) {
       out = op1 / op2;
     }
@@ -110,6 +130,8 @@ class Division {
 
 class Equals {
   public:
+    constexpr static const char* kName = "Equals";
+
     inline static void operate(float_t op1, float_t op2, float_t& out) {
       float_t diff = std::abs(op2 - op1);
       out = diff <= kFloatPrecision;
@@ -123,6 +145,8 @@ class Equals {
 
 class Exp {
   public:
+    constexpr static const char* kName = "Exp";
+
     inline static void operate(float_t op1, float_t& out) {
       out = std::exp(op1);
     }
@@ -134,6 +158,8 @@ class Exp {
 
 class Exp2 {
   public:
+    constexpr static const char* kName = "Exp2";
+
     inline static void operate(float_t op1, float_t& out) {
       out = std::exp2(op1);
     }
@@ -145,6 +171,8 @@ class Exp2 {
 
 class Floor {
   public:
+    constexpr static const char* kName = "Floor";
+
     inline static void operate(float_t op1, float_t& out) {
       out = std::floor(op1);
     }
@@ -154,8 +182,54 @@ class Floor {
     }
 };
 
+// Activations (GELU, LeakyReLU, ReLU, Sigmoid, Softplus, Tanh) sit in order among the others.
+//   Besides the usual forms, their operate(op1, value, gradient) computes the activation and its
+//   derivative at op1 together, sharing the expensive part (an exp, a tanh). The *Gradient
+//   classes compute the derivative alone, and the *OutputGradient ones compute it from the
+//   activation's output rather than its input.
+
+const float_t kSqrt1_2 = 0.70710678118654752440;
+const float_t kInvSqrt2Pi = 0.39894228040143267794;
+
+// Exact (erf based) GELU: x * Phi(x).
+class GELU {
+  public:
+    constexpr static const char* kName = "GELU";
+
+    inline static void operate(float_t op1, float_t& out) {
+      out = 0.5 * op1 * (1.0 + std::erf(op1 * kSqrt1_2));
+    }
+
+    inline static void operate(float_t& op1) {
+      op1 = 0.5 * op1 * (1.0 + std::erf(op1 * kSqrt1_2));
+    }
+
+    inline static void operate(float_t op1, float_t& value, float_t& gradient) {
+      float_t cdf = 0.5 * (1.0 + std::erf(op1 * kSqrt1_2));
+      value = op1 * cdf;
+      gradient = cdf + op1 * kInvSqrt2Pi * std::exp(-0.5 * op1 * op1);
+    }
+};
+
+class GELUGradient {
+  public:
+    constexpr static const char* kName = "GELUGradient";
+
+    inline static void operate(float_t op1, float_t& out) {
+      float_t value;
+      GELU::operate(op1, value, out);
+    }
+
+    inline static void operate(float_t& op1) {
+      float_t value;
+      GELU::operate(op1, value, op1);
+    }
+};
+
 class GreaterThan {
   public:
+    constexpr static const char* kName = "GreaterThan";
+
     inline static void operate(float_t op1, float_t op2, float_t& out) {
       out = op1 > op2;
     }
@@ -167,6 +241,8 @@ class GreaterThan {
 
 class GreaterThanEquals {
   public:
+    constexpr static const char* kName = "GreaterThanEquals";
+
     inline static void operate(float_t op1, float_t op2, float_t& out) {
       out = op1 >= op2;
     }
@@ -176,8 +252,54 @@ class GreaterThanEquals {
     }
 };
 
+// Stateful: called through an instance holding the slope for negative inputs.
+class LeakyReLU {
+  public:
+    constexpr static const char* kName = "LeakyReLU";
+
+    explicit LeakyReLU(float_t slope) : slope(slope) {}
+
+    inline void operate(float_t op1, float_t& out) const {
+      out = op1 > 0 ? op1 : slope * op1;
+    }
+
+    inline void operate(float_t& op1) const {
+      op1 = op1 > 0 ? op1 : slope * op1;
+    }
+
+    inline void operate(float_t op1, float_t& value, float_t& gradient) const {
+      bool positive = op1 > 0;
+      value = positive ? op1 : slope * op1;
+      gradient = positive ? 1.0 : slope;
+    }
+
+  private:
+    float_t slope;
+};
+
+// Also the gradient from LeakyReLU's output (for positive slopes), which has the input's sign.
+class LeakyReLUGradient {
+  public:
+    constexpr static const char* kName = "LeakyReLUGradient";
+
+    explicit LeakyReLUGradient(float_t slope) : slope(slope) {}
+
+    inline void operate(float_t op1, float_t& out) const {
+      out = op1 > 0 ? 1.0 : slope;
+    }
+
+    inline void operate(float_t& op1) const {
+      op1 = op1 > 0 ? 1.0 : slope;
+    }
+
+  private:
+    float_t slope;
+};
+
 class LessThan {
   public:
+    constexpr static const char* kName = "LessThan";
+
     inline static void operate(float_t op1, float_t op2, float_t& out) {
       out = op1 < op2;
     }
@@ -189,6 +311,8 @@ class LessThan {
 
 class LessThanEquals {
   public:
+    constexpr static const char* kName = "LessThanEquals";
+
     inline static void operate(float_t op1, float_t op2, float_t& out) {
       out = op1 <= op2;
     }
@@ -200,6 +324,8 @@ class LessThanEquals {
 
 class Log {
   public:
+    constexpr static const char* kName = "Log";
+
     inline static void operate(float_t op1, float_t& out) {
       out = std::log(op1);
     }
@@ -211,6 +337,8 @@ class Log {
 
 class Log2 {
   public:
+    constexpr static const char* kName = "Log2";
+
     inline static void operate(float_t op1, float_t& out) {
       out = std::log2(op1);
     }
@@ -222,6 +350,8 @@ class Log2 {
 
 class Log10 {
   public:
+    constexpr static const char* kName = "Log10";
+
     inline static void operate(float_t op1, float_t& out) {
       out = std::log10(op1);
     }
@@ -233,6 +363,8 @@ class Log10 {
 
 class Max {
   public:
+    constexpr static const char* kName = "Max";
+
     inline static void operate(float_t op1, float_t op2, float_t& out) {
       out = op1 > op2 ? op1 : op2;
     }
@@ -246,6 +378,8 @@ class Max {
 
 class Min {
   public:
+    constexpr static const char* kName = "Min";
+
     inline static void operate(float_t op1, float_t op2, float_t& out) {
       out = op1 < op2 ? op1 : op2;
     }
@@ -259,6 +393,8 @@ class Min {
 
 class Mod {
   public:
+    constexpr static const char* kName = "Mod";
+
     inline static void operate(float_t op1, float_t op2, float_t& out) {
       out = op1 - op2 * std::floor(op1 / op2);
     }
@@ -270,6 +406,8 @@ class Mod {
 
 class Multiplication {
   public:
+    constexpr static const char* kName = "Multiplication";
+
     inline static void operate(float_t op1, float_t op2, float_t& out) {
       out = op1 * op2;
     }
@@ -281,6 +419,8 @@ class Multiplication {
 
 class Negate {
   public:
+    constexpr static const char* kName = "Negate";
+
     inline static void operate(float_t op1, float_t& out) {
       out = -op1;
     }
@@ -292,6 +432,8 @@ class Negate {
 
 class Not {
   public:
+    constexpr static const char* kName = "Not";
+
     inline static void operate(float_t op1, float_t& out) {
       out = !op1;
     }
@@ -303,6 +445,8 @@ class Not {
 
 class NotEquals {
   public:
+    constexpr static const char* kName = "NotEquals";
+
     inline static void operate(float_t op1, float_t op2, float_t& out) {
       out = op1 != op2;
     }
@@ -314,6 +458,8 @@ class NotEquals {
 
 class Or {
   public:
+    constexpr static const char* kName = "Or";
+
     inline static void operate(float_t op1, float_t op2, float_t& out) {
       out = op1 || op2;
     }
@@ -325,6 +471,8 @@ class Or {
 
 class Pow {
   public:
+    constexpr static const char* kName = "Pow";
+
     inline static void operate(float_t op1, float_t op2, float_t& out) {
       out = std::pow(op1, op2);
     }
@@ -334,8 +482,43 @@ class Pow {
     }
 };
 
+class ReLU {
+  public:
+    constexpr static const char* kName = "ReLU";
+
+    inline static void operate(float_t op1, float_t& out) {
+      out = op1 > 0 ? op1 : 0.0;
+    }
+
+    inline static void operate(float_t& op1) {
+      op1 = op1 > 0 ? op1 : 0.0;
+    }
+
+    inline static void operate(float_t op1, float_t& value, float_t& gradient) {
+      bool positive = op1 > 0;
+      value = positive ? op1 : 0.0;
+      gradient = positive;
+    }
+};
+
+// Also the gradient from ReLU's output, which is positive exactly where the input is.
+class ReLUGradient {
+  public:
+    constexpr static const char* kName = "ReLUGradient";
+
+    inline static void operate(float_t op1, float_t& out) {
+      out = op1 > 0;
+    }
+
+    inline static void operate(float_t& op1) {
+      op1 = op1 > 0;
+    }
+};
+
 class Round {
   public:
+    constexpr static const char* kName = "Round";
+
     inline static void operate(float_t op1, float_t& out) {
       out = std::round(op1);
     }
@@ -345,8 +528,57 @@ class Round {
     }
 };
 
+class Sigmoid {
+  public:
+    constexpr static const char* kName = "Sigmoid";
+
+    inline static void operate(float_t op1, float_t& out) {
+      out = 1.0 / (1.0 + std::exp(-op1));
+    }
+
+    inline static void operate(float_t& op1) {
+      op1 = 1.0 / (1.0 + std::exp(-op1));
+    }
+
+    inline static void operate(float_t op1, float_t& value, float_t& gradient) {
+      float_t sigmoid = 1.0 / (1.0 + std::exp(-op1));
+      value = sigmoid;
+      gradient = sigmoid * (1.0 - sigmoid);
+    }
+};
+
+class SigmoidGradient {
+  public:
+    constexpr static const char* kName = "SigmoidGradient";
+
+    inline static void operate(float_t op1, float_t& out) {
+      float_t sigmoid = 1.0 / (1.0 + std::exp(-op1));
+      out = sigmoid * (1.0 - sigmoid);
+    }
+
+    inline static void operate(float_t& op1) {
+      float_t sigmoid = 1.0 / (1.0 + std::exp(-op1));
+      op1 = sigmoid * (1.0 - sigmoid);
+    }
+};
+
+class SigmoidOutputGradient {
+  public:
+    constexpr static const char* kName = "SigmoidOutputGradient";
+
+    inline static void operate(float_t op1, float_t& out) {
+      out = op1 * (1.0 - op1);
+    }
+
+    inline static void operate(float_t& op1) {
+      op1 = op1 * (1.0 - op1);
+    }
+};
+
 class Sin {
   public:
+    constexpr static const char* kName = "Sin";
+
     inline static void operate(float_t op1, float_t& out) {
       out = std::sin(op1);
     }
@@ -356,8 +588,57 @@ class Sin {
     }
 };
 
+// log(1 + e^x), written so that it neither overflows for large x nor loses precision for small x.
+class Softplus {
+  public:
+    constexpr static const char* kName = "Softplus";
+
+    inline static void operate(float_t op1, float_t& out) {
+      out = std::max<float_t>(op1, 0.0) + std::log1p(std::exp(-std::abs(op1)));
+    }
+
+    inline static void operate(float_t& op1) {
+      op1 = std::max<float_t>(op1, 0.0) + std::log1p(std::exp(-std::abs(op1)));
+    }
+
+    inline static void operate(float_t op1, float_t& value, float_t& gradient) {
+      float_t e = std::exp(-std::abs(op1));
+      value = std::max<float_t>(op1, 0.0) + std::log1p(e);
+      // sigmoid(op1), from the same exponential
+      gradient = op1 >= 0 ? 1.0 / (1.0 + e) : e / (1.0 + e);
+    }
+};
+
+class SoftplusGradient {
+  public:
+    constexpr static const char* kName = "SoftplusGradient";
+
+    inline static void operate(float_t op1, float_t& out) {
+      out = 1.0 / (1.0 + std::exp(-op1));
+    }
+
+    inline static void operate(float_t& op1) {
+      op1 = 1.0 / (1.0 + std::exp(-op1));
+    }
+};
+
+class SoftplusOutputGradient {
+  public:
+    constexpr static const char* kName = "SoftplusOutputGradient";
+
+    inline static void operate(float_t op1, float_t& out) {
+      out = -std::expm1(-op1);
+    }
+
+    inline static void operate(float_t& op1) {
+      op1 = -std::expm1(-op1);
+    }
+};
+
 class Sqr {
   public:
+    constexpr static const char* kName = "Sqr";
+
     inline static void operate(float_t op1, float_t& out) {
       out = op1 * op1;
     }
@@ -369,6 +650,8 @@ class Sqr {
 
 class Sqrt {
   public:
+    constexpr static const char* kName = "Sqrt";
+
     inline static void operate(float_t op1, float_t& out) {
       out = std::sqrt(op1);
     }
@@ -380,6 +663,8 @@ class Sqrt {
 
 class Subtraction {
   public:
+    constexpr static const char* kName = "Subtraction";
+
     inline static void operate(float_t op1, float_t op2, float_t& out) {
       out = op1 - op2;
     }
@@ -391,6 +676,8 @@ class Subtraction {
 
 class Tan {
   public:
+    constexpr static const char* kName = "Tan";
+
     inline static void operate(float_t op1, float_t& out) {
       out = std::tan(op1);
     }
@@ -400,6 +687,132 @@ class Tan {
     }
 };
 
+class Tanh {
+  public:
+    constexpr static const char* kName = "Tanh";
+
+    inline static void operate(float_t op1, float_t& out) {
+      out = std::tanh(op1);
+    }
+
+    inline static void operate(float_t& op1) {
+      op1 = std::tanh(op1);
+    }
+
+    inline static void operate(float_t op1, float_t& value, float_t& gradient) {
+      float_t tanh = std::tanh(op1);
+      value = tanh;
+      gradient = 1.0 - tanh * tanh;
+    }
+};
+
+class TanhGradient {
+  public:
+    constexpr static const char* kName = "TanhGradient";
+
+    inline static void operate(float_t op1, float_t& out) {
+      float_t tanh = std::tanh(op1);
+      out = 1.0 - tanh * tanh;
+    }
+
+    inline static void operate(float_t& op1) {
+      float_t tanh = std::tanh(op1);
+      op1 = 1.0 - tanh * tanh;
+    }
+};
+
+class TanhOutputGradient {
+  public:
+    constexpr static const char* kName = "TanhOutputGradient";
+
+    inline static void operate(float_t op1, float_t& out) {
+      out = 1.0 - op1 * op1;
+    }
+
+    inline static void operate(float_t& op1) {
+      op1 = 1.0 - op1 * op1;
+    }
+};
+
+// Optimizer updates. Stateful: instances hold the hyperparameters (and, for Adam, the bias
+//   corrections of the current step). operate() updates a weight and its optimizer state in place
+//   from the weight's gradient.
+
+// SGD with (optionally Nesterov) momentum and L2 weight decay, as in most frameworks:
+//   velocity = momentum * velocity + (gradient + weightDecay * weight).
+class SGDMomentumUpdate {
+  public:
+    constexpr static const char* kName = "SGDMomentumUpdate";
+
+    SGDMomentumUpdate(float_t learningRate, float_t momentum, float_t weightDecay, bool nesterov)
+        : learningRate(learningRate), momentum(momentum), weightDecay(weightDecay),
+          nesterov(nesterov) {}
+
+    inline void operate(float_t& weight, float_t gradient, float_t& velocity) const {
+      float_t g = gradient + weightDecay * weight;
+      float_t v = momentum * velocity + g;
+      velocity = v;
+      weight -= learningRate * (nesterov ? g + momentum * v : v);
+    }
+
+  private:
+    float_t learningRate;
+    float_t momentum;
+    float_t weightDecay;
+    bool nesterov;
+};
+
+// Adam for step t (from 1), with decoupled weight decay (AdamW) when weightDecay isn't 0.
+class AdamUpdate {
+  public:
+    constexpr static const char* kName = "AdamUpdate";
+
+    AdamUpdate(
+        float_t learningRate, float_t beta1, float_t beta2, float_t epsilon, float_t weightDecay,
+        std::uint64_t step)
+        : beta1(beta1), beta2(beta2), epsilon(epsilon),
+          decay(1.0 - learningRate * weightDecay),
+          // the bias corrections fold into a per-step size and a scale for the second moment
+          stepSize(learningRate / (1.0 - std::pow(beta1, static_cast<float_t>(step)))),
+          secondScale(1.0 / std::sqrt(1.0 - std::pow(beta2, static_cast<float_t>(step)))) {}
+
+    inline void operate(
+        float_t& weight, float_t gradient, float_t& moment1, float_t& moment2) const {
+      float_t m = beta1 * moment1 + (1.0 - beta1) * gradient;
+      float_t v = beta2 * moment2 + (1.0 - beta2) * gradient * gradient;
+      moment1 = m;
+      moment2 = v;
+      weight = weight * decay - stepSize * m / (std::sqrt(v) * secondScale + epsilon);
+    }
+
+  private:
+    float_t beta1;
+    float_t beta2;
+    float_t epsilon;
+    float_t decay;
+    float_t stepSize;
+    float_t secondScale;
+};
+
+class RMSPropUpdate {
+  public:
+    constexpr static const char* kName = "RMSPropUpdate";
+
+    RMSPropUpdate(float_t learningRate, float_t decay, float_t epsilon)
+        : learningRate(learningRate), decay(decay), epsilon(epsilon) {}
+
+    inline void operate(float_t& weight, float_t gradient, float_t& meanSquare) const {
+      float_t s = decay * meanSquare + (1.0 - decay) * gradient * gradient;
+      meanSquare = s;
+      weight -= learningRate * gradient / (std::sqrt(s) + epsilon);
+    }
+
+  private:
+    float_t learningRate;
+    float_t decay;
+    float_t epsilon;
+};
+
 } // op
 } // math
 } // mdl
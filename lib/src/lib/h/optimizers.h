@@ -0,0 +1,66 @@
+#ifndef _MDL_MATH_OPTIMIZERS
+#define _MDL_MATH_OPTIMIZERS
+
+#include <cstdint>
+
+#include "typedefs.h"
+#include "basematrix.h"
+
+namespace mdl {
+namespace math {
+
+  // Fused optimizer steps. Each call reads the gradient and updates the weights and the optimizer
+  //   state (owned by the caller, zero-initialized before the first step) in place, in a single
+  //   multithreaded pass: no temporaries, one read and one write of every buffer. The weights,
+  //   the gradient and the state must have the same dimensions and be contiguous: matrices,
+  //   slices of whole rows, or ParameterArena views (e.g. Packed(), to step a whole model at once).
+  //   Anything else throws std::invalid_argument.
+
+  struct SGDMomentum {
+    float_t learningRate;
+    float_t momentum = 0.9;
+    // L2 penalty, added to the gradient
+    float_t weightDecay = 0.0;
+    bool nesterov = false;
+  };
+
+  void Update(
+      const SGDMomentum& optimizer,
+      BaseMatrix& weights,
+      const BaseMatrix& gradient,
+      BaseMatrix& velocity);
+
+  struct Adam {
+    float_t learningRate = 0.001;
+    float_t beta1 = 0.9;
+    float_t beta2 = 0.999;
+    float_t epsilon = 1e-8;
+    // decoupled (AdamW): weights shrink by learningRate * weightDecay every step
+    float_t weightDecay = 0.0;
+  };
+
+  // step counts from 1 and drives the bias correction of both moments.
+  void Update(
+      const Adam& optimizer,
+      BaseMatrix& weights,
+      const BaseMatrix& gradient,
+      BaseMatrix& moment1,
+      BaseMatrix& moment2,
+      std::uint64_t step);
+
+  struct RMSProp {
+    float_t learningRate = 0.01;
+    float_t decay = 0.99;
+    float_t epsilon = 1e-8;
+  };
+
+  void Update(
+      const RMSProp& optimizer,
+      BaseMatrix& weights,
+      const BaseMatrix& gradient,
+      BaseMatrix& meanSquare);
+
+} // math
+} // mdl
+
+#endif // _MDL_MATH_OPTIMIZERS
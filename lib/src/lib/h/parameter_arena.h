@@ -0,0 +1,70 @@
+#ifndef _MDL_MATH_PARAMETER_ARENA
+#define _MDL_MATH_PARAMETER_ARENA
+
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+#include "typedefs.h"
+#include "matrix.h"
+
+namespace mdl {
+namespace math {
+
+  // A set of matrices (e.g. the weights of a model) carved out of one contiguous buffer, laid out
+  //   back to back in the order of Pack(). Every matrix and the packed 1 x NumCells() view alias
+  //   that buffer, so moving between the two representations costs nothing:
+  //
+  //     ParameterArena params({{784, 100}, {1, 100}, {100, 10}, {1, 10}});
+  //     Matrix& w1 = params[0];
+  //     ...
+  //     params.Packed() -= gradient * learningRate;   // w1 sees the update
+  //
+  // Views must be updated in place (+=, -=, element access, Load()) and held by reference:
+  //   assigning a new matrix to a view, or copying one, allocates a separate buffer.
+  class ParameterArena {
+    public:
+      // Zero-filled matrices of the given (rows, cols) shapes.
+      explicit ParameterArena(const std::vector<std::pair<size_t, size_t>>& shapes);
+      // Braced lists of shapes would otherwise also match the constructor taking matrices.
+      explicit ParameterArena(std::initializer_list<std::pair<size_t, size_t>> shapes)
+          : ParameterArena(std::vector<std::pair<size_t, size_t>>(shapes)) {}
+      // Copies matrices into the arena, once.
+      explicit ParameterArena(const std::vector<Matrix>& matrices);
+      // Adopts packed (e.g. the result of Pack()) without copying it. The packed view shares its
+      //   buffer with the argument.
+      ParameterArena(Matrix&& packed, const std::vector<std::pair<size_t, size_t>>& shapes);
+
+      // Copies would have to re-carve their views, so arenas are move-only.
+      ParameterArena(const ParameterArena&) = delete;
+      ParameterArena& operator=(const ParameterArena&) = delete;
+      ParameterArena(ParameterArena&&) = default;
+      ParameterArena& operator=(ParameterArena&&) = default;
+
+      inline size_t NumMatrices() const { return views.size(); }
+      inline size_t NumCells() const { return packed.NumCells(); }
+      inline const std::vector<std::pair<size_t, size_t>>& GetShapes() const { return shapes; }
+
+      inline Matrix& operator[](size_t index) { return views[index]; }
+      inline const Matrix& operator[](size_t index) const { return views[index]; }
+      inline const std::vector<Matrix>& Views() const { return views; }
+
+      inline Matrix& Packed() { return packed; }
+      inline const Matrix& Packed() const { return packed; }
+
+      // Overwrites every parameter with the contents of a 1 x NumCells() matrix, in place.
+      void Load(const Matrix& values);
+
+    private:
+      std::vector<std::pair<size_t, size_t>> shapes;
+      Matrix packed;
+      std::vector<Matrix> views;
+
+      static size_t TotalCells(const std::vector<std::pair<size_t, size_t>>& shapes);
+      void CarveViews();
+  };
+
+} // math
+} // mdl
+
+#endif // _MDL_MATH_PARAMETER_ARENA
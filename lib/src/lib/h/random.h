@@ -0,0 +1,83 @@
+#ifndef _MDL_MATH_RANDOM
+#define _MDL_MATH_RANDOM
+
+#include <array>
+#include <cstdint>
+
+#include "typedefs.h"
+
+namespace mdl {
+namespace math {
+
+  // Counter-based generator (Philox4x32-10, Salmon et al., "Parallel Random Numbers: As Easy as
+  // 1, 2, 3"). Every output is a pure function of (seed, counter), so any element of a random
+  // matrix can be computed independently of all others. This is what allows matrices to be filled
+  // in parallel while producing the exact same values regardless of how work is partitioned.
+  class Philox {
+    public:
+      typedef std::array<std::uint32_t, 4> block_t;
+
+      // Number of blocks processed together by Fill(). Kept small enough so that the four lanes
+      // fit in registers and large enough for the compiler to vectorize the rounds.
+      static constexpr int kBatchSize = 8;
+
+      explicit Philox(std::uint64_t seed);
+
+      block_t operator()(const block_t& counter) const;
+
+      // Fills out[lane * count + i] with lane "lane" of block "first + i", for i in [0, count).
+      // The counter's last word is set to "stream" so different distributions draw from
+      // independent sequences.
+      void Fill(std::uint64_t first, int count, std::uint32_t stream, std::uint32_t* out) const;
+
+      // Seekable distributions. Each value is the "index"-th draw of the given distribution.
+      float_t Uniform(std::uint64_t index) const;
+      float_t Normal(std::uint64_t index) const;
+      float_t TruncatedNormal(std::uint64_t index) const;
+
+      // Turn a block obtained from Fill() into distribution values. The seekable methods above are
+      //   implemented in terms of these, so bulk fills and single draws always agree.
+      static float_t NormalFromBlock(const block_t& bits, int cell);
+      // Returns false when every candidate in the block falls outside the truncation bound.
+      static bool TruncatedNormalFromBlock(const block_t& bits, float_t& value);
+
+      inline std::uint64_t GetSeed() const { return seed; }
+
+      // Maps 32 random bits into [0, 1).
+      inline static float_t ToUniform(std::uint32_t bits) {
+        if (kDoublePrecision) {
+          return bits * 0x1.0p-32;
+        }
+        return (bits >> 8) * 0x1.0p-24f;
+      }
+
+      // Maps 32 random bits into (0, 1]. Suitable as input to log().
+      inline static float_t ToOpenUniform(std::uint32_t bits) {
+        if (kDoublePrecision) {
+          return (bits + 1.0) * 0x1.0p-32;
+        }
+        return ((bits >> 8) + 1) * 0x1.0p-24f;
+      }
+
+      const static std::uint32_t kUniformStream = 0;
+      const static std::uint32_t kNormalStream = 1;
+      const static std::uint32_t kTruncatedNormalStream = 2;
+      const static std::uint32_t kShuffleStream = 3;
+
+      // Truncated normals are redrawn, never clamped, until within this many standard deviations
+      //   of the mean.
+      constexpr static float_t kTruncationBound = 2.0;
+
+    private:
+      std::uint32_t key0;
+      std::uint32_t key1;
+      std::uint64_t seed;
+  };
+
+  // Returns a fresh non-deterministic seed, for callers that do not care about reproducibility.
+  std::uint64_t NextSeed();
+
+} // math
+} // mdl
+
+#endif // _MDL_MATH_RANDOM
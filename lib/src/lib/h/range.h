@@ -3,6 +3,9 @@
 
 #include "typedefs.h"
 
+#include <memory>
+#include <vector>
+
 namespace mdl {
 namespace math {
 
@@ -69,6 +72,24 @@ namespace math {
       Range FitToBounds(size_t max) const;
   };
 
+  // An arbitrary list of indices, e.g. the rows of a minibatch or of an embedding lookup, which may
+  //   repeat. Copies share the list. Unlike the other ranges it isn't affine, so slices taking it
+  //   have no MemoryLayout; Gather and Scatter in functions.h move whole rows instead.
+  class IndexRange {
+    public:
+      IndexRange(std::vector<size_t> indices);
+
+      inline size_t Get(size_t index) const { return (*indices)[index]; }
+      inline size_t Length() const { return indices->size(); }
+      inline const std::vector<size_t>& GetIndices() const { return *indices; }
+
+      // Indices can't be clipped the way bounds are: throws std::invalid_argument if any of them
+      //   is out of [0, max).
+      IndexRange FitToBounds(size_t max) const;
+    private:
+      std::shared_ptr<const std::vector<size_t>> indices;
+  };
+
   class Ranges {
     public:
       const static RightRange ALL;
@@ -95,6 +116,18 @@ namespace math {
       static UnitRange Compose(const Range& current, const UnitRange& next);
       static Range Compose(const Range& current, const Range& next);
 
+      // Every index of next, mapped through current, and the other way around.
+      static IndexRange Compose(const LeftRange& current, const IndexRange& next);
+      static IndexRange Compose(const RightRange& current, const IndexRange& next);
+      static IndexRange Compose(const UnitRange& current, const IndexRange& next);
+      static IndexRange Compose(const Range& current, const IndexRange& next);
+
+      static IndexRange Compose(const IndexRange& current, const LeftRange& next);
+      static IndexRange Compose(const IndexRange& current, const RightRange& next);
+      static UnitRange Compose(const IndexRange& current, const UnitRange& next);
+      static IndexRange Compose(const IndexRange& current, const Range& next);
+      static IndexRange Compose(const IndexRange& current, const IndexRange& next);
+
       template <typename CUR, typename NXT>
       static auto FitAndCompose(const CUR& current, const NXT& next) {
         return Ranges::Compose(current, next.FitToBounds(current.Length()));
@@ -2,6 +2,7 @@
 #define _MDL_MATH_SINGLE_THREAD_BASE_MATRIX_IMPL
 
 #include "../matrix.h"
+#include "../stats.h"
 
 namespace mdl {
 namespace math {
@@ -11,6 +12,11 @@ namespace singlethread {
     public:
       template <typename Operation>
       static Matrix Operate(float_t scalar, const BaseMatrix& matrix) {
+        static stats::Counter counter(
+            stats::OpKey<Operation>("BaseScalarOperate"), stats::Backend::kSingleThread);
+        std::uint64_t numCells = static_cast<std::uint64_t>(matrix.NumRows()) * matrix.NumCols();
+        stats::Probe probe(counter, matrix.NumRows(), matrix.NumCols(), numCells, numCells,
+            2 * numCells * sizeof(float_t));
         size_t rows = matrix.NumRows();
         size_t cols = matrix.NumCols();
         Matrix result(rows, cols);
@@ -26,6 +32,11 @@ namespace singlethread {
 
       template <typename Operation>
       static Matrix Operate(const BaseMatrix& matrix, float_t scalar) {
+        static stats::Counter counter(
+            stats::OpKey<Operation>("BaseScalarOperate"), stats::Backend::kSingleThread);
+        std::uint64_t numCells = static_cast<std::uint64_t>(matrix.NumRows()) * matrix.NumCols();
+        stats::Probe probe(counter, matrix.NumRows(), matrix.NumCols(), numCells, numCells,
+            2 * numCells * sizeof(float_t));
         size_t rows = matrix.NumRows();
         size_t cols = matrix.NumCols();
         Matrix result(rows, cols);
@@ -57,6 +68,12 @@ namespace singlethread {
 
           size_t rows = std::max(rows1, rows2);
           size_t cols = std::max(cols1, cols2);
+          static stats::Counter counter(
+              stats::OpKey<Operation>("BaseOperate"), stats::Backend::kSingleThread);
+          std::uint64_t numCells = static_cast<std::uint64_t>(rows) * cols;
+          stats::Probe probe(counter, rows, cols, numCells, numCells,
+              (static_cast<std::uint64_t>(rows1) * cols1 + static_cast<std::uint64_t>(rows2) * cols2
+                  + numCells) * sizeof(float_t));
           Matrix result(rows, cols);
 
           rows1--; cols1--; rows2--; cols2--;
@@ -81,6 +98,11 @@ namespace singlethread {
 
       template <typename Operation>
       static Matrix UnaryOperate(const BaseMatrix& matrix) {
+        static stats::Counter counter(
+            stats::OpKey<Operation>("BaseUnaryOperate"), stats::Backend::kSingleThread);
+        std::uint64_t numCells = static_cast<std::uint64_t>(matrix.NumRows()) * matrix.NumCols();
+        stats::Probe probe(counter, matrix.NumRows(), matrix.NumCols(), numCells, numCells,
+            2 * numCells * sizeof(float_t));
         size_t rows = matrix.NumRows();
         size_t cols = matrix.NumCols();
         Matrix result(rows, cols);
@@ -96,6 +118,11 @@ namespace singlethread {
 
       template <typename Operation>
       static Matrix RowReduce(const BaseMatrix& matrix, float_t initialValue = 0.0) {
+        static stats::Counter counter(
+            stats::OpKey<Operation>("BaseRowReduce"), stats::Backend::kSingleThread);
+        std::uint64_t numCells = static_cast<std::uint64_t>(matrix.NumRows()) * matrix.NumCols();
+        stats::Probe probe(counter, matrix.NumRows(), matrix.NumCols(), numCells, numCells,
+            (numCells + matrix.NumRows()) * sizeof(float_t));
         Matrix result(
             matrix.NumRows(), 
             1, 
@@ -115,6 +142,11 @@ namespace singlethread {
 
       template <typename Operation>
       static Matrix ColReduce(const BaseMatrix& matrix, float_t initialValue = 0.0) {
+        static stats::Counter counter(
+            stats::OpKey<Operation>("BaseColReduce"), stats::Backend::kSingleThread);
+        std::uint64_t numCells = static_cast<std::uint64_t>(matrix.NumRows()) * matrix.NumCols();
+        stats::Probe probe(counter, matrix.NumRows(), matrix.NumCols(), numCells, numCells,
+            (numCells + matrix.NumCols()) * sizeof(float_t));
         Matrix result(1, 
             matrix.NumCols(), 
             [initialValue] (size_t row, size_t col) { return initialValue; });
@@ -2,6 +2,7 @@
 #define _MDL_MATH_SINGLE_THREAD_MATRIX_IMPL
 
 #include "../matrix.h"
+#include "../stats.h"
 
 namespace mdl {
 namespace math {
@@ -39,6 +40,9 @@ namespace singlethread {
     size_t rows = matrix.rows;
     size_t cols = matrix.cols;
     float_t * data1 = matrix.data.get();
+    static stats::Counter counter("Transpose", stats::Backend::kSingleThread);
+    std::uint64_t numCells = static_cast<std::uint64_t>(rows) * cols;
+    stats::Probe probe(counter, rows, cols, numCells, 0, 2 * numCells * sizeof(float_t));
     float_t * data2 = new float_t[rows * cols];
 
     for (size_t row = 0; row < rows; row++) {
@@ -54,6 +58,11 @@ namespace singlethread {
 
   template <typename Operation>
   Matrix MatrixImpl::Operate(float_t scalar, const Matrix& matrix) {
+    static stats::Counter counter(
+        stats::OpKey<Operation>("ScalarOperate"), stats::Backend::kSingleThread);
+    std::uint64_t numCells = static_cast<std::uint64_t>(matrix.NumRows()) * matrix.NumCols();
+    stats::Probe probe(counter, matrix.NumRows(), matrix.NumCols(), numCells, numCells,
+        2 * numCells * sizeof(float_t));
     size_t rows = matrix.NumRows();
     size_t cols = matrix.NumCols();
     Matrix result(rows, cols);
@@ -69,6 +78,11 @@ namespace singlethread {
 
   template <typename Operation>
   Matrix MatrixImpl::Operate(const Matrix& matrix, float_t scalar) {
+    static stats::Counter counter(
+        stats::OpKey<Operation>("ScalarOperate"), stats::Backend::kSingleThread);
+    std::uint64_t numCells = static_cast<std::uint64_t>(matrix.NumRows()) * matrix.NumCols();
+    stats::Probe probe(counter, matrix.NumRows(), matrix.NumCols(), numCells, numCells,
+        2 * numCells * sizeof(float_t));
     size_t rows = matrix.NumRows();
     size_t cols = matrix.NumCols();
     Matrix result(rows, cols);
@@ -100,6 +114,12 @@ namespace singlethread {
 
       size_t rows = std::max(rows1, rows2);
       size_t cols = std::max(cols1, cols2);
+      static stats::Counter counter(
+          stats::OpKey<Operation>("Operate"), stats::Backend::kSingleThread);
+      std::uint64_t numCells = static_cast<std::uint64_t>(rows) * cols;
+      stats::Probe probe(counter, rows, cols, numCells, numCells,
+          (static_cast<std::uint64_t>(rows1) * cols1 + static_cast<std::uint64_t>(rows2) * cols2
+              + numCells) * sizeof(float_t));
       Matrix result(rows, cols);
 
       rows1--; cols1--; rows2--; cols2--;
@@ -124,6 +144,11 @@ namespace singlethread {
 
   template <typename Operation>
   Matrix MatrixImpl::UnaryOperate(const Matrix& matrix) {
+    static stats::Counter counter(
+        stats::OpKey<Operation>("UnaryOperate"), stats::Backend::kSingleThread);
+    std::uint64_t numCells = static_cast<std::uint64_t>(matrix.NumRows()) * matrix.NumCols();
+    stats::Probe probe(counter, matrix.NumRows(), matrix.NumCols(), numCells, numCells,
+        2 * numCells * sizeof(float_t));
     size_t rows = matrix.NumRows();
     size_t cols = matrix.NumCols();
     Matrix result(rows, cols);
@@ -139,6 +164,11 @@ namespace singlethread {
 
   template <typename Operation>
   Matrix MatrixImpl::RowReduce(const Matrix& matrix) {
+    static stats::Counter counter(
+        stats::OpKey<Operation>("RowReduce"), stats::Backend::kSingleThread);
+    std::uint64_t numCells = static_cast<std::uint64_t>(matrix.NumRows()) * matrix.NumCols();
+    stats::Probe probe(counter, matrix.NumRows(), matrix.NumCols(), numCells, numCells,
+        (numCells + matrix.NumRows()) * sizeof(float_t));
     Matrix result(matrix.NumRows(), 1);
 
     size_t rows = matrix.NumRows();
@@ -155,6 +185,11 @@ namespace singlethread {
 
   template <typename Operation>
   Matrix MatrixImpl::ColReduce(const Matrix& matrix) {
+    static stats::Counter counter(
+        stats::OpKey<Operation>("ColReduce"), stats::Backend::kSingleThread);
+    std::uint64_t numCells = static_cast<std::uint64_t>(matrix.NumRows()) * matrix.NumCols();
+    stats::Probe probe(counter, matrix.NumRows(), matrix.NumCols(), numCells, numCells,
+        (numCells + matrix.NumCols()) * sizeof(float_t));
     Matrix result(1, matrix.NumCols());
 
     size_t rows = matrix.NumRows();
@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <iostream>
+#include <type_traits>
 
 #include "typedefs.h"
 #include "basematrix.h"
@@ -55,15 +56,32 @@ namespace math {
       }
       
       Slice& operator=(const Slice& other) {
-        BaseMatrix::BufferedCopy(other);
+        BaseMatrix::AliasAwareCopy(other);
         return *this;
       }
 
       Slice& operator=(const BaseMatrix& other) {
-        BaseMatrix::BufferedCopy(other);
+        BaseMatrix::AliasAwareCopy(other);
         return *this;
       }
 
+      bool GetLayout(MemoryLayout& layout) const override {
+        if constexpr (std::is_same_v<RowRange, IndexRange>
+            || std::is_same_v<ColRange, IndexRange>) {
+          return false;
+        }
+        // All other range types are affine (Get(i) == start + i * increment), so the strides can be
+        //   read off the addresses of cells (0, 0), (1, 0) and (0, 1).
+        const auto& rows = Accessor::GetRow(rowRange, colRange);
+        const auto& cols = Accessor::GetCol(rowRange, colRange);
+        std::ptrdiff_t origin = Accessor::Offset(rowLength, rows.Get(0), cols.Get(0));
+
+        layout.data = data.get() + origin;
+        layout.rowStride = Accessor::Offset(rowLength, rows.Get(1), cols.Get(0)) - origin;
+        layout.colStride = Accessor::Offset(rowLength, rows.Get(0), cols.Get(1)) - origin;
+        return true;
+      }
+
       inline float_t& operator()(size_t row, size_t col) {
         return Accessor::GetLRef(
             data.get(), 
@@ -0,0 +1,160 @@
+#ifndef _MDL_MATH_STATS
+#define _MDL_MATH_STATS
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "typedefs.h"
+
+namespace mdl {
+namespace math {
+namespace stats {
+
+  enum class Backend { kSingleThread, kMultiThread, kMetal };
+
+  const char* ToString(Backend backend);
+
+  // Shapes are bucketed per dimension by the next power of two, i.e. class k holds sizes in
+  //   (2^(k-1), 2^k]. The last class also holds everything larger.
+  const int kShapeClasses = 16;
+
+  inline int ShapeClass(size_t size) {
+    if (size < 0) {
+      return 0;
+    }
+    std::uint64_t bound = static_cast<std::uint64_t>(size);
+    int shapeClass = 0;
+    while (shapeClass < kShapeClasses - 1 && (std::uint64_t(1) << shapeClass) < bound) {
+      shapeClass++;
+    }
+    return shapeClass;
+  }
+
+  // Counter name of a template entry point running one of the operations in operation.h, e.g.
+  //   "UnaryOperate<Exp>", so every operation gets rows of its own. Types without a kName (e.g.
+  //   ad hoc test operations) are counted under the entry point alone.
+  template <typename Operation>
+  std::string OpKey(const char* entryPoint) {
+    if constexpr (requires { Operation::kName; }) {
+      return std::string(entryPoint) + '<' + Operation::kName + '>';
+    } else {
+      return entryPoint;
+    }
+  }
+
+  // Totals for one (op, backend, shape bucket) key. "rows"/"cols" are the upper bounds of the
+  //   bucket's shape classes.
+  struct OpStats {
+    std::string op;
+    Backend backend;
+    std::uint64_t rows;
+    std::uint64_t cols;
+    std::uint64_t calls;
+    std::uint64_t elements;
+    std::uint64_t flops;
+    std::uint64_t bytes;
+    std::uint64_t nanos;
+  };
+
+  // Counters for one backend entry point. Meant to be declared as a function local static at the
+  //   instrumented site, so the only cost of a call is a handful of relaxed atomic increments and
+  //   two clock reads. Buckets are allocated the first time a shape class is seen.
+  class Counter {
+    public:
+      Counter(std::string op, Backend backend);
+      ~Counter();
+
+      Counter(const Counter&) = delete;
+      Counter& operator=(const Counter&) = delete;
+
+      void Record(
+          size_t rows,
+          size_t cols,
+          std::uint64_t elements,
+          std::uint64_t flops,
+          std::uint64_t bytes,
+          std::uint64_t nanos);
+
+      void Collect(std::vector<OpStats>& out) const;
+      void Reset();
+
+    private:
+      struct Bucket {
+        std::atomic<std::uint64_t> calls{0};
+        std::atomic<std::uint64_t> elements{0};
+        std::atomic<std::uint64_t> flops{0};
+        std::atomic<std::uint64_t> bytes{0};
+        std::atomic<std::uint64_t> nanos{0};
+      };
+
+      std::string op;
+      Backend backend;
+      std::atomic<Bucket*> buckets[kShapeClasses * kShapeClasses];
+  };
+
+  bool IsEnabled();
+  void SetEnabled(bool enabled);
+
+  // Times the enclosing scope and records it against "counter" on destruction. Does nothing while
+  //   stats are disabled.
+  class Probe {
+    public:
+      inline Probe(
+          Counter& counter,
+          size_t rows,
+          size_t cols,
+          std::uint64_t elements,
+          std::uint64_t flops,
+          std::uint64_t bytes)
+          : counter(IsEnabled() ? &counter : nullptr),
+            rows(rows), cols(cols), elements(elements), flops(flops), bytes(bytes) {
+        if (this->counter) {
+          start = std::chrono::steady_clock::now();
+        }
+      }
+
+      inline ~Probe() {
+        if (counter) {
+          auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - start).count();
+          counter->Record(rows, cols, elements, flops, bytes, nanos);
+        }
+      }
+
+      // For entry points that delegate to another instrumented entry point, so the work isn't
+      //   counted twice.
+      inline void Dismiss() { counter = nullptr; }
+
+      Probe(const Probe&) = delete;
+      Probe& operator=(const Probe&) = delete;
+
+    private:
+      Counter* counter;
+      size_t rows;
+      size_t cols;
+      std::uint64_t elements;
+      std::uint64_t flops;
+      std::uint64_t bytes;
+      std::chrono::steady_clock::time_point start;
+  };
+
+  // Totals of all counters, merged by (op, backend, shape bucket) and sorted by those same keys.
+  std::vector<OpStats> Snapshot();
+  void Reset();
+
+  // Human readable table, one line per key.
+  void Dump(std::ostream& out);
+  void Dump(std::ostream& out, const std::vector<OpStats>& snapshot);
+  // JSON array with one object per key.
+  void DumpJson(std::ostream& out);
+  void DumpJson(std::ostream& out, const std::vector<OpStats>& snapshot);
+
+} // stats
+} // math
+} // mdl
+
+#endif // _MDL_MATH_STATS
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <mdl/matrix.h>
+
+namespace mdl {
+namespace math {
+
+  AsyncHandle<Matrix> Pipeline(const Matrix& x, const Matrix& w1, const Matrix& w2) {
+    co_await ResumeInBackground();
+    AsyncHandle<Matrix> hidden = MultiplyAsync(x, w1);
+    const Matrix& h = co_await hidden;
+    // locals of a coroutine live in its frame, so they can be passed by reference
+    Matrix activation = Sigmoid(h);
+    AsyncHandle<Matrix> out = MultiplyAsync(activation, w2);
+    co_return Matrix(co_await out);
+  }
+
+  AsyncHandle<Matrix> FailingPipeline(const Matrix& x) {
+    AsyncHandle<Matrix> product = MultiplyAsync(x, x);
+    co_return Matrix(co_await product);
+  }
+
+  AsyncHandle<void> Accumulate(std::atomic<int>& runs, AsyncHandle<void> after) {
+    co_await after;
+    runs++;
+    co_return;
+  }
+
+  TEST(AsyncTest, TestMultiplyAsync) {
+    Matrix m1 = Matrices::Normal(130, 70, 1);
+    Matrix m2 = Matrices::Normal(70, 90, 2);
+
+    AsyncHandle<Matrix> handle = MultiplyAsync(m1, m2);
+    ASSERT_TRUE((m1 * m2).Equals(handle.Get()));
+    ASSERT_TRUE(handle.IsReady());
+  }
+
+  TEST(AsyncTest, TestChaining) {
+    Matrix a = Matrices::Normal(50, 50, 3);
+    Matrix b = Matrices::Normal(50, 50, 4);
+
+    AsyncHandle<Matrix> ab = MultiplyAsync(a, b);
+    AsyncHandle<Matrix> ba = MultiplyAsync(b, a);
+    AsyncHandle<Matrix> sum = OperateAsync(
+        [](const Matrix& m1, const Matrix& m2) { return m1 + m2; }, ab, ba);
+    AsyncHandle<Matrix> product = MultiplyAsync(sum, ab);
+
+    ASSERT_TRUE(((a * b + b * a) * (a * b)).Equals(product.Get()));
+  }
+
+  TEST(AsyncTest, TestDependencies) {
+    std::atomic<bool> first(false);
+    AsyncHandle<int> slow = RunAsync([&first]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      first = true;
+      return 1;
+    });
+    AsyncHandle<bool> after = RunAsync([&first]() { return first.load(); }, {slow});
+
+    ASSERT_TRUE(after.Get());
+  }
+
+  TEST(AsyncTest, TestVoid) {
+    std::atomic<int> runs(0);
+    AsyncHandle<void> first = RunAsync([&runs]() { runs++; });
+    AsyncHandle<int> after = RunAsync([&runs]() { return runs.load(); }, {first});
+    ASSERT_EQ(1, after.Get());
+    first.Get();
+
+    AsyncHandle<void> failed = RunAsync([]() { throw std::invalid_argument("failed"); });
+    AsyncHandle<void> dependent = RunAsync([&runs]() { runs++; }, {failed});
+    ASSERT_THROW(failed.Get(), std::invalid_argument);
+    ASSERT_THROW(dependent.Get(), std::invalid_argument);
+    ASSERT_EQ(1, runs);
+
+    ASSERT_THROW(Accumulate(runs, failed).Get(), std::invalid_argument);
+    Accumulate(runs, first).Get();
+    ASSERT_EQ(2, runs);
+  }
+
+  TEST(AsyncTest, TestErrorPropagation) {
+    Matrix m1(3, 4);
+    Matrix m2(5, 6);
+
+    AsyncHandle<Matrix> bad = MultiplyAsync(m1, m2);
+    std::atomic<bool> ran(false);
+    AsyncHandle<int> dependent = RunAsync([&ran]() {
+      ran = true;
+      return 1;
+    }, {bad});
+
+    ASSERT_THROW(bad.Get(), std::invalid_argument);
+    ASSERT_THROW(dependent.Get(), std::invalid_argument);
+    ASSERT_FALSE(ran);
+  }
+
+  TEST(AsyncTest, TestFromMtxAsync) {
+    AsyncHandle<std::vector<Matrix>> handle =
+        FromMtxAsync("lib/src/test/resources/matrix/mat_seq_4_5_single.mtx");
+    ASSERT_EQ(1, handle.Get().size());
+    ASSERT_TRUE(handle.Get()[0].Equals(Matrices::Sequence(4, 5, Range(1))));
+  }
+
+  TEST(AsyncTest, TestCoroutine) {
+    Matrix x = Matrices::Normal(40, 30, 5);
+    Matrix w1 = Matrices::Normal(30, 20, 6);
+    Matrix w2 = Matrices::Normal(20, 10, 7);
+
+    ASSERT_TRUE((Sigmoid(x * w1) * w2).Equals(Pipeline(x, w1, w2).Get()));
+    ASSERT_THROW(FailingPipeline(Matrix(3, 4)).Get(), std::invalid_argument);
+  }
+
+} // math
+} // mdl
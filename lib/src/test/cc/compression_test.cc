@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <mdl/matrix.h>
+#include "../../lib/h/compression.h"
+
+namespace mdl {
+namespace math {
+namespace compression {
+
+  namespace {
+    std::vector<char> RoundTrip(const std::vector<char>& data, std::size_t& compressedSize) {
+      std::unique_ptr<char[]> compressed(new char[CompressBound(data.size())]);
+      compressedSize = Compress(data.data(), data.size(), compressed.get());
+      EXPECT_LE(compressedSize, CompressBound(data.size()));
+
+      std::vector<char> result(data.size());
+      EXPECT_TRUE(Decompress(compressed.get(), compressedSize, result.data(), result.size()));
+      return result;
+    }
+  }
+
+  TEST(CompressionTest, TestRoundTrip) {
+    std::mt19937 random(1);
+    std::vector<char> noise(100000);
+    for (char& c : noise) { c = static_cast<char>(random()); }
+    std::vector<char> repeated(100000);
+    for (std::size_t i = 0; i < repeated.size(); i++) { repeated[i] = "abcdefg"[i % 7]; }
+    std::vector<char> runs(70000, 'x');
+
+    for (const std::vector<char>* data : {&noise, &repeated, &runs}) {
+      std::size_t size;
+      ASSERT_EQ(*data, RoundTrip(*data, size));
+      if (data != &noise) {
+        ASSERT_LT(size, data->size() / 50);
+      }
+    }
+
+    // sizes around the minimum a match can be searched in
+    for (std::size_t n = 0; n < 40; n++) {
+      std::vector<char> small(repeated.begin(), repeated.begin() + n);
+      std::size_t size;
+      ASSERT_EQ(small, RoundTrip(small, size));
+    }
+  }
+
+  TEST(CompressionTest, TestShuffle) {
+    std::vector<float> values({1.0f, 2.0f, 3.0f, -4.5f, 1e10f});
+    std::vector<char> shuffled(values.size() * sizeof(float));
+    Shuffle(reinterpret_cast<const char*>(values.data()), shuffled.data(), values.size(),
+        sizeof(float));
+    for (std::size_t i = 0; i < values.size(); i++) {
+      for (std::size_t b = 0; b < sizeof(float); b++) {
+        ASSERT_EQ(reinterpret_cast<const char*>(&values[i])[b], shuffled[b * values.size() + i]);
+      }
+    }
+
+    std::vector<float> restored(values.size());
+    Unshuffle(shuffled.data(), reinterpret_cast<char*>(restored.data()), values.size(),
+        sizeof(float));
+    ASSERT_EQ(values, restored);
+  }
+
+  TEST(CompressionTest, TestInvalidInput) {
+    std::vector<char> data(10000);
+    for (std::size_t i = 0; i < data.size(); i++) { data[i] = static_cast<char>(i / 100); }
+    std::unique_ptr<char[]> compressed(new char[CompressBound(data.size())]);
+    std::size_t size = Compress(data.data(), data.size(), compressed.get());
+    std::vector<char> out(data.size());
+
+    // truncated input, wrong expected sizes
+    ASSERT_FALSE(Decompress(compressed.get(), size - 1, out.data(), out.size()));
+    ASSERT_FALSE(Decompress(compressed.get(), size, out.data(), out.size() - 1));
+    ASSERT_FALSE(Decompress(compressed.get(), size, out.data(), out.size() + 1));
+
+    // garbage never reads or writes out of bounds
+    std::mt19937 random(2);
+    for (int attempt = 0; attempt < 100; attempt++) {
+      std::vector<char> garbage(compressed.get(), compressed.get() + size);
+      garbage[random() % size] = static_cast<char>(random());
+      Decompress(garbage.data(), garbage.size(), out.data(), out.size());
+    }
+  }
+
+} // compression
+} // math
+} // mdl
@@ -0,0 +1,233 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <mdl/matrix.h>
+
+namespace mdl {
+namespace math {
+
+  namespace {
+    void AssertConvNear(const Matrix& expected, const Matrix& actual) {
+      ASSERT_EQ(expected.NumRows(), actual.NumRows());
+      ASSERT_EQ(expected.NumCols(), actual.NumCols());
+      for (size_t row = 0; row < expected.NumRows(); row++) {
+        for (size_t col = 0; col < expected.NumCols(); col++) {
+          float_t tolerance = 1e-4 * std::max<float_t>(1.0, std::abs(expected(row, col)));
+          ASSERT_NEAR(expected(row, col), actual(row, col), tolerance)
+              << "at (" << row << ", " << col << ")";
+        }
+      }
+    }
+
+    Matrix NaiveConv2D(const Matrix& images, const Matrix& filters, const Conv2DShape& shape) {
+      size_t oh = shape.OutputHeight();
+      size_t ow = shape.OutputWidth();
+      size_t kh = shape.kernelHeight;
+      size_t kw = shape.kernelWidth;
+      Matrix result(images.NumRows(), filters.NumRows() * oh * ow);
+      for (size_t n = 0; n < images.NumRows(); n++) {
+        for (size_t k = 0; k < filters.NumRows(); k++) {
+          for (size_t oy = 0; oy < oh; oy++) {
+            for (size_t ox = 0; ox < ow; ox++) {
+              float_t sum = 0.0;
+              for (size_t c = 0; c < shape.channels; c++) {
+                for (size_t r = 0; r < kh; r++) {
+                  for (size_t s = 0; s < kw; s++) {
+                    size_t iy = oy * shape.stride + r * shape.dilation - shape.padding;
+                    size_t ix = ox * shape.stride + s * shape.dilation - shape.padding;
+                    if (iy < 0 || iy >= shape.height || ix < 0 || ix >= shape.width) { continue; }
+                    sum += filters(k, (c * kh + r) * kw + s)
+                        * images(n, (c * shape.height + iy) * shape.width + ix);
+                  }
+                }
+              }
+              result(n, (k * oh + oy) * ow + ox) = sum;
+            }
+          }
+        }
+      }
+      return result;
+    }
+  }
+
+  TEST(ConvolutionTest, TestOutputShape) {
+    Conv2DShape conv{3, 28, 28, 5, 5};
+    ASSERT_EQ(24, conv.OutputHeight());
+    conv.padding = 2;
+    ASSERT_EQ(28, conv.OutputWidth());
+    conv.stride = 2;
+    ASSERT_EQ(14, conv.OutputWidth());
+    conv.dilation = 2;
+    ASSERT_EQ(12, conv.OutputHeight());
+
+    Pool2DShape pool{3, 7, 9, 2, 2};
+    ASSERT_EQ(3, pool.OutputHeight());
+    ASSERT_EQ(4, pool.OutputWidth());
+    pool.padding = 1;
+    ASSERT_EQ(4, pool.OutputHeight());
+    ASSERT_EQ(5, pool.OutputWidth());
+  }
+
+  TEST(ConvolutionTest, TestForward) {
+    Conv2DShape shapes[] = {
+      {1, 5, 5, 3, 3},
+      {3, 9, 7, 3, 2, 1, 1, 1},
+      {2, 11, 8, 3, 3, 2, 1, 1},
+      {4, 12, 10, 3, 3, 1, 2, 2},
+      {3, 13, 9, 2, 3, 3, 2, 2}
+    };
+    std::uint64_t seed = 1;
+    for (const Conv2DShape& shape : shapes) {
+      Matrix images = Matrices::Normal(3, shape.channels * shape.height * shape.width, seed++);
+      Matrix filters = Matrices::Normal(
+          5, shape.channels * shape.kernelHeight * shape.kernelWidth, seed++);
+      AssertConvNear(NaiveConv2D(images, filters, shape), Conv2D(images, filters, shape));
+    }
+  }
+
+  TEST(ConvolutionTest, TestLarge) {
+    // large enough to be split across threads
+    Conv2DShape shape{8, 32, 32, 3, 3, 1, 1};
+    Matrix images = Matrices::Normal(16, 8 * 32 * 32, 11);
+    Matrix filters = Matrices::Normal(16, 8 * 3 * 3, 12);
+    AssertConvNear(NaiveConv2D(images, filters, shape), Conv2D(images, filters, shape));
+  }
+
+  TEST(ConvolutionTest, TestPointwise) {
+    // a 1x1 convolution is a matrix product per pixel
+    Conv2DShape shape{6, 4, 5, 1, 1};
+    Matrix images = Matrices::Normal(2, 6 * 4 * 5, 13);
+    Matrix filters = Matrices::Normal(3, 6, 14);
+    Matrix result = Conv2D(images, filters, shape);
+
+    for (size_t n = 0; n < 2; n++) {
+      Matrix pixels(6, 20);
+      for (size_t c = 0; c < 6; c++) {
+        for (size_t p = 0; p < 20; p++) {
+          pixels(c, p) = images(n, c * 20 + p);
+        }
+      }
+      Matrix expected = filters * pixels;
+      for (size_t k = 0; k < 3; k++) {
+        for (size_t p = 0; p < 20; p++) {
+          ASSERT_NEAR(expected(k, p), result(n, k * 20 + p), 1e-4);
+        }
+      }
+    }
+  }
+
+  TEST(ConvolutionTest, TestBackward) {
+    // <Conv2D(x, w), dy> is linear in both x and w, so its gradients must satisfy
+    //   <dx, x'> = <Conv2D(x', w), dy> and <dw, w'> = <Conv2D(x, w'), dy>.
+    Conv2DShape shapes[] = {
+      {2, 6, 7, 3, 3},
+      {3, 9, 8, 3, 2, 2, 1, 1},
+      {2, 10, 11, 3, 3, 3, 2, 2}
+    };
+    std::uint64_t seed = 20;
+    for (const Conv2DShape& shape : shapes) {
+      size_t imageSize = shape.channels * shape.height * shape.width;
+      size_t filterSize = shape.channels * shape.kernelHeight * shape.kernelWidth;
+      size_t outSize = 4 * shape.OutputHeight() * shape.OutputWidth();
+      Matrix images = Matrices::Normal(3, imageSize, seed++);
+      Matrix filters = Matrices::Normal(4, filterSize, seed++);
+      Matrix outputGradient = Matrices::Normal(3, outSize, seed++);
+      Conv2DGradients gradients = Conv2DBackward(images, filters, outputGradient, shape);
+
+      Matrix otherImages = Matrices::Normal(3, imageSize, seed++);
+      Matrix otherFilters = Matrices::Normal(4, filterSize, seed++);
+      float_t expected = DotProd(Conv2D(otherImages, filters, shape), outputGradient);
+      ASSERT_NEAR(expected, DotProd(gradients.images, otherImages),
+          1e-4 * std::max<float_t>(1.0, std::abs(expected)));
+      expected = DotProd(Conv2D(images, otherFilters, shape), outputGradient);
+      ASSERT_NEAR(expected, DotProd(gradients.filters, otherFilters),
+          1e-4 * std::max<float_t>(1.0, std::abs(expected)));
+    }
+  }
+
+  TEST(ConvolutionTest, TestMaxPool) {
+    Pool2DShape shape{1, 4, 4, 2, 2};
+    Matrix images = Matrices::WithValues(16, {
+      1, 2, 5, 6,
+      3, 4, 8, 7,
+      -1, -2, 0, 0,
+      -3, -4, 0, 0});
+    Matrix result = MaxPool2D(images, shape);
+    ASSERT_TRUE(Matrices::WithValues(4, {4, 8, -1, 0}).Equals(result));
+
+    Matrix gradient = MaxPool2DBackward(images, Matrices::WithValues(4, {1, 2, 3, 4}), shape);
+    ASSERT_TRUE(Matrices::WithValues(16, {
+      0, 0, 0, 0,
+      0, 1, 2, 0,
+      3, 0, 4, 0,
+      0, 0, 0, 0}).Equals(gradient));
+
+    // padding never wins, even over negative values
+    shape.padding = 1;
+    shape.stride = 3;
+    result = MaxPool2D(images * -1.0, shape);
+    ASSERT_TRUE(Matrices::WithValues(4, {-1, -5, 3, 0}).Equals(result));
+  }
+
+  TEST(ConvolutionTest, TestAvgPool) {
+    Pool2DShape shape{2, 3, 3, 2, 2, 1};
+    Matrix images = Matrices::WithValues(18, {
+      1, 2, 3,
+      4, 5, 6,
+      7, 8, 9,
+      0, 0, 0,
+      0, 4, 0,
+      0, 0, 0});
+    Matrix result = AvgPool2D(images, shape);
+    ASSERT_TRUE(Matrices::WithValues(8, {
+      1, 2.5, 5.5, 7,
+      0, 0, 0, 1}).Equals(result));
+
+    Matrix gradient = AvgPool2DBackward(Matrices::WithValues(8, {1, 2, 4, 8, 1, 1, 1, 1}), shape);
+    ASSERT_TRUE(Matrices::WithValues(18, {
+      1, 1, 1,
+      2, 2, 2,
+      2, 2, 2,
+      1, 0.5, 0.5,
+      0.5, 0.25, 0.25,
+      0.5, 0.25, 0.25}).Equals(gradient));
+  }
+
+  TEST(ConvolutionTest, TestPoolBackward) {
+    Pool2DShape shape{3, 9, 8, 3, 2, 1};
+    size_t outSize = 3 * shape.OutputHeight() * shape.OutputWidth();
+    Matrix images = Matrices::Normal(4, 3 * 9 * 8, 30);
+    Matrix outputGradient = Matrices::Normal(4, outSize, 31);
+
+    // average pooling is linear
+    Matrix other = Matrices::Normal(4, 3 * 9 * 8, 32);
+    float_t expected = DotProd(AvgPool2D(other, shape), outputGradient);
+    ASSERT_NEAR(expected, DotProd(AvgPool2DBackward(outputGradient, shape), other),
+        1e-4 * std::max<float_t>(1.0, std::abs(expected)));
+
+    // max pooling is linear around images, where every max is unique
+    expected = DotProd(MaxPool2D(images, shape), outputGradient);
+    ASSERT_NEAR(expected, DotProd(MaxPool2DBackward(images, outputGradient, shape), images),
+        1e-4 * std::max<float_t>(1.0, std::abs(expected)));
+  }
+
+  TEST(ConvolutionTest, TestInvalid) {
+    Matrix images(2, 3 * 5 * 5);
+    Matrix filters(4, 3 * 3 * 3);
+    ASSERT_THROW(Conv2D(images, filters, {2, 5, 5, 3, 3}), std::invalid_argument);
+    ASSERT_THROW(Conv2D(images, Matrix(4, 3 * 2 * 3), {3, 5, 5, 3, 3}), std::invalid_argument);
+    ASSERT_THROW(Conv2D(images, filters, {3, 5, 5, 3, 3, 0}), std::invalid_argument);
+    ASSERT_THROW(Conv2D(images, filters, {3, 5, 5, 3, 3, 1, 0, 3}), std::invalid_argument);
+    ASSERT_THROW(Conv2DBackward(images, filters, Matrix(2, 4 * 3 * 4), {3, 5, 5, 3, 3}),
+        std::invalid_argument);
+
+    ASSERT_THROW(MaxPool2D(images, {3, 5, 5, 2, 2, 2}), std::invalid_argument);
+    ASSERT_THROW(MaxPool2D(images, {3, 5, 5, 6, 1}), std::invalid_argument);
+    ASSERT_THROW(AvgPool2D(images, {3, 5, 4, 2, 2}), std::invalid_argument);
+    ASSERT_THROW(AvgPool2DBackward(Matrix(2, 3 * 3 * 3), {3, 5, 5, 2, 2}), std::invalid_argument);
+  }
+
+} // math
+} // mdl
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include <mdl/matrix.h>
+
+namespace mdl {
+namespace math {
+
+  namespace {
+    float_t NaiveDistance(const Matrix& a, size_t i, const Matrix& b, size_t j, Distance metric) {
+      double squares = 0, dot = 0, normA = 0, normB = 0;
+      for (size_t col = 0; col < a.NumCols(); col++) {
+        double x = a(i, col);
+        double y = b(j, col);
+        squares += (x - y) * (x - y);
+        dot += x * y;
+        normA += x * x;
+        normB += y * y;
+      }
+      switch (metric) {
+        case Distance::kEuclidean:
+          return std::sqrt(squares);
+        case Distance::kSquaredEuclidean:
+          return squares;
+        default:
+          return normA == 0 || normB == 0 ? 1 : 1 - dot / std::sqrt(normA * normB);
+      }
+    }
+
+    void AssertPairwise(const Matrix& a, const Matrix& b, Distance metric) {
+      Matrix distances = PairwiseDistances(a, b, metric);
+      ASSERT_EQ(a.NumRows(), distances.NumRows());
+      ASSERT_EQ(b.NumRows(), distances.NumCols());
+      for (size_t i = 0; i < a.NumRows(); i++) {
+        for (size_t j = 0; j < b.NumRows(); j++) {
+          ASSERT_NEAR(NaiveDistance(a, i, b, j, metric), distances(i, j), 1e-3);
+        }
+      }
+    }
+  }
+
+  TEST(DistancesTest, TestPairwiseDistances) {
+    Matrix a = Matrices::Normal(37, 19, 31);
+    Matrix b = Matrices::Normal(53, 19, 32);
+    // a row of zeros, and a row of b repeated, whose distance must be 0 rather than NaN
+    for (size_t col = 0; col < 19; col++) {
+      b(4, col) = 0;
+      a(5, col) = b(7, col);
+    }
+
+    AssertPairwise(a, b, Distance::kEuclidean);
+    AssertPairwise(a, b, Distance::kSquaredEuclidean);
+    AssertPairwise(a, b, Distance::kCosine);
+    ASSERT_EQ(0, PairwiseDistances(a, b)(5, 7));
+
+    ASSERT_THROW(PairwiseDistances(a, Matrix(3, 18)), std::invalid_argument);
+  }
+
+  TEST(DistancesTest, TestKNearest) {
+    // more queries than a block and more references than a tile, so heaps span both
+    Matrix queries = Matrices::Normal(1100, 8, 33);
+    Matrix references = Matrices::Normal(5000, 8, 34);
+
+    for (Distance metric : {Distance::kEuclidean, Distance::kCosine}) {
+      ValuesWithIndices nearest = KNearest(queries, references, 5, metric);
+      Matrix all = PairwiseDistances(queries, references, metric);
+      std::vector<size_t> order = ArgSort(all);
+      ASSERT_EQ(1100, nearest.values.NumRows());
+      ASSERT_EQ(5, nearest.values.NumCols());
+      ASSERT_EQ(1100 * 5, nearest.indices.size());
+      for (size_t i = 0; i < 1100; i++) {
+        for (size_t j = 0; j < 5; j++) {
+          ASSERT_EQ(order[i * 5000 + j], nearest.indices[i * 5 + j]);
+          ASSERT_NEAR(all(i, order[i * 5000 + j]), nearest.values(i, j), 1e-5);
+        }
+      }
+    }
+  }
+
+  TEST(DistancesTest, TestKNearestFewReferences) {
+    Matrix queries = Matrices::WithValues(2, {0, 0, 10, 10});
+    Matrix references = Matrices::WithValues(2, {3, 4, 0, 1, 10, 9, 0, 1});
+
+    // ties go to the lower index, and k is clipped to the number of references
+    ValuesWithIndices nearest = KNearest(queries, references, 10, Distance::kSquaredEuclidean);
+    ASSERT_TRUE(Matrices::WithValues(4, {1, 1, 25, 181, 1, 85, 181, 181}).Equals(nearest.values));
+    ASSERT_EQ(std::vector<size_t>({1, 3, 0, 2, 2, 0, 1, 3}), nearest.indices);
+
+    ValuesWithIndices none = KNearest(queries, references, 0);
+    ASSERT_EQ(2, none.values.NumRows());
+    ASSERT_EQ(0, none.values.NumCols());
+    ASSERT_TRUE(none.indices.empty());
+
+    ASSERT_THROW(KNearest(queries, references, -1), std::invalid_argument);
+    ASSERT_THROW(KNearest(queries, Matrix(3, 3), 1), std::invalid_argument);
+  }
+
+} // math
+} // mdl
@@ -1,5 +1,11 @@
 #include <gtest/gtest.h>
 
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+
 #include <mdl/matrix.h>
 #include <mdl/io.h>
 
@@ -204,6 +210,66 @@ namespace math {
      Matrix data2 = Matrices::Sequence(1, 5, Range(1));
      ASSERT_THROW(DotProd(data, data2), std::invalid_argument);
   }
+  // Sums accumulate in a different order than operator*, so compare with a tolerance.
+  void AssertProductNear(const Matrix& expected, const Matrix& actual) {
+    ASSERT_EQ(expected.NumRows(), actual.NumRows());
+    ASSERT_EQ(expected.NumCols(), actual.NumCols());
+    for (size_t row = 0; row < expected.NumRows(); row++) {
+      for (size_t col = 0; col < expected.NumCols(); col++) {
+        ASSERT_NEAR(expected(row, col), actual(row, col), 1e-4);
+      }
+    }
+  }
+
+  TEST(MatrixFunctionsTest, BatchMultiplyTest) {
+    std::vector<Matrix> matrices1;
+    std::vector<Matrix> matrices2;
+    // covers every specialized width plus a generic one, and enough products to go parallel
+    size_t widths[] = {1, 2, 4, 8, 16, 17, 32, 64};
+    for (int i = 0; i < 200; i++) {
+      size_t m = 1 + i % 13;
+      size_t k = 1 + i % 7;
+      size_t n = widths[i % 8];
+      matrices1.push_back(Matrices::Normal(m, k, i));
+      matrices2.push_back(Matrices::Normal(k, n, i + 1000));
+    }
+
+    std::vector<Matrix> results = BatchMultiply(matrices1, matrices2);
+    ASSERT_EQ(200, results.size());
+    for (int i = 0; i < 200; i++) {
+      AssertProductNear(matrices1[i] * matrices2[i], results[i]);
+    }
+
+    ASSERT_TRUE(BatchMultiply(std::vector<Matrix>(), std::vector<Matrix>()).empty());
+  }
+
+  TEST(MatrixFunctionsTest, BatchMultiplyTest_Stacked) {
+    size_t batchSize = 50;
+    Matrix stacked1 = Matrices::Normal(batchSize * 8, 12, 1);
+    Matrix stacked2 = Matrices::Normal(batchSize * 12, 16, 2);
+
+    Matrix result = BatchMultiply(stacked1, stacked2, batchSize);
+    ASSERT_EQ(batchSize * 8, result.NumRows());
+    ASSERT_EQ(16, result.NumCols());
+    for (size_t i = 0; i < batchSize; i++) {
+      Matrix product = 
+          Matrix(stacked1(Range(i * 8, (i + 1) * 8), Range()))
+          * Matrix(stacked2(Range(i * 12, (i + 1) * 12), Range()));
+      AssertProductNear(product, result(Range(i * 8, (i + 1) * 8), Range()));
+    }
+  }
+
+  TEST(MatrixFunctionsTest, BatchMultiplyTest_Fail) {
+    std::vector<Matrix> matrices1({Matrix(2, 3), Matrix(2, 3)});
+    std::vector<Matrix> matrices2({Matrix(3, 2), Matrix(2, 2)});
+    ASSERT_THROW(BatchMultiply(matrices1, matrices2), std::invalid_argument);
+    ASSERT_THROW(
+        BatchMultiply(matrices1, std::span<const Matrix>(matrices2).first(1)), 
+        std::invalid_argument);
+    ASSERT_THROW(BatchMultiply(Matrix(6, 3), Matrix(9, 2), 4), std::invalid_argument);
+    ASSERT_THROW(BatchMultiply(Matrix(6, 3), Matrix(6, 2), 3), std::invalid_argument);
+  }
+
 
   TEST(MatrixFunctionsTest, Sigmoid) {
      Matrix data = Matrices::WithValues(5, {-1000, -1, 0, 1, 1000});
@@ -219,6 +285,295 @@ namespace math {
     ASSERT_EQ(5, Sum(mdl::math::Abs(expected - grad) < 0.0001) (0,0));
   }
 
+  namespace {
+    void AssertAllNear(const Matrix& expected, const Matrix& actual, float_t tolerance) {
+      ASSERT_EQ(expected.NumRows(), actual.NumRows());
+      ASSERT_EQ(expected.NumCols(), actual.NumCols());
+      for (size_t row = 0; row < expected.NumRows(); row++) {
+        for (size_t col = 0; col < expected.NumCols(); col++) {
+          ASSERT_NEAR(expected(row, col), actual(row, col), tolerance)
+              << "at (" << row << ", " << col << ")";
+        }
+      }
+    }
+
+    // Checks the fused value and gradient against the separate functions and the gradient against
+    //   central differences. Points within h of a kink are avoided.
+    void AssertActivation(
+        std::function<Matrix (const Matrix&)> function,
+        std::function<Matrix (const Matrix&)> gradient,
+        std::function<ActivationWithGradient (const Matrix&)> withGradient) {
+      Matrix x = Matrices::WithValues(1, {-6, -3, -1, -0.5, 0.5, 1, 3, 6});
+      float_t h = 1e-2;
+      Matrix numeric = (function(x + h) - function(x - h)) / (2 * h);
+
+      ActivationWithGradient result = withGradient(x);
+      AssertAllNear(function(x), result.value, 1e-6);
+      AssertAllNear(gradient(x), result.gradient, 1e-6);
+      AssertAllNear(numeric, result.gradient, 1e-3);
+
+      // large enough to be split across threads
+      Matrix large = Matrices::Normal(300, 200, 17) * 3;
+      ActivationWithGradient largeResult = withGradient(large);
+      AssertAllNear(function(large), largeResult.value, 1e-6);
+      AssertAllNear(gradient(large), largeResult.gradient, 1e-6);
+    }
+  }
+
+  TEST(MatrixFunctionsTest, TestActivationsWithGradient) {
+    AssertActivation(
+        [](const Matrix& m) { return Sigmoid(m); }, SigmoidGradient, SigmoidWithGradient);
+    AssertActivation(ReLU, ReLUGradient, ReLUWithGradient);
+    AssertActivation(Tanh, TanhGradient, TanhWithGradient);
+    AssertActivation(GELU, GELUGradient, GELUWithGradient);
+    AssertActivation(Softplus, SoftplusGradient, SoftplusWithGradient);
+    AssertActivation(
+        [](const Matrix& m) { return LeakyReLU(m, 0.1); },
+        [](const Matrix& m) { return LeakyReLUGradient(m, 0.1); },
+        [](const Matrix& m) { return LeakyReLUWithGradient(m, 0.1); });
+  }
+
+  TEST(MatrixFunctionsTest, TestActivationValues) {
+    Matrix x = Matrices::WithValues(1, {-2, 0, 3});
+    ASSERT_TRUE(Matrices::WithValues(1, {0, 0, 3}).Equals(ReLU(x)));
+    ASSERT_TRUE(Matrices::WithValues(1, {0, 0, 1}).Equals(ReLUGradient(x)));
+    ASSERT_TRUE(Matrices::WithValues(1, {-0.5, 0, 3}).Equals(LeakyReLU(x, 0.25)));
+    AssertAllNear(Matrices::WithValues(1, {-0.045500, 0, 2.995950}), GELU(x), 1e-5);
+    AssertAllNear(Matrices::WithValues(1, {0.126928, 0.693147, 3.048587}), Softplus(x), 1e-5);
+
+    // no overflow for large inputs
+    Matrix large = Matrices::WithValues(1, {-1000, 1000});
+    ASSERT_TRUE(Matrices::WithValues(1, {0, 1000}).Equals(Softplus(large)));
+    ASSERT_TRUE(Matrices::WithValues(1, {0, 1}).Equals(SoftplusWithGradient(large).gradient));
+  }
+
+  TEST(MatrixFunctionsTest, TestGradientsFromOutput) {
+    Matrix x = Matrices::Normal(20, 30, 18) * 3;
+    AssertAllNear(SigmoidGradient(x), SigmoidGradientFromOutput(Sigmoid(x)), 1e-6);
+    AssertAllNear(ReLUGradient(x), ReLUGradientFromOutput(ReLU(x)), 0);
+    AssertAllNear(TanhGradient(x), TanhGradientFromOutput(Tanh(x)), 1e-5);
+    AssertAllNear(
+        LeakyReLUGradient(x, 0.2), LeakyReLUGradientFromOutput(LeakyReLU(x, 0.2), 0.2), 0);
+    AssertAllNear(SoftplusGradient(x), SoftplusGradientFromOutput(Softplus(x)), 1e-5);
+  }
+
+  namespace {
+    Matrix NaiveSoftmax(const Matrix& matrix) {
+      Matrix result(matrix.NumRows(), matrix.NumCols());
+      for (size_t row = 0; row < matrix.NumRows(); row++) {
+        double max = -INFINITY;
+        for (size_t col = 0; col < matrix.NumCols(); col++) {
+          max = std::max<double>(max, matrix(row, col));
+        }
+        double sum = 0.0;
+        for (size_t col = 0; col < matrix.NumCols(); col++) {
+          sum += std::exp(matrix(row, col) - max);
+        }
+        for (size_t col = 0; col < matrix.NumCols(); col++) {
+          result(row, col) = std::exp(matrix(row, col) - max) / sum;
+        }
+      }
+      return result;
+    }
+  }
+
+  TEST(MatrixFunctionsTest, TestSoftmax) {
+    // spans several blocks per row, and enough rows to run in parallel
+    Matrix m = Matrices::Normal(60, 700, 19) * 5;
+    Matrix softmax = Softmax(m);
+    AssertAllNear(NaiveSoftmax(m), softmax, 1e-6);
+    AssertAllNear(Matrices::Ones(60, 1), Sum(softmax.Transpose()).Transpose(), 1e-5);
+    AssertAllNear(mdl::math::Log(NaiveSoftmax(m)), LogSoftmax(m), 1e-4);
+
+    AssertAllNear(
+        Matrices::WithValues(2, {0.268941, 0.731059, 0.5, 0.5}),
+        Softmax(Matrices::WithValues(2, {1000, 1001, -1000, -1000})),
+        1e-6);
+    AssertAllNear(
+        Matrices::WithValues(1, {1000 + std::log(2.0), -1000 + std::log(3.0)}),
+        LogSumExp(Matrices::WithValues(3, {1000, 1000, -INFINITY, -1000, -1000, -1000})),
+        1e-3);
+
+    // a NaN spoils its own row only
+    Matrix withNaN = Softmax(Matrices::WithValues(2, {1, NAN, 3, 3}));
+    ASSERT_TRUE(std::isnan(withNaN(0, 0)) && std::isnan(withNaN(0, 1)));
+    AssertAllNear(Matrices::WithValues(2, {0.5, 0.5}), withNaN(Range(1, 2), Range()), 1e-6);
+  }
+
+  TEST(MatrixFunctionsTest, TestColSoftmax) {
+    Matrix m = Matrices::Normal(300, 70, 20) * 5;
+    AssertAllNear(Softmax(m.Transpose()).Transpose(), ColSoftmax(m), 1e-5);
+    AssertAllNear(LogSoftmax(m.Transpose()).Transpose(), ColLogSoftmax(m), 1e-4);
+    AssertAllNear(LogSumExp(m.Transpose()).Transpose(), ColLogSumExp(m), 1e-4);
+  }
+
+  TEST(MatrixFunctionsTest, TestSoftmaxCrossEntropy) {
+    size_t rows = 40;
+    size_t cols = 500;
+    Matrix logits = Matrices::Normal(rows, cols, 21) * 4;
+    std::vector<size_t> labels;
+    Matrix targets(rows, cols);
+    for (size_t row = 0; row < rows; row++) {
+      labels.push_back((row * 37) % cols);
+      targets(row, labels.back()) = 1.0;
+    }
+
+    LossWithGradient dense = SoftmaxCrossEntropy(logits, targets);
+    LossWithGradient sparse = SoftmaxCrossEntropy(logits, labels);
+    Matrix expectedLoss = -Sum(Prod(targets, LogSoftmax(logits)).Transpose()).Transpose();
+    AssertAllNear(expectedLoss, dense.loss, 1e-4);
+    AssertAllNear(expectedLoss, sparse.loss, 1e-4);
+    AssertAllNear(Softmax(logits) - targets, dense.gradient, 1e-6);
+    AssertAllNear(Softmax(logits) - targets, sparse.gradient, 1e-6);
+
+    // soft targets
+    Matrix soft = Softmax(Matrices::Normal(rows, cols, 22));
+    expectedLoss = -Sum(Prod(soft, LogSoftmax(logits)).Transpose()).Transpose();
+    AssertAllNear(expectedLoss, SoftmaxCrossEntropy(logits, soft).loss, 1e-4);
+
+    ASSERT_THROW(SoftmaxCrossEntropy(logits, Matrix(rows, cols + 1)), std::invalid_argument);
+    ASSERT_THROW(SoftmaxCrossEntropy(logits, std::vector<size_t>(rows - 1)), std::invalid_argument);
+    labels[3] = cols;
+    ASSERT_THROW(SoftmaxCrossEntropy(logits, labels), std::invalid_argument);
+  }
+
+  // Indices that stably sort every row of matrix, NaNs last.
+  std::vector<size_t> NaiveArgSort(const Matrix& matrix, bool descending) {
+    std::vector<size_t> result;
+    for (size_t row = 0; row < matrix.NumRows(); row++) {
+      std::vector<size_t> order(matrix.NumCols());
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(), [&](size_t i, size_t j) {
+        float_t a = matrix(row, i);
+        float_t b = matrix(row, j);
+        if (std::isnan(a) || std::isnan(b)) {
+          return !std::isnan(a);
+        }
+        return descending ? a > b : a < b;
+      });
+      result.insert(result.end(), order.begin(), order.end());
+    }
+    return result;
+  }
+
+  TEST(MatrixFunctionsTest, TestArgMaxArgMin) {
+    float_t nan = std::numeric_limits<float_t>::quiet_NaN();
+    Matrix m = Matrices::WithValues(4, {
+        1,   5,   5,   -2,
+        nan, -1,  nan, -1,
+        nan, nan, nan, nan,
+        3,   -7,  0,   -7});
+    ASSERT_EQ(std::vector<size_t>({1, 1, 0, 0}), ArgMax(m));
+    ASSERT_EQ(std::vector<size_t>({3, 1, 0, 1}), ArgMin(m));
+    ASSERT_EQ(std::vector<size_t>({3, 0, 0, 1}), ColArgMax(m));
+    ASSERT_EQ(std::vector<size_t>({0, 3, 3, 3}), ColArgMin(m));
+
+    // many ties, rows not a multiple of the lanes wide, and enough cells to run in parallel
+    Matrix scores = Round(Matrices::Normal(300, 1001, 23) * 3);
+    std::vector<size_t> ascending = NaiveArgSort(scores, false);
+    std::vector<size_t> descending = NaiveArgSort(scores, true);
+    std::vector<size_t> argMax = ArgMax(scores);
+    std::vector<size_t> argMin = ArgMin(scores);
+    for (size_t row = 0; row < scores.NumRows(); row++) {
+      ASSERT_EQ(descending[row * scores.NumCols()], argMax[row]) << "row " << row;
+      ASSERT_EQ(ascending[row * scores.NumCols()], argMin[row]) << "row " << row;
+    }
+    ASSERT_EQ(ArgMax(scores.Transpose()), ColArgMax(scores));
+    ASSERT_EQ(ArgMin(scores.Transpose()), ColArgMin(scores));
+  }
+
+  TEST(MatrixFunctionsTest, TestTopKArgSort) {
+    float_t nan = std::numeric_limits<float_t>::quiet_NaN();
+    Matrix scores = Round(Matrices::Normal(300, 1001, 24) * 3);
+    scores(5, 7) = nan;
+    scores(5, 2) = -std::numeric_limits<float_t>::infinity();
+    std::vector<size_t> descending = NaiveArgSort(scores, true);
+    ASSERT_EQ(NaiveArgSort(scores, false), ArgSort(scores));
+    ASSERT_EQ(descending, ArgSort(scores, true));
+
+    size_t cols = scores.NumCols();
+    for (size_t k : {1, 10, 1000, 1001, 2000}) {
+      ValuesWithIndices top = TopK(scores, k);
+      size_t kept = std::min(k, cols);
+      ASSERT_EQ(scores.NumRows(), top.values.NumRows());
+      ASSERT_EQ(kept, top.values.NumCols());
+      ASSERT_EQ(static_cast<std::size_t>(scores.NumRows() * kept), top.indices.size());
+      for (size_t row = 0; row < scores.NumRows(); row++) {
+        for (size_t i = 0; i < kept; i++) {
+          size_t col = descending[row * cols + i];
+          ASSERT_EQ(col, top.indices[row * kept + i]) << "k " << k << ", row " << row;
+          ASSERT_TRUE(scores(row, col) == top.values(row, i) || std::isnan(scores(row, col)));
+        }
+      }
+    }
+
+    ASSERT_EQ(0, TopK(scores, 0).values.NumCols());
+    ASSERT_THROW(TopK(scores, -1), std::invalid_argument);
+  }
+
+  TEST(MatrixFunctionsTest, TestGatherScatter) {
+    // an embedding table, looked up with repeats, and a batch large enough to run in parallel
+    Matrix table = Matrices::Normal(1000, 64, 25);
+    std::vector<size_t> rows;
+    for (size_t i = 0; i < 3000; i++) {
+      rows.push_back((i * 7919) % 997);
+    }
+
+    Matrix embedded = Gather(table, rows);
+    ASSERT_TRUE(embedded.Equals(Matrix(table(IndexRange(rows), Range()))));
+
+    Matrix gradient = Matrices::Normal(3000, 64, 26);
+    Matrix expected = Matrix(1000, 64);
+    for (std::size_t i = 0; i < rows.size(); i++) {
+      expected(Range(rows[i], rows[i] + 1), Range()) += gradient(Range(i, i + 1), Range());
+    }
+    Matrix sum = Matrix(1000, 64);
+    ScatterAdd(sum, rows, gradient);
+    AssertAllNear(expected, sum, 1e-4);
+
+    // last one wins
+    Matrix scattered = table;
+    Scatter(scattered, std::vector<size_t>({4, 2, 4}), Matrices::Sequence(3, 64, Range(0)));
+    ASSERT_TRUE(Matrices::Sequence(3, 64, Range(0))(Range(2, 3), Range())
+        .Equals(scattered(Range(4, 5), Range())));
+    ASSERT_TRUE(Matrices::Sequence(3, 64, Range(0))(Range(1, 2), Range())
+        .Equals(scattered(Range(2, 3), Range())));
+    ASSERT_TRUE(table(Range(3, 4), Range()).Equals(scattered(Range(3, 4), Range())));
+
+    // onto itself
+    std::vector<size_t> reversed;
+    for (size_t i = 0; i < 1000; i++) {
+      reversed.push_back(999 - i);
+    }
+    Matrix before = scattered;
+    Scatter(scattered, reversed, scattered);
+    ASSERT_TRUE(before(Range(999, -1, -1), Range()).Equals(scattered));
+
+    // from views of the same buffer, the source 100 rows into the target (Matrix moves share)
+    ParameterArena whole(std::vector<Matrix>({table}));
+    ParameterArena shifted(std::move(whole.Packed()), {{100, 64}, {900, 64}});
+    Matrix& target = whole[0];
+    const Matrix& source = shifted[1];
+    ASSERT_EQ(target(100, 0), source(0, 0));
+    Matrix copied = target;
+    Scatter(copied, std::vector<size_t>(reversed.begin() + 100, reversed.end()), Matrix(source));
+    Scatter(target, std::vector<size_t>(reversed.begin() + 100, reversed.end()), source);
+    ASSERT_TRUE(copied.Equals(target));
+
+    ASSERT_THROW(Gather(table, std::vector<size_t>({1000})), std::invalid_argument);
+    ASSERT_THROW(Scatter(sum, std::vector<size_t>({1}), gradient), std::invalid_argument);
+    ASSERT_THROW(ScatterAdd(sum, rows, Matrix(3000, 65)), std::invalid_argument);
+  }
+
+  TEST(MatrixFunctionsTest, TestPermute) {
+    Matrix m = Matrices::Sequence(4, 2, Range(0));
+    ASSERT_TRUE(Matrices::WithValues(2, {6, 7, 0, 1, 4, 5, 2, 3})
+        .Equals(Permute(m, std::vector<size_t>({3, 0, 2, 1}))));
+    ASSERT_THROW(Permute(m, std::vector<size_t>({3, 0, 2})), std::invalid_argument);
+    ASSERT_THROW(Permute(m, std::vector<size_t>({3, 0, 2, 2})), std::invalid_argument);
+    ASSERT_THROW(Permute(m, std::vector<size_t>({3, 0, 2, 4})), std::invalid_argument);
+  }
+
   TEST(MatrixFunctionsTest, TestPackUnpack) {
     std::vector<Matrix> matrices;
     matrices.push_back(Matrices::Sequence(3, 3, Range(1)));
@@ -270,6 +625,76 @@ namespace math {
     ASSERT_TRUE(m2.Equals(matrices[1]));
   }
 
+  TEST(MatrixFunctionsTest, TestSaveMtx_Compressed) {
+    const char* fileName = "/tmp/MatricesTestSuite_TestSaveMtx_Compressed.mtx";
+    // several blocks, the last one partial: compressible, incompressible and tiny matrices
+    Matrix sequence = Matrices::Sequence(300, 500, Range(0));
+    Matrix ones = Matrices::Ones(5000, 40);
+    Matrix noise = Matrices::Uniform(70000, 1, 1, -1.0, 1.0);
+    Matrix tiny = Matrices::Sequence(1, 3, Range(7));
+    std::vector<Matrix> v({sequence, ones, noise, tiny});
+    SaveMtx(fileName, v.begin(), v.end(), MtxCompression::kShuffleLZ);
+
+    std::vector<Matrix> matrices = FromMtx(fileName);
+    ASSERT_EQ(4, matrices.size());
+    for (int i = 0; i < 4; i++) {
+      ASSERT_TRUE(v[i].Equals(matrices[i])) << "matrix " << i;
+    }
+
+    std::ifstream in(fileName, std::ios_base::binary | std::ios_base::ate);
+    std::size_t rawSize = (sequence.NumCells() + ones.NumCells() + noise.NumCells() + 3)
+        * sizeof(float_t);
+    ASSERT_LT(static_cast<std::size_t>(in.tellg()), rawSize * 3 / 4);
+
+    // streamed reads decode one matrix at a time
+    auto stream = FromMtxStream(fileName);
+    ASSERT_TRUE(sequence.Equals(*stream()));
+    ASSERT_TRUE(ones.Equals(*stream()));
+  }
+
+  TEST(MatrixFunctionsTest, TestMtxCompressionOf) {
+    const char* fileName = "/tmp/MatricesTestSuite_TestMtxCompressionOf.mtx";
+    SaveMtx(fileName, Matrices::Ones(3, 3), MtxCompression::kShuffleLZ);
+    ASSERT_EQ(MtxCompression::kShuffleLZ, MtxCompressionOf(fileName));
+    SaveMtx(fileName, Matrices::Ones(3, 3));
+    ASSERT_EQ(MtxCompression::kNone, MtxCompressionOf(fileName));
+
+    ASSERT_THROW(
+        MtxCompressionOf("lib/src/test/resources/matrix/MatricesTestSuite_FromCsv.csv"),
+        std::runtime_error);
+    ASSERT_THROW(MtxCompressionOf("/tmp/bogus/dir/file.mtx"), mdl::io::io_exception);
+  }
+
+  TEST(MatrixFunctionsTest, TestFromMtx_Corrupted) {
+    const char* fileName = "/tmp/MatricesTestSuite_TestFromMtx_Corrupted.mtx";
+    SaveMtx(fileName, Matrices::Sequence(100, 100, Range(0)), MtxCompression::kShuffleLZ);
+    std::uintmax_t size = std::filesystem::file_size(fileName);
+    {
+      // a block size larger than the block itself
+      std::fstream file(fileName, std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+      file.seekp(4 * sizeof(int));
+      int blockSize = 100 * 100 * sizeof(float_t) + 1;
+      file.write(reinterpret_cast<const char*>(&blockSize), sizeof(int));
+    }
+    ASSERT_THROW(FromMtx(fileName), mdl::io::io_exception);
+
+    SaveMtx(fileName, Matrices::Sequence(100, 100, Range(0)), MtxCompression::kShuffleLZ);
+    std::filesystem::resize_file(fileName, size - 10);
+    ASSERT_THROW(FromMtx(fileName), mdl::io::io_exception);
+
+    // cut within the table of block sizes
+    SaveMtx(fileName, Matrices::Sequence(1000, 1000, Range(0)), MtxCompression::kShuffleLZ);
+    std::filesystem::resize_file(fileName, 6 * sizeof(int));
+    ASSERT_THROW(FromMtx(fileName), mdl::io::io_exception);
+  }
+
+  TEST(MatrixFunctionsTest, TestSaveMtx_NotContiguous) {
+    Matrix m = Matrices::Sequence(4, 4, Range(0));
+    auto slices = {m(Range(0, 2), Range(0, 2))};
+    std::ostringstream out;
+    ASSERT_THROW(SaveMtx(out, slices.begin(), slices.end()), mdl::io::io_exception);
+  }
+
   TEST(MatrixFunctionsTest, TestFromMtx_WrongFormat) {
     ASSERT_THROW(
       FromMtx("lib/src/test/resources/matrix/MatricesTestSuite_FromCsv.csv"),
@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <mdl/matrix.h>
+
+namespace mdl {
+namespace math {
+
+  namespace {
+    void AssertGraphNear(const Matrix& expected, const Matrix& actual) {
+      ASSERT_EQ(expected.NumRows(), actual.NumRows());
+      ASSERT_EQ(expected.NumCols(), actual.NumCols());
+      for (size_t row = 0; row < expected.NumRows(); row++) {
+        for (size_t col = 0; col < expected.NumCols(); col++) {
+          float_t tolerance = 1e-4 * std::max<float_t>(1.0, std::abs(expected(row, col)));
+          ASSERT_NEAR(expected(row, col), actual(row, col), tolerance)
+              << "at (" << row << ", " << col << ")";
+        }
+      }
+    }
+  }
+
+  TEST(GraphTest, TestMultiLayer) {
+    Matrix w1 = Matrices::Normal(30, 20, 1);
+    Matrix b1 = Matrices::Normal(1, 20, 2);
+    Matrix w2 = Matrices::Normal(20, 5, 3);
+    Matrix b2 = Matrices::Normal(1, 5, 4);
+
+    Graph graph;
+    Graph::Value x = graph.Input(64, 30);
+    Graph::Value hidden = graph.Sigmoid(
+        graph.Add(graph.Multiply(x, graph.Constant(w1)), graph.Constant(b1)));
+    Graph::Value out = graph.ReLU(
+        graph.Add(graph.Multiply(hidden, graph.Constant(w2)), graph.Constant(b2)));
+    CompiledGraph compiled = graph.Compile({out});
+
+    // two products, each followed by one fused pass
+    ASSERT_EQ(4, compiled.NumSteps());
+
+    // replays with new inputs every time
+    for (std::uint64_t seed = 5; seed < 8; seed++) {
+      Matrix input = Matrices::Normal(64, 30, seed);
+      Matrix expected = ReLU(Sigmoid(input * w1 + b1) * w2 + b2);
+      AssertGraphNear(expected, compiled.Run({input})[0]);
+    }
+  }
+
+  TEST(GraphTest, TestBroadcastAndReversed) {
+    Matrix m = Matrices::Normal(40, 30, 9);
+    Matrix row = Matrices::Normal(1, 30, 10);
+    Matrix col = Matrices::Normal(40, 1, 11);
+
+    Graph graph;
+    Graph::Value x = graph.Input(40, 30);
+    Graph::Value y = graph.Prod(graph.Add(x, graph.Constant(row)), graph.Constant(col));
+    Graph::Value z = graph.Subtract(graph.Constant(m), graph.Scale(graph.Exp(y), 0.5));
+    Graph::Value w = graph.Subtract(z, graph.Constant(Matrix(2.0)));
+    CompiledGraph compiled = graph.Compile({w});
+
+    ASSERT_EQ(1, compiled.NumSteps());
+    ASSERT_EQ(0, compiled.ArenaSize());
+
+    Matrix input = Matrices::Normal(40, 30, 12);
+    Matrix expected = m - mdl::math::Exp(Prod(input + row, col)) * 0.5 - 2.0;
+    AssertGraphNear(expected, compiled.Run({input})[0]);
+  }
+
+  TEST(GraphTest, TestArenaReuse) {
+    size_t n = 50;
+    Matrix c = Matrices::Normal(n, n, 13) * 0.1;
+
+    Graph graph;
+    Graph::Value x = graph.Input(n, n);
+    Graph::Value h = x;
+    for (int i = 0; i < 3; i++) {
+      h = graph.Multiply(h, graph.Multiply(h, graph.Constant(c)));
+    }
+    CompiledGraph compiled = graph.Compile({h});
+
+    // Every other product needs an intermediate plus a transposed copy of it, 8 buffers in all.
+    //   At most 4 are live at a time.
+    ASSERT_EQ(6, compiled.NumSteps());
+    ASSERT_LT(compiled.ArenaSize(), 5 * n * n);
+
+    Matrix input = Matrices::Normal(n, n, 14) * 0.1;
+    Matrix expected = input;
+    for (int i = 0; i < 3; i++) {
+      expected = expected * (expected * c);
+    }
+    AssertGraphNear(expected, compiled.Run({input})[0]);
+  }
+
+  TEST(GraphTest, TestOutputs) {
+    Matrix c = Matrices::Normal(3, 3, 15);
+
+    Graph graph;
+    Graph::Value x = graph.Input(3, 3);
+    // no output depends on it, but it's still an input of Run()
+    [[maybe_unused]] Graph::Value unused = graph.Input(2, 2);
+    Graph::Value sum = graph.Add(x, graph.Constant(c));
+    Graph::Value product = graph.Multiply(sum, x);
+    graph.Exp(product);
+    CompiledGraph compiled = graph.Compile({x, sum, product, sum});
+
+    Matrix input = Matrices::Normal(3, 3, 16);
+    Matrix ignored(2, 2);
+    const std::vector<Matrix>& outputs = compiled.Run({input, ignored});
+    ASSERT_EQ(4, outputs.size());
+    AssertGraphNear(input, outputs[0]);
+    AssertGraphNear(input + c, outputs[1]);
+    AssertGraphNear((input + c) * input, outputs[2]);
+    AssertGraphNear(input + c, outputs[3]);
+  }
+
+  TEST(GraphTest, TestInvalid) {
+    Graph graph;
+    Graph::Value x = graph.Input(3, 4);
+    ASSERT_THROW(graph.Multiply(x, x), std::invalid_argument);
+    ASSERT_THROW(graph.Add(x, graph.Input(4, 3)), std::invalid_argument);
+    ASSERT_THROW(graph.Add(x, graph.Input(3, 2)), std::invalid_argument);
+    ASSERT_THROW(graph.Sigmoid(Graph::Value()), std::invalid_argument);
+
+    Graph other;
+    CompiledGraph compiled = other.Compile({other.Sigmoid(other.Input(3, 4))});
+    ASSERT_THROW(compiled.Run({}), std::invalid_argument);
+    Matrix transposed(4, 3);
+    ASSERT_THROW(compiled.Run({transposed}), std::invalid_argument);
+  }
+
+} // math
+} // mdl
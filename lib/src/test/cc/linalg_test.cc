@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include <mdl/matrix.h>
+
+namespace mdl {
+namespace math {
+
+  namespace {
+    void AssertNear(const Matrix& expected, const Matrix& actual, float_t tolerance) {
+      ASSERT_EQ(expected.NumRows(), actual.NumRows());
+      ASSERT_EQ(expected.NumCols(), actual.NumCols());
+      for (size_t row = 0; row < expected.NumRows(); row++) {
+        for (size_t col = 0; col < expected.NumCols(); col++) {
+          ASSERT_NEAR(expected(row, col), actual(row, col), tolerance)
+              << "at (" << row << ", " << col << ")";
+        }
+      }
+    }
+
+    // Diagonally dominated so that it is well conditioned. 150 spans a few factorization blocks.
+    Matrix WellConditioned(size_t n, std::uint64_t seed) {
+      return Matrices::Normal(n, n, seed) + Matrices::Identity(n) * 20.0;
+    }
+  }
+
+  TEST(LinalgTest, TestLUSmall) {
+    Matrix a = Matrices::WithValues(3, {2, 1, 1, 4, -6, 0, -2, 7, 2});
+    LU lu(a);
+
+    ASSERT_FALSE(lu.IsSingular());
+    ASSERT_NEAR(-16.0, lu.Determinant(), 1e-4);
+    ASSERT_NEAR(-16.0, Determinant(a), 1e-4);
+    AssertNear(
+        Matrices::WithValues(1, {1, 1, 2}),
+        Solve(a, Matrices::WithValues(1, {5, -2, 9})),
+        1e-5);
+  }
+
+  TEST(LinalgTest, TestLUFactors) {
+    size_t n = 150;
+    Matrix a = WellConditioned(n, 1);
+    LU lu(a);
+    const std::vector<size_t>& permutation = lu.GetPermutation();
+    Matrix pa(n, n, [&a, &permutation](size_t row, size_t col) {
+      return a(permutation[row], col);
+    });
+
+    AssertNear(pa, lu.L() * lu.U(), 1e-3);
+    for (size_t i = 0; i < n; i++) {
+      ASSERT_EQ(1.0, lu.L()(i, i));
+    }
+  }
+
+  TEST(LinalgTest, TestLUPivots) {
+    // needs pivoting: the leading entry is zero
+    Matrix a = Matrices::WithValues(2, {0, 1, 1, 0});
+    LU lu(a);
+    ASSERT_EQ(std::vector<size_t>({1, 0}), lu.GetPermutation());
+    ASSERT_NEAR(-1.0, lu.Determinant(), 1e-6);
+    AssertNear(a, Inverse(a), 1e-6);
+  }
+
+  TEST(LinalgTest, TestSolveAndInverse) {
+    size_t n = 150;
+    Matrix a = WellConditioned(n, 2);
+    Matrix x = Matrices::Normal(n, 7, 3);
+    Matrix b = a * x;
+
+    AssertNear(x, Solve(a, b), 1e-4);
+    AssertNear(Matrices::Identity(n), a * Inverse(a), 1e-4);
+  }
+
+  TEST(LinalgTest, TestSingular) {
+    Matrix a = Matrices::WithValues(3, {1, 2, 3, 2, 4, 6, 1, 0, 1});
+    LU lu(a);
+    ASSERT_TRUE(lu.IsSingular());
+    ASSERT_EQ(0.0, lu.Determinant());
+    ASSERT_THROW(lu.Solve(Matrices::Ones(3, 1)), std::invalid_argument);
+    ASSERT_THROW(Inverse(a), std::invalid_argument);
+  }
+
+  TEST(LinalgTest, TestInvalidDimensions) {
+    ASSERT_THROW(LU(Matrix(3, 4)), std::invalid_argument);
+    ASSERT_THROW(Cholesky(Matrix(3, 4)), std::invalid_argument);
+    ASSERT_THROW(QR(Matrix(3, 4)), std::invalid_argument);
+    ASSERT_THROW(Solve(Matrices::Identity(3), Matrix(4, 1)), std::invalid_argument);
+  }
+
+  TEST(LinalgTest, TestCholesky) {
+    size_t n = 150;
+    Matrix r = Matrices::Normal(n, n, 4);
+    Matrix a = r * r.Transpose() + Matrices::Identity(n) * n;
+    Cholesky cholesky(a);
+    Matrix l = cholesky.L();
+
+    for (size_t row = 0; row < n; row++) {
+      for (size_t col = row + 1; col < n; col++) {
+        ASSERT_EQ(0.0, l(row, col));
+      }
+    }
+    AssertNear(a, l * l.Transpose(), 1e-2);
+
+    Matrix x = Matrices::Normal(n, 3, 5);
+    AssertNear(x, cholesky.Solve(a * x), 1e-4);
+
+    Matrix small = Matrices::WithValues(2, {4, 2, 2, 3});
+    ASSERT_NEAR(8.0, Cholesky(small).Determinant(), 1e-5);
+  }
+
+  TEST(LinalgTest, TestCholeskyNotPositiveDefinite) {
+    ASSERT_THROW(Cholesky(Matrices::WithValues(2, {1, 2, 2, 1})), std::invalid_argument);
+  }
+
+  TEST(LinalgTest, TestQR) {
+    Matrix a = Matrices::Normal(200, 130, 6);
+    QR qr(a);
+    Matrix q = qr.Q();
+    Matrix r = qr.R();
+
+    ASSERT_EQ(200, q.NumRows());
+    ASSERT_EQ(130, q.NumCols());
+    for (size_t row = 0; row < r.NumRows(); row++) {
+      for (size_t col = 0; col < row; col++) {
+        ASSERT_EQ(0.0, r(row, col));
+      }
+    }
+    AssertNear(a, q * r, 1e-4);
+    AssertNear(Matrices::Identity(130), q.Transpose() * q, 1e-4);
+  }
+
+  TEST(LinalgTest, TestLeastSquares) {
+    Matrix a = Matrices::Normal(200, 70, 7);
+    Matrix b = Matrices::Normal(200, 2, 8);
+    Matrix x = LeastSquares(a, b);
+
+    // residual must be orthogonal to the column space of A
+    AssertNear(Matrix(70, 2), a.Transpose() * (a * x - b), 1e-3);
+
+    // consistent systems are solved exactly
+    Matrix x0 = Matrices::Normal(70, 2, 9);
+    AssertNear(x0, LeastSquares(a, a * x0), 1e-4);
+  }
+
+} // math
+} // mdl
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include <mdl/matrix.h>
+
+namespace mdl {
+namespace math {
+
+  namespace {
+    // A partial last word, and enough cells to run in parallel.
+    Matrix TestMatrix() {
+      return Round(Matrices::Normal(300, 301, 27) * 2);
+    }
+  }
+
+  TEST(MaskTest, TestCompare) {
+    Matrix m = TestMatrix();
+    Matrix other = Round(Matrices::Normal(300, 301, 28) * 2);
+    ASSERT_TRUE((m > 0).Equals(Mask::Compare<op::GreaterThan>(m, 0.0).ToMatrix()));
+    ASSERT_TRUE((m <= 1).Equals(Mask::Compare<op::LessThanEquals>(m, 1.0).ToMatrix()));
+    ASSERT_TRUE((m == 0).Equals(Mask::Compare<op::Equals>(m, 0.0).ToMatrix()));
+    ASSERT_TRUE((m < other).Equals(Mask::Compare<op::LessThan>(m, other).ToMatrix()));
+    ASSERT_TRUE((m != other).Equals(Mask::Compare<op::NotEquals>(m, other).ToMatrix()));
+    ASSERT_TRUE(Mask::NonZero(m > 0).Equals(Mask::Compare<op::GreaterThan>(m, 0.0)));
+
+    Mask small = Mask::Compare<op::GreaterThanEquals>(Matrices::WithValues(3, {1, -2, 3, 0}), 1.0);
+    ASSERT_EQ(2, small.NumRows());
+    ASSERT_EQ(3, small.NumCols());
+    ASSERT_TRUE(small(0, 0));
+    ASSERT_FALSE(small(0, 1));
+    ASSERT_TRUE(small(0, 2));
+    ASSERT_FALSE(small(1, 0));
+
+    ASSERT_THROW(Mask::Compare<op::LessThan>(m, Matrix(300, 300)), std::invalid_argument);
+  }
+
+  TEST(MaskTest, TestCountAndLogic) {
+    Matrix m = TestMatrix();
+    Mask positive = Mask::Compare<op::GreaterThan>(m, 0.0);
+    Mask small = Mask::Compare<op::LessThan>(m, 2.0);
+    ASSERT_EQ(Sum(Sum(m > 0).Transpose())(0, 0), positive.Count());
+
+    ASSERT_TRUE(((m > 0) && (m < 2)).Equals((positive && small).ToMatrix()));
+    ASSERT_TRUE(((m > 0) || (m < 2)).Equals((positive || small).ToMatrix()));
+    ASSERT_TRUE((!(m > 0)).Equals((!positive).ToMatrix()));
+    // bits past the last cell stay unset
+    ASSERT_EQ(m.NumCells() - positive.Count(), (!positive).Count());
+
+    Mask mask(2, 2);
+    mask.Set(1, 0, true);
+    mask.Set(1, 1, true);
+    mask.Set(1, 1, false);
+    ASSERT_EQ(1, mask.Count());
+    ASSERT_TRUE(mask(1, 0));
+    ASSERT_THROW(mask && positive, std::invalid_argument);
+  }
+
+  TEST(MaskTest, TestWhere) {
+    Matrix m = TestMatrix();
+    Matrix other = Matrices::Normal(300, 301, 29);
+    Mask positive = Mask::Compare<op::GreaterThan>(m, 0.0);
+    ASSERT_TRUE(Prod(m, m > 0).Equals(Where(positive, m, 0.0)));
+    ASSERT_TRUE((Prod(m, m > 0) + Prod(other, m <= 0)).Equals(Where(positive, m, other)));
+
+    ASSERT_THROW(Where(positive, m, Matrix(300, 300)), std::invalid_argument);
+    ASSERT_THROW(Where(Mask(3, 3), m, 0.0), std::invalid_argument);
+  }
+
+  TEST(MaskTest, TestMaskedAssign) {
+    Matrix m = Matrices::Sequence(4, 3, Range(0));
+    Mask mask(3, 2);
+    mask.Set(0, 1, true);
+    mask.Set(2, 0, true);
+
+    // onto a transposed slice: cells (1, 0) and (0, 2) of m
+    MaskedAssign(m(Range(0, 2), Range()).Transpose(), mask, -1.0);
+    ASSERT_TRUE(Matrices::WithValues(3, {0, 1, -1, -1, 4, 5, 6, 7, 8, 9, 10, 11}).Equals(m));
+
+    // from slices that share cells with the target, and onto one without a layout
+    Matrix expected = Matrices::WithValues(3, {0, 1, -1, -1, 4, 5, 6, 7, 8, 9, 10, 11});
+    MaskedAssign(m(Range(0, 3), Range(1, 3)), mask, m(Range(0, 3), Range(0, 2)));
+    expected(0, 2) = 1;
+    expected(2, 1) = 6;
+    ASSERT_TRUE(expected.Equals(m));
+
+    MaskedAssign(m(IndexRange({3, 1, 0}), Range(0, 2)), mask, 100.0);
+    expected(3, 1) = 100;
+    expected(0, 0) = 100;
+    ASSERT_TRUE(expected.Equals(m));
+
+    ASSERT_THROW(MaskedAssign(m, mask, 1.0), std::invalid_argument);
+    ASSERT_THROW(MaskedAssign(m(Range(0, 3), Range(0, 2)), mask, m), std::invalid_argument);
+  }
+
+} // math
+} // mdl
@@ -21,6 +21,27 @@ namespace math {
     }
   }
 
+  TEST(MatricesTestSuite, OnesMatrixTest_Large) {
+    Matrix ones = Matrices::Ones(300, 301);
+    for (size_t row = 0; row < ones.NumRows(); row++) {
+      for (size_t col = 0; col < ones.NumCols(); col++) {
+        ASSERT_EQ(1, ones(row, col));
+      }
+    }
+  }
+
+  TEST(MatricesTestSuite, IdentityMatrixTest) {
+    Matrix identity = Matrices::Identity(200);
+    ASSERT_EQ(200, identity.NumRows());
+    ASSERT_EQ(200, identity.NumCols());
+
+    for (size_t row = 0; row < identity.NumRows(); row++) {
+      for (size_t col = 0; col < identity.NumCols(); col++) {
+        ASSERT_EQ(row == col, identity(row, col));
+      }
+    }
+  }
+
   TEST(MatricesTestSuite, ZerosMatrixTest) {
     Matrix zeros = Matrices::Zeros(2, 3);
     ASSERT_EQ(2, zeros.NumRows());
@@ -85,6 +106,14 @@ namespace math {
     }
   }
 
+  TEST(MatricesTestSuite, SequenceMatrixTest_Large) {
+    Matrix seq = Matrices::Sequence(200, 300, Range(5, 50005, 2));
+    
+    for (size_t i = 0; i < seq.NumCells(); i++) {
+      ASSERT_EQ(i < 25000 ? 5 + 2 * i : 0, seq[i]);
+    }
+  }
+
   TEST(MatricesTestSuite, DefaultMatrixTest) {
     Matrix def = Matrices::Default(2, 10, -2.5);
 
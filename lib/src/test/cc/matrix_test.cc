@@ -23,6 +23,26 @@ namespace math {
       }
   };
 
+  TEST_F(MatrixTestSuite, TestGeneratorConstructor) {
+    Matrix small(3, 5, [](size_t row, size_t col) { return row * 10 + col; });
+    for (size_t row = 0; row < small.NumRows(); row++) {
+      for (size_t col = 0; col < small.NumCols(); col++) {
+        ASSERT_EQ(row * 10 + col, small(row, col));
+      }
+    }
+
+    // large enough to be split across the worker pool, with partitions ending mid-row
+    Matrix large(301, 257, [](size_t row, size_t col) { return row * 1000 + col; });
+    for (size_t row = 0; row < large.NumRows(); row++) {
+      for (size_t col = 0; col < large.NumCols(); col++) {
+        ASSERT_EQ(row * 1000 + col, large(row, col));
+      }
+    }
+
+    Matrix empty(0, 5, [](size_t, size_t) { return 1.0; });
+    ASSERT_EQ(0, empty.NumCells());
+  }
+
   TEST_F(MatrixTestSuite, TestGetSet) {
     size_t count = 0;
     for (size_t row = 0; row < matrix.NumRows(); row++) {
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include <set>
+
+#include <mdl/matrix.h>
+
+namespace mdl {
+namespace math {
+
+  class MinibatchLoaderTest : public ::testing::Test {
+    protected:
+      // 25 rows total, split in matrices of 10, 7 (file 1) and 8 (file 2) rows. Row r holds
+      //   {3r, 3r + 1, 3r + 2}.
+      void SetUp() override {
+        std::vector<Matrix> first({Rows(0, 10), Rows(10, 7)});
+        SaveMtx(kFile1, first.begin(), first.end());
+        SaveMtx(kFile2, Rows(17, 8));
+      }
+
+      static Matrix Rows(size_t first, size_t count) {
+        return Matrix(count, 3, [first](size_t row, size_t col) {
+          return static_cast<float_t>((first + row) * 3 + col);
+        });
+      }
+
+      // Returns the ids of all rows of all batches of one epoch, checking each row is intact.
+      static std::vector<int> Epoch(MinibatchLoader& loader, std::vector<size_t>& sizes) {
+        std::vector<int> ids;
+        Matrix batch;
+        while (loader.Next(batch)) {
+          sizes.push_back(batch.NumRows());
+          for (size_t row = 0; row < batch.NumRows(); row++) {
+            int id = static_cast<int>(batch(row, 0)) / 3;
+            EXPECT_EQ(id * 3 + 1, batch(row, 1));
+            EXPECT_EQ(id * 3 + 2, batch(row, 2));
+            ids.push_back(id);
+          }
+        }
+        return ids;
+      }
+
+      const char* kFile1 = "/tmp/MinibatchLoaderTest_1.mtx";
+      const char* kFile2 = "/tmp/MinibatchLoaderTest_2.mtx";
+  };
+
+  TEST_F(MinibatchLoaderTest, TestSequential) {
+    MinibatchLoader loader({kFile1, kFile2}, 4, false);
+
+    for (int epoch = 0; epoch < 3; epoch++) {
+      std::vector<size_t> sizes;
+      std::vector<int> ids = Epoch(loader, sizes);
+
+      ASSERT_EQ(std::vector<size_t>({4, 4, 4, 4, 4, 4, 1}), sizes);
+      ASSERT_EQ(25, ids.size());
+      for (int i = 0; i < 25; i++) {
+        ASSERT_EQ(i, ids[i]);
+      }
+    }
+  }
+
+  TEST_F(MinibatchLoaderTest, TestShuffled) {
+    MinibatchLoader loader({kFile1, kFile2}, 10, true, 17);
+
+    std::vector<size_t> sizes;
+    std::vector<int> epoch1 = Epoch(loader, sizes);
+    std::vector<int> epoch2 = Epoch(loader, sizes);
+
+    ASSERT_EQ(std::vector<size_t>({10, 10, 5, 10, 10, 5}), sizes);
+    ASSERT_EQ(25, std::set<int>(epoch1.begin(), epoch1.end()).size());
+    ASSERT_EQ(25, std::set<int>(epoch2.begin(), epoch2.end()).size());
+    ASSERT_NE(epoch1, epoch2);
+  }
+
+  TEST_F(MinibatchLoaderTest, TestShuffledIsReproducible) {
+    MinibatchLoader loader1({kFile1, kFile2}, 6, true, 99);
+    MinibatchLoader loader2({kFile1, kFile2}, 6, true, 99, 1);
+
+    for (int epoch = 0; epoch < 2; epoch++) {
+      std::vector<size_t> sizes1, sizes2;
+      ASSERT_EQ(Epoch(loader1, sizes1), Epoch(loader2, sizes2));
+    }
+  }
+
+  TEST_F(MinibatchLoaderTest, TestReusesBuffers) {
+    MinibatchLoader loader({kFile1, kFile2}, 5, false);
+    std::set<const float_t*> buffers;
+
+    Matrix batch;
+    for (int epoch = 0; epoch < 4; epoch++) {
+      while (loader.Next(batch)) {
+        buffers.insert(&batch(0, 0));
+      }
+    }
+    // Queue, free list and the caller's matrix bound the number of distinct buffers.
+    ASSERT_GE(6, buffers.size());
+  }
+
+  TEST_F(MinibatchLoaderTest, TestReusesBuffersAroundShortBatches) {
+    // every epoch ends with a short batch of 1 row, which must not cost a full buffer
+    MinibatchLoader loader({kFile1, kFile2}, 4, true, 7);
+    std::set<const float_t*> buffers;
+
+    Matrix batch;
+    for (int epoch = 0; epoch < 4; epoch++) {
+      while (loader.Next(batch)) {
+        if (batch.NumRows() == 4) {
+          buffers.insert(&batch(0, 0));
+        }
+      }
+    }
+    ASSERT_GE(6, buffers.size());
+  }
+
+  TEST_F(MinibatchLoaderTest, TestColumnMismatch) {
+    SaveMtx(kFile2, Matrix(2, 4));
+    MinibatchLoader loader({kFile1, kFile2}, 100, false);
+    Matrix batch;
+    ASSERT_THROW(loader.Next(batch), std::invalid_argument);
+  }
+
+  TEST_F(MinibatchLoaderTest, TestMissingFile) {
+    MinibatchLoader loader({"/tmp/MinibatchLoaderTest_missing.mtx"}, 4, true);
+    Matrix batch;
+    ASSERT_THROW(loader.Next(batch), std::exception);
+  }
+
+  TEST_F(MinibatchLoaderTest, TestEarlyDestruction) {
+    MinibatchLoader loader({kFile1, kFile2}, 1, false, 0, 1);
+    Matrix batch;
+    ASSERT_TRUE(loader.Next(batch));
+    ASSERT_EQ(0, batch(0, 0));
+  }
+
+} // math
+} // mdl
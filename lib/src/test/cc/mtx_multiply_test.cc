@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include <mdl/matrix.h>
+
+namespace mdl {
+namespace math {
+
+  namespace {
+    const char* kInput = "/tmp/MtxMultiplyTest.mtx";
+    const char* kOutput = "/tmp/MtxMultiplyTest.out.mtx";
+
+    void AssertNear(const Matrix& expected, const Matrix& result) {
+      ASSERT_EQ(expected.NumRows(), result.NumRows());
+      ASSERT_EQ(expected.NumCols(), result.NumCols());
+      for (size_t i = 0; i < expected.NumRows(); i++) {
+        for (size_t j = 0; j < expected.NumCols(); j++) {
+          ASSERT_NEAR(expected(i, j), result(i, j), 1e-3) << "cell " << i << ", " << j;
+        }
+      }
+    }
+
+    // 150x70, 70x90 and 40x70, none a multiple of the tiles.
+    std::vector<Matrix> TestMatrices() {
+      std::vector<Matrix> matrices;
+      matrices.reserve(3);
+      matrices.push_back(Matrices::Normal(150, 70, 41));
+      matrices.push_back(Matrices::Normal(70, 90, 42));
+      matrices.push_back(Matrices::Normal(40, 70, 43));
+      return matrices;
+    }
+  }
+
+  TEST(MtxMultiplyTest, TestMultiply) {
+    std::vector<Matrix> matrices = TestMatrices();
+    Matrix expected = matrices[0] * matrices[1];
+
+    for (MtxCompression compression : {MtxCompression::kNone, MtxCompression::kShuffleLZ}) {
+      SaveMtx(kInput, matrices.begin(), matrices.end(), compression);
+      MtxReader reader(kInput);
+      // tiles of 18, of 8, and whole matrices
+      for (std::uint64_t budget : {20000, 8000, 1 << 20}) {
+        for (bool background : {false, true}) {
+          {
+            MtxWriter writer(kOutput, {MtxCompression::kNone, background});
+            MultiplyMtx(reader, 0, reader, 1, writer, {budget});
+            writer.Close();
+          }
+          std::vector<Matrix> result = FromMtx(kOutput);
+          ASSERT_EQ(1, result.size());
+          AssertNear(expected, result[0]);
+        }
+      }
+    }
+  }
+
+  TEST(MtxMultiplyTest, TestTransposeSecond) {
+    std::vector<Matrix> matrices = TestMatrices();
+    SaveMtx(kInput, matrices.begin(), matrices.end());
+    MtxReader reader(kInput);
+
+    for (std::uint64_t budget : {20000, 1 << 20}) {
+      {
+        MtxWriter writer(kOutput);
+        // a Gram matrix, and a product with another file's matrix
+        MultiplyMtx(reader, 0, reader, 0, writer, {budget, true});
+        MtxReader other(kInput);
+        MultiplyMtx(reader, 0, other, 2, writer, {budget, true});
+      }
+      std::vector<Matrix> result = FromMtx(kOutput);
+      ASSERT_EQ(2, result.size());
+      AssertNear(matrices[0] * matrices[0].Transposed(), result[0]);
+      AssertNear(matrices[0] * matrices[2].Transposed(), result[1]);
+    }
+  }
+
+  TEST(MtxMultiplyTest, TestEmpty) {
+    // files read anything without cells as 0x0, so the product has no cells either
+    std::vector<Matrix> matrices;
+    matrices.push_back(Matrix(5, 0));
+    matrices.push_back(Matrix(0, 3));
+    SaveMtx(kInput, matrices.begin(), matrices.end());
+    MtxReader reader(kInput);
+    {
+      MtxWriter writer(kOutput);
+      MultiplyMtx(reader, 0, reader, 1, writer);
+      // and nothing is left pending, so the writer takes another matrix
+      writer.Write(Matrices::Ones(1, 1));
+      writer.Close();
+    }
+    std::vector<Matrix> result = FromMtx(kOutput);
+    ASSERT_EQ(2, result.size());
+    ASSERT_EQ(0, result[0].NumCells());
+    ASSERT_TRUE(Matrices::Ones(1, 1).Equals(result[1]));
+  }
+
+  TEST(MtxMultiplyTest, TestErrors) {
+    std::vector<Matrix> matrices = TestMatrices();
+    SaveMtx(kInput, matrices.begin(), matrices.end());
+    MtxReader reader(kInput);
+    MtxWriter writer(kOutput);
+
+    ASSERT_THROW(MultiplyMtx(reader, 0, reader, 2, writer), std::invalid_argument);
+    ASSERT_THROW(MultiplyMtx(reader, 0, reader, 1, writer, {100}), std::invalid_argument);
+    ASSERT_THROW(MultiplyMtx(reader, 0, reader, 3, writer), std::invalid_argument);
+
+    // products are written a band at a time, which compressed files can't take
+    MtxWriter compressed(kOutput, {MtxCompression::kShuffleLZ});
+    ASSERT_THROW(MultiplyMtx(reader, 2, reader, 0, compressed, {1 << 20, true}),
+        std::invalid_argument);
+
+    // nothing was written, so the writer takes another matrix
+    MultiplyMtx(reader, 2, reader, 0, writer, {1 << 20, true});
+    writer.Close();
+    AssertNear(matrices[2] * matrices[0].Transposed(), FromMtx(kOutput)[0]);
+  }
+
+} // math
+} // mdl
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include <sys/stat.h>
+
+#include <mdl/matrix.h>
+
+namespace mdl {
+namespace math {
+
+  class MtxReaderTest : public ::testing::TestWithParam<MtxCompression> {
+    protected:
+      // Several compressed blocks per matrix, and rows wide enough that reading a few columns
+      //   skips most of every row.
+      void SetUp() override {
+        std::vector<Matrix> matrices({
+            Matrices::Sequence(3, 4, Range(1)),
+            Matrix(),
+            Matrices::Uniform(700, 300, 1),
+            Matrices::Sequence(5, 40000, Range(0))});
+        SaveMtx(kFile, matrices.begin(), matrices.end(), GetParam());
+        expected = FromMtx(kFile);
+      }
+
+      static constexpr const char* kFile = "/tmp/MtxReaderTest.mtx";
+      std::vector<Matrix> expected;
+  };
+
+  TEST_P(MtxReaderTest, TestWholeMatrices) {
+    MtxReader reader(kFile);
+    ASSERT_TRUE(reader.Contains(3));
+    ASSERT_FALSE(reader.Contains(4));
+    ASSERT_EQ(4, reader.NumMatrices());
+    for (size_t i = 0; i < 4; i++) {
+      ASSERT_EQ(expected[i].NumRows(), reader.NumRows(i));
+      ASSERT_EQ(expected[i].NumCols(), reader.NumCols(i));
+      ASSERT_TRUE(expected[i].Equals(reader.Read(i))) << "matrix " << i;
+    }
+  }
+
+  TEST_P(MtxReaderTest, TestRanges) {
+    MtxReader reader(kFile);
+    std::vector<std::pair<Range, Range>> ranges({
+        {Range(0, 10), Range()},
+        {Range(123, 456), Range(7, 250)},
+        {Range(5, 600, 7), Range(1, 299, 3)},
+        {Range(650, 100, -5), Range(299, 0, -1)},
+        {Range(699, 2000), Range(100, 101)},
+        {Range(800, 900), Range()},
+        {Range(1, 4), Range(39990)}});
+
+    for (size_t i : {0, 2, 3}) {
+      for (auto& [rows, cols] : ranges) {
+        Matrix expectedSlice = expected[i](rows, cols);
+        Matrix actual = reader.Read(i, rows, cols);
+        ASSERT_EQ(expectedSlice.NumRows(), actual.NumRows());
+        ASSERT_EQ(expectedSlice.NumCols(), actual.NumCols());
+        ASSERT_TRUE(expectedSlice.Equals(actual))
+            << "matrix " << i << ", rows " << rows.start << ":" << rows.end << ":"
+            << rows.increment << ", cols " << cols.start << ":" << cols.end << ":"
+            << cols.increment;
+      }
+    }
+  }
+
+  // As the mtxtool commands that rewrite a file do: the copy keeps its compression, byte for byte.
+  TEST_P(MtxReaderTest, TestCompressionRoundTrip) {
+    MtxReader reader(kFile);
+    ASSERT_EQ(GetParam(), reader.GetCompression());
+
+    const char* copyFile = "/tmp/MtxReaderTest.copy.mtx";
+    {
+      MtxWriter writer(copyFile, {.compression = reader.GetCompression(), .background = true});
+      for (size_t i = 0; i < reader.NumMatrices(); i++) {
+        writer.Write(reader.Read(i));
+      }
+      writer.Close();
+    }
+    ASSERT_EQ(GetParam(), MtxReader(copyFile).GetCompression());
+
+    auto bytes = [](const char* fileName) {
+      std::ostringstream os;
+      os << std::ifstream(fileName, std::ios_base::binary).rdbuf();
+      return os.str();
+    };
+    ASSERT_EQ(bytes(kFile), bytes(copyFile));
+  }
+
+  INSTANTIATE_TEST_SUITE_P(
+      Compression, MtxReaderTest,
+      ::testing::Values(MtxCompression::kNone, MtxCompression::kShuffleLZ));
+
+  TEST(MtxReaderTest, TestOtherPrecision) {
+    MtxReader reader("lib/src/test/resources/matrix/mat_seq_4_5_double.mtx");
+    ASSERT_TRUE(Matrices::Sequence(4, 5, Range(1)).Equals(reader.Read(0)));
+    ASSERT_TRUE(Matrices::Sequence(4, 5, Range(1))(Range(1, 3), Range(2, 5, 2))
+        .Equals(reader.Read(0, Range(1, 3), Range(2, 5, 2))));
+  }
+
+  TEST(MtxReaderTest, TestErrors) {
+    ASSERT_THROW(
+        MtxReader("lib/src/test/resources/matrix/bogus.mtx"), mdl::io::file_not_found_exception);
+    ASSERT_THROW(
+        MtxReader("lib/src/test/resources/matrix/MatricesTestSuite_FromCsv.csv"),
+        std::runtime_error);
+
+    const char* fileName = "/tmp/MtxReaderTest_TestErrors.mtx";
+    SaveMtx(fileName, Matrices::Sequence(100, 100, Range(0)));
+    {
+      MtxReader reader(fileName);
+      ASSERT_THROW(reader.Read(1), std::invalid_argument);
+      ASSERT_THROW(reader.NumRows(-1), std::invalid_argument);
+    }
+
+    // truncated files are caught when locating the matrix, before reading any cell
+    std::filesystem::resize_file(fileName, std::filesystem::file_size(fileName) - 4);
+    MtxReader reader(fileName);
+    ASSERT_THROW(reader.Read(0, Range(0, 1), Range()), mdl::io::io_exception);
+  }
+
+  TEST(MtxReaderTest, TestIsSeekable) {
+    ASSERT_TRUE(MtxReader::IsSeekable("lib/src/test/resources/matrix/mat_seq_4_5_double.mtx"));
+    ASSERT_TRUE(MtxReader::IsSeekable("lib/src/test/resources/matrix/bogus.mtx"));
+    ASSERT_FALSE(MtxReader::IsSeekable("lib/src/test/resources/matrix"));
+
+    const char* fifoName = "/tmp/MtxReaderTest_TestIsSeekable.fifo";
+    std::filesystem::remove(fifoName);
+    ASSERT_EQ(0, ::mkfifo(fifoName, 0600));
+    ASSERT_FALSE(MtxReader::IsSeekable(fifoName));
+    std::filesystem::remove(fifoName);
+  }
+
+} // math
+} // mdl
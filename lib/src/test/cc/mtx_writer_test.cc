@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <mdl/matrix.h>
+
+namespace mdl {
+namespace math {
+
+  namespace {
+    const char* kFile = "/tmp/MtxWriterTest.mtx";
+
+    std::string ReadFile(const char* fileName) {
+      std::ifstream in(fileName, std::ios_base::binary);
+      std::ostringstream os;
+      os << in.rdbuf();
+      return os.str();
+    }
+
+    // Small, large (bypasses the buffers) and empty matrices, with buffers of a single page.
+    std::vector<Matrix> TestMatrices() {
+      std::vector<Matrix> matrices;
+      matrices.reserve(5);
+      matrices.push_back(Matrices::Sequence(3, 4, Range(1)));
+      matrices.push_back(Matrices::Uniform(300, 70, 1));
+      matrices.push_back(Matrix());
+      matrices.push_back(Matrices::Sequence(100, 100, Range(0)));
+      matrices.push_back(Matrices::Ones(1, 1));
+      return matrices;
+    }
+  }
+
+  TEST(MtxWriterTest, TestSameBytesAsSaveMtx) {
+    std::vector<Matrix> expected = TestMatrices();
+    for (MtxCompression compression : {MtxCompression::kNone, MtxCompression::kShuffleLZ}) {
+      std::ostringstream os;
+      SaveMtx(os, expected.begin(), expected.end(), compression);
+
+      for (bool background : {false, true}) {
+        for (bool move : {false, true}) {
+          std::vector<Matrix> matrices = TestMatrices();
+          {
+            MtxWriter writer(kFile, {compression, background, true, 4096});
+            for (Matrix& matrix : matrices) {
+              if (move) {
+                writer.Write(std::move(matrix));
+              } else {
+                writer.Write(matrix);
+              }
+            }
+            writer.Close();
+          }
+          ASSERT_EQ(os.str(), ReadFile(kFile))
+              << "background: " << background << ", move: " << move;
+
+          if (move) {
+            // handed off, and let go of
+            ASSERT_EQ(0, matrices[1].NumCells());
+          }
+        }
+      }
+    }
+  }
+
+  TEST(MtxWriterTest, TestCallerMayChangeCopiedMatrices) {
+    Matrix matrix = Matrices::Sequence(500, 100, Range(0));
+    Matrix expected = matrix;
+    {
+      MtxWriter writer(kFile, {MtxCompression::kNone, true});
+      for (int i = 0; i < 10; i++) {
+        writer.Write(matrix);
+        matrix += 1.0;
+      }
+    }
+
+    auto stream = FromMtxStream(kFile);
+    for (int i = 0; i < 10; i++) {
+      ASSERT_TRUE(expected.Equals(*stream())) << "matrix " << i;
+      expected += 1.0;
+    }
+    ASSERT_FALSE(stream());
+  }
+
+  TEST(MtxWriterTest, TestDescriptor) {
+    std::ofstream(kFile).close();
+    int fd = ::open(kFile, O_WRONLY | O_TRUNC);
+    ASSERT_GE(fd, 0);
+    {
+      MtxWriter writer(fd);
+      writer.Write(Matrices::Sequence(2, 2, Range(0)));
+    }
+    // left open
+    ASSERT_EQ(0, ::close(fd));
+    ASSERT_TRUE(Matrices::Sequence(2, 2, Range(0)).Equals(FromMtx(kFile)[0]));
+  }
+
+  TEST(MtxWriterTest, TestRows) {
+    std::vector<Matrix> expected = TestMatrices();
+    std::ostringstream os;
+    SaveMtx(os, expected.begin() + 1, expected.begin() + 2);
+
+    for (bool background : {false, true}) {
+      Matrix matrix = expected[1];
+      {
+        MtxWriter writer(kFile, {MtxCompression::kNone, background, true, 4096});
+        writer.BeginRows(300, 70);
+        writer.WriteRows(Matrix(matrix(Range(0, 100), Range())));
+        writer.WriteRows(Matrix(0, 70));
+        // large enough to be handed off
+        writer.WriteRows(Matrix(matrix(Range(100, 300), Range())));
+        writer.Close();
+      }
+      ASSERT_EQ(os.str(), ReadFile(kFile)) << "background: " << background;
+    }
+
+    // rows of no columns are written as soon as they begin
+    {
+      MtxWriter writer(kFile);
+      writer.BeginRows(3, 0);
+      writer.Write(Matrices::Ones(1, 1));
+      writer.Close();
+    }
+    std::vector<Matrix> empty = FromMtx(kFile);
+    ASSERT_EQ(2, empty.size());
+    ASSERT_EQ(0, empty[0].NumCells());
+    ASSERT_TRUE(Matrices::Ones(1, 1).Equals(empty[1]));
+
+    MtxWriter writer(kFile);
+    ASSERT_THROW(writer.BeginRows(-1, 4), std::invalid_argument);
+    ASSERT_THROW(writer.BeginRows(3, -1), std::invalid_argument);
+    writer.BeginRows(3, 4);
+    ASSERT_THROW(writer.Write(Matrix(2, 2)), std::invalid_argument);
+    ASSERT_THROW(writer.BeginRows(2, 2), std::invalid_argument);
+    ASSERT_THROW(writer.WriteRows(Matrix(2, 3)), std::invalid_argument);
+    ASSERT_THROW(writer.WriteRows(Matrix(4, 4)), std::invalid_argument);
+    writer.WriteRows(Matrix(2, 4));
+    ASSERT_THROW(writer.Close(), mdl::io::io_exception);
+
+    MtxWriter compressed(kFile, {MtxCompression::kShuffleLZ});
+    ASSERT_THROW(compressed.BeginRows(3, 4), std::invalid_argument);
+  }
+
+  TEST(MtxWriterTest, TestErrors) {
+    ASSERT_THROW(MtxWriter("/tmp/bogus/dir/MtxWriterTest.mtx"), mdl::io::io_exception);
+
+    MtxWriter writer(kFile, {MtxCompression::kNone, true});
+    writer.Close();
+    ASSERT_THROW(writer.Write(Matrix(2, 2)), mdl::io::io_exception);
+
+    // a full device fails in the background, and surfaces on a later call
+    if (std::filesystem::exists("/dev/full")) {
+      MtxWriter full("/dev/full", {MtxCompression::kNone, true, false, 4096});
+      ASSERT_THROW({
+        for (int i = 0; i < 10; i++) {
+          full.Write(Matrix(100, 100));
+        }
+        full.Close();
+      }, mdl::io::io_exception);
+    }
+  }
+
+} // math
+} // mdl
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+#include <mdl/matrix.h>
+#include "../../lib/h/multithread/helper.h"
+#include "../../lib/h/multithread/numa.h"
+
+namespace mdl {
+namespace math {
+namespace multithread {
+
+  class NumaTest : public ::testing::Test {
+    protected:
+      void TearDown() override {
+        DisableNuma();
+      }
+
+      // Node that ran each chunk of a kNumKernels-way partition.
+      static std::vector<int> ChunkNodes() {
+        std::vector<int> nodes(kNumKernels, -2);
+        Partition(kNumKernels, [&nodes](size_t from, size_t) {
+          return [&nodes, from]() {
+            nodes[from] = CurrentNode();
+            return 0;
+          };
+        });
+        return nodes;
+      }
+  };
+
+  TEST_F(NumaTest, TestTopology) {
+    Topology fake = Topology::Fake(2, 3);
+    ASSERT_EQ(2, fake.NumNodes());
+    ASSERT_EQ(3, fake.CpusOf(0).size());
+    ASSERT_EQ(3, fake.CpusOf(1).size());
+
+    Topology detected = Topology::Detect();
+    ASSERT_LE(1, detected.NumNodes());
+    for (int node = 0; node < detected.NumNodes(); node++) {
+      ASSERT_FALSE(detected.CpusOf(node).empty());
+    }
+
+    ASSERT_THROW(EnableNuma(Topology({})), std::invalid_argument);
+    ASSERT_THROW(EnableNuma(Topology({{0}, {}})), std::invalid_argument);
+  }
+
+  TEST_F(NumaTest, TestChunksStayOnTheirNode) {
+    ASSERT_FALSE(IsNumaEnabled());
+    ASSERT_EQ(-1, NodeOfChunk(0));
+    ASSERT_EQ(std::vector<int>(kNumKernels, -1), ChunkNodes());
+
+    EnableNuma(Topology::Fake(2, 2));
+    ASSERT_TRUE(IsNumaEnabled());
+    ASSERT_EQ(0, NodeOfChunk(0));
+    ASSERT_EQ(1, NodeOfChunk(kNumKernels - 1));
+
+    std::vector<int> expected;
+    for (int chunk = 0; chunk < kNumKernels; chunk++) {
+      expected.push_back(NodeOfChunk(chunk));
+    }
+    // contiguous chunks share a node, and the placement doesn't change from one op to the next
+    ASSERT_TRUE(std::is_sorted(expected.begin(), expected.end()));
+    ASSERT_EQ(expected, ChunkNodes());
+    ASSERT_EQ(expected, ChunkNodes());
+  }
+
+  TEST_F(NumaTest, TestPinning) {
+    EnableNuma(Topology::Detect(), Pinning::kCore);
+#ifdef __linux__
+    ASSERT_TRUE(IsNumaPinned());
+#endif
+    EnableNuma(Topology::Fake(2, 1), Pinning::kNone);
+    ASSERT_TRUE(IsNumaPinned());
+  }
+
+  TEST_F(NumaTest, TestOperationsMatch) {
+    Matrix matrix1 = Matrices::Normal(300, 200, 1);
+    Matrix matrix2 = Matrices::Normal(200, 100, 2);
+    Matrix product = matrix1 * matrix2;
+    Matrix sum = matrix1 + matrix1;
+    Matrix filled(300, 200);
+
+    EnableNuma(Topology::Fake(2, 4), Pinning::kNode);
+    ASSERT_TRUE(product.Equals(matrix1 * matrix2));
+    ASSERT_TRUE(sum.Equals(matrix1 + matrix1));
+    ASSERT_TRUE(filled.Equals(Matrix(300, 200)));
+  }
+
+  TEST_F(NumaTest, TestExceptionsAndNesting) {
+    EnableNuma(Topology::Fake(1, 2));
+
+    ASSERT_THROW(
+        Partition(kNumKernels, [](size_t from, size_t) {
+          return [from]() -> int {
+            if (from == 3) { throw std::runtime_error("boom"); }
+            return 0;
+          };
+        }),
+        std::runtime_error);
+
+    // partitions started from within a worker run inline instead of deadlocking
+    std::atomic<int> count(0);
+    Partition(kNumKernels, [&count](size_t, size_t) {
+      return [&count]() {
+        Partition(kNumKernels, [&count](size_t, size_t) {
+          return [&count]() { count++; return 0; };
+        });
+        return 0;
+      };
+    });
+    ASSERT_EQ(kNumKernels * kNumKernels, count);
+  }
+
+} // namespace multithread
+} // math
+} // mdl
@@ -1247,5 +1247,79 @@ namespace math {
     ASSERT_TRUE(result.Equals(vector));
   }
 
+  Matrix NaiveMultiply(const Matrix& matrix1, const Matrix& matrix2) {
+    Matrix result(matrix1.NumRows(), matrix2.NumCols());
+    for (size_t row = 0; row < result.NumRows(); row++) {
+      for (size_t col = 0; col < result.NumCols(); col++) {
+        for (size_t k = 0; k < matrix1.NumCols(); k++) {
+          result(row, col) += matrix1(row, k) * matrix2(k, col);
+        }
+      }
+    }
+    return result;
+  }
+
+  void AssertNear(const Matrix& expected, const Matrix& result) {
+    ASSERT_EQ(expected.NumRows(), result.NumRows());
+    ASSERT_EQ(expected.NumCols(), result.NumCols());
+    for (size_t row = 0; row < result.NumRows(); row++) {
+      for (size_t col = 0; col < result.NumCols(); col++) {
+        ASSERT_NEAR(expected(row, col), result(row, col), 1e-3);
+      }
+    }
+  }
+
+  void AssertMultiplyNear(const Matrix& matrix1, const Matrix& matrix2) {
+    AssertNear(NaiveMultiply(matrix1, matrix2), matrix1 * matrix2);
+  }
+
+  TEST_F(MatrixOperatorOverloadTestSuite, MatrixVectorMultiplyTest) {
+    ASSERT_TRUE(Matrices::WithValues(1, {14, 32, 50, 68}).Equals(
+        matrix * Matrices::WithValues(1, {1, 2, 3})));
+    // large enough to be split across rows, with a length that isn't a multiple of the unroll
+    AssertMultiplyNear(Matrices::Normal(1000, 37, 1), Matrices::Normal(37, 1, 2));
+    AssertMultiplyNear(Matrices::Normal(1, 5, 1), Matrices::Normal(5, 1, 2));
+  }
+
+  TEST_F(MatrixOperatorOverloadTestSuite, VectorMatrixMultiplyTest) {
+    ASSERT_TRUE(Matrices::WithValues(3, {70, 80, 90}).Equals(
+        Matrices::WithValues(4, {1, 2, 3, 4}) * matrix));
+    AssertMultiplyNear(Matrices::Normal(1, 300, 3), Matrices::Normal(300, 101, 4));
+    AssertMultiplyNear(Matrices::Normal(1, 7, 3), Matrices::Normal(7, 3, 4));
+  }
+
+  TEST_F(MatrixOperatorOverloadTestSuite, VectorMultiplyTest_Fail) {
+    ASSERT_THROW(matrix * Matrix(4, 1), std::invalid_argument);
+    ASSERT_THROW(Matrix(1, 3) * matrix, std::invalid_argument);
+  }
+
+  TEST_F(MatrixOperatorOverloadTestSuite, TransposedMultiplyTest) {
+    // wider than a block of output columns, with an inner length not a multiple of the unroll
+    Matrix a = Matrices::Normal(45, 301, 1);
+    Matrix b = Matrices::Normal(301, 270, 2);
+    Matrix aTransp = a.Transpose();
+    Matrix bTransp = b.Transpose();
+    Matrix expected = NaiveMultiply(a, b);
+
+    AssertNear(expected, a * b);
+    AssertNear(expected, a * bTransp.Transposed());
+    AssertNear(expected, aTransp.Transposed() * b);
+    AssertNear(expected, aTransp.Transposed() * bTransp.Transposed());
+    AssertNear(NaiveMultiply(b.Transpose(), a.Transpose()), b.Transposed() * a.Transposed());
+
+    // vectors, and slices whose rows and columns are both strided, which are copied first
+    AssertNear(NaiveMultiply(a(Range(0, 1), Range()), b),
+        aTransp(Range(), Range(0, 1)).Transpose() * b);
+    AssertNear(NaiveMultiply(a, b(Range(), Range(7, 8))),
+        a * bTransp(Range(7, 8), Range()).Transpose());
+    Matrix wide = Matrices::Normal(90, 602, 3);
+    Matrix strided = wide(Range(0, 90, 2), Range(0, 602, 2));
+    AssertNear(NaiveMultiply(strided, b), wide(Range(0, 90, 2), Range(0, 602, 2)) * b);
+    AssertNear(NaiveMultiply(a, strided.Transpose()),
+        a * wide(Range(0, 90, 2), Range(0, 602, 2)).Transpose());
+
+    ASSERT_THROW(a.Transposed() * b, std::invalid_argument);
+  }
+
 } // math
 } // mdl
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <mdl/matrix.h>
+
+namespace mdl {
+namespace math {
+
+  namespace {
+    void AssertOptimizerNear(const Matrix& expected, const BaseMatrix& actual) {
+      ASSERT_EQ(expected.NumRows(), actual.NumRows());
+      ASSERT_EQ(expected.NumCols(), actual.NumCols());
+      for (size_t row = 0; row < expected.NumRows(); row++) {
+        for (size_t col = 0; col < expected.NumCols(); col++) {
+          float_t tolerance = 1e-5 * std::max<float_t>(1.0, std::abs(expected(row, col)));
+          ASSERT_NEAR(expected(row, col), actual(row, col), tolerance)
+              << "at (" << row << ", " << col << ")";
+        }
+      }
+    }
+  }
+
+  TEST(OptimizersTest, TestSGDMomentum) {
+    for (bool nesterov : {false, true}) {
+      SGDMomentum sgd{0.1, 0.9, 0.01, nesterov};
+      Matrix weights = Matrices::Normal(30, 40, 1);
+      Matrix velocity(30, 40);
+      Matrix expectedWeights = weights;
+      Matrix expectedVelocity(30, 40);
+
+      for (int step = 0; step < 3; step++) {
+        Matrix gradient = Matrices::Normal(30, 40, 2 + step);
+        Update(sgd, weights, gradient, velocity);
+
+        Matrix g = gradient + expectedWeights * 0.01;
+        expectedVelocity = expectedVelocity * 0.9 + g;
+        expectedWeights -= (nesterov ? g + expectedVelocity * 0.9 : expectedVelocity) * 0.1;
+      }
+      AssertOptimizerNear(expectedVelocity, velocity);
+      AssertOptimizerNear(expectedWeights, weights);
+    }
+  }
+
+  TEST(OptimizersTest, TestAdam) {
+    Adam adam{0.01, 0.9, 0.999, 1e-8, 0.1};
+    Matrix weights = Matrices::Normal(200, 300, 10);
+    Matrix moment1(200, 300);
+    Matrix moment2(200, 300);
+    Matrix expectedWeights = weights;
+    Matrix m(200, 300);
+    Matrix v(200, 300);
+
+    for (std::uint64_t step = 1; step <= 3; step++) {
+      Matrix gradient = Matrices::Normal(200, 300, 10 + step);
+      Update(adam, weights, gradient, moment1, moment2, step);
+
+      m = m * 0.9 + gradient * 0.1;
+      v = v * 0.999 + Prod(gradient, gradient) * 0.001;
+      Matrix mHat = m / (1.0 - std::pow(0.9, step));
+      Matrix vHat = v / (1.0 - std::pow(0.999, step));
+      expectedWeights = expectedWeights * (1.0 - 0.01 * 0.1)
+          - mHat / (Sqrt(vHat) + 1e-8) * 0.01;
+    }
+    AssertOptimizerNear(m, moment1);
+    AssertOptimizerNear(v, moment2);
+    AssertOptimizerNear(expectedWeights, weights);
+  }
+
+  TEST(OptimizersTest, TestRMSProp) {
+    RMSProp rmsProp{0.01, 0.9, 1e-8};
+    Matrix weights = Matrices::Normal(10, 20, 20);
+    Matrix meanSquare(10, 20);
+    Matrix expectedWeights = weights;
+    Matrix s(10, 20);
+
+    for (int step = 0; step < 3; step++) {
+      Matrix gradient = Matrices::Normal(10, 20, 21 + step);
+      Update(rmsProp, weights, gradient, meanSquare);
+
+      s = s * 0.9 + Prod(gradient, gradient) * 0.1;
+      expectedWeights -= gradient / (Sqrt(s) + 1e-8) * 0.01;
+    }
+    AssertOptimizerNear(s, meanSquare);
+    AssertOptimizerNear(expectedWeights, weights);
+  }
+
+  TEST(OptimizersTest, TestSlicesAndArenas) {
+    // rows 2 to 5 of every matrix, which are contiguous
+    Matrix weights = Matrices::Normal(8, 5, 30);
+    Matrix gradient = Matrices::Normal(8, 5, 31);
+    Matrix velocity(8, 5);
+    Matrix expected = weights;
+    auto weightRows = weights(Range(2, 6), RightRange(0));
+    auto velocityRows = velocity(Range(2, 6), RightRange(0));
+    Update(SGDMomentum{0.5}, weightRows, gradient(Range(2, 6), RightRange(0)), velocityRows);
+    for (size_t row = 2; row < 6; row++) {
+      for (size_t col = 0; col < 5; col++) {
+        expected(row, col) -= 0.5 * gradient(row, col);
+      }
+    }
+    AssertOptimizerNear(expected, weights);
+
+    // a whole model at once, through the packed views
+    ParameterArena params({{3, 4}, {1, 4}});
+    ParameterArena gradients({{3, 4}, {1, 4}});
+    ParameterArena state({{3, 4}, {1, 4}});
+    gradients.Packed() += 1.0;
+    Update(RMSProp{0.1, 0.0, 0.0}, params.Packed(), gradients.Packed(), state.Packed());
+    AssertOptimizerNear(Matrices::Default(1, 4, -0.1), params[1]);
+    AssertOptimizerNear(Matrices::Default(3, 4, 1.0), state[0]);
+  }
+
+  TEST(OptimizersTest, TestInvalid) {
+    Matrix weights(4, 5);
+    Matrix gradient(4, 5);
+    Matrix state1(4, 5);
+    Matrix state2(4, 5);
+    ASSERT_THROW(Update(SGDMomentum{0.1}, weights, Matrix(5, 4), state1), std::invalid_argument);
+    Matrix column(4, 1);
+    ASSERT_THROW(Update(RMSProp{}, weights, gradient, column), std::invalid_argument);
+    ASSERT_THROW(Update(Adam{}, weights, gradient, state1, state2, 0), std::invalid_argument);
+    ASSERT_THROW(Update(Adam{}, weights, gradient, state1, state1, 1), std::invalid_argument);
+    ASSERT_THROW(Update(RMSProp{}, weights, gradient, weights), std::invalid_argument);
+
+    // columns 1 to 3 skip cells between rows
+    auto weightCols = weights(RightRange(0), Range(1, 4));
+    auto stateCols = state1(RightRange(0), Range(1, 4));
+    ASSERT_THROW(Update(RMSProp{}, weightCols, gradient(RightRange(0), Range(1, 4)), stateCols),
+        std::invalid_argument);
+  }
+
+} // math
+} // mdl
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <mdl/matrix.h>
+
+namespace mdl {
+namespace math {
+
+  TEST(ParameterArenaTest, TestShapes) {
+    ParameterArena arena({{3, 3}, {2, 2}, {1, 1}});
+    ASSERT_EQ(3, arena.NumMatrices());
+    ASSERT_EQ(14, arena.NumCells());
+    ASSERT_EQ(1, arena.Packed().NumRows());
+    ASSERT_EQ(14, arena.Packed().NumCols());
+    ASSERT_EQ(2, arena[1].NumRows());
+    ASSERT_EQ(2, arena[1].NumCols());
+    ASSERT_TRUE(arena.Packed().Equals(Matrix(1, 14)));
+  }
+
+  TEST(ParameterArenaTest, TestAliasing) {
+    std::vector<Matrix> matrices;
+    matrices.push_back(Matrices::Sequence(3, 3, Range(1)));
+    matrices.push_back(Matrices::Sequence(2, 2, Range(10)));
+    matrices.push_back(Matrices::Sequence(1, 1, Range(14)));
+
+    ParameterArena arena(matrices);
+    // same layout as Pack()
+    ASSERT_TRUE(arena.Packed().Equals(Pack(matrices)));
+    ASSERT_TRUE(arena[1].Equals(matrices[1]));
+
+    // writes through the packed view show in the matrices, and vice versa
+    arena.Packed() += 1.0;
+    ASSERT_TRUE(arena[0].Equals(matrices[0] + 1.0));
+    ASSERT_TRUE(arena[2].Equals(matrices[2] + 1.0));
+    arena[1] *= 2.0;
+    arena[2](0, 0) = -1.0;
+    ASSERT_EQ(22, arena.Packed()(0, 9));
+    ASSERT_EQ(28, arena.Packed()(0, 12));
+    ASSERT_EQ(-1, arena.Packed()(0, 13));
+
+    // copying the arena's inputs is the only copy
+    matrices[0](0, 0) = 100.0;
+    ASSERT_EQ(2, arena[0](0, 0));
+
+    MemoryLayout packed, view;
+    arena.Packed().GetLayout(packed);
+    arena[1].GetLayout(view);
+    ASSERT_EQ(packed.data + 9, view.data);
+  }
+
+  TEST(ParameterArenaTest, TestAdoptAndLoad) {
+    Matrix packed = Matrices::Sequence(1, 10, Range(0));
+    MemoryLayout before;
+    packed.GetLayout(before);
+
+    ParameterArena arena(std::move(packed), {{2, 3}, {4, 1}});
+    MemoryLayout after;
+    arena.Packed().GetLayout(after);
+    ASSERT_EQ(before.data, after.data);
+    ASSERT_TRUE(arena[1].Equals(Matrices::Sequence(4, 1, Range(6))));
+
+    arena.Load(Matrices::Sequence(1, 10, Range(20)));
+    ASSERT_TRUE(arena[0].Equals(Matrices::Sequence(2, 3, Range(20))));
+    ASSERT_TRUE(arena[1].Equals(Matrices::Sequence(4, 1, Range(26))));
+
+    // moving the arena keeps its views attached to the buffer
+    ParameterArena moved(std::move(arena));
+    moved[0] -= 20.0;
+    ASSERT_TRUE(moved.Packed().Equals(Matrices::Sequence(1, 10, Range(0)) + 20.0
+        - Matrices::WithValues(10, {20, 20, 20, 20, 20, 20, 0, 0, 0, 0})));
+  }
+
+  TEST(ParameterArenaTest, TestInvalid) {
+    ASSERT_THROW(ParameterArena(Matrix(1, 10), {{2, 3}}), std::invalid_argument);
+    ASSERT_THROW(ParameterArena(Matrix(2, 3), {{2, 3}}), std::invalid_argument);
+    ParameterArena arena({{2, 3}});
+    ASSERT_THROW(arena.Load(Matrix(1, 5)), std::invalid_argument);
+    ASSERT_THROW(arena.Load(Matrix(2, 3)), std::invalid_argument);
+  }
+
+} // math
+} // mdl
@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include <mdl/matrix.h>
+#include "../../lib/h/random.h"
+
+namespace mdl {
+namespace math {
+
+  namespace {
+    float_t CellMean(const Matrix& matrix) {
+      double sum = 0.0;
+      for (size_t row = 0; row < matrix.NumRows(); row++) {
+        for (size_t col = 0; col < matrix.NumCols(); col++) {
+          sum += matrix(row, col);
+        }
+      }
+      return sum / matrix.NumCells();
+    }
+
+    float_t CellStdDev(const Matrix& matrix) {
+      double mean = CellMean(matrix);
+      double sum = 0.0;
+      for (size_t row = 0; row < matrix.NumRows(); row++) {
+        for (size_t col = 0; col < matrix.NumCols(); col++) {
+          sum += (matrix(row, col) - mean) * (matrix(row, col) - mean);
+        }
+      }
+      return std::sqrt(sum / matrix.NumCells());
+    }
+  }
+
+  TEST(RandomTest, TestPhiloxKnownAnswers) {
+    // Known answer vectors from the Random123 distribution (kat_vectors, philox4x32 10 rounds).
+    Philox::block_t result = Philox(0)(Philox::block_t{0, 0, 0, 0});
+    ASSERT_EQ(0x6627e8d5u, result[0]);
+    ASSERT_EQ(0xe169c58du, result[1]);
+    ASSERT_EQ(0xbc57ac4cu, result[2]);
+    ASSERT_EQ(0x9b00dbd8u, result[3]);
+
+    result = Philox(0xffffffffffffffffull)(
+        Philox::block_t{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff});
+    ASSERT_EQ(0x408f276du, result[0]);
+    ASSERT_EQ(0x41c83b0eu, result[1]);
+    ASSERT_EQ(0xa20bc7c6u, result[2]);
+    ASSERT_EQ(0x6d5451fdu, result[3]);
+  }
+
+  TEST(RandomTest, TestFillMatchesSingleBlocks) {
+    Philox philox(1234);
+    const int count = 21;
+    std::uint32_t bits[4 * count];
+    philox.Fill(100, count, 7, bits);
+
+    for (int i = 0; i < count; i++) {
+      Philox::block_t expected = philox(Philox::block_t{100u + i, 0, 0, 7});
+      for (int lane = 0; lane < 4; lane++) {
+        ASSERT_EQ(expected[lane], bits[lane * count + i]);
+      }
+    }
+  }
+
+  TEST(RandomTest, TestUniformRange) {
+    Philox philox(42);
+    for (std::uint64_t i = 0; i < 10000; i++) {
+      float_t value = philox.Uniform(i);
+      ASSERT_LE(0.0, value);
+      ASSERT_GT(1.0, value);
+    }
+    ASSERT_EQ(0.0, Philox::ToUniform(0));
+    ASSERT_GT(1.0, Philox::ToUniform(0xffffffff));
+    ASSERT_LT(0.0, Philox::ToOpenUniform(0));
+    ASSERT_EQ(1.0, Philox::ToOpenUniform(0xffffffff));
+  }
+
+  TEST(RandomTest, TestSameSeedSameValues) {
+    ASSERT_TRUE(Matrices::Uniform(50, 37, 99).Equals(Matrices::Uniform(50, 37, 99)));
+    ASSERT_TRUE(Matrices::Normal(50, 37, 99).Equals(Matrices::Normal(50, 37, 99)));
+    ASSERT_FALSE(Matrices::Uniform(50, 37, 99).Equals(Matrices::Uniform(50, 37, 100)));
+  }
+
+  TEST(RandomTest, TestMatricesAreSeekable) {
+    // Each cell must be the index-th draw of the sequence, regardless of which thread filled it.
+    Philox philox(2023);
+    Matrix uniform = Matrices::Uniform(33, 71, 2023);
+    Matrix normal = Matrices::Normal(33, 71, 2023);
+    Matrix truncated = Matrices::TruncatedNormal(33, 71, 2023);
+
+    for (size_t row = 0; row < uniform.NumRows(); row++) {
+      for (size_t col = 0; col < uniform.NumCols(); col++) {
+        std::uint64_t index = row * uniform.NumCols() + col;
+        ASSERT_EQ(philox.Uniform(index), uniform(row, col));
+        ASSERT_EQ(philox.Normal(index), normal(row, col));
+        ASSERT_EQ(philox.TruncatedNormal(index), truncated(row, col));
+      }
+    }
+  }
+
+  TEST(RandomTest, TestSameSequenceForAnyShape) {
+    Matrix wide = Matrices::Normal(1, 120, 5);
+    Matrix tall = Matrices::Normal(120, 1, 5);
+    for (size_t i = 0; i < 120; i++) {
+      ASSERT_EQ(wide(0, i), tall(i, 0));
+    }
+  }
+
+  TEST(RandomTest, TestUniformDistribution) {
+    Matrix matrix = Matrices::Uniform(200, 300, 7, -2.0, 4.0);
+    for (size_t row = 0; row < matrix.NumRows(); row++) {
+      for (size_t col = 0; col < matrix.NumCols(); col++) {
+        ASSERT_LE(-2.0, matrix(row, col));
+        ASSERT_GT(4.0, matrix(row, col));
+      }
+    }
+    ASSERT_NEAR(1.0, CellMean(matrix), 0.05);
+    ASSERT_NEAR(6.0 / std::sqrt(12.0), CellStdDev(matrix), 0.05);
+  }
+
+  TEST(RandomTest, TestNormalDistribution) {
+    Matrix matrix = Matrices::Normal(200, 300, 7, 3.0, 2.0);
+    ASSERT_NEAR(3.0, CellMean(matrix), 0.05);
+    ASSERT_NEAR(2.0, CellStdDev(matrix), 0.05);
+  }
+
+  TEST(RandomTest, TestTruncatedNormalDistribution) {
+    Matrix matrix = Matrices::TruncatedNormal(200, 300, 7, 1.0, 0.5);
+    for (size_t row = 0; row < matrix.NumRows(); row++) {
+      for (size_t col = 0; col < matrix.NumCols(); col++) {
+        ASSERT_LE(0.0, matrix(row, col));
+        ASSERT_GE(2.0, matrix(row, col));
+      }
+    }
+    ASSERT_NEAR(1.0, CellMean(matrix), 0.05);
+    // standard deviation of a standard normal truncated at +-2 is ~0.88
+    ASSERT_NEAR(0.5 * 0.88, CellStdDev(matrix), 0.02);
+  }
+
+  TEST(RandomTest, TestBernoulli) {
+    Matrix mask = Matrices::Bernoulli(200, 300, 11, 0.8);
+    for (size_t row = 0; row < mask.NumRows(); row++) {
+      for (size_t col = 0; col < mask.NumCols(); col++) {
+        ASSERT_TRUE(mask(row, col) == 0.0 || mask(row, col) == 1.0);
+      }
+    }
+    ASSERT_NEAR(0.8, CellMean(mask), 0.01);
+  }
+
+  TEST(RandomTest, TestInitializers) {
+    Matrix xavier = Matrices::XavierUniform(400, 200, 3);
+    float_t limit = std::sqrt(6.0 / 600);
+    for (size_t row = 0; row < xavier.NumRows(); row++) {
+      for (size_t col = 0; col < xavier.NumCols(); col++) {
+        ASSERT_GE(limit, std::abs(xavier(row, col)));
+      }
+    }
+    ASSERT_NEAR(std::sqrt(2.0 / 600), CellStdDev(Matrices::XavierNormal(400, 200, 3)), 0.002);
+    ASSERT_NEAR(limit / std::sqrt(3.0), CellStdDev(xavier), 0.002);
+    ASSERT_NEAR(std::sqrt(2.0 / 400), CellStdDev(Matrices::HeNormal(400, 200, 3)), 0.002);
+    ASSERT_NEAR(std::sqrt(2.0 / 400), CellStdDev(Matrices::HeUniform(400, 200, 3)), 0.002);
+  }
+
+  TEST(RandomTest, TestEmpty) {
+    Matrix matrix = Matrices::Normal(0, 0, 1);
+    ASSERT_EQ(0, matrix.NumRows());
+    ASSERT_EQ(0, matrix.NumCols());
+  }
+} // math
+} // mdl
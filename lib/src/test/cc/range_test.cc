@@ -523,5 +523,45 @@ namespace math {
     ASSERT_EQ(6, newRange5.Get(1));
   }
 
+  TEST(RangeTest, TestIndexRange) {
+    IndexRange range({4, 0, 4, 2});
+    ASSERT_EQ(4, range.Length());
+    ASSERT_EQ(4, range.Get(0));
+    ASSERT_EQ(2, range.Get(3));
+
+    ASSERT_EQ(4, range.FitToBounds(5).Length());
+    ASSERT_THROW(range.FitToBounds(4), std::invalid_argument);
+    ASSERT_THROW(IndexRange({-1}).FitToBounds(4), std::invalid_argument);
+  }
+
+  TEST(RangeTest, TestFitAndCompose_IndexRange) {
+    IndexRange indices({3, 1, 1});
+    ASSERT_EQ(std::vector<size_t>({3, 1, 1}),
+        Ranges::FitAndCompose(LeftRange(5), indices).GetIndices());
+    ASSERT_EQ(std::vector<size_t>({5, 3, 3}),
+        Ranges::FitAndCompose(RightRange(2).FitToBounds(7), indices).GetIndices());
+    ASSERT_EQ(std::vector<size_t>({7, 3, 3}),
+        Ranges::FitAndCompose(Range(1, 9, 2), indices).GetIndices());
+    ASSERT_EQ(std::vector<size_t>({4, 8, 8}),
+        Ranges::FitAndCompose(Range(10, 0, -2), indices).GetIndices());
+    ASSERT_EQ(std::vector<size_t>({2, 2, 2}),
+        Ranges::FitAndCompose(UnitRange(2), IndexRange({0, 0, 0})).GetIndices());
+    ASSERT_THROW(Ranges::FitAndCompose(UnitRange(2), IndexRange({0, 1})), std::invalid_argument);
+    ASSERT_THROW(Ranges::FitAndCompose(UnitRange(-1), IndexRange({0})), std::invalid_argument);
+    ASSERT_THROW(Ranges::FitAndCompose(LeftRange(3), indices), std::invalid_argument);
+
+    IndexRange current({9, 7, 5, 3});
+    ASSERT_EQ(std::vector<size_t>({9, 7}),
+        Ranges::FitAndCompose(current, LeftRange(2)).GetIndices());
+    ASSERT_EQ(std::vector<size_t>({5, 3}),
+        Ranges::FitAndCompose(current, RightRange(2)).GetIndices());
+    ASSERT_EQ(std::vector<size_t>({3, 7}),
+        Ranges::FitAndCompose(current, Range(10, -1, -2)).GetIndices());
+    ASSERT_EQ(std::vector<size_t>({3, 7, 7}),
+        Ranges::FitAndCompose(current, indices).GetIndices());
+    ASSERT_EQ(5, Ranges::FitAndCompose(current, UnitRange(2)).Get(0));
+    ASSERT_EQ(0, Ranges::FitAndCompose(current, UnitRange(4)).Length());
+  }
+
 } // math
 } // mdl
@@ -244,5 +244,112 @@ namespace math {
     }
   }
 
+  TEST_F(SliceTestSuite, TestGetLayout) {
+    MemoryLayout layout;
+    ASSERT_TRUE(slice.GetLayout(layout));
+    ASSERT_EQ(&matrix(1, 1), layout.data);
+    ASSERT_EQ(3, layout.rowStride);
+    ASSERT_EQ(1, layout.colStride);
+
+    ASSERT_TRUE(matrix(Range(3, -1, -1), Range(0, 3, 2)).Transpose().GetLayout(layout));
+    ASSERT_EQ(&matrix(3, 0), layout.data);
+    ASSERT_EQ(2, layout.rowStride);
+    ASSERT_EQ(-3, layout.colStride);
+  }
+
+  TEST_F(SliceTestSuite, TestLayoutOverlaps) {
+    MemoryLayout left, right, top, bottom, everything;
+    matrix(RightRange(0), Range(0, 1)).GetLayout(left);
+    matrix(RightRange(0), RightRange(1)).GetLayout(right);
+    matrix(Range(0, 2), RightRange(0)).GetLayout(top);
+    matrix(Range(2, 4), RightRange(0)).GetLayout(bottom);
+    matrix.GetLayout(everything);
+
+    ASSERT_FALSE(left.Overlaps(right, 4, 1));
+    ASSERT_FALSE(top.Overlaps(bottom, 2, 3));
+    ASSERT_TRUE(top.Overlaps(everything, 2, 3));
+    ASSERT_TRUE(everything.Overlaps(everything, 4, 3));
+
+    Matrix other(4, 3);
+    MemoryLayout otherLayout;
+    other.GetLayout(otherLayout);
+    ASSERT_FALSE(everything.Overlaps(otherLayout, 4, 3));
+  }
+
+  TEST_F(SliceTestSuite, TestDirectCopy_Large) {
+    Matrix source = Matrices::Sequence(300, 200, 60000);
+    Matrix destination(310, 200);
+
+    destination(Range(10, 310), RightRange(0)) = source;
+    ASSERT_TRUE(destination(RightRange(10), RightRange(0)).Equals(source));
+    ASSERT_TRUE(destination(Range(0, 10), RightRange(0)).Equals(Matrix(10, 200)));
+  }
+
+  TEST_F(SliceTestSuite, TestDirectCopy_Transposed) {
+    Matrix source = Matrices::Sequence(150, 170, 150 * 170);
+    Matrix destination(170, 150);
+
+    destination() = source().Transpose();
+    ASSERT_TRUE(destination.Equals(source.Transpose()));
+  }
+
+  TEST_F(SliceTestSuite, TestDirectCopy_Strided) {
+    Matrix source = Matrices::Sequence(200, 200, 200 * 200);
+    Matrix destination(100, 100);
+
+    destination() = source(Range(0, 200, 2), Range(199, -1, -2));
+    for (size_t row = 0; row < destination.NumRows(); row++) {
+      for (size_t col = 0; col < destination.NumCols(); col++) {
+        ASSERT_EQ(source(2 * row, 199 - 2 * col), destination(row, col));
+      }
+    }
+  }
+
+  TEST_F(SliceTestSuite, TestDirectCopy_SameMatrixDisjoint) {
+    Matrix m = Matrices::Sequence(4, 6, 24);
+    m(RightRange(0), Range(3, 6)) = m(RightRange(0), Range(0, 3));
+
+    for (size_t row = 0; row < m.NumRows(); row++) {
+      for (size_t col = 0; col < 3; col++) {
+        ASSERT_EQ(row * 6 + col, m(row, col));
+        ASSERT_EQ(row * 6 + col, m(row, col + 3));
+      }
+    }
+  }
+
+  TEST_F(SliceTestSuite, TestMaterializeSlice_Large) {
+    Matrix source = Matrices::Sequence(300, 200, 60000);
+    Matrix m = source(Range(1, 300, 3), Range(2, 200));
+
+    for (size_t row = 0; row < m.NumRows(); row++) {
+      for (size_t col = 0; col < m.NumCols(); col++) {
+        ASSERT_EQ(source(1 + 3 * row, 2 + col), m(row, col));
+      }
+    }
+  }
+
+  TEST_F(SliceTestSuite, TestIndexRange) {
+    auto rows = matrix(IndexRange({3, 0, 3}), Range(2, -1, -1));
+    MemoryLayout layout;
+    ASSERT_FALSE(rows.GetLayout(layout));
+    ASSERT_TRUE(Matrices::WithValues(3, {12, 11, 10, 3, 2, 1, 12, 11, 10}).Equals(Matrix(rows)));
+
+    // slices of slices, and columns
+    ASSERT_TRUE(Matrices::WithValues(2, {1, 3, 10, 12}).Equals(
+        Matrix(rows(Range(1, 3), IndexRange({2, 0})))));
+    ASSERT_TRUE(Matrices::WithValues(1, {5, 8}).Equals(
+        Matrix(slice(IndexRange({0, 1}), IndexRange({0})))));
+
+    // a single row, repeated
+    auto row = matrix(UnitRange(1), Range());
+    ASSERT_TRUE(Matrices::WithValues(3, {4, 5, 6, 4, 5, 6, 4, 5, 6}).Equals(
+        Matrix(row(IndexRange({0, 0, 0}), Range()))));
+    ASSERT_THROW(row(IndexRange({0, 1}), Range()), std::invalid_argument);
+
+    matrix(IndexRange({1, 2}), Range()) = Matrix(2, 3);
+    ASSERT_TRUE(Matrices::WithValues(3, {1, 2, 3, 0, 0, 0, 0, 0, 0, 10, 11, 12}).Equals(matrix));
+    ASSERT_THROW(matrix(IndexRange({4}), Range()), std::invalid_argument);
+  }
+
 } // math
-} // mdl
\ No newline at end of file
+} // mdl
@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include <mdl/matrix.h>
+#include "../../lib/h/operation.h"
+#include "../../lib/h/singlethread/matrix_impl.h"
+#include "../../lib/h/multithread/matrix_impl.h"
+
+namespace mdl {
+namespace math {
+namespace stats {
+
+  const OpStats* Find(const std::vector<OpStats>& snapshot, const char* op, Backend backend) {
+    for (const OpStats& stats : snapshot) {
+      if (stats.op == op && stats.backend == backend) {
+        return &stats;
+      }
+    }
+    return nullptr;
+  }
+
+  class StatsTest : public ::testing::Test {
+    protected:
+      void SetUp() override {
+        SetEnabled(true);
+        Reset();
+      }
+
+      void TearDown() override {
+        SetEnabled(true);
+      }
+  };
+
+  TEST_F(StatsTest, TestShapeClass) {
+    ASSERT_EQ(0, ShapeClass(1));
+    ASSERT_EQ(1, ShapeClass(2));
+    ASSERT_EQ(2, ShapeClass(3));
+    ASSERT_EQ(2, ShapeClass(4));
+    ASSERT_EQ(7, ShapeClass(100));
+    ASSERT_EQ(kShapeClasses - 1, ShapeClass(kMaxSizeT));
+  }
+
+  TEST_F(StatsTest, TestMultiply) {
+    Matrix m1(30, 20);
+    Matrix m2(20, 10);
+    Matrix result = m1 * m2;
+    result = m1 * m2;
+
+    std::vector<OpStats> snapshot = Snapshot();
+    const OpStats* stats = Find(snapshot, "Multiply", Backend::kMultiThread);
+    ASSERT_NE(nullptr, stats);
+    ASSERT_EQ(32, stats->rows);
+    ASSERT_EQ(16, stats->cols);
+    ASSERT_EQ(2, stats->calls);
+    ASSERT_EQ(2 * 300, stats->elements);
+    ASSERT_EQ(2 * 2 * 300 * 20, stats->flops);
+    ASSERT_EQ(2 * (600 + 200 + 300) * sizeof(float_t), stats->bytes);
+  }
+
+  TEST_F(StatsTest, TestBackendsAndBuckets) {
+    Matrix m1(4, 4);
+    Matrix m2(100, 3);
+    singlethread::MatrixImpl::Transpose(m1);
+    singlethread::MatrixImpl::Transpose(m2);
+    m1.Transpose();
+
+    std::vector<OpStats> snapshot = Snapshot();
+    int buckets = 0;
+    for (const OpStats& stats : snapshot) {
+      if (stats.op == "Transpose" && stats.backend == Backend::kSingleThread) {
+        buckets++;
+        ASSERT_EQ(1, stats.calls);
+        ASSERT_EQ(0, stats.flops);
+      }
+    }
+    ASSERT_EQ(2, buckets);
+    ASSERT_NE(nullptr, Find(snapshot, "Transpose", Backend::kMultiThread));
+  }
+
+  TEST_F(StatsTest, TestScalarBroadcastNotCountedTwice) {
+    Matrix m1(5, 5);
+    Matrix scalar(1, 1);
+    multithread::MatrixImpl::Operate<op::Addition>(m1, scalar);
+
+    std::vector<OpStats> snapshot = Snapshot();
+    ASSERT_EQ(nullptr, Find(snapshot, "Operate<Addition>", Backend::kMultiThread));
+    const OpStats* stats = Find(snapshot, "ScalarOperate<Addition>", Backend::kMultiThread);
+    ASSERT_NE(nullptr, stats);
+    ASSERT_EQ(1, stats->calls);
+    ASSERT_EQ(25, stats->elements);
+  }
+
+  TEST_F(StatsTest, TestOperationsCountedApart) {
+    Matrix m(4, 4);
+    multithread::MatrixImpl::UnaryOperate<op::Exp>(m);
+    multithread::MatrixImpl::UnaryOperate<op::Exp>(m);
+    multithread::MatrixImpl::UnaryOperate<op::Sqrt>(m);
+    multithread::MatrixImpl::Operate<op::Addition>(m, m);
+    multithread::MatrixImpl::Operate<op::Multiplication>(m, m);
+    multithread::MatrixImpl::RowReduce<op::Max>(m);
+
+    std::vector<OpStats> snapshot = Snapshot();
+    const OpStats* exp = Find(snapshot, "UnaryOperate<Exp>", Backend::kMultiThread);
+    const OpStats* sqrt = Find(snapshot, "UnaryOperate<Sqrt>", Backend::kMultiThread);
+    ASSERT_NE(nullptr, exp);
+    ASSERT_NE(nullptr, sqrt);
+    ASSERT_EQ(2, exp->calls);
+    ASSERT_EQ(1, sqrt->calls);
+    ASSERT_NE(nullptr, Find(snapshot, "Operate<Addition>", Backend::kMultiThread));
+    ASSERT_NE(nullptr, Find(snapshot, "Operate<Multiplication>", Backend::kMultiThread));
+    ASSERT_NE(nullptr, Find(snapshot, "RowReduce<Max>", Backend::kMultiThread));
+    ASSERT_EQ(nullptr, Find(snapshot, "UnaryOperate", Backend::kMultiThread));
+  }
+
+  TEST_F(StatsTest, TestResetAndDisable) {
+    Matrix m(3, 3);
+    m.Transpose();
+    ASSERT_FALSE(Snapshot().empty());
+
+    Reset();
+    ASSERT_TRUE(Snapshot().empty());
+
+    SetEnabled(false);
+    m.Transpose();
+    ASSERT_TRUE(Snapshot().empty());
+  }
+
+  TEST_F(StatsTest, TestDump) {
+    std::vector<OpStats> snapshot({
+        OpStats{"Multiply", Backend::kMultiThread, 32, 16, 2, 600, 24000, 8800, 1000},
+        OpStats{"Transpose", Backend::kMetal, 1, 2, 1, 2, 0, 16, 10}});
+
+    std::ostringstream json;
+    DumpJson(json, snapshot);
+    ASSERT_EQ(
+        "[{\"op\":\"Multiply\",\"backend\":\"multithread\",\"rows\":32,\"cols\":16,\"calls\":2,"
+        "\"elements\":600,\"flops\":24000,\"bytes\":8800,\"nanos\":1000},"
+        "{\"op\":\"Transpose\",\"backend\":\"metal\",\"rows\":1,\"cols\":2,\"calls\":1,"
+        "\"elements\":2,\"flops\":0,\"bytes\":16,\"nanos\":10}]",
+        json.str());
+
+    std::ostringstream text;
+    Dump(text, snapshot);
+    std::string str = text.str();
+    ASSERT_NE(std::string::npos, str.find("Multiply"));
+    ASSERT_NE(std::string::npos, str.find("<=32x16"));
+    ASSERT_NE(std::string::npos, str.find("24.000"));
+    ASSERT_NE(std::string::npos, str.find("metal"));
+  }
+
+} // stats
+} // math
+} // mdl